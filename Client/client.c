@@ -2,28 +2,306 @@
 
 #include "client.h"
 
+connection_state_t connection = {.sockfd = -1, .mutex = PTHREAD_MUTEX_INITIALIZER};
+
+// Parties en cours, mises à jour par le thread récepteur et lues avant d'envoyer un coup
+tracked_game_t tracked_games[MAX_TRACKED_GAMES];
+int tracked_count = 0;
+pthread_mutex_t tracked_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Une ligne de contrôle commence par l'un de ces préfixes
+static int control_prefix_length(const char *data, int length) {
+    const char *prefixes[] = {PING_MESSAGE, SESSION_MESSAGE, BOARD_MESSAGE, END_MESSAGE, DISPLAY_MESSAGE};
+    for (int i = 0; i < (int)(sizeof(prefixes) / sizeof(prefixes[0])); i++) {
+        int prefix_length = strlen(prefixes[i]);
+        int compared = length < prefix_length ? length : prefix_length;
+        if (memcmp(data, prefixes[i], compared) == 0) {
+            return compared;
+        }
+    }
+    return -1;
+}
+
+static int has_prefix(const char *line, int length, const char *prefix) {
+    int prefix_length = strlen(prefix);
+    return length >= prefix_length && memcmp(line, prefix, prefix_length) == 0;
+}
+
+// Index de la partie dans le suivi, -1 si elle n'y est pas (tracked_mutex tenu)
+static int find_tracked_game(int game_id) {
+    for (int i = 0; i < tracked_count; i++) {
+        if (tracked_games[i].game_id == game_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void forget_tracked_game(int game_id) {
+    pthread_mutex_lock(&tracked_mutex);
+    int index = find_tracked_game(game_id);
+    if (index >= 0) {
+        tracked_games[index] = tracked_games[--tracked_count];
+    }
+    pthread_mutex_unlock(&tracked_mutex);
+}
+
+static void forget_all_tracked_games() {
+    pthread_mutex_lock(&tracked_mutex);
+    tracked_count = 0;
+    pthread_mutex_unlock(&tracked_mutex);
+}
+
+// Lire "@PLATEAU <partie> <version> <variante> <trous> <trait> <score> <score adverse> <adversaire> <trous>...", 0 si la ligne est invalide
+static int parse_board_line(const char *line, tracked_game_t *game) {
+    int consumed = 0;
+    if (sscanf(line, BOARD_MESSAGE "%d %d %15s %d %d %d %d %31s%n", &game->game_id, &game->version, game->variant, &game->pits, &game->my_turn,
+               &game->own_score, &game->other_score, game->opponent, &consumed) != 8) {
+        return 0;
+    }
+    if (game->pits <= 0 || game->pits > MAX_PITS) {
+        return 0;
+    }
+
+    const char *cursor = line + consumed;
+    for (int i = 0; i < 2 * game->pits; i++) {
+        char *end;
+        long seeds = strtol(cursor, &end, 10);
+        if (end == cursor) {
+            return 0;
+        }
+        if (i < game->pits) {
+            game->own[i] = seeds;
+        } else {
+            game->other[i - game->pits] = seeds;
+        }
+        cursor = end;
+    }
+    return 1;
+}
+
+// Dessiner le plateau comme le serveur le fait en affichage complet : camp adverse en haut, de droite à gauche
+static void render_board(const tracked_game_t *game) {
+    char border[8 + MAX_PITS * 6];
+    int length = snprintf(border, sizeof(border), "   +");
+    for (int i = 0; i < game->pits; i++) {
+        length += snprintf(border + length, sizeof(border) - length, "-----+");
+    }
+
+    printf("\n" YELLOW "[Partie %d | %s | v%d] Adversaire (%s) : %d points\n\n" RESET, game->game_id, game->variant, game->version, game->opponent,
+           game->other_score);
+    printf("%s\n   |", border);
+    for (int i = game->pits - 1; i >= 0; i--) {
+        printf(" %3d |", game->other[i]);
+    }
+    printf("\n%s\n   |", border);
+    for (int i = 0; i < game->pits; i++) {
+        printf(" %3d |", game->own[i]);
+    }
+    printf("\n%s\n ", border);
+    for (int i = 0; i < game->pits; i++) {
+        printf("   [%d]", i);
+    }
+    printf("\n\n" CYAN "Toi : %d points%s\n" RESET, game->own_score, game->my_turn ? " (à toi de jouer)" : "");
+}
+
+// Mettre à jour la partie décrite par une ligne @PLATEAU et la dessiner
+static void handle_board_line(const char *data, int length) {
+    char line[CONTROL_LINE_SIZE];
+    tracked_game_t game;
+
+    memcpy(line, data, length);
+    line[length] = '\0';
+    if (!parse_board_line(line, &game)) {
+        return;
+    }
+
+    pthread_mutex_lock(&tracked_mutex);
+    int index = find_tracked_game(game.game_id);
+    if (index < 0 && tracked_count < MAX_TRACKED_GAMES) {
+        index = tracked_count++;
+    }
+    if (index >= 0) {
+        tracked_games[index] = game;
+    }
+    pthread_mutex_unlock(&tracked_mutex);
+
+    render_board(&game);
+}
+
+// Traiter une ligne de contrôle complète (sans le retour à la ligne)
+static void handle_control_line(int sockfd, const char *line, int length) {
+    int session_length = strlen(SESSION_MESSAGE);
+    int ping_length = strlen(PING_MESSAGE) - 1; // Sans le retour à la ligne
+    if (length == ping_length && strncmp(line, PING_MESSAGE, ping_length) == 0) {
+        send(sockfd, PONG_MESSAGE, strlen(PONG_MESSAGE), MSG_NOSIGNAL);
+    } else if (has_prefix(line, length, SESSION_MESSAGE)) {
+        if (length > session_length && length - session_length < SESSION_TOKEN_SIZE) {
+            memcpy(connection.session_token, line + session_length, length - session_length);
+            connection.session_token[length - session_length] = '\0';
+        }
+        // Nouvelle session ou reprise : le serveur renvoie l'état des parties reprises
+        send(sockfd, DISPLAY_COMMAND, strlen(DISPLAY_COMMAND), MSG_NOSIGNAL);
+    } else if (has_prefix(line, length, BOARD_MESSAGE)) {
+        handle_board_line(line, length);
+    } else if (has_prefix(line, length, END_MESSAGE)) {
+        forget_tracked_game(atoi(line + strlen(END_MESSAGE)));
+    }
+}
+
+// Vérifier un coup sur le dernier plateau reçu, retourne 0 s'il est refusé sans être envoyé
+static int check_move(const char *command) {
+    int game_id, pit;
+    char extra;
+    if (sscanf(command, "/play %d %d %c", &game_id, &pit, &extra) != 2) {
+        return 1; // Pas un coup : le serveur répond
+    }
+
+    pthread_mutex_lock(&tracked_mutex);
+    int index = find_tracked_game(game_id);
+    tracked_game_t game;
+    if (index >= 0) {
+        game = tracked_games[index];
+    }
+    pthread_mutex_unlock(&tracked_mutex);
+
+    // Partie inconnue ou règle propre à la variante (obligation de nourrir) : le serveur tranche
+    if (index < 0) {
+        return 1;
+    }
+    if (!game.my_turn) {
+        printf(RED "Ce n'est pas votre tour de jouer dans la partie %d.\n" RESET, game_id);
+    } else if (pit < 0 || pit >= game.pits) {
+        printf(RED "Entrée invalide. Veuillez entrer un nombre entre 0 et %d.\n" RESET, game.pits - 1);
+    } else if (game.own[pit] == 0) {
+        printf(RED "Le trou %d est vide. Essayez à nouveau.\n" RESET, pit);
+    } else {
+        return 1;
+    }
+    fflush(stdout);
+    return 0;
+}
+
+// Retirer les lignes de contrôle du flux et les traiter, retourne le nombre d'octets restant à afficher dans output
+int filter_control_lines(int sockfd, control_filter_t *filter, const char *data, int length, char *output) {
+    char work[BUFFER_SIZE + CONTROL_LINE_SIZE];
+    int work_length = filter->pending_length;
+    int output_length = 0;
+
+    memcpy(work, filter->pending, filter->pending_length);
+    memcpy(work + work_length, data, length);
+    work_length += length;
+    filter->pending_length = 0;
+
+    int pos = 0;
+    while (pos < work_length) {
+        if (filter->at_line_start && !filter->in_escape && work[pos] == '@') {
+            int remaining = work_length - pos;
+            char *newline = memchr(work + pos, '\n', remaining);
+            int line_length = newline != NULL ? newline - (work + pos) : remaining;
+            if (control_prefix_length(work + pos, line_length + (newline != NULL)) >= 0) {
+                if (newline != NULL) {
+                    // Ce qui précède est affiché d'abord : un plateau dessiné ici garde sa place dans le flux
+                    fwrite(output, 1, output_length, stdout);
+                    output_length = 0;
+                    handle_control_line(sockfd, work + pos, line_length);
+                    pos += line_length + 1;
+                    continue;
+                }
+                if (remaining < CONTROL_LINE_SIZE) {
+                    // Ligne de contrôle coupée : on attend la suite avant d'afficher
+                    memcpy(filter->pending, work + pos, remaining);
+                    filter->pending_length = remaining;
+                    break;
+                }
+            }
+        }
+        // Les messages finissent par "\n" suivi du code de fin de couleur : une ligne de contrôle peut suivre ce code
+        char c = work[pos];
+        output[output_length++] = c;
+        if (c == '\x1b') {
+            filter->in_escape = 1;
+        } else if (filter->in_escape) {
+            filter->in_escape = (c != 'm');
+        } else {
+            filter->at_line_start = (c == '\n');
+        }
+        pos++;
+    }
+    return output_length;
+}
+
+// Reprendre la session sur une nouvelle connexion après une coupure, retourne le nouveau socket ou -1
+static int reconnect() {
+    char buffer[BUFFER_SIZE];
+
+    for (int attempt = 1; attempt <= RECONNECT_ATTEMPTS; attempt++) {
+        printf("\nConnexion perdue, reprise de la session (essai %d/%d)...\n", attempt, RECONNECT_ATTEMPTS);
+        fflush(stdout);
+        if (attempt > 1) {
+            sleep(1);
+        }
+
+        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0) {
+            continue;
+        }
+        if (connect(sockfd, (struct sockaddr *)&connection.server_addr, sizeof(connection.server_addr)) < 0) {
+            close(sockfd);
+            continue;
+        }
+
+        // Un seul message : le serveur retrouve le joueur et ses parties à partir du jeton
+        snprintf(buffer, sizeof(buffer), RESUME_COMMAND "%s\n", connection.session_token);
+        if (send(sockfd, buffer, strlen(buffer), MSG_NOSIGNAL) < 0) {
+            close(sockfd);
+            continue;
+        }
+
+        pthread_mutex_lock(&connection.mutex);
+        close(connection.sockfd);
+        connection.sockfd = sockfd;
+        pthread_mutex_unlock(&connection.mutex);
+        return sockfd;
+    }
+    return -1;
+}
+
 // Fonction pour recevoir les messages du serveur
 void *receiver_thread(void *args) {
-    receiver_args_t *r_args = (receiver_args_t *)args;
-    int sockfd = r_args->sockfd;
+    int sockfd = connection.sockfd;
     char buffer[BUFFER_SIZE];
+    char output[BUFFER_SIZE + CONTROL_LINE_SIZE];
     int bytes_received;
+    control_filter_t filter = {.pending_length = 0, .at_line_start = 1, .in_escape = 0};
 
     while (1) {
         memset(buffer, 0, sizeof(buffer));
         bytes_received = recv(sockfd, buffer, sizeof(buffer) - 1, 0);
         if (bytes_received > 0) {
-            buffer[bytes_received] = '\0';
-            printf("%s", buffer);
+            int output_length = filter_control_lines(sockfd, &filter, buffer, bytes_received, output);
+            fwrite(output, 1, output_length, stdout);
             fflush(stdout);
-        } else if (bytes_received == 0) {
+            continue;
+        }
+
+        pthread_mutex_lock(&connection.mutex);
+        int quitting = connection.quitting;
+        pthread_mutex_unlock(&connection.mutex);
+
+        // Coupure réseau : reprendre la session si le serveur nous a donné un jeton
+        if (!quitting && connection.session_token[0] != '\0' && (sockfd = reconnect()) >= 0) {
+            filter = (control_filter_t){.pending_length = 0, .at_line_start = 1, .in_escape = 0};
+            continue;
+        }
+
+        if (bytes_received == 0 || quitting) {
             printf("\nDéconnecté du serveur.\n");
             fflush(stdout);
             exit(EXIT_SUCCESS);
-        } else {
-            perror("Erreur lors de la réception des données");
-            exit(EXIT_FAILURE);
         }
+        perror("Erreur lors de la réception des données");
+        exit(EXIT_FAILURE);
     }
 
     return NULL;
@@ -34,7 +312,6 @@ int main(int argc, char *argv[]) {
     struct sockaddr_in server_addr;
     char buffer[BUFFER_SIZE];
     pthread_t recv_thread;
-    receiver_args_t r_args;
 
     if (argc != 3) {
         fprintf(stderr, "Usage: %s <Adresse_IP_Serveur> <Port>\n", argv[0]);
@@ -83,9 +360,10 @@ int main(int argc, char *argv[]) {
     // Envoyer le pseudo au serveur
     send(sockfd, buffer, strlen(buffer), 0);
 
-    // Initialiser les arguments pour le thread récepteur
-    r_args.sockfd = sockfd;
-    if (pthread_create(&recv_thread, NULL, receiver_thread, (void *)&r_args) != 0) {
+    // Le thread récepteur reprend la connexion après une coupure
+    connection.sockfd = sockfd;
+    connection.server_addr = server_addr;
+    if (pthread_create(&recv_thread, NULL, receiver_thread, NULL) != 0) {
         perror("Erreur lors de la création du thread récepteur");
         close(sockfd);
         exit(EXIT_FAILURE);
@@ -99,20 +377,38 @@ int main(int argc, char *argv[]) {
             break;
         }
 
-        // Envoyer la commande au serveur
-        if (send(sockfd, buffer, strlen(buffer), 0) < 0) {
-            perror("Erreur lors de l'envoi des données");
-            break;
+        // Les coups impossibles sur le dernier plateau reçu ne font pas l'aller-retour
+        if (!check_move(buffer)) {
+            continue;
+        }
+
+        // Un autre mode d'affichage ne nous enverra plus l'état des parties
+        if (strncmp(buffer, "/affichage", 10) == 0 && strstr(buffer, "client") == NULL) {
+            forget_all_tracked_games();
+        }
+
+        // Si l'utilisateur souhaite quitter, la fermeture de la connexion par le serveur est attendue
+        int quitting = strncmp(buffer, "/quit", 5) == 0;
+
+        // Envoyer la commande au serveur, sur la connexion courante (elle change après une reprise de session)
+        pthread_mutex_lock(&connection.mutex);
+        connection.quitting = quitting;
+        int sent = send(connection.sockfd, buffer, strlen(buffer), MSG_NOSIGNAL);
+        pthread_mutex_unlock(&connection.mutex);
+        if (sent < 0) {
+            printf("Message non envoyé : connexion perdue, reprise en cours.\n");
+            continue;
         }
 
-        // Si l'utilisateur souhaite quitter, fermer le socket et terminer
-        if (strncmp(buffer, "/quit", 5) == 0) {
+        if (quitting) {
             printf("Déconnexion...\n");
             break;
         }
     }
 
     // Fermer le socket
-    close(sockfd);
+    pthread_mutex_lock(&connection.mutex);
+    close(connection.sockfd);
+    pthread_mutex_unlock(&connection.mutex);
     return 0;
 }
@@ -12,10 +12,56 @@
 
 // Constants
 #define BUFFER_SIZE 1024
+#define PING_MESSAGE "@PING\n" // Battement de cœur du serveur, jamais affiché
+#define PONG_MESSAGE "/pong\n"
+#define SESSION_MESSAGE "@SESSION " // Jeton de session envoyé par le serveur, jamais affiché
+#define RESUME_COMMAND "RESUME "
+#define SESSION_TOKEN_SIZE 64
+#define BOARD_MESSAGE "@PLATEAU " // État d'une partie, dessiné par le client
+#define END_MESSAGE "@FIN " // Partie terminée, retirée du suivi
+#define DISPLAY_MESSAGE "@AFFICHAGE " // Confirmation du mode d'affichage, jamais affichée
+#define DISPLAY_COMMAND "/affichage client\n" // Demandé à chaque ouverture de session
+#define CONTROL_LINE_SIZE 256 // Longueur maximale d'une ligne de contrôle (@PING, @SESSION, @PLATEAU...)
+#define RECONNECT_ATTEMPTS 5 // Essais de reprise de session après une coupure, une seconde d'écart
+#define MAX_TRACKED_GAMES 32 // Parties suivies pour l'affichage et la vérification des coups
+#define MAX_PITS 6 // Plus grand nombre de trous par joueur parmi les variantes
+
+// Couleurs des plateaux, les mêmes que celles du serveur
+#define RESET "\x1b[0m"
+#define YELLOW "\x1b[33m"
+#define CYAN "\x1b[36m"
+#define RED "\x1b[31m"
 
 // Structures
+// Connexion au serveur, partagée par le thread principal (envois) et le thread récepteur (reconnexion)
 typedef struct {
     int sockfd;
-} receiver_args_t;
+    struct sockaddr_in server_addr;
+    char session_token[SESSION_TOKEN_SIZE]; // Dernier jeton reçu, vide avant la connexion
+    int quitting; // /quit envoyé : la fermeture par le serveur est attendue
+    pthread_mutex_t mutex;
+} connection_state_t;
+
+// Dernier état connu d'une partie, vu depuis notre camp
+typedef struct {
+    int game_id;
+    int version;
+    char variant[16];
+    int pits;
+    int my_turn;
+    int own_score;
+    int other_score;
+    char opponent[32];
+    int own[MAX_PITS]; // Nos trous, numérotés comme pour /play
+    int other[MAX_PITS]; // Trous adverses, dans la numérotation de l'adversaire
+} tracked_game_t;
+
+// Filtrage des lignes de contrôle (@PING, @SESSION) dans le flux reçu
+typedef struct {
+    char pending[CONTROL_LINE_SIZE]; // Début d'une ligne de contrôle coupée entre deux recv
+    int pending_length;
+    int at_line_start;
+    int in_escape; // Dans un code couleur, qui ne change pas le début de ligne
+} control_filter_t;
 
 #endif
\ No newline at end of file
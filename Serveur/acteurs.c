@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "acteurs.h"
+#include "travailleurs.h"
+
+void actor_init(actor_t *actor, actor_handler_t handler, actor_release_t release, int affinity)
+{
+    actor->stub.next = NULL;
+    actor->head = &actor->stub;
+    actor->tail = &actor->stub;
+    actor->pending = 0;
+    actor->handler = handler;
+    actor->release = release;
+    actor->affinity = affinity;
+}
+
+static void mailbox_push(actor_t *actor, actor_message_t *message)
+{
+    __atomic_store_n(&message->next, NULL, __ATOMIC_RELAXED);
+    actor_message_t *previous = __atomic_exchange_n(&actor->head, message, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&previous->next, message, __ATOMIC_RELEASE);
+}
+
+/*
+    Retirer le plus ancien message. Retourne NULL si la file est vide, ou si un producteur a échangé
+    head sans avoir encore chaîné son message : il sera visible au prochain essai.
+*/
+static actor_message_t *mailbox_pop(actor_t *actor)
+{
+    actor_message_t *tail = actor->tail;
+    actor_message_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    // Le message vide ne sert qu'à ne jamais laisser la file sans élément
+    if (tail == &actor->stub)
+    {
+        if (next == NULL)
+        {
+            return NULL;
+        }
+        actor->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next != NULL)
+    {
+        actor->tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&actor->head, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    // Dernier message : remettre le message vide derrière lui avant de le retirer
+    mailbox_push(actor, &actor->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL)
+    {
+        actor->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/*
+    Traiter au plus budget messages (0 : sans limite). Retourne 1 s'il en reste, l'acteur doit alors
+    être reprogrammé ; 0 sinon, et l'acteur ne doit plus être touché : il a pu être libéré.
+*/
+static int run_actor(actor_t *actor, int budget)
+{
+    for (int done = 0; budget == 0 || done < budget; ++done)
+    {
+        actor_message_t *message;
+        while ((message = mailbox_pop(actor)) == NULL)
+        {
+            // pending garantit que le message arrive : son producteur est en train de le chaîner
+            sched_yield();
+        }
+
+        actor->handler(actor, message);
+        int left = __atomic_sub_fetch(&actor->pending, 1, __ATOMIC_ACQ_REL);
+        // Tant qu'il reste des messages, chacun garde une référence sur l'acteur
+        actor->release(actor);
+        if (left == 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+    Tâche de la réserve : traiter un lot de messages, puis se soumettre à nouveau s'il en reste
+*/
+static void run_actor_task(void *arg)
+{
+    actor_t *actor = (actor_t *)arg;
+    if (run_actor(actor, ACTOR_BATCH))
+    {
+        pool_submit(run_actor_task, actor, actor->affinity);
+    }
+}
+
+/*
+    Poster un message, qui porte une référence sur l'acteur prise par l'appelant
+*/
+void actor_post(actor_t *actor, actor_message_t *message)
+{
+    mailbox_push(actor, message);
+    if (__atomic_fetch_add(&actor->pending, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return; // L'acteur est déjà soumis ou en cours de traitement
+    }
+
+    if (pool_started())
+    {
+        pool_submit(run_actor_task, actor, actor->affinity);
+    }
+    else
+    {
+        run_actor(actor, 0);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef ACTEURS_H
+#define ACTEURS_H
+
+/*
+    Acteurs : un objet (une partie) dont les messages sont traités un par un, dans l'ordre d'arrivée,
+    par le travailleur qui le prend en charge, sans verrou sur l'état de l'objet.
+    La boîte aux lettres est une file sans verrou à plusieurs producteurs et un seul consommateur.
+    pending compte les messages postés et pas encore traités : le producteur qui le fait passer de 0 à 1
+    soumet l'acteur à la réserve de travailleurs, si bien qu'un seul travailleur traite l'acteur à la fois.
+    Un acteur est toujours soumis au même travailleur (affinité), qui peut se le faire voler s'il est occupé.
+    Un acteur très sollicité rend la main après ACTOR_BATCH messages et ne bloque pas les autres.
+    Tant que la réserve n'est pas lancée (simulation), les messages sont traités tout de suite
+    par le thread qui poste.
+*/
+
+// Constants
+#define ACTOR_BATCH 32 // Messages traités d'affilée avant de repasser derrière les autres tâches du travailleur
+
+// Structures
+typedef struct actor_message_t actor_message_t;
+struct actor_message_t
+{
+    actor_message_t *next;
+};
+
+typedef struct actor_t actor_t;
+
+// Le gestionnaire libère le message
+typedef void (*actor_handler_t)(actor_t *actor, actor_message_t *message);
+// Chaque message posté porte une référence sur l'acteur, rendue après son traitement : l'acteur peut être libéré ici
+typedef void (*actor_release_t)(actor_t *actor);
+
+struct actor_t
+{
+    actor_message_t *head; // Dernier message posté, échangé par les producteurs
+    actor_message_t *tail; // Prochain message à traiter, lu par le seul travailleur en cours
+    actor_message_t stub;
+    int pending;
+    actor_handler_t handler;
+    actor_release_t release;
+    int affinity; // Travailleur préféré
+};
+
+// Prototypes
+void actor_init(actor_t *actor, actor_handler_t handler, actor_release_t release, int affinity);
+void actor_post(actor_t *actor, actor_message_t *message);
+
+#endif
@@ -0,0 +1,769 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "admin.h"
+#include "admission.h"
+
+// Réponse en cours d'écriture vers la console, envoyée par blocs de ADMIN_OUTPUT_SIZE octets
+typedef struct admin_output_t
+{
+    int fd;
+    int failed; // La console est partie : le reste de la réponse est ignoré
+    size_t length;
+    char data[ADMIN_OUTPUT_SIZE];
+} admin_output_t;
+
+static void flush_output(admin_output_t *out)
+{
+    size_t sent = 0;
+    while (!out->failed && sent < out->length)
+    {
+        ssize_t written = send(out->fd, out->data + sent, out->length - sent, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            out->failed = 1;
+            break;
+        }
+        sent += written;
+    }
+    out->length = 0;
+}
+
+// Compatible avec report_line_t pour réutiliser les rapports de /stats
+static void emit_line(void *ctx, const char *line)
+{
+    admin_output_t *out = (admin_output_t *)ctx;
+    size_t length = strlen(line);
+    if (out->length + length > sizeof(out->data))
+    {
+        flush_output(out);
+    }
+    if (length > sizeof(out->data))
+    {
+        length = sizeof(out->data);
+    }
+    memcpy(out->data + out->length, line, length);
+    out->length += length;
+}
+
+static void emit(admin_output_t *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void emit(admin_output_t *out, const char *format, ...)
+{
+    char line[BUFFER_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    emit_line(out, line);
+}
+
+// ********************************************************************************* //
+
+// Copies des listes
+
+/*
+    Copier l'état de tous les joueurs. players_mutex n'est tenu que pendant la copie.
+    Retourne le nombre de joueurs copiés (le tableau est à libérer), ou -1 faute de mémoire.
+*/
+int snapshot_players(admin_player_t **snapshot)
+{
+    LOCK(&players_mutex);
+    admin_player_t *copy = malloc(sizeof(admin_player_t) * (player_count > 0 ? player_count : 1));
+    if (copy == NULL)
+    {
+        UNLOCK(&players_mutex);
+        *snapshot = NULL;
+        return -1;
+    }
+
+    int count = player_count;
+    for (int i = 0; i < count; ++i)
+    {
+        player_t *p = players[i];
+        admin_player_t *entry = &copy[i];
+        LOCK(&p->player_mutex);
+        memcpy(entry->pseudo, p->pseudo, sizeof(entry->pseudo));
+        entry->connected = p->connected;
+        entry->connection_id = p->connection_id;
+        entry->game_count = p->game_count;
+        entry->wins = p->wins;
+        entry->losses = p->losses;
+        entry->draws = p->draws;
+        entry->last_seen = __atomic_load_n(&p->last_seen, __ATOMIC_RELAXED);
+        UNLOCK(&p->player_mutex);
+    }
+    UNLOCK(&players_mutex);
+
+    *snapshot = copy;
+    return count;
+}
+
+// Réponse attendue des acteurs des parties interrogées par la console
+typedef struct admin_reply_t admin_reply_t;
+
+typedef struct admin_call_t
+{
+    admin_reply_t *reply;
+    game_t *game;
+    int index;
+} admin_call_t;
+
+struct admin_reply_t
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+    int remaining; // Parties qui n'ont pas encore répondu
+    int refs;      // La console et chaque message posté : une partie peut répondre après l'abandon de l'attente
+    int result;
+    admin_game_t *entries;
+    admin_call_t calls[];
+};
+
+enum
+{
+    ADMIN_GAME_ENDED,
+    ADMIN_GAME_FINISHED, // Terminée avant que le message soit traité
+    ADMIN_GAME_WAITING
+};
+
+static admin_reply_t *new_reply(int count)
+{
+    admin_reply_t *reply = malloc(sizeof(admin_reply_t) + sizeof(admin_call_t) * count);
+    if (reply == NULL)
+    {
+        return NULL;
+    }
+    reply->entries = calloc(count > 0 ? count : 1, sizeof(admin_game_t));
+    if (reply->entries == NULL)
+    {
+        free(reply);
+        return NULL;
+    }
+    pthread_mutex_init(&reply->mutex, NULL);
+    pthread_cond_init(&reply->done, NULL);
+    reply->remaining = count;
+    reply->refs = count + 1;
+    reply->result = ADMIN_GAME_FINISHED;
+    return reply;
+}
+
+/*
+    Rendre une référence sur la réponse, answered si elle vient d'une partie (ou d'un message non posté)
+*/
+static void release_reply(admin_reply_t *reply, int answered)
+{
+    LOCK(&reply->mutex);
+    if (answered && --reply->remaining == 0)
+    {
+        pthread_cond_signal(&reply->done);
+    }
+    int last = --reply->refs == 0;
+    UNLOCK(&reply->mutex);
+
+    if (last)
+    {
+        pthread_mutex_destroy(&reply->mutex);
+        pthread_cond_destroy(&reply->done);
+        free(reply->entries);
+        free(reply);
+    }
+}
+
+/*
+    Attendre la réponse de toutes les parties, au plus ADMIN_REPLY_MS (reply->mutex verrouillé au retour)
+*/
+static void wait_reply(admin_reply_t *reply)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ADMIN_REPLY_MS / 1000;
+    deadline.tv_nsec += (ADMIN_REPLY_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    LOCK(&reply->mutex);
+    while (reply->remaining > 0)
+    {
+        if (pthread_cond_timedwait(&reply->done, &reply->mutex, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+}
+
+/*
+    Copier l'état d'une partie (acteur de la partie)
+*/
+static void copy_game_state(game_t *game, void *data)
+{
+    admin_call_t *call = (admin_call_t *)data;
+    admin_reply_t *reply = call->reply;
+
+    LOCK(&reply->mutex);
+    if (!game->game_over)
+    {
+        admin_game_t *entry = &reply->entries[call->index];
+        entry->player1_score = game->player1_score;
+        entry->player2_score = game->player2_score;
+        entry->turn = game->turn;
+        entry->board_version = game->board_version;
+        entry->position_hash = game->positions.hash;
+        entry->waiting_reconnect = game->waiting_reconnect;
+        memcpy(entry->board, game->board, sizeof(entry->board));
+        entry->board_copied = 1;
+    }
+    UNLOCK(&reply->mutex);
+    release_reply(reply, 1);
+}
+
+/*
+    Copier l'état de toutes les parties. La liste est prise sous games_mutex ; l'état de chaque partie
+    est copié par son acteur, entre deux coups. Une partie qui ne répond pas dans les ADMIN_REPLY_MS
+    est copiée sans son plateau.
+*/
+int snapshot_games(admin_game_t **snapshot)
+{
+    LOCK(&games_mutex);
+    int count = game_count;
+    admin_reply_t *reply = new_reply(count);
+    if (reply == NULL)
+    {
+        UNLOCK(&games_mutex);
+        *snapshot = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        game_t *game = games[i];
+        admin_game_t *entry = &reply->entries[i];
+        entry->game_id = game->game_id;
+        entry->variant = game->variant;
+        entry->tournament_id = game->tournament_id;
+        memcpy(entry->player1, game->player1->pseudo, sizeof(entry->player1));
+        memcpy(entry->player2, game->player2->pseudo, sizeof(entry->player2));
+
+        game_retain(game);
+        reply->calls[i].reply = reply;
+        reply->calls[i].game = game;
+        reply->calls[i].index = i;
+    }
+    UNLOCK(&games_mutex);
+
+    // Poster sans verrou : sans travailleurs, l'acteur répond tout de suite
+    for (int i = 0; i < count; ++i)
+    {
+        if (post_game_call(reply->calls[i].game, copy_game_state, &reply->calls[i]) < 0)
+        {
+            release_reply(reply, 1);
+        }
+    }
+
+    admin_game_t *copy = malloc(sizeof(admin_game_t) * (count > 0 ? count : 1));
+    wait_reply(reply);
+    if (copy != NULL)
+    {
+        memcpy(copy, reply->entries, sizeof(admin_game_t) * count);
+    }
+    UNLOCK(&reply->mutex);
+    release_reply(reply, 0);
+
+    *snapshot = copy;
+    return copy != NULL ? count : -1;
+}
+
+// ********************************************************************************* //
+
+// Commandes de la console
+
+static void list_players(admin_output_t *out)
+{
+    admin_player_t *snapshot;
+    int count = snapshot_players(&snapshot);
+    if (count < 0)
+    {
+        emit(out, "erreur : mémoire insuffisante\n");
+        return;
+    }
+
+    time_t now = time(NULL);
+    emit(out, "%d joueurs\n", count);
+    for (int i = 0; i < count; ++i)
+    {
+        admin_player_t *p = &snapshot[i];
+        emit(out, "%s %s connexion=%d parties=%d V=%d D=%d N=%d inactif=%lds\n", p->pseudo, p->connected ? "connecté" : "absent",
+             p->connection_id, p->game_count, p->wins, p->losses, p->draws, (long)(now - p->last_seen));
+    }
+    free(snapshot);
+}
+
+static void emit_row(admin_output_t *out, const char *pseudo, const int board[], int pits)
+{
+    char line[BUFFER_SIZE];
+    int length = snprintf(line, sizeof(line), "  %s :", pseudo);
+    for (int i = 0; i < pits && length < (int)sizeof(line); ++i)
+    {
+        length += snprintf(line + length, sizeof(line) - length, " %d", board[i]);
+    }
+    if (length < (int)sizeof(line))
+    {
+        snprintf(line + length, sizeof(line) - length, "\n");
+    }
+    emit_line(out, line);
+}
+
+static void list_games(admin_output_t *out)
+{
+    admin_game_t *snapshot;
+    int count = snapshot_games(&snapshot);
+    if (count < 0)
+    {
+        emit(out, "erreur : mémoire insuffisante\n");
+        return;
+    }
+
+    emit(out, "%d parties\n", count);
+    for (int i = 0; i < count; ++i)
+    {
+        admin_game_t *g = &snapshot[i];
+        if (!g->board_copied)
+        {
+            emit(out, "partie %d %s %s contre %s tournoi=%d (pas de réponse de la partie, plateau non copié)\n", g->game_id, g->variant->name, g->player1, g->player2,
+                 g->tournament_id);
+            continue;
+        }
+
+        emit(out, "partie %d %s %s contre %s score=%d-%d trait=%s v%d empreinte=%016llx tournoi=%d%s\n", g->game_id, g->variant->name, g->player1, g->player2,
+             g->player1_score, g->player2_score, g->turn == 0 ? g->player1 : g->player2, g->board_version, (unsigned long long)g->position_hash, g->tournament_id,
+             g->waiting_reconnect ? " (attente de reconnexion)" : "");
+        // Chaque camp dans le sens du semis, trou 0 en premier
+        emit_row(out, g->player1, g->board, g->variant->pits);
+        emit_row(out, g->player2, g->board + g->variant->pits, g->variant->pits);
+    }
+    free(snapshot);
+}
+
+/*
+    Couper la connexion d'un joueur et supprimer son jeton de session, pour que le client ne reprenne
+    pas la session aussitôt. Ses parties suivent l'attente de reconnexion habituelle.
+*/
+static void kick_player(admin_output_t *out, const char *pseudo)
+{
+    char buffer[BUFFER_SIZE];
+    int connected = 0;
+
+    LOCK(&players_mutex);
+    for (int i = 0; i < player_count; ++i)
+    {
+        player_t *p = players[i];
+        if (strcmp(p->pseudo, pseudo) != 0)
+        {
+            continue;
+        }
+
+        LOCK(&p->player_mutex);
+        connected = p->connected;
+        if (connected)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Vous avez été expulsé par un administrateur.\n" RESET);
+            send_to_player(p, buffer);
+            if (p->transport->shutdown != NULL)
+            {
+                p->transport->shutdown(p->sockfd, p->transport_ctx);
+            }
+        }
+        UNLOCK(&p->player_mutex);
+
+        // sessions_mutex se prend avant player_mutex
+        if (connected)
+        {
+            forget_session(p, 1);
+        }
+        break;
+    }
+    UNLOCK(&players_mutex);
+
+    if (connected)
+    {
+        JOURNAL(LOG_WARN, LOG_NONE, LOG_NONE, "Console : %s expulsé", pseudo);
+        emit(out, "%s expulsé\n", pseudo);
+    }
+    else
+    {
+        emit(out, "erreur : %s n'est pas connecté\n", pseudo);
+    }
+}
+
+/*
+    Arrêter une partie (acteur de la partie)
+*/
+static void end_game_call(game_t *game, void *data)
+{
+    char buffer[BUFFER_SIZE];
+    admin_call_t *call = (admin_call_t *)data;
+    int result = ADMIN_GAME_ENDED;
+
+    if (game->game_over)
+    {
+        result = ADMIN_GAME_FINISHED;
+    }
+    else if (game->waiting_reconnect)
+    {
+        // L'attente de reconnexion termine elle-même la partie
+        result = ADMIN_GAME_WAITING;
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "[Partie %d] Partie arrêtée par un administrateur.\n" RESET, game->game_id);
+        send_to_player(game->player1, buffer);
+        send_to_player(game->player2, buffer);
+        JOURNAL(LOG_WARN, LOG_NONE, game->game_id, "Console : partie arrêtée");
+        end_game(game);
+    }
+
+    LOCK(&call->reply->mutex);
+    call->reply->result = result;
+    UNLOCK(&call->reply->mutex);
+    release_reply(call->reply, 1);
+}
+
+/*
+    Arrêter une partie comme si elle était finie : chaque joueur marque les graines de son camp
+*/
+static void force_end_game(admin_output_t *out, int game_id)
+{
+    game_t *game = NULL;
+
+    // La partie est retenue sous games_mutex, puis arrêtée par son acteur
+    LOCK(&games_mutex);
+    for (int i = 0; i < game_count; ++i)
+    {
+        if (games[i]->game_id == game_id)
+        {
+            game = games[i];
+            game_retain(game);
+            break;
+        }
+    }
+    UNLOCK(&games_mutex);
+
+    if (game == NULL)
+    {
+        emit(out, "erreur : pas de partie %d\n", game_id);
+        return;
+    }
+
+    admin_reply_t *reply = new_reply(1);
+    if (reply == NULL)
+    {
+        game_release(game);
+        emit(out, "erreur : mémoire insuffisante\n");
+        return;
+    }
+    reply->calls[0].reply = reply;
+    reply->calls[0].game = game;
+    reply->calls[0].index = 0;
+    if (post_game_call(game, end_game_call, &reply->calls[0]) < 0)
+    {
+        release_reply(reply, 1);
+    }
+
+    wait_reply(reply);
+    int answered = reply->remaining == 0;
+    int result = reply->result;
+    UNLOCK(&reply->mutex);
+    release_reply(reply, 0);
+
+    if (!answered)
+    {
+        emit(out, "erreur : la partie %d n'a pas répondu, elle sera arrêtée dès que possible\n", game_id);
+    }
+    else if (result == ADMIN_GAME_FINISHED)
+    {
+        emit(out, "erreur : pas de partie %d\n", game_id);
+    }
+    else if (result == ADMIN_GAME_WAITING)
+    {
+        emit(out, "erreur : la partie %d attend la reconnexion d'un joueur\n", game_id);
+    }
+    else
+    {
+        emit(out, "partie %d terminée\n", game_id);
+    }
+}
+
+static void announce(admin_output_t *out, const char *message)
+{
+    char buffer[BUFFER_SIZE];
+    snprintf(buffer, sizeof(buffer), YELLOW "[Annonce] %s\n" RESET, message);
+    broadcast_to_all(buffer, NULL);
+    JOURNAL(LOG_INFO, LOG_NONE, LOG_NONE, "Console : annonce « %s »", message);
+    emit(out, "annonce envoyée\n");
+}
+
+static void show_stats(admin_output_t *out)
+{
+    admin_player_t *snapshot;
+    int count = snapshot_players(&snapshot);
+    int connected = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        connected += snapshot[i].connected;
+    }
+    free(snapshot);
+
+    LOCK(&games_mutex);
+    int games_running = game_count;
+    UNLOCK(&games_mutex);
+
+    unsigned long long written, dropped;
+    int threads;
+    journal_counters(&written, &dropped, &threads);
+
+    emit(out, "joueurs=%d connectés=%d parties=%d échéances=%d en attente=%d\n", count, connected, games_running, timer_pending(), admission_waiting());
+    emit(out, "journal : %llu enregistrements écrits, %llu perdus, %d tampons\n", written, dropped, threads);
+
+    account_counters_t accounts;
+    account_counters(&accounts);
+    emit(out, "comptes : %llu inscrits, %u compartiments, %u pages de débordement, %d en cache (%llu trouvés, %llu lus), %llu pages lues, %llu écrites\n",
+         accounts.accounts, accounts.buckets, accounts.overflow_pages, accounts.cached, accounts.hits, accounts.misses, accounts.page_reads,
+         accounts.page_writes);
+    buffer_pool_report(emit_line, out);
+    report_command_stats(emit_line, out);
+}
+
+/*
+    Afficher ou changer le taux d'échantillonnage des traces, ou les exporter au format de Chrome
+*/
+static void trace_command(admin_output_t *out, char *argument)
+{
+    char *value = argument + strcspn(argument, " ");
+    if (*value != '\0')
+    {
+        *value++ = '\0';
+        value += strspn(value, " ");
+    }
+
+    if (strcmp(argument, "taux") == 0 && *value != '\0')
+    {
+        trace_set_rate(atoi(value));
+    }
+    else if (strcmp(argument, "export") == 0)
+    {
+        const char *path = *value != '\0' ? value : TRACE_FILE;
+        int written = trace_export(path);
+        if (written < 0)
+        {
+            emit(out, "erreur : impossible d'écrire %s : %s\n", path, strerror(errno));
+            return;
+        }
+        emit(out, "%d intervalles écrits dans %s\n", written, path);
+        return;
+    }
+    else if (*argument != '\0')
+    {
+        emit(out, "erreur : utilisez trace [taux <une requête sur N, 0 pour arrêter>|export [fichier]]\n");
+        return;
+    }
+
+    int rate = trace_get_rate();
+    if (rate == 0)
+    {
+        emit(out, "traces désactivées, %lu intervalles enregistrés\n", trace_recorded());
+    }
+    else
+    {
+        emit(out, "une requête sur %d tracée, %lu intervalles enregistrés (%d conservés au plus)\n", rate, trace_recorded(), TRACE_RING_SIZE);
+    }
+}
+
+static void show_usage(admin_output_t *out)
+{
+    emit(out, "joueurs - Lister les joueurs\n"
+              "parties - Lister les parties avec leur plateau\n"
+              "expulser <pseudo> - Couper la connexion d'un joueur et supprimer sa session\n"
+              "annonce <message> - Envoyer un message à tous les joueurs connectés\n"
+              "terminer <numéro de partie> - Arrêter une partie, les graines restantes vont au camp qui les porte\n"
+              "stats - Compteurs du serveur et des commandes\n"
+              "trace [taux <N>|export [fichier]] - Échantillonnage des traces (une requête sur N, 0 pour arrêter) et export au format de Chrome\n"
+              "aide - Afficher cette aide\n");
+}
+
+static void run_command(admin_output_t *out, char *line)
+{
+    char *argument = line + strcspn(line, " ");
+    if (*argument != '\0')
+    {
+        *argument++ = '\0';
+        argument += strspn(argument, " ");
+    }
+
+    if (strcmp(line, "joueurs") == 0)
+    {
+        list_players(out);
+    }
+    else if (strcmp(line, "parties") == 0)
+    {
+        list_games(out);
+    }
+    else if (strcmp(line, "expulser") == 0 && *argument != '\0')
+    {
+        kick_player(out, argument);
+    }
+    else if (strcmp(line, "annonce") == 0 && *argument != '\0')
+    {
+        announce(out, argument);
+    }
+    else if (strcmp(line, "terminer") == 0 && *argument != '\0')
+    {
+        force_end_game(out, atoi(argument));
+    }
+    else if (strcmp(line, "stats") == 0)
+    {
+        show_stats(out);
+    }
+    else if (strcmp(line, "trace") == 0)
+    {
+        trace_command(out, argument);
+    }
+    else if (strcmp(line, "aide") == 0)
+    {
+        show_usage(out);
+    }
+    else
+    {
+        emit(out, "erreur : commande inconnue ou incomplète, tapez aide\n");
+    }
+}
+
+// ********************************************************************************* //
+
+// Socket de la console
+
+static void *admin_session(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    admin_output_t *out = malloc(sizeof(admin_output_t));
+    char data[ADMIN_LINE_SIZE];
+    size_t length = 0;
+
+    if (out == NULL)
+    {
+        close(fd);
+        return NULL;
+    }
+    out->fd = fd;
+    out->failed = 0;
+    out->length = 0;
+
+    while (!out->failed)
+    {
+        char *newline = memchr(data, '\n', length);
+        if (newline == NULL)
+        {
+            // Une ligne trop longue est coupée
+            if (length == sizeof(data))
+            {
+                newline = &data[length - 1];
+            }
+            else
+            {
+                ssize_t received = recv(fd, data + length, sizeof(data) - length, 0);
+                if (received <= 0)
+                {
+                    break;
+                }
+                length += received;
+                continue;
+            }
+        }
+
+        *newline = '\0';
+        size_t consumed = newline - data + 1;
+        data[strcspn(data, "\r")] = '\0';
+        if (data[0] != '\0')
+        {
+            run_command(out, data);
+            emit_line(out, ".\n");
+            flush_output(out);
+        }
+        memmove(data, data + consumed, length - consumed);
+        length -= consumed;
+    }
+
+    close(fd);
+    free(out);
+    return NULL;
+}
+
+static void *admin_listener(void *arg)
+{
+    int server_fd = (int)(intptr_t)arg;
+    while (1)
+    {
+        int fd = accept(server_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            JOURNAL(LOG_ERROR, LOG_NONE, LOG_NONE, "Console : erreur d'acceptation : %s", strerror(errno));
+            continue;
+        }
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, admin_session, (void *)(intptr_t)fd) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+/*
+    Ouvrir le socket de la console, lisible par le seul compte du serveur, et lancer son thread
+*/
+int admin_start(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("Socket de la console");
+        return -1;
+    }
+
+    // Socket laissé par une exécution précédente : le port TCP est déjà à nous, ce n'est donc pas un autre serveur
+    unlink(path);
+    mode_t mask = umask(0077);
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (bound < 0 || listen(fd, 4) < 0)
+    {
+        perror("Socket de la console");
+        close(fd);
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, admin_listener, (void *)(intptr_t)fd) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
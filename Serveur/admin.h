@@ -0,0 +1,55 @@
+#ifndef ADMIN_H
+#define ADMIN_H
+
+#include "serveur.h"
+
+/*
+    Console d'administration sur un socket Unix (ADMIN_SOCKET dans le dossier de lancement, accessible
+    au seul compte du serveur) : une commande par ligne, chaque réponse se termine par une ligne ".".
+    Les listes sont écrites depuis une copie prise sous players_mutex ou games_mutex : le verrou n'est
+    tenu que le temps de la copie, pas pendant l'écriture de milliers de lignes sur le socket.
+    L'état d'une partie n'a pas de verrou : il est copié ou modifié par un message à son acteur.
+*/
+
+// Constants
+#define ADMIN_SOCKET "admin.sock"
+#define ADMIN_LINE_SIZE 512
+#define ADMIN_OUTPUT_SIZE 8192 // Réponse envoyée par blocs de cette taille
+#define ADMIN_REPLY_MS 2000 // Attente maximale de la réponse des parties interrogées
+
+// Structures
+typedef struct admin_player_t
+{
+    char pseudo[32];
+    int connected;
+    int connection_id;
+    int game_count;
+    int wins;
+    int losses;
+    int draws;
+    time_t last_seen;
+} admin_player_t;
+
+typedef struct admin_game_t
+{
+    int game_id;
+    const variant_t *variant;
+    char player1[32];
+    char player2[32];
+    int player1_score;
+    int player2_score;
+    int turn;
+    int board_version;
+    uint64_t position_hash;
+    int tournament_id;
+    int waiting_reconnect;
+    int board_copied; // 0 si la partie n'a pas répondu à temps
+    int board[MAX_BOARD_SIZE];
+} admin_game_t;
+
+// Prototypes
+int admin_start(const char *path);
+int snapshot_players(admin_player_t **snapshot);
+int snapshot_games(admin_game_t **snapshot);
+
+#endif
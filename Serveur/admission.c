@@ -0,0 +1,301 @@
+// POLLRDHUP : fermeture de la connexion par le client en attente
+#define _GNU_SOURCE
+
+#include <poll.h>
+
+#include "admission.h"
+#include "tournoi.h"
+
+admission_entry_t *admission_head = NULL;
+int admission_count = 0;
+int admission_priority_count = 0; // Les prioritaires sont en tête de file
+int admission_slots = 0; // Places libérées depuis le dernier refus faute de place
+double admission_interval = 0; // Moyenne glissante des secondes entre deux admissions, 0 si inconnue
+time_t last_admission = 0;
+pthread_mutex_t admission_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t admission_cond;
+admission_callback_t admit_callback = NULL;
+admission_callback_t drop_callback = NULL;
+
+/*
+    Prévenir le joueur de sa position (à partir de 1) et de l'attente estimée
+*/
+static void send_position(admission_entry_t *entry, int position)
+{
+    char buffer[BUFFER_SIZE];
+    if (admission_interval > 0)
+    {
+        int wait = (int)(admission_interval * position + 0.5);
+        snprintf(buffer, sizeof(buffer), YELLOW "Le serveur est plein. Vous êtes %d%s dans la file d'attente, attente estimée : %d min %02d s.\n" RESET, position,
+                 position == 1 ? "er" : "e", wait / 60, wait % 60);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "Le serveur est plein. Vous êtes %d%s dans la file d'attente, vous serez admis dès qu'une place se libère.\n" RESET,
+                 position, position == 1 ? "er" : "e");
+    }
+    send_to_player(entry->player, buffer);
+    entry->last_notice = time(NULL);
+}
+
+/*
+    Mettre un joueur authentifié en attente d'une place. Retourne -1 si la file est pleine :
+    l'appelant garde alors la connexion.
+*/
+int admission_enqueue(player_t *player, void *ctx)
+{
+    admission_entry_t *entry = malloc(sizeof(admission_entry_t));
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    entry->player = player;
+    entry->ctx = ctx;
+    entry->priority = tournament_is_playing(player->pseudo);
+    entry->enqueued = time(NULL);
+    entry->next = NULL;
+
+    LOCK(&admission_mutex);
+    if (admit_callback == NULL || admission_count >= ADMISSION_MAX_QUEUE)
+    {
+        UNLOCK(&admission_mutex);
+        free(entry);
+        return -1;
+    }
+
+    // Après les prioritaires déjà en file s'il l'est, sinon en fin de file
+    int position = entry->priority ? admission_priority_count : admission_count;
+    admission_entry_t **link = &admission_head;
+    for (int i = 0; i < position; ++i)
+    {
+        link = &(*link)->next;
+    }
+    entry->next = *link;
+    *link = entry;
+    admission_count++;
+    admission_priority_count += entry->priority;
+
+    JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "%s en file d'attente (position %d%s)", player->pseudo, position + 1, entry->priority ? ", tournoi" : "");
+    send_position(entry, position + 1);
+    UNLOCK(&admission_mutex);
+    return 0;
+}
+
+/*
+    Une place s'est libérée (appelé sous players_mutex : ne fait que réveiller le thread d'admission).
+    La place est comptée même si la file est vide : un joueur refusé juste avant la libération et mis
+    en file juste après est admis au tick suivant.
+*/
+void admission_notify()
+{
+    LOCK(&admission_mutex);
+    admission_slots++;
+    if (admission_count > 0)
+    {
+        pthread_cond_signal(&admission_cond);
+    }
+    UNLOCK(&admission_mutex);
+}
+
+int admission_waiting()
+{
+    LOCK(&admission_mutex);
+    int count = admission_count;
+    UNLOCK(&admission_mutex);
+    return count;
+}
+
+static admission_entry_t *pop_head()
+{
+    admission_entry_t *entry = admission_head;
+    admission_head = entry->next;
+    admission_count--;
+    admission_priority_count -= entry->priority;
+    return entry;
+}
+
+/*
+    Remettre en tête un joueur qui n'a pas trouvé de place (admission_mutex verrouillé)
+*/
+static void push_head(admission_entry_t *entry)
+{
+    entry->next = admission_head;
+    admission_head = entry;
+    admission_count++;
+    admission_priority_count += entry->priority;
+}
+
+/*
+    Admettre les premiers de la file tant qu'il y a de la place
+*/
+static void admit_waiting()
+{
+    while (1)
+    {
+        LOCK(&admission_mutex);
+        if (admission_head == NULL)
+        {
+            // Les places restantes sont gardées pour les prochains en file
+            UNLOCK(&admission_mutex);
+            return;
+        }
+        admission_entry_t *entry = pop_head();
+        UNLOCK(&admission_mutex);
+
+        // Hors de admission_mutex : add_player_to_players prend players_mutex, qui réveille la file sous ce verrou
+        int result = add_player_to_players(entry->player);
+        if (result == -1)
+        {
+            LOCK(&admission_mutex);
+            push_head(entry);
+            admission_slots = 0;
+            UNLOCK(&admission_mutex);
+            return;
+        }
+
+        if (result == -2)
+        {
+            char buffer[BUFFER_SIZE];
+            snprintf(buffer, sizeof(buffer), RED "Ce pseudo est déjà utilisé en jeu. Veuillez réessayer plus tard.\n" RESET);
+            send_to_player(entry->player, buffer);
+            drop_callback(entry->player, entry->ctx);
+        }
+        else
+        {
+            time_t now = time(NULL);
+            LOCK(&admission_mutex);
+            if (last_admission != 0)
+            {
+                double interval = difftime(now, last_admission);
+                admission_interval = admission_interval > 0 ? 0.8 * admission_interval + 0.2 * interval : interval;
+            }
+            last_admission = now;
+            UNLOCK(&admission_mutex);
+
+            JOURNAL(LOG_INFO, entry->player->connection_id, LOG_NONE, "%s admis après %.0f s d'attente", entry->player->pseudo, difftime(now, entry->enqueued));
+            admit_callback(entry->player, entry->ctx);
+        }
+        free(entry);
+    }
+}
+
+/*
+    Retirer les connexions fermées pendant l'attente et rappeler leur position aux autres
+*/
+static void sweep_waiting()
+{
+    LOCK(&admission_mutex);
+    int count = admission_count;
+    if (count <= 0)
+    {
+        UNLOCK(&admission_mutex);
+        return;
+    }
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * count);
+    if (fds == NULL)
+    {
+        UNLOCK(&admission_mutex);
+        return;
+    }
+    admission_entry_t *entry = admission_head;
+    for (int i = 0; i < count; ++i, entry = entry->next)
+    {
+        fds[i].fd = entry->player->sockfd;
+        fds[i].events = POLLRDHUP;
+        fds[i].revents = 0;
+    }
+
+    // Sans attente : seules les connexions déjà fermées sont signalées
+    poll(fds, count, 0);
+
+    admission_entry_t *gone = NULL;
+    admission_entry_t **link = &admission_head;
+    time_t now = time(NULL);
+    int position = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        entry = *link;
+        if (fds[i].revents & (POLLRDHUP | POLLHUP | POLLERR))
+        {
+            *link = entry->next;
+            admission_count--;
+            admission_priority_count -= entry->priority;
+            entry->next = gone;
+            gone = entry;
+            continue;
+        }
+        position++;
+        if (now - entry->last_notice >= ADMISSION_NOTICE_INTERVAL)
+        {
+            send_position(entry, position);
+        }
+        link = &entry->next;
+    }
+    UNLOCK(&admission_mutex);
+    free(fds);
+
+    while (gone != NULL)
+    {
+        entry = gone;
+        gone = entry->next;
+        JOURNAL(LOG_INFO, entry->player->connection_id, LOG_NONE, "%s a quitté la file d'attente", entry->player->pseudo);
+        drop_callback(entry->player, entry->ctx);
+        free(entry);
+    }
+}
+
+static void *admission_thread(void *arg)
+{
+    while (1)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += ADMISSION_TICK_MS / 1000;
+        deadline.tv_nsec += (ADMISSION_TICK_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        LOCK(&admission_mutex);
+        // Rien à admettre sans place libérée ni joueur en file : attendre le tick
+        while (admission_slots == 0 || admission_head == NULL)
+        {
+            if (pthread_cond_timedwait(&admission_cond, &admission_mutex, &deadline) == ETIMEDOUT)
+            {
+                break;
+            }
+        }
+        UNLOCK(&admission_mutex);
+
+        sweep_waiting();
+        admit_waiting();
+    }
+    return NULL;
+}
+
+/*
+    Lancer le thread d'admission. Sans lui, un joueur refusé faute de place n'est pas mis en file.
+*/
+int admission_start(admission_callback_t admit, admission_callback_t drop)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&admission_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    LOCK(&admission_mutex);
+    admit_callback = admit;
+    drop_callback = drop;
+    UNLOCK(&admission_mutex);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, admission_thread, NULL) != 0)
+    {
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
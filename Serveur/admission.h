@@ -0,0 +1,41 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include "serveur.h"
+
+/*
+    File d'attente des joueurs authentifiés quand le serveur est plein, au lieu de les renvoyer.
+    Une connexion en attente n'a ni thread ni tampon, et ne prend jamais players_mutex : un seul thread
+    d'admission surveille toute la file, prévient chacun de sa position et de l'attente estimée, et admet
+    les joueurs dans l'ordre d'arrivée dès qu'une place se libère. Les participants d'un tournoi en cours,
+    dont les parties les attendent, passent devant les autres (un joueur qui revient dans une partie
+    en cours reprend sa place sans passer par la file).
+*/
+
+// Constants
+#define ADMISSION_MAX_QUEUE 1000 // Au-delà, le joueur est renvoyé comme avant
+#define ADMISSION_TICK_MS 1000 // Vérification des connexions en attente
+#define ADMISSION_NOTICE_INTERVAL 15 // Secondes entre deux rappels de la position
+
+// Démarrer le thread du joueur admis, ou libérer la connexion d'un joueur qui n'attend plus
+typedef void (*admission_callback_t)(player_t *player, void *ctx);
+
+// Structures
+typedef struct admission_entry_t admission_entry_t;
+struct admission_entry_t
+{
+    player_t *player;
+    void *ctx;
+    int priority;
+    time_t enqueued;
+    time_t last_notice;
+    admission_entry_t *next;
+};
+
+// Prototypes
+int admission_start(admission_callback_t admit, admission_callback_t drop);
+int admission_enqueue(player_t *player, void *ctx);
+void admission_notify();
+int admission_waiting();
+
+#endif
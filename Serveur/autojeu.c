@@ -0,0 +1,498 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "awale.h"
+#include "tablebase.h"
+
+/*
+    Autojeu : des parties jouées sans serveur ni réseau, avec les règles du serveur (awale.c : semis,
+    captures, fin de partie, position répétée et graines restantes), pour régler les robots et étudier l'équilibre des
+    variantes. Chaque camp suit une politique : aleatoire, glouton (la plus grosse capture) ou moteur
+    (table de finales si la position y est, sinon recherche alpha-bêta à MOTEUR_DEPTH demi-coups).
+    La table et la recherche comptent 0 une boucle sans fin, alors que la partie s'arrête à la première
+    position répétée avec partage des graines : le moteur ne joue pas exactement selon cette règle.
+
+    Les parties sont distribuées aux threads par lots de AUTOPLAY_BATCH : chaque thread joue ses parties
+    sans rien partager et remplit son propre tampon, écrit dans le fichier d'un bloc quand il est plein.
+    Le tirage d'une partie ne dépend que de la graine et de son numéro : le fichier contient les mêmes
+    parties quel que soit le nombre de threads (dans un ordre qui peut varier).
+
+    Fichier : un en-tête autoplay_header_t, puis pour chaque partie un autoplay_record_t suivi de ses
+    coups, un octet chacun (trou de 0 à pits - 1 dans la rangée du joueur au trait).
+
+    Usage : ./Serveur/autojeu [parties] [politique1:politique2] [threads] [fichier] [variante] [graine]
+*/
+
+#define DEFAULT_GAMES 100000
+#define DEFAULT_FILE "autojeu.bin"
+#define MAX_THREADS 64
+#define AUTOPLAY_MAGIC "AWALEAJ2"
+#define AUTOPLAY_BATCH 256 // Parties réservées à la fois par un thread
+#define AUTOPLAY_MAX_PLIES 1000 // Au-delà, une partie qui n'a répété aucune position est interrompue
+#define AUTOPLAY_FLUSH (1 << 20) // Taille du tampon d'un thread avant écriture
+#define MOTEUR_DEPTH 6
+
+// Résultat d'une partie
+#define RESULT_PLAYER1 0
+#define RESULT_PLAYER2 1
+#define RESULT_DRAW 2
+#define RESULT_UNFINISHED 3
+
+typedef struct autoplay_header_t
+{
+    char magic[8];
+    uint8_t variant; // Indice dans variants[]
+    uint8_t policies[2];
+    uint8_t reserved;
+    uint32_t max_plies;
+    uint64_t games;
+    uint64_t seed;
+} autoplay_header_t;
+
+typedef struct __attribute__((packed)) autoplay_record_t
+{
+    uint32_t game;     // Numéro de la partie, qui détermine ses tirages
+    uint8_t first;     // Joueur qui commence
+    uint8_t result;    // RESULT_*
+    uint8_t repeated;  // 1 si la partie s'est arrêtée sur une position répétée, comme sur le serveur
+    uint8_t scores[2]; // Graines capturées puis restantes (capturées seulement si la partie est interrompue)
+    uint16_t plies;    // Nombre de coups qui suivent
+} autoplay_record_t;
+
+// Générateur d'une partie (splitmix64)
+typedef struct rng_t
+{
+    unsigned long long state;
+} rng_t;
+
+typedef int (*policy_t)(const int board[], int player_id, rng_t *rng);
+
+typedef struct policy_entry_t
+{
+    const char *name;
+    policy_t choose;
+} policy_entry_t;
+
+// Compteurs d'un thread, sur leur propre ligne de cache
+typedef struct __attribute__((aligned(64))) worker_t
+{
+    pthread_t thread;
+    unsigned long long games;
+    unsigned long long plies;
+    unsigned long long results[4];
+    unsigned long long repeated;
+    double seconds;
+    unsigned char *buffer;
+    size_t length;
+} worker_t;
+
+static const variant_t *variant = NULL;
+static policy_t policies[2];
+static int policy_ids[2];
+static unsigned long long game_total = DEFAULT_GAMES;
+static unsigned long long next_game = 0;
+static unsigned long long seed = 1;
+static tablebase_t table;
+static int table_loaded = 0;
+static FILE *output = NULL;
+static pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int next_random(rng_t *rng)
+{
+    unsigned long long z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((z ^ (z >> 31)) >> 32);
+}
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// ********************************************************************************* //
+// ********************************** Politiques *********************************** //
+// ********************************************************************************* //
+
+/*
+    Un coup valide au hasard
+*/
+static int choose_random(const int board[], int player_id, rng_t *rng)
+{
+    int start = player_id * variant->pits;
+    int chosen = -1, count = 0;
+    for (int pit = start; pit < start + variant->pits; ++pit)
+    {
+        int copy[MAX_BOARD_SIZE];
+        memcpy(copy, board, sizeof(copy));
+        if (variant->play(copy, player_id, pit) >= 0 && next_random(rng) % ++count == 0)
+        {
+            chosen = pit;
+        }
+    }
+    return chosen;
+}
+
+/*
+    La plus grosse capture immédiate, au hasard entre les coups qui capturent autant
+*/
+static int choose_greedy(const int board[], int player_id, rng_t *rng)
+{
+    int start = player_id * variant->pits;
+    int chosen = -1, best = -1, count = 0;
+    for (int pit = start; pit < start + variant->pits; ++pit)
+    {
+        int copy[MAX_BOARD_SIZE];
+        memcpy(copy, board, sizeof(copy));
+        int captured = variant->play(copy, player_id, pit);
+        if (captured < 0)
+        {
+            continue;
+        }
+        if (captured > best)
+        {
+            best = captured;
+            chosen = pit;
+            count = 1;
+        }
+        else if (captured == best && next_random(rng) % ++count == 0)
+        {
+            chosen = pit;
+        }
+    }
+    return chosen;
+}
+
+/*
+    Différence de graines que player_id obtient d'ici la fin, au mieux des deux camps sur depth demi-coups
+*/
+static int negamax(const int board[], int player_id, int depth, int alpha, int beta)
+{
+    if (variant->game_over(board, player_id))
+    {
+        int remaining[2];
+        remaining_seeds(variant, board, remaining);
+        return remaining[player_id] - remaining[1 - player_id];
+    }
+    if (depth == 0)
+    {
+        return 0;
+    }
+
+    int start = player_id * variant->pits;
+    int best = INT_MIN + 1;
+    for (int pit = start; pit < start + variant->pits; ++pit)
+    {
+        int copy[MAX_BOARD_SIZE];
+        memcpy(copy, board, sizeof(copy));
+        int captured = variant->play(copy, player_id, pit);
+        if (captured < 0)
+        {
+            continue;
+        }
+        int value = captured - negamax(copy, 1 - player_id, depth - 1, -beta, -(alpha > best ? alpha : best));
+        if (value > best)
+        {
+            best = value;
+            if (best >= beta)
+            {
+                break;
+            }
+        }
+    }
+    return best == INT_MIN + 1 ? 0 : best;
+}
+
+/*
+    Le coup exact de la table de finales si elle couvre la position, sinon le meilleur coup de la recherche
+*/
+static int choose_engine(const int board[], int player_id, rng_t *rng)
+{
+    int start = player_id * variant->pits;
+    if (table_loaded && variant == DEFAULT_VARIANT)
+    {
+        int values[PLAYER_PITS];
+        int best = tablebase_advice(&table, board, player_id, values);
+        if (best >= 0)
+        {
+            return start + best;
+        }
+    }
+
+    int chosen = -1, best = INT_MIN, count = 0;
+    for (int pit = start; pit < start + variant->pits; ++pit)
+    {
+        int copy[MAX_BOARD_SIZE];
+        memcpy(copy, board, sizeof(copy));
+        int captured = variant->play(copy, player_id, pit);
+        if (captured < 0)
+        {
+            continue;
+        }
+        // Fenêtre qui garde les égalités, départagées au hasard
+        int value = captured - negamax(copy, 1 - player_id, MOTEUR_DEPTH - 1, INT_MIN + 1, best == INT_MIN ? INT_MAX : captured - best + 1);
+        if (value > best)
+        {
+            best = value;
+            chosen = pit;
+            count = 1;
+        }
+        else if (value == best && next_random(rng) % ++count == 0)
+        {
+            chosen = pit;
+        }
+    }
+    return chosen;
+}
+
+static const policy_entry_t policy_table[] = {
+    {"aleatoire", choose_random},
+    {"glouton", choose_greedy},
+    {"moteur", choose_engine},
+};
+static const int policy_count = sizeof(policy_table) / sizeof(policy_table[0]);
+
+static int find_policy(const char *name)
+{
+    for (int i = 0; i < policy_count; ++i)
+    {
+        if (strcmp(policy_table[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// ********************************************************************************* //
+// ************************************ Parties ************************************ //
+// ********************************************************************************* //
+
+static void flush_worker(worker_t *worker)
+{
+    if (worker->length == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&output_mutex);
+    if (fwrite(worker->buffer, 1, worker->length, output) != worker->length)
+    {
+        perror("Écriture des parties");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_unlock(&output_mutex);
+    worker->length = 0;
+}
+
+/*
+    Jouer la partie numéro game et l'ajouter au tampon du thread
+*/
+static void play_game(worker_t *worker, unsigned long long game)
+{
+    rng_t rng = {seed ^ (game * 0xD1B54A32D192ED03ULL)};
+    int board[MAX_BOARD_SIZE];
+    int scores[2] = {0, 0};
+    init_board(board, variant);
+
+    // Comme pour un défi, le premier joueur est tiré au sort
+    int first = next_random(&rng) % 2;
+    int player_id = first;
+
+    if (worker->length + sizeof(autoplay_record_t) + AUTOPLAY_MAX_PLIES > AUTOPLAY_FLUSH)
+    {
+        flush_worker(worker);
+    }
+    autoplay_record_t record;
+    unsigned char *moves = worker->buffer + worker->length + sizeof(record);
+
+    // Comme le serveur, la partie s'arrête quand un coup ramène une position déjà jouée
+    position_history_t history;
+    position_history_init(&history, variant, board, player_id);
+
+    int plies = 0;
+    while (!history.repeated && !variant->game_over(board, player_id) && plies < AUTOPLAY_MAX_PLIES)
+    {
+        int pit = policies[player_id](board, player_id, &rng);
+        if (pit < 0)
+        {
+            break; // Aucun coup valide : ne se produit pas tant que game_over est cohérent avec play
+        }
+        scores[player_id] += position_history_play(&history, variant, board, player_id, pit);
+        moves[plies++] = (unsigned char)(pit - player_id * variant->pits);
+        player_id = 1 - player_id;
+    }
+
+    int result = RESULT_UNFINISHED;
+    if (history.repeated || plies < AUTOPLAY_MAX_PLIES)
+    {
+        int remaining[2];
+        remaining_seeds(variant, board, remaining);
+        scores[0] += remaining[0];
+        scores[1] += remaining[1];
+        result = scores[0] > scores[1] ? RESULT_PLAYER1 : scores[1] > scores[0] ? RESULT_PLAYER2 : RESULT_DRAW;
+    }
+
+    record.game = (uint32_t)game;
+    record.first = (uint8_t)first;
+    record.result = (uint8_t)result;
+    record.repeated = (uint8_t)history.repeated;
+    record.scores[0] = (uint8_t)scores[0];
+    record.scores[1] = (uint8_t)scores[1];
+    record.plies = (uint16_t)plies;
+    memcpy(worker->buffer + worker->length, &record, sizeof(record));
+    worker->length += sizeof(record) + plies;
+
+    worker->games++;
+    worker->plies += plies;
+    worker->results[result]++;
+    worker->repeated += history.repeated;
+}
+
+static void *run_worker(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (1)
+    {
+        unsigned long long begin = __atomic_fetch_add(&next_game, AUTOPLAY_BATCH, __ATOMIC_RELAXED);
+        if (begin >= game_total)
+        {
+            break;
+        }
+        unsigned long long end = begin + AUTOPLAY_BATCH < game_total ? begin + AUTOPLAY_BATCH : game_total;
+        for (unsigned long long game = begin; game < end; ++game)
+        {
+            play_game(worker, game);
+        }
+    }
+    flush_worker(worker);
+    worker->seconds = elapsed(&start);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    char policy_names[64];
+    game_total = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_GAMES;
+    snprintf(policy_names, sizeof(policy_names), "%s", argc > 2 ? argv[2] : "aleatoire:aleatoire");
+    int thread_count = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *path = argc > 4 ? argv[4] : DEFAULT_FILE;
+    variant = find_variant(argc > 5 ? argv[5] : "awale");
+    seed = argc > 6 ? strtoull(argv[6], NULL, 10) : 1;
+
+    char *separator = strchr(policy_names, ':');
+    if (separator != NULL)
+    {
+        *separator = '\0';
+    }
+    policy_ids[0] = find_policy(policy_names);
+    policy_ids[1] = separator != NULL ? find_policy(separator + 1) : policy_ids[0];
+    if (game_total == 0 || game_total > UINT32_MAX || variant == NULL || policy_ids[0] < 0 || policy_ids[1] < 0)
+    {
+        fprintf(stderr, "Usage : %s [parties] [politique1:politique2] [threads] [fichier] [variante] [graine]\n", argv[0]);
+        fprintf(stderr, "Politiques : aleatoire, glouton, moteur. Variantes : awale, oware, mini.\n");
+        return EXIT_FAILURE;
+    }
+    policies[0] = policy_table[policy_ids[0]].choose;
+    policies[1] = policy_table[policy_ids[1]].choose;
+    if (thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    if (thread_count > MAX_THREADS)
+    {
+        thread_count = MAX_THREADS;
+    }
+    // Table de finales facultative, pour la politique moteur
+    table_loaded = tablebase_load(&table, TABLEBASE_FILE) == 0;
+
+    output = fopen(path, "wb");
+    if (output == NULL)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    autoplay_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, AUTOPLAY_MAGIC, sizeof(header.magic));
+    header.variant = (uint8_t)(variant - variants);
+    header.policies[0] = (uint8_t)policy_ids[0];
+    header.policies[1] = (uint8_t)policy_ids[1];
+    header.max_plies = AUTOPLAY_MAX_PLIES;
+    header.games = game_total;
+    header.seed = seed;
+    fwrite(&header, sizeof(header), 1, output);
+
+    printf("%llu parties %s, %s contre %s, %d threads%s\n", game_total, variant->name, policy_table[policy_ids[0]].name,
+           policy_table[policy_ids[1]].name, thread_count, table_loaded ? ", table de finales chargée" : "");
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    worker_t *workers = aligned_alloc(64, sizeof(worker_t) * thread_count);
+    if (workers == NULL)
+    {
+        perror("aligned_alloc");
+        return EXIT_FAILURE;
+    }
+    memset(workers, 0, sizeof(worker_t) * thread_count);
+    for (int i = 0; i < thread_count; ++i)
+    {
+        workers[i].buffer = malloc(AUTOPLAY_FLUSH);
+        if (workers[i].buffer == NULL || pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]) != 0)
+        {
+            perror("Création des threads");
+            return EXIT_FAILURE;
+        }
+    }
+
+    unsigned long long plies = 0;
+    unsigned long long results[4] = {0, 0, 0, 0};
+    unsigned long long repeated = 0;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        pthread_join(workers[i].thread, NULL);
+        plies += workers[i].plies;
+        repeated += workers[i].repeated;
+        for (int r = 0; r < 4; ++r)
+        {
+            results[r] += workers[i].results[r];
+        }
+        free(workers[i].buffer);
+    }
+    double seconds = elapsed(&start);
+    long size = ftell(output);
+    if (fclose(output) != 0)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    printf("Durée                : %.2f s, %.0f parties/s\n", seconds, game_total / seconds);
+    for (int i = 0; i < thread_count; ++i)
+    {
+        printf("Thread %2d            : %llu parties, %.0f parties/s\n", i, workers[i].games, workers[i].seconds > 0 ? workers[i].games / workers[i].seconds : 0.0);
+    }
+    printf("Joueur 1 (%-9s)  : %llu victoires (%.1f %%)\n", policy_table[policy_ids[0]].name, results[RESULT_PLAYER1], 100.0 * results[RESULT_PLAYER1] / game_total);
+    printf("Joueur 2 (%-9s)  : %llu victoires (%.1f %%)\n", policy_table[policy_ids[1]].name, results[RESULT_PLAYER2], 100.0 * results[RESULT_PLAYER2] / game_total);
+    printf("Nuls                 : %llu, interrompues après %d coups : %llu\n", results[RESULT_DRAW], AUTOPLAY_MAX_PLIES, results[RESULT_UNFINISHED]);
+    printf("Positions répétées   : %llu parties arrêtées, graines partagées (%.1f %%)\n", repeated, 100.0 * repeated / game_total);
+    printf("Coups par partie     : %.1f en moyenne\n", (double)plies / game_total);
+    printf("Fichier              : %s (%ld octets)\n", path, size);
+
+    free(workers);
+    if (table_loaded)
+    {
+        tablebase_unload(&table);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include <string.h>
+
+#include "awale.h"
+
+// Règles de la maison : 6 trous de 4 graines, le semis repasse par le trou de départ
+#define VARIANT_PREFIX awale
+#define VARIANT_PITS PLAYER_PITS
+#define VARIANT_SKIP_ORIGIN 0
+#define VARIANT_GRAND_SLAM 0
+#define VARIANT_MUST_FEED 0
+#include "regles.h"
+
+// Oware abapa, les règles des compétitions
+#define VARIANT_PREFIX oware
+#define VARIANT_PITS 6
+#define VARIANT_SKIP_ORIGIN 1
+#define VARIANT_GRAND_SLAM 1
+#define VARIANT_MUST_FEED 1
+#include "regles.h"
+
+// Petit plateau de 4 trous de 3 graines, pour des parties courtes
+#define VARIANT_PREFIX mini
+#define VARIANT_PITS 4
+#define VARIANT_SKIP_ORIGIN 0
+#define VARIANT_GRAND_SLAM 0
+#define VARIANT_MUST_FEED 0
+#include "regles.h"
+
+const variant_t variants[] = {
+    {"awale", "6 trous de 4 graines, règles de la maison", PLAYER_PITS, BOARD_SIZE, INITIAL_SEEDS, awale_play, awale_game_over},
+    {"oware", "6 trous de 4 graines, oware abapa : semis sans le trou de départ, grand chelem sans capture, obligation de nourrir", 6, 12, 4, oware_play,
+     oware_game_over},
+    {"mini", "4 trous de 3 graines, règles de la maison", 4, 8, 3, mini_play, mini_game_over},
+};
+const int variant_count = sizeof(variants) / sizeof(variants[0]);
+
+// Clés de Zobrist, tirées au chargement du programme : les mêmes à chaque lancement
+static uint64_t zobrist_pits[MAX_BOARD_SIZE][MAX_SEEDS + 1];
+static uint64_t zobrist_variants[sizeof(variants) / sizeof(variants[0])];
+static uint64_t zobrist_turn;
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void __attribute__((constructor)) init_zobrist()
+{
+    uint64_t state = 0x6177616c65ULL;
+    for (int pit = 0; pit < MAX_BOARD_SIZE; ++pit)
+    {
+        for (int seeds = 0; seeds <= MAX_SEEDS; ++seeds)
+        {
+            zobrist_pits[pit][seeds] = splitmix64(&state);
+        }
+    }
+    for (int i = 0; i < variant_count; ++i)
+    {
+        zobrist_variants[i] = splitmix64(&state);
+    }
+    zobrist_turn = splitmix64(&state);
+}
+
+/*
+    Empreinte complète d'une position, player_id ayant le trait
+*/
+uint64_t position_hash(const variant_t *variant, const int board[], int player_id)
+{
+    uint64_t hash = zobrist_variants[variant - variants];
+    for (int i = 0; i < variant->board_size; ++i)
+    {
+        hash ^= zobrist_pits[i][board[i]];
+    }
+    return player_id ? hash ^ zobrist_turn : hash;
+}
+
+/*
+    Empreinte après un coup qui a changé le plateau before en after, à partir de celle d'avant le coup
+*/
+uint64_t zobrist_update(const variant_t *variant, uint64_t hash, const int before[], const int after[])
+{
+    for (int i = 0; i < variant->board_size; ++i)
+    {
+        if (before[i] != after[i])
+        {
+            hash ^= zobrist_pits[i][before[i]] ^ zobrist_pits[i][after[i]];
+        }
+    }
+    return hash ^ zobrist_turn;
+}
+
+/*
+    Historique d'une partie qui commence sur board, player_id ayant le trait
+*/
+void position_history_init(position_history_t *history, const variant_t *variant, const int board[], int player_id)
+{
+    history->hash = position_hash(variant, board, player_id);
+    history->hashes[0] = history->hash;
+    history->count = 1;
+    history->repeated = 0;
+}
+
+/*
+    Jouer le coup comme variant->play (graines capturées ou -1) et ajouter la nouvelle position à
+    l'historique ; history->repeated passe à 1 si elle a déjà été jouée
+*/
+int position_history_play(position_history_t *history, const variant_t *variant, int board[], int player_id, int pit)
+{
+    int before[MAX_BOARD_SIZE];
+    memcpy(before, board, sizeof(before));
+    int captured_seeds = variant->play(board, player_id, pit);
+    if (captured_seeds < 0)
+    {
+        return -1;
+    }
+
+    // Seuls les trous touchés par le semis et les captures changent l'empreinte
+    history->hash = zobrist_update(variant, history->hash, before, board);
+    if (captured_seeds > 0)
+    {
+        history->count = 0;
+    }
+    else
+    {
+        // Même joueur au trait un coup sur deux : les autres empreintes ne peuvent pas être égales
+        int oldest = history->count > POSITION_HISTORY_SIZE ? history->count - POSITION_HISTORY_SIZE : 0;
+        for (int i = history->count - 2; i >= oldest; i -= 2)
+        {
+            if (history->hashes[i % POSITION_HISTORY_SIZE] == history->hash)
+            {
+                history->repeated = 1;
+                break;
+            }
+        }
+    }
+    history->hashes[history->count % POSITION_HISTORY_SIZE] = history->hash;
+    history->count++;
+    return captured_seeds;
+}
+
+/*
+    Variante à partir de son nom, NULL si elle n'existe pas
+*/
+const variant_t *find_variant(const char *name)
+{
+    for (int i = 0; i < variant_count; ++i)
+    {
+        if (strcmp(variants[i].name, name) == 0)
+        {
+            return &variants[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+    Plateau de début de partie
+*/
+void init_board(int board[], const variant_t *variant)
+{
+    memset(board, 0, sizeof(int) * MAX_BOARD_SIZE);
+    for (int i = 0; i < variant->board_size; ++i)
+    {
+        board[i] = variant->seeds;
+    }
+}
+
+/*
+    Graines restantes dans le camp de chaque joueur, qui les garde à la fin de la partie
+*/
+void remaining_seeds(const variant_t *variant, const int board[], int remaining[2])
+{
+    remaining[0] = 0;
+    remaining[1] = 0;
+    for (int i = 0; i < variant->pits; ++i)
+    {
+        remaining[0] += board[i];
+        remaining[1] += board[variant->pits + i];
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef AWALE_H
+#define AWALE_H
+
+#include <stdint.h>
+
+/*
+    Règles du jeu sur un plateau seul, sans partie ni joueur : utilisées par le serveur (make_move),
+    par le générateur de la table de finales et par l'autojeu, qui doivent jouer exactement les mêmes coups.
+    Chaque variante a ses propres fonctions, générées à la compilation depuis regles.h.
+*/
+
+// Constants
+#define BOARD_SIZE 12 // Nombre total de trou sur le plateau de jeu (variante awale)
+#define PLAYER_PITS 6 // Nombre de trou par joueur (variante awale)
+#define INITIAL_SEEDS 4 // Nombre de graine par trou au début du jeu (variante awale)
+
+#define MAX_PLAYER_PITS 6 // Plus grand nombre de trou par joueur parmi les variantes
+#define MAX_BOARD_SIZE (2 * MAX_PLAYER_PITS)
+#define MAX_SEEDS (MAX_BOARD_SIZE * INITIAL_SEEDS) // Plus grand nombre de graines sur le plateau parmi les variantes
+#define POSITION_HISTORY_SIZE 128 // Empreintes gardées depuis la dernière capture pour repérer une position répétée
+
+// Variante jouée par défaut, dans les tournois et couverte par la table de finales
+#define DEFAULT_VARIANT (&variants[0])
+
+// Structures
+typedef struct variant_t
+{
+    const char *name;
+    const char *description;
+    int pits;       // Trous par joueur
+    int board_size; // 2 * pits
+    int seeds;      // Graines par trou au début du jeu
+    // Retourne les graines capturées, ou -1 si le coup est invalide (le plateau n'est pas modifié)
+    int (*play)(int board[], int player_id, int pit);
+    // La partie est terminée quand player_id doit jouer
+    int (*game_over)(const int board[], int player_id);
+} variant_t;
+
+// Empreinte de la position courante et celles des positions jouées depuis la dernière capture : les
+// graines ne font que diminuer, une position d'avant une capture ne peut plus revenir
+typedef struct position_history_t
+{
+    uint64_t hash;
+    uint64_t hashes[POSITION_HISTORY_SIZE];
+    int count;    // Coups depuis la dernière capture, les plus anciens sortent de l'historique
+    int repeated; // Le dernier coup a ramené une position déjà jouée : la partie tourne en rond
+} position_history_t;
+
+extern const variant_t variants[];
+extern const int variant_count;
+
+/*
+    Empreinte de Zobrist d'une position : le ou exclusif d'une clé aléatoire par trou et par nombre de
+    graines, d'une clé par variante et d'une clé quand le joueur 2 a le trait. Après un coup, seuls les
+    trous modifiés changent l'empreinte (zobrist_update). Deux positions égales ont la même empreinte,
+    quelle que soit la partie : elle peut servir de clé à un cache d'affichage ou d'analyse.
+    Une partie qui ramène une position déjà jouée tourne en rond : le serveur et l'autojeu l'arrêtent
+    (position_history_play) et chaque joueur garde les graines de son camp.
+*/
+
+// Prototypes
+uint64_t position_hash(const variant_t *variant, const int board[], int player_id);
+uint64_t zobrist_update(const variant_t *variant, uint64_t hash, const int before[], const int after[]);
+void position_history_init(position_history_t *history, const variant_t *variant, const int board[], int player_id);
+int position_history_play(position_history_t *history, const variant_t *variant, int board[], int player_id, int pit);
+void init_board(int board[], const variant_t *variant);
+void remaining_seeds(const variant_t *variant, const int board[], int remaining[2]);
+int awale_play(int board[], int player_id, int pit);
+int awale_game_over(const int board[], int player_id);
+const variant_t *find_variant(const char *name);
+
+#endif
@@ -0,0 +1,541 @@
+#include <fcntl.h>
+#include <math.h>
+#include <sys/socket.h>
+
+#include "serveur.h"
+
+/*
+    Mesures des fonctions les plus appelées du serveur, en ns par opération. Chaque mesure est répétée
+    BENCH_REPETITIONS fois après un tour de chauffe ; la moyenne, l'écart type, le minimum et le maximum
+    des répétitions sont affichés et écrits dans un fichier CSV. Avec un fichier de référence (résultat
+    d'une exécution précédente), l'écart de chaque moyenne est affiché pour comparer avant et après
+    une modification. Les comptes sont créés dans un dossier temporaire, jusqu'à un million.
+
+    Usage : ./Serveur/bench [fichier] [référence]
+*/
+
+// Constants
+#define BENCH_FILE "bench.csv"
+#define BENCH_REPETITIONS 10
+#define BENCH_POSITIONS 256 // Positions de milieu de partie rejouées par make_move et check_game_end, puissance de 2
+#define BENCH_BROADCAST_PLAYERS 64
+#define BENCH_BROADCAST_ROUNDS 100 // Diffusions par tour : le tampon d'un socketpair ne doit jamais être plein
+#define BENCH_MAX_RESULTS 64
+
+// Structures
+typedef struct bench_result_t
+{
+    char name[64];
+    int repetitions;
+    long iterations;
+    double mean_ns;
+    double stddev_ns;
+    double min_ns;
+    double max_ns;
+} bench_result_t;
+
+// Position de départ et coup valide à y jouer
+typedef struct bench_position_t
+{
+    int board[MAX_BOARD_SIZE];
+    int player_id;
+    int pit;
+} bench_position_t;
+
+typedef void (*bench_body_t)(void *arg, long iterations);
+typedef void (*bench_prepare_t)(void *arg);
+
+bench_result_t results[BENCH_MAX_RESULTS];
+int result_count = 0;
+
+bench_position_t positions[BENCH_POSITIONS];
+volatile long bench_sink = 0; // Empêche le compilateur de retirer les appels mesurés
+unsigned long long bench_rng_state = 42;
+unsigned long long null_bytes = 0;
+
+static unsigned int bench_random()
+{
+    unsigned long long z = (bench_rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((z ^ (z >> 31)) >> 32);
+}
+
+static unsigned long long now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/*
+    Mesurer body : un tour de chauffe puis BENCH_REPETITIONS tours de iterations opérations.
+    prepare est appelé avant chaque tour, hors du temps mesuré.
+*/
+static void run_bench(const char *name, bench_body_t body, bench_prepare_t prepare, void *arg, long iterations)
+{
+    double samples[BENCH_REPETITIONS];
+
+    if (result_count == BENCH_MAX_RESULTS)
+    {
+        return;
+    }
+    if (prepare != NULL)
+    {
+        prepare(arg);
+    }
+    body(arg, iterations);
+
+    for (int r = 0; r < BENCH_REPETITIONS; ++r)
+    {
+        if (prepare != NULL)
+        {
+            prepare(arg);
+        }
+        unsigned long long start = now_ns();
+        body(arg, iterations);
+        samples[r] = (double)(now_ns() - start) / iterations;
+    }
+
+    bench_result_t *result = &results[result_count++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->repetitions = BENCH_REPETITIONS;
+    result->iterations = iterations;
+    result->min_ns = samples[0];
+    result->max_ns = samples[0];
+    double sum = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; ++r)
+    {
+        sum += samples[r];
+        result->min_ns = samples[r] < result->min_ns ? samples[r] : result->min_ns;
+        result->max_ns = samples[r] > result->max_ns ? samples[r] : result->max_ns;
+    }
+    result->mean_ns = sum / BENCH_REPETITIONS;
+    double variance = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; ++r)
+    {
+        variance += (samples[r] - result->mean_ns) * (samples[r] - result->mean_ns);
+    }
+    result->stddev_ns = BENCH_REPETITIONS > 1 ? sqrt(variance / (BENCH_REPETITIONS - 1)) : 0;
+
+    printf("%-40s %12.1f ns/op  ± %8.1f  (min %.1f, max %.1f)\n", result->name, result->mean_ns, result->stddev_ns, result->min_ns, result->max_ns);
+    fflush(stdout);
+}
+
+// ********************************************************************************* //
+
+// Jeu
+
+/*
+    Positions atteintes en jouant des coups valides au hasard depuis le plateau initial
+*/
+static void generate_positions()
+{
+    const variant_t *variant = DEFAULT_VARIANT;
+    int board[MAX_BOARD_SIZE];
+    int player_id = 0;
+    int moves = 0;
+
+    init_board(board, variant);
+    for (int i = 0; i < BENCH_POSITIONS;)
+    {
+        int valid[MAX_PLAYER_PITS];
+        int valid_count = 0;
+        for (int pit = 0; pit < variant->pits; ++pit)
+        {
+            if (board[player_id * variant->pits + pit] > 0)
+            {
+                valid[valid_count++] = pit;
+            }
+        }
+
+        // Partie finie ou assez longue : on repart du plateau initial
+        if (valid_count == 0 || variant->game_over(board, player_id) || moves > 60)
+        {
+            init_board(board, variant);
+            player_id = 0;
+            moves = 0;
+            continue;
+        }
+
+        int pit = player_id * variant->pits + valid[bench_random() % valid_count];
+        memcpy(positions[i].board, board, sizeof(board));
+        positions[i].player_id = player_id;
+        positions[i].pit = pit;
+        i++;
+
+        variant->play(board, player_id, pit);
+        player_id = 1 - player_id;
+        moves++;
+    }
+}
+
+static void bench_make_move(void *arg, long iterations)
+{
+    game_t *game = (game_t *)arg;
+    for (long i = 0; i < iterations; ++i)
+    {
+        bench_position_t *position = &positions[i & (BENCH_POSITIONS - 1)];
+        memcpy(game->board, position->board, sizeof(game->board));
+        bench_sink += make_move(position->player_id, position->pit, NULL, game->board, game);
+    }
+}
+
+// Copie du plateau seule, à retrancher de make_move
+static void bench_board_copy(void *arg, long iterations)
+{
+    game_t *game = (game_t *)arg;
+    for (long i = 0; i < iterations; ++i)
+    {
+        memcpy(game->board, positions[i & (BENCH_POSITIONS - 1)].board, sizeof(game->board));
+        bench_sink += game->board[i % MAX_BOARD_SIZE];
+    }
+}
+
+static void bench_check_game_end(void *arg, long iterations)
+{
+    game_t *game = (game_t *)arg;
+    for (long i = 0; i < iterations; ++i)
+    {
+        bench_position_t *position = &positions[i & (BENCH_POSITIONS - 1)];
+        memcpy(game->board, position->board, sizeof(game->board));
+        bench_sink += check_game_end(game, position->player_id);
+    }
+}
+
+// ********************************************************************************* //
+
+// Affichage et envois
+
+static ssize_t null_send(int sockfd, void *ctx, const char *data, size_t length)
+{
+    null_bytes += length;
+    return length;
+}
+
+static void null_close(int sockfd, void *ctx)
+{
+}
+
+static const transport_t null_transport = {null_send, null_close, NULL, NULL};
+
+static void bench_print_board(void *arg, long iterations)
+{
+    game_t *game = (game_t *)arg;
+    for (long i = 0; i < iterations; ++i)
+    {
+        print_board(i & 1, (i & 1) ? game->player2 : game->player1, (i & 1) ? game->player1 : game->player2, game->board, game->game_id, game);
+    }
+}
+
+static void bench_broadcast(void *arg, long iterations)
+{
+    char message[] = "\x1b[33m[Annonce] Le tournoi commence dans cinq minutes.\n\x1b[0m";
+    for (long i = 0; i < iterations; ++i)
+    {
+        broadcast_to_all(message, NULL);
+    }
+}
+
+// Vider les sockets des destinataires entre deux tours, pour que les envois ne bloquent jamais
+static void drain_sockets(void *arg)
+{
+    int *fds = (int *)arg;
+    char buffer[65536];
+    for (int i = 0; i < BENCH_BROADCAST_PLAYERS; ++i)
+    {
+        while (recv(fds[i], buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+            ;
+    }
+}
+
+// Commande envoyée à handle_command, avec le joueur qui l'envoie
+typedef struct bench_command_t
+{
+    player_t *player;
+    const char *line;
+} bench_command_t;
+
+static void bench_handle_command(void *arg, long iterations)
+{
+    bench_command_t *command = (bench_command_t *)arg;
+    for (long i = 0; i < iterations; ++i)
+    {
+        handle_command(command->player, command->line);
+    }
+}
+
+// ********************************************************************************* //
+
+// Comptes
+
+// Pseudos cherchés par un tour : toujours le même (en cache) ou répartis sur tous les comptes
+typedef struct bench_lookup_t
+{
+    int size;
+    int stride; // 0 : toujours le compte 0
+} bench_lookup_t;
+
+static void account_pseudo(int index, char *pseudo, size_t size)
+{
+    snprintf(pseudo, size, "joueur%07d", index);
+}
+
+static void bench_account_find(void *arg, long iterations)
+{
+    bench_lookup_t *lookup = (bench_lookup_t *)arg;
+    char pseudo[32];
+    account_t account;
+    for (long i = 0; i < iterations; ++i)
+    {
+        account_pseudo((int)((i * lookup->stride) % lookup->size), pseudo, sizeof(pseudo));
+        bench_sink += account_find(pseudo, &account);
+    }
+}
+
+static void bench_account_absent(void *arg, long iterations)
+{
+    char pseudo[32];
+    account_t account;
+    for (long i = 0; i < iterations; ++i)
+    {
+        snprintf(pseudo, sizeof(pseudo), "absent%ld", i & 4095);
+        bench_sink += account_find(pseudo, &account);
+    }
+}
+
+static void bench_account_update(void *arg, long iterations)
+{
+    bench_lookup_t *lookup = (bench_lookup_t *)arg;
+    char pseudo[32];
+    for (long i = 0; i < iterations; ++i)
+    {
+        account_pseudo((int)((i * lookup->stride) % lookup->size), pseudo, sizeof(pseudo));
+        bench_sink += account_update_scores(pseudo, (int)i, 1, 2);
+    }
+}
+
+/*
+    Comptes créés dans un dossier temporaire, mesurés à chaque taille atteinte : un compte resté en
+    cache, des comptes répartis sur tout le fichier (hors cache dès que la taille dépasse ACCOUNT_CACHE_SIZE),
+    un pseudo absent et l'écriture d'un bilan
+*/
+static void run_account_benches()
+{
+    const int sizes[] = {1000, 100000, 1000000};
+    char name[64];
+    char pseudo[32];
+    char directory[] = "/tmp/bench-XXXXXX";
+    int origin = open(".", O_RDONLY);
+
+    // Les anciens fichiers du dossier de lancement ne doivent pas être importés
+    if (origin < 0 || mkdtemp(directory) == NULL || chdir(directory) != 0 || accounts_open(ACCOUNTS_FILE, ACCOUNTS_OVERFLOW_FILE) != 0)
+    {
+        perror("Fichier des comptes temporaire");
+        if (origin >= 0)
+        {
+            close(origin);
+        }
+        return;
+    }
+
+    int created = 0;
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); ++s)
+    {
+        int size = sizes[s];
+        unsigned long long start = now_ns();
+        for (; created < size; ++created)
+        {
+            account_pseudo(created, pseudo, sizeof(pseudo));
+            account_create(pseudo, "mot de passe");
+        }
+        printf("%d comptes créés en %.2f s\n", size, (now_ns() - start) / 1e9);
+
+        // Un pas premier avec la taille : chaque tour parcourt des comptes différents
+        bench_lookup_t cached = {size, 0};
+        bench_lookup_t spread = {size, 7919};
+        long iterations = size > ACCOUNT_CACHE_SIZE ? 200000 : 2000000;
+
+        snprintf(name, sizeof(name), "account_find %d en cache", size);
+        run_bench(name, bench_account_find, NULL, &cached, 2000000);
+        snprintf(name, sizeof(name), "account_find %d répartis", size);
+        run_bench(name, bench_account_find, NULL, &spread, iterations);
+        snprintf(name, sizeof(name), "account_find %d absent", size);
+        run_bench(name, bench_account_absent, NULL, NULL, 200000);
+        snprintf(name, sizeof(name), "account_update_scores %d", size);
+        run_bench(name, bench_account_update, NULL, &spread, 100000);
+    }
+
+    account_counters_t counters;
+    account_counters(&counters);
+    printf("%llu comptes, %u compartiments, %u pages de débordement\n", counters.accounts, counters.buckets, counters.overflow_pages);
+
+    unlink(ACCOUNTS_FILE);
+    unlink(ACCOUNTS_OVERFLOW_FILE);
+    if (fchdir(origin) != 0)
+    {
+        perror("fchdir");
+    }
+    close(origin);
+    rmdir(directory);
+}
+
+// ********************************************************************************* //
+
+// Résultats
+
+static int write_results(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fprintf(file, "nom,repetitions,iterations,ns_par_op,ecart_type,min,max\n");
+    for (int i = 0; i < result_count; ++i)
+    {
+        bench_result_t *result = &results[i];
+        fprintf(file, "%s,%d,%ld,%.2f,%.2f,%.2f,%.2f\n", result->name, result->repetitions, result->iterations, result->mean_ns, result->stddev_ns,
+                result->min_ns, result->max_ns);
+    }
+    return fclose(file);
+}
+
+/*
+    Comparer les moyennes à celles d'un fichier écrit par une exécution précédente
+*/
+static void compare_results(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+
+    if (file == NULL)
+    {
+        perror(path);
+        return;
+    }
+
+    printf("\nComparaison avec %s :\n", path);
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char *comma = strchr(line, ',');
+        double reference_ns, stddev_ns;
+        int repetitions;
+        long iterations;
+        if (comma == NULL || sscanf(comma + 1, "%d,%ld,%lf,%lf", &repetitions, &iterations, &reference_ns, &stddev_ns) != 4 || reference_ns <= 0)
+        {
+            continue; // En-tête
+        }
+        *comma = '\0';
+
+        for (int i = 0; i < result_count; ++i)
+        {
+            if (strcmp(results[i].name, line) == 0)
+            {
+                double change = (results[i].mean_ns - reference_ns) / reference_ns * 100.0;
+                // Un écart plus petit que la dispersion des deux mesures n'est pas significatif
+                int significant = fabs(results[i].mean_ns - reference_ns) > results[i].stddev_ns + stddev_ns;
+                printf("%-40s %12.1f -> %10.1f ns/op  %+7.1f %%%s\n", line, reference_ns, results[i].mean_ns, change, significant ? "" : "  (bruit)");
+            }
+        }
+    }
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = argc > 1 ? argv[1] : BENCH_FILE;
+    const char *reference = argc > 2 ? argv[2] : NULL;
+
+    if (argc > 3)
+    {
+        fprintf(stderr, "Usage : %s [fichier] [référence]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Comme la simulation : pas de travailleurs (les messages des parties sont traités par l'appelant) ni de limitation
+    seed_game_random(42);
+    for (int i = 0; i < RATE_CLASS_COUNT; ++i)
+    {
+        rate_limits[i].rate = 1e12;
+        rate_limits[i].burst = 1e12;
+    }
+    init_commands();
+    generate_positions();
+
+    // Partie hors de la liste des parties : seules les fonctions mesurées la touchent
+    player_t *player1 = create_player(-1, &null_transport, NULL);
+    player_t *player2 = create_player(-1, &null_transport, NULL);
+    game_t *game = calloc(1, sizeof(game_t));
+    if (player1 == NULL || player2 == NULL || game == NULL)
+    {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    strcpy(player1->pseudo, "banc1");
+    strcpy(player2->pseudo, "banc2");
+    game->game_id = 1;
+    game->variant = DEFAULT_VARIANT;
+    game->player1 = player1;
+    game->player2 = player2;
+    memcpy(game->board, positions[BENCH_POSITIONS / 2].board, sizeof(game->board));
+
+    run_bench("copie du plateau (référence)", bench_board_copy, NULL, game, 10000000);
+    run_bench("make_move", bench_make_move, NULL, game, 10000000);
+    run_bench("check_game_end", bench_check_game_end, NULL, game, 10000000);
+
+    memcpy(game->board, positions[BENCH_POSITIONS / 2].board, sizeof(game->board));
+    run_bench("print_board complet", bench_print_board, NULL, game, 200000);
+    player1->display_mode = DISPLAY_CLIENT;
+    player2->display_mode = DISPLAY_CLIENT;
+    run_bench("print_board client", bench_print_board, NULL, game, 200000);
+
+    bench_command_t command = {player1, "/affichage complet"};
+    run_bench("handle_command /affichage complet", bench_handle_command, NULL, &command, 500000);
+    command.line = "/defier";
+    run_bench("handle_command format incorrect", bench_handle_command, NULL, &command, 500000);
+    command.line = "/inconnue avec des arguments";
+    run_bench("handle_command inconnue", bench_handle_command, NULL, &command, 500000);
+
+    // Diffusion vers des joueurs dont le socket est une extrémité de socketpair, l'autre étant vidée entre les tours
+    int readers[BENCH_BROADCAST_PLAYERS];
+    for (int i = 0; i < BENCH_BROADCAST_PLAYERS; ++i)
+    {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+        {
+            perror("socketpair");
+            return EXIT_FAILURE;
+        }
+        readers[i] = pair[0];
+        player_t *player = create_player(pair[1], &tcp_transport, NULL);
+        if (player == NULL)
+        {
+            perror("calloc");
+            return EXIT_FAILURE;
+        }
+        snprintf(player->pseudo, sizeof(player->pseudo), "diffusion%d", i);
+        if (add_player_to_players(player) != 0)
+        {
+            fprintf(stderr, "Liste des joueurs pleine (%d)\n", max_players);
+            return EXIT_FAILURE;
+        }
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "broadcast_to_all %d sockets", BENCH_BROADCAST_PLAYERS);
+    run_bench(name, bench_broadcast, drain_sockets, readers, BENCH_BROADCAST_ROUNDS);
+
+    run_account_benches();
+
+    if (write_results(output) != 0)
+    {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+    printf("\nRésultats écrits dans %s\n", output);
+    if (reference != NULL)
+    {
+        compare_results(reference);
+    }
+    return EXIT_SUCCESS;
+}
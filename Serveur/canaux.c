@@ -0,0 +1,457 @@
+#include <ctype.h>
+
+#include "serveur.h"
+#include "canaux.h"
+
+channel_t *channel_buckets[CHANNEL_BUCKETS];
+int channel_total = 0;
+
+static unsigned int hash_channel(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    for (const char *c = name; *c; ++c)
+    {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    return hash & (CHANNEL_BUCKETS - 1);
+}
+
+/*
+    Canal de ce nom, créé au besoin si create est vrai. Retourne NULL si le canal n'existe pas ou si
+    CHANNEL_MAX canaux ont déjà été créés.
+*/
+channel_t *find_channel(const char *name, int create)
+{
+    channel_t **bucket = &channel_buckets[hash_channel(name)];
+    channel_t *head = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+    for (channel_t *channel = head; channel != NULL; channel = channel->next)
+    {
+        if (strcmp(channel->name, name) == 0)
+        {
+            return channel;
+        }
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+    // La place est réservée avant la création, et rendue si le canal n'est finalement pas inséré
+    if (__atomic_add_fetch(&channel_total, 1, __ATOMIC_RELAXED) > CHANNEL_MAX)
+    {
+        __atomic_sub_fetch(&channel_total, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    channel_t *channel = calloc(1, sizeof(channel_t));
+    if (channel == NULL)
+    {
+        __atomic_sub_fetch(&channel_total, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    pthread_mutex_init(&channel->mutex, NULL);
+    snprintf(channel->name, sizeof(channel->name), "%s", name);
+
+    // Insertion en tête ; si un autre thread a inséré entre-temps, vérifier qu'il ne s'agit pas du même canal
+    channel->next = head;
+    while (!__atomic_compare_exchange_n(bucket, &channel->next, channel, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+    {
+        for (channel_t *other = channel->next; other != head; other = other->next)
+        {
+            if (strcmp(other->name, name) == 0)
+            {
+                pthread_mutex_destroy(&channel->mutex);
+                free(channel);
+                __atomic_sub_fetch(&channel_total, 1, __ATOMIC_RELAXED);
+                return other;
+            }
+        }
+        head = channel->next;
+    }
+    return channel;
+}
+
+channel_t *global_chat_channel()
+{
+    static channel_t *global = NULL;
+    channel_t *channel = __atomic_load_n(&global, __ATOMIC_ACQUIRE);
+    if (channel == NULL)
+    {
+        // find_channel retourne le même canal à tous les threads qui le créent en même temps
+        channel = find_channel(GLOBAL_CHANNEL, 1);
+        __atomic_store_n(&global, channel, __ATOMIC_RELEASE);
+    }
+    return channel;
+}
+
+/*
+    Ajouter un abonnement aux abonnés connectés de son canal
+*/
+static void attach_subscription(subscription_t *subscription)
+{
+    channel_t *channel = subscription->channel;
+    LOCK(&channel->mutex);
+    if (subscription->index < 0)
+    {
+        if (channel->subscriber_count == channel->subscriber_capacity)
+        {
+            int new_capacity = channel->subscriber_capacity == 0 ? 16 : channel->subscriber_capacity * 2;
+            subscription_t **new_subscribers = realloc(channel->subscribers, sizeof(subscription_t *) * new_capacity);
+            if (new_subscribers == NULL)
+            {
+                UNLOCK(&channel->mutex);
+                return;
+            }
+            channel->subscribers = new_subscribers;
+            channel->subscriber_capacity = new_capacity;
+        }
+        subscription->index = channel->subscriber_count;
+        channel->subscribers[channel->subscriber_count++] = subscription;
+    }
+    UNLOCK(&channel->mutex);
+}
+
+/*
+    Retirer un abonnement des abonnés connectés : le dernier abonné prend sa place
+*/
+static void detach_subscription(subscription_t *subscription)
+{
+    channel_t *channel = subscription->channel;
+    LOCK(&channel->mutex);
+    int index = subscription->index;
+    if (index >= 0)
+    {
+        subscription_t *last = channel->subscribers[--channel->subscriber_count];
+        channel->subscribers[index] = last;
+        last->index = index;
+        subscription->index = -1;
+    }
+    UNLOCK(&channel->mutex);
+}
+
+static int find_subscription(player_t *player, channel_t *channel)
+{
+    for (int i = 0; i < player->subscription_count; ++i)
+    {
+        if (player->subscriptions[i]->channel == channel)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+    Abonner un joueur à un canal. Retourne 1 s'il y était déjà, -1 s'il a atteint CHANNEL_MAX_PER_PLAYER canaux.
+*/
+int channel_join(player_t *player, channel_t *channel)
+{
+    LOCK(&player->player_mutex);
+    if (find_subscription(player, channel) >= 0)
+    {
+        UNLOCK(&player->player_mutex);
+        return 1;
+    }
+    subscription_t *subscription = player->subscription_count < CHANNEL_MAX_PER_PLAYER ? malloc(sizeof(subscription_t)) : NULL;
+    if (subscription == NULL)
+    {
+        UNLOCK(&player->player_mutex);
+        return -1;
+    }
+    subscription->channel = channel;
+    subscription->player = player;
+    subscription->index = -1;
+    player->subscriptions[player->subscription_count++] = subscription;
+    if (player->connected)
+    {
+        attach_subscription(subscription);
+    }
+    UNLOCK(&player->player_mutex);
+    return 0;
+}
+
+/*
+    Désabonner un joueur d'un canal. Retourne -1 s'il n'y était pas abonné.
+*/
+int channel_leave(player_t *player, channel_t *channel)
+{
+    LOCK(&player->player_mutex);
+    int index = find_subscription(player, channel);
+    if (index < 0)
+    {
+        UNLOCK(&player->player_mutex);
+        return -1;
+    }
+    subscription_t *subscription = player->subscriptions[index];
+    detach_subscription(subscription);
+    player->subscriptions[index] = player->subscriptions[--player->subscription_count];
+    UNLOCK(&player->player_mutex);
+    free(subscription);
+    return 0;
+}
+
+int channel_is_member(player_t *player, channel_t *channel)
+{
+    LOCK(&player->player_mutex);
+    int member = find_subscription(player, channel) >= 0;
+    UNLOCK(&player->player_mutex);
+    return member;
+}
+
+/*
+    Envoyer un message aux abonnés connectés du canal, sauf à sender. Retourne le nombre de destinataires.
+    Les destinations sont copiées sous le verrou du canal et les envois faits après, comme broadcast_to_all.
+*/
+int channel_publish(channel_t *channel, const char *message, player_t *sender)
+{
+    endpoint_t *endpoints;
+    int endpoint_count = 0;
+
+    LOCK(&channel->mutex);
+    endpoints = malloc(sizeof(endpoint_t) * (channel->subscriber_count > 0 ? channel->subscriber_count : 1));
+    if (endpoints == NULL)
+    {
+        UNLOCK(&channel->mutex);
+        return 0;
+    }
+    for (int i = 0; i < channel->subscriber_count; ++i)
+    {
+        // Les destinations d'un abonné connecté ne changent pas : reattach_player ne rattache qu'un joueur déconnecté
+        player_t *p = channel->subscribers[i]->player;
+        if (p != sender)
+        {
+            endpoints[endpoint_count].transport = p->transport;
+            endpoints[endpoint_count].ctx = p->transport_ctx;
+            endpoints[endpoint_count].sockfd = p->sockfd;
+            endpoint_count++;
+        }
+    }
+    UNLOCK(&channel->mutex);
+
+    size_t length = strlen(message);
+    for (int i = 0; i < endpoint_count; ++i)
+    {
+        endpoints[i].transport->send(endpoints[i].sockfd, endpoints[i].ctx, message, length);
+    }
+    free(endpoints);
+    return endpoint_count;
+}
+
+/*
+    Le joueur vient de se (re)connecter : le remettre parmi les abonnés de ses canaux (player_mutex verrouillé)
+*/
+void channels_attach(player_t *player)
+{
+    for (int i = 0; i < player->subscription_count; ++i)
+    {
+        attach_subscription(player->subscriptions[i]);
+    }
+}
+
+/*
+    Le joueur s'est déconnecté : il garde ses abonnements mais ne reçoit plus rien (player_mutex verrouillé)
+*/
+void channels_detach(player_t *player)
+{
+    for (int i = 0; i < player->subscription_count; ++i)
+    {
+        detach_subscription(player->subscriptions[i]);
+    }
+}
+
+/*
+    Supprimer tous les abonnements d'un joueur qui va être libéré
+*/
+void channels_forget(player_t *player)
+{
+    LOCK(&player->player_mutex);
+    for (int i = 0; i < player->subscription_count; ++i)
+    {
+        detach_subscription(player->subscriptions[i]);
+        free(player->subscriptions[i]);
+    }
+    player->subscription_count = 0;
+    UNLOCK(&player->player_mutex);
+}
+
+// ********************************************************************************* //
+// ********************************** Commandes ************************************ //
+// ********************************************************************************* //
+
+/*
+    Nom d'un canal donné par le joueur, en minuscules et précédé de '#'. Retourne -1 s'il n'est pas valide.
+*/
+static int parse_channel_name(str_view_t view, char *name)
+{
+    const char *text = view.ptr;
+    size_t length = view.len;
+    if (length > 0 && text[0] == '#')
+    {
+        text++;
+        length--;
+    }
+    if (length == 0 || length > CHANNEL_NAME_SIZE - 2)
+    {
+        return -1;
+    }
+    name[0] = '#';
+    for (size_t i = 0; i < length; ++i)
+    {
+        unsigned char c = (unsigned char)text[i];
+        if (!isalnum(c) && c != '-' && c != '_')
+        {
+            return -1;
+        }
+        name[i + 1] = (char)tolower(c);
+    }
+    name[length + 1] = '\0';
+    return 0;
+}
+
+static void send_invalid_name(player_t *player)
+{
+    char buffer[BUFFER_SIZE];
+    snprintf(buffer, sizeof(buffer), RED "Nom de canal invalide : lettres, chiffres, '-' et '_', %d caractères au plus.\n" RESET, CHANNEL_NAME_SIZE - 2);
+    send_to_player(player, buffer);
+}
+
+static void cmd_join(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    char name[CHANNEL_NAME_SIZE];
+    if (parse_channel_name(args->argv[0], name) < 0)
+    {
+        send_invalid_name(player);
+        return;
+    }
+
+    channel_t *channel = find_channel(name, 1);
+    int joined = channel != NULL ? channel_join(player, channel) : -1;
+    if (joined == 1)
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "Vous êtes déjà dans %s.\n" RESET, name);
+    }
+    else if (joined < 0)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Impossible de rejoindre %s : %d canaux au plus par joueur.\n" RESET, name, CHANNEL_MAX_PER_PLAYER);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), CYAN "[%s] %s a rejoint le canal.\n" RESET, name, player->pseudo);
+        channel_publish(channel, buffer, player);
+        snprintf(buffer, sizeof(buffer), GREEN "Vous avez rejoint %s. /say %s <message> pour y écrire, /leave %s pour le quitter.\n" RESET, name, name, name);
+    }
+    send_to_player(player, buffer);
+}
+
+static void cmd_leave(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    char name[CHANNEL_NAME_SIZE];
+    if (parse_channel_name(args->argv[0], name) < 0)
+    {
+        send_invalid_name(player);
+        return;
+    }
+
+    channel_t *channel = find_channel(name, 0);
+    if (channel == NULL || channel_leave(player, channel) < 0)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans %s.\n" RESET, name);
+        send_to_player(player, buffer);
+        return;
+    }
+    snprintf(buffer, sizeof(buffer), CYAN "[%s] %s a quitté le canal.\n" RESET, name, player->pseudo);
+    channel_publish(channel, buffer, player);
+    snprintf(buffer, sizeof(buffer), GREEN "Vous avez quitté %s.\n" RESET, name);
+    send_to_player(player, buffer);
+}
+
+/*
+    Publier un message du joueur dans un canal dont il est membre. Le chat global garde son format et son historique.
+*/
+static void say_in_channel(player_t *player, channel_t *channel, const char *message)
+{
+    char buffer[BUFFER_SIZE];
+    if (channel == NULL || !channel_is_member(player, channel))
+    {
+        snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans %s : /join %s pour le rejoindre.\n" RESET,
+                 channel != NULL ? channel->name : "ce canal", channel != NULL ? channel->name : "<#canal>");
+        send_to_player(player, buffer);
+        return;
+    }
+
+    if (channel == global_chat_channel())
+    {
+        snprintf(buffer, sizeof(buffer), CYAN "[Global] %s: %s\n" RESET, player->pseudo, message);
+        history_append(history_global(), player->pseudo, NULL, message);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), CYAN "[%s] %s: %s\n" RESET, channel->name, player->pseudo, message);
+    }
+    channel_publish(channel, buffer, player);
+}
+
+static void cmd_say(player_t *player, const command_args_t *args)
+{
+    char name[CHANNEL_NAME_SIZE];
+    if (parse_channel_name(args->argv[0], name) < 0)
+    {
+        send_invalid_name(player);
+        return;
+    }
+    say_in_channel(player, find_channel(name, 0), args->argv[1].ptr);
+}
+
+static void cmd_global(player_t *player, const command_args_t *args)
+{
+    say_in_channel(player, global_chat_channel(), args->argv[0].ptr);
+}
+
+static void cmd_canaux(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    channel_t *channels[CHANNEL_MAX_PER_PLAYER];
+
+    LOCK(&player->player_mutex);
+    int count = player->subscription_count;
+    for (int i = 0; i < count; ++i)
+    {
+        channels[i] = player->subscriptions[i]->channel;
+    }
+    UNLOCK(&player->player_mutex);
+
+    if (count == 0)
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "Vous n'êtes dans aucun canal. /join <#canal> pour en rejoindre un.\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    int length = snprintf(buffer, sizeof(buffer), CYAN "Vos canaux :\n" RESET);
+    for (int i = 0; i < count && length < (int)sizeof(buffer); ++i)
+    {
+        LOCK(&channels[i]->mutex);
+        int connected = channels[i]->subscriber_count;
+        UNLOCK(&channels[i]->mutex);
+        length += snprintf(buffer + length, sizeof(buffer) - length, "%s - %d connecté%s\n", channels[i]->name, connected, connected > 1 ? "s" : "");
+    }
+    send_to_player(player, buffer);
+}
+
+/*
+    Enregistrer les commandes des canaux de discussion
+*/
+void init_channel_commands()
+{
+    // Créé avant tout canal de joueur, pour ne pas compter dans CHANNEL_MAX
+    global_chat_channel();
+    register_command("/global", 1, 1, CMD_TEXT_LAST, PERM_PLAYER, cmd_global, "/global <message>");
+    register_command("/join", 1, 1, 0, PERM_PLAYER, cmd_join, "/join <#canal>");
+    register_command("/leave", 1, 1, 0, PERM_PLAYER, cmd_leave, "/leave <#canal>");
+    register_command("/say", 2, 2, CMD_TEXT_LAST, PERM_PLAYER, cmd_say, "/say <#canal> <message>");
+    register_command("/canaux", 0, 0, 0, PERM_PLAYER, cmd_canaux, "/canaux");
+
+    set_command_rate_class("/global", RATE_CLASS_CHAT);
+    set_command_rate_class("/say", RATE_CLASS_CHAT);
+}
@@ -0,0 +1,59 @@
+#ifndef CANAUX_H
+#define CANAUX_H
+
+#include <pthread.h>
+
+/*
+    Canaux de discussion nommés (#global, #fr, ...), avec abonnement. Chaque canal garde l'ensemble de
+    ses abonnés connectés sous son propre verrou : publier un message coûte un parcours de ses seuls
+    abonnés, sans verrou global. Les canaux sont trouvés dans un répertoire sans verrou, comme les canaux
+    privés de l'historique : un canal n'y est jamais retiré et un nouveau canal est inséré en tête de son
+    seau par compare-and-swap.
+    Les abonnements d'un joueur sont dans le joueur, sous player_mutex. Un joueur déconnecté garde ses
+    abonnements mais sort des ensembles d'abonnés, qu'il retrouve à sa reconnexion.
+    Ordre des verrous : player_mutex puis le verrou d'un canal.
+*/
+
+// Constants
+#define CHANNEL_NAME_SIZE 24 // '#' compris
+#define CHANNEL_BUCKETS 256
+#define CHANNEL_MAX 1024 // Canaux créés au plus depuis le lancement
+#define CHANNEL_MAX_PER_PLAYER 16
+#define GLOBAL_CHANNEL "#global" // Chat global : chaque joueur y est abonné à son arrivée
+
+typedef struct player_t player_t;
+
+// Structures
+typedef struct channel_t channel_t;
+typedef struct subscription_t subscription_t;
+
+struct subscription_t
+{
+    channel_t *channel;
+    player_t *player;
+    int index; // Place dans les abonnés connectés du canal, -1 si le joueur est déconnecté (verrou du canal)
+};
+
+struct channel_t
+{
+    pthread_mutex_t mutex;
+    char name[CHANNEL_NAME_SIZE];
+    subscription_t **subscribers; // Abonnés connectés
+    int subscriber_count;
+    int subscriber_capacity;
+    channel_t *next; // Seau du répertoire
+};
+
+// Prototypes
+channel_t *find_channel(const char *name, int create);
+channel_t *global_chat_channel();
+int channel_join(player_t *player, channel_t *channel);
+int channel_leave(player_t *player, channel_t *channel);
+int channel_is_member(player_t *player, channel_t *channel);
+int channel_publish(channel_t *channel, const char *message, player_t *sender);
+void channels_attach(player_t *player);
+void channels_detach(player_t *player);
+void channels_forget(player_t *player);
+void init_channel_commands();
+
+#endif
@@ -0,0 +1,728 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "comptes.h"
+#include "journal.h"
+#include "verrous.h"
+
+#define ACCOUNTS_MAGIC "AWALECP1"
+
+// Une page lue ou écrite en entier, quelle que soit la place occupée par les comptes
+typedef union page_buffer_t
+{
+    account_page_t page;
+    account_header_t header;
+    char raw[ACCOUNT_PAGE_SIZE];
+} page_buffer_t;
+
+// Position d'une page : compartiment dans ACCOUNTS_FILE ou débordement dans ACCOUNTS_OVERFLOW_FILE
+typedef struct page_location_t
+{
+    int fd;
+    uint32_t page;
+} page_location_t;
+
+typedef struct cache_entry_t cache_entry_t;
+struct cache_entry_t
+{
+    account_t account;
+    uint32_t hash;
+    cache_entry_t *next;  // Même case de la table
+    cache_entry_t *newer; // Ordre d'utilisation, du plus récent au plus ancien
+    cache_entry_t *older;
+};
+
+// Anciens fichiers, lus une seule fois pour l'import
+typedef struct legacy_user_t
+{
+    char pseudo[32];
+    char password[128];
+} legacy_user_t;
+
+typedef struct legacy_score_t
+{
+    char pseudo[32];
+    int wins;
+    int losses;
+    int draws;
+} legacy_score_t;
+
+int accounts_fd = -1; // -1 tant que le fichier n'est pas ouvert (simulation) : aucun compte
+int overflow_fd = -1;
+account_header_t account_header;
+pthread_mutex_t accounts_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+cache_entry_t *cache_pool = NULL;
+int cache_used = 0;
+cache_entry_t *cache_table[ACCOUNT_CACHE_BUCKETS];
+cache_entry_t *cache_newest = NULL;
+cache_entry_t *cache_oldest = NULL;
+
+unsigned long long cache_hits = 0;
+unsigned long long cache_misses = 0;
+unsigned long long page_reads = 0;
+unsigned long long page_writes = 0;
+
+static uint32_t hash_pseudo(const char *pseudo)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)pseudo; *c != '\0'; ++c)
+    {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+// ********************************************************************************* //
+
+// Pages
+
+static uint32_t bucket_count()
+{
+    return (ACCOUNT_INITIAL_BUCKETS << account_header.level) + account_header.split;
+}
+
+/*
+    Compartiment d'un pseudo : ceux qui précèdent split sont déjà coupés et se lisent avec un bit de plus
+*/
+static uint32_t bucket_of(uint32_t hash)
+{
+    uint32_t round = ACCOUNT_INITIAL_BUCKETS << account_header.level;
+    uint32_t bucket = hash & (round - 1);
+    if (bucket < account_header.split)
+    {
+        bucket = hash & (2 * round - 1);
+    }
+    return bucket;
+}
+
+static page_location_t bucket_location(uint32_t bucket)
+{
+    page_location_t location = {accounts_fd, bucket + 1}; // La page 0 est l'en-tête
+    return location;
+}
+
+static page_location_t overflow_location(uint32_t page)
+{
+    page_location_t location = {overflow_fd, page};
+    return location;
+}
+
+/*
+    Lire une page ; une page au-delà de la fin du fichier est un compartiment encore vide
+*/
+static int read_page(page_location_t location, page_buffer_t *buffer)
+{
+    unsigned long long trace_start = TRACE_START();
+    ssize_t length = pread(location.fd, buffer->raw, ACCOUNT_PAGE_SIZE, (off_t)location.page * ACCOUNT_PAGE_SIZE);
+    if (length < 0)
+    {
+        return -1;
+    }
+    memset(buffer->raw + length, 0, ACCOUNT_PAGE_SIZE - (size_t)length);
+    page_reads++;
+    TRACE_END("lecture de page", ACCOUNTS_FILE, trace_start);
+    return 0;
+}
+
+static int write_page(page_location_t location, const page_buffer_t *buffer)
+{
+    unsigned long long trace_start = TRACE_START();
+    if (pwrite(location.fd, buffer->raw, ACCOUNT_PAGE_SIZE, (off_t)location.page * ACCOUNT_PAGE_SIZE) != ACCOUNT_PAGE_SIZE)
+    {
+        return -1;
+    }
+    page_writes++;
+    TRACE_END("sauvegarde", ACCOUNTS_FILE, trace_start);
+    return 0;
+}
+
+static int write_header()
+{
+    page_buffer_t buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.header = account_header;
+    page_location_t location = {accounts_fd, 0};
+    return write_page(location, &buffer);
+}
+
+/*
+    Chercher le compte dans la chaîne de son compartiment. Retourne 1 et laisse dans buffer la page qui
+    le contient (position dans location, rang dans slot), 0 s'il est absent, -1 en cas d'erreur.
+*/
+static int locate_account(const char *pseudo, uint32_t hash, page_buffer_t *buffer, page_location_t *location, int *slot)
+{
+    *location = bucket_location(bucket_of(hash));
+    while (1)
+    {
+        if (read_page(*location, buffer) != 0)
+        {
+            return -1;
+        }
+        for (uint32_t i = 0; i < buffer->page.count && i < ACCOUNTS_PER_PAGE; ++i)
+        {
+            if (strcmp(buffer->page.accounts[i].pseudo, pseudo) == 0)
+            {
+                *slot = (int)i;
+                return 1;
+            }
+        }
+        if (buffer->page.overflow == 0)
+        {
+            return 0;
+        }
+        *location = overflow_location(buffer->page.overflow);
+    }
+}
+
+/*
+    Page de débordement libre : d'abord celles rendues par les coupes, sinon une nouvelle en fin de fichier
+*/
+static int allocate_overflow_page(uint32_t *page)
+{
+    if (account_header.free_overflow != 0)
+    {
+        page_buffer_t buffer;
+        if (read_page(overflow_location(account_header.free_overflow), &buffer) != 0)
+        {
+            return -1;
+        }
+        *page = account_header.free_overflow;
+        account_header.free_overflow = buffer.page.overflow;
+        return 0;
+    }
+    *page = ++account_header.overflow_pages;
+    return 0;
+}
+
+static int free_overflow_page(uint32_t page)
+{
+    page_buffer_t buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.page.overflow = account_header.free_overflow;
+    account_header.free_overflow = page;
+    return write_page(overflow_location(page), &buffer);
+}
+
+/*
+    Ajouter un compte dans la première page de la chaîne qui a de la place, ou dans une nouvelle page de débordement
+*/
+static int append_to_bucket(uint32_t bucket, const account_t *account)
+{
+    page_buffer_t buffer;
+    page_location_t location = bucket_location(bucket);
+
+    while (1)
+    {
+        if (read_page(location, &buffer) != 0)
+        {
+            return -1;
+        }
+        if (buffer.page.count < ACCOUNTS_PER_PAGE)
+        {
+            buffer.page.accounts[buffer.page.count++] = *account;
+            return write_page(location, &buffer);
+        }
+        if (buffer.page.overflow == 0)
+        {
+            break;
+        }
+        location = overflow_location(buffer.page.overflow);
+    }
+
+    // Chaîne pleine : la nouvelle page est écrite avant d'être reliée
+    uint32_t page;
+    if (allocate_overflow_page(&page) != 0)
+    {
+        return -1;
+    }
+    page_buffer_t overflow;
+    memset(&overflow, 0, sizeof(overflow));
+    overflow.page.count = 1;
+    overflow.page.accounts[0] = *account;
+    if (write_page(overflow_location(page), &overflow) != 0)
+    {
+        return -1;
+    }
+    buffer.page.overflow = page;
+    return write_page(location, &buffer);
+}
+
+/*
+    Écrire une chaîne qui contient les count comptes donnés et commence à la page first. Les pages de
+    débordement, nouvelles, sont écrites en premier : la chaîne ne change qu'à l'écriture de first.
+*/
+static int write_chain(page_location_t first, const account_t *accounts, size_t count)
+{
+    page_buffer_t buffer;
+    size_t pages = count > ACCOUNTS_PER_PAGE ? (count + ACCOUNTS_PER_PAGE - 1) / ACCOUNTS_PER_PAGE : 1;
+    uint32_t next = 0;
+
+    for (size_t index = pages; index-- > 0;)
+    {
+        size_t start = index * ACCOUNTS_PER_PAGE;
+        size_t in_page = count - start < ACCOUNTS_PER_PAGE ? count - start : ACCOUNTS_PER_PAGE;
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.page.count = (uint32_t)in_page;
+        buffer.page.overflow = next;
+        memcpy(buffer.page.accounts, accounts + start, sizeof(account_t) * in_page);
+
+        page_location_t location = first;
+        if (index > 0)
+        {
+            if (allocate_overflow_page(&location.page) != 0)
+            {
+                return -1;
+            }
+            location.fd = overflow_fd;
+        }
+        if (write_page(location, &buffer) != 0)
+        {
+            return -1;
+        }
+        next = location.page;
+    }
+    return 0;
+}
+
+/*
+    Couper le compartiment split : ses comptes sont répartis entre lui et le nouveau compartiment
+    split + (ACCOUNT_INITIAL_BUCKETS << level), ajouté à la fin du fichier. Le nouveau compartiment est
+    écrit puis publié par l'en-tête avant que l'ancienne chaîne ne soit réécrite, et ses pages de
+    débordement ne sont rendues qu'ensuite : une coupe interrompue laisse tous les comptes lisibles.
+    Retourne -1 si la coupe n'a pas été publiée (le fichier est inchangé).
+*/
+static int split_bucket()
+{
+    uint32_t bucket = account_header.split;
+    uint32_t round = ACCOUNT_INITIAL_BUCKETS << account_header.level;
+    account_t *kept = NULL;
+    account_t *moved = NULL;
+    uint32_t *old_pages = NULL;
+    size_t kept_count = 0, moved_count = 0, old_count = 0, capacity = 0;
+    account_header_t saved = account_header;
+    page_buffer_t buffer;
+    page_location_t location = bucket_location(bucket);
+
+    // Relever les comptes de la chaîne, répartis selon le bit de plus de leur empreinte
+    while (1)
+    {
+        if (read_page(location, &buffer) != 0)
+        {
+            goto failed;
+        }
+        size_t in_page = buffer.page.count < ACCOUNTS_PER_PAGE ? buffer.page.count : ACCOUNTS_PER_PAGE;
+        if (kept_count + moved_count + in_page > capacity || old_count == capacity)
+        {
+            capacity = capacity == 0 ? 2 * ACCOUNTS_PER_PAGE : capacity * 2;
+            account_t *grown_kept = realloc(kept, sizeof(account_t) * capacity);
+            kept = grown_kept != NULL ? grown_kept : kept;
+            account_t *grown_moved = realloc(moved, sizeof(account_t) * capacity);
+            moved = grown_moved != NULL ? grown_moved : moved;
+            uint32_t *grown_pages = realloc(old_pages, sizeof(uint32_t) * capacity);
+            old_pages = grown_pages != NULL ? grown_pages : old_pages;
+            if (grown_kept == NULL || grown_moved == NULL || grown_pages == NULL)
+            {
+                goto failed;
+            }
+        }
+        for (size_t i = 0; i < in_page; ++i)
+        {
+            uint32_t hash = hash_pseudo(buffer.page.accounts[i].pseudo);
+            if ((hash & (round - 1)) != bucket)
+            {
+                continue; // Copie laissée par une coupe dont la réécriture a échoué
+            }
+            if (hash & round)
+            {
+                moved[moved_count++] = buffer.page.accounts[i];
+            }
+            else
+            {
+                kept[kept_count++] = buffer.page.accounts[i];
+            }
+        }
+
+        if (location.fd == overflow_fd)
+        {
+            old_pages[old_count++] = location.page;
+        }
+        if (buffer.page.overflow == 0)
+        {
+            break;
+        }
+        location = overflow_location(buffer.page.overflow);
+    }
+
+    // Nouveau compartiment, hors du fichier tant que l'en-tête n'a pas avancé la ronde
+    if (write_chain(bucket_location(bucket + round), moved, moved_count) != 0)
+    {
+        goto failed;
+    }
+    account_header.split++;
+    if (account_header.split == round)
+    {
+        account_header.level++;
+        account_header.split = 0;
+    }
+    if (write_header() != 0)
+    {
+        goto failed;
+    }
+
+    // Publié : l'ancienne chaîne garde des copies inaccessibles des comptes partis, jusqu'à sa réécriture
+    if (write_chain(bucket_location(bucket), kept, kept_count) != 0)
+    {
+        JOURNAL(LOG_WARN, LOG_NONE, LOG_NONE, "Compartiment %u non réécrit après sa coupe : %s", bucket, strerror(errno));
+    }
+    else
+    {
+        for (size_t i = 0; i < old_count; ++i)
+        {
+            free_overflow_page(old_pages[i]);
+        }
+    }
+    free(kept);
+    free(moved);
+    free(old_pages);
+    return 0;
+
+failed:
+    // Les pages prises depuis la lecture de l'en-tête ne sont reliées à rien sur le disque
+    account_header = saved;
+    free(kept);
+    free(moved);
+    free(old_pages);
+    return -1;
+}
+
+// ********************************************************************************* //
+
+// Cache des comptes récents
+
+static void lru_unlink(cache_entry_t *entry)
+{
+    if (entry->newer != NULL)
+    {
+        entry->newer->older = entry->older;
+    }
+    else
+    {
+        cache_newest = entry->older;
+    }
+    if (entry->older != NULL)
+    {
+        entry->older->newer = entry->newer;
+    }
+    else
+    {
+        cache_oldest = entry->newer;
+    }
+}
+
+static void lru_push(cache_entry_t *entry)
+{
+    entry->newer = NULL;
+    entry->older = cache_newest;
+    if (cache_newest != NULL)
+    {
+        cache_newest->newer = entry;
+    }
+    cache_newest = entry;
+    if (cache_oldest == NULL)
+    {
+        cache_oldest = entry;
+    }
+}
+
+static cache_entry_t *cache_lookup(const char *pseudo, uint32_t hash)
+{
+    for (cache_entry_t *entry = cache_table[hash & (ACCOUNT_CACHE_BUCKETS - 1)]; entry != NULL; entry = entry->next)
+    {
+        if (entry->hash == hash && strcmp(entry->account.pseudo, pseudo) == 0)
+        {
+            // Le compte redevient le plus récent
+            lru_unlink(entry);
+            lru_push(entry);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_insert(const account_t *account, uint32_t hash)
+{
+    cache_entry_t *entry;
+    if (cache_used < ACCOUNT_CACHE_SIZE)
+    {
+        entry = &cache_pool[cache_used++];
+    }
+    else
+    {
+        // Évincer le compte utilisé le moins récemment
+        entry = cache_oldest;
+        lru_unlink(entry);
+        cache_entry_t **link = &cache_table[entry->hash & (ACCOUNT_CACHE_BUCKETS - 1)];
+        while (*link != entry)
+        {
+            link = &(*link)->next;
+        }
+        *link = entry->next;
+    }
+
+    entry->account = *account;
+    entry->hash = hash;
+    entry->next = cache_table[hash & (ACCOUNT_CACHE_BUCKETS - 1)];
+    cache_table[hash & (ACCOUNT_CACHE_BUCKETS - 1)] = entry;
+    lru_push(entry);
+}
+
+// ********************************************************************************* //
+
+// Comptes
+
+/*
+    Retourne 1 et copie le compte s'il existe, 0 s'il n'existe pas, -1 en cas d'erreur (accounts_mutex tenu)
+*/
+static int find_locked(const char *pseudo, uint32_t hash, account_t *account)
+{
+    cache_entry_t *entry = cache_lookup(pseudo, hash);
+    if (entry != NULL)
+    {
+        cache_hits++;
+        *account = entry->account;
+        return 1;
+    }
+    cache_misses++;
+
+    page_buffer_t buffer;
+    page_location_t location;
+    int slot;
+    int found = locate_account(pseudo, hash, &buffer, &location, &slot);
+    if (found == 1)
+    {
+        *account = buffer.page.accounts[slot];
+        cache_insert(account, hash);
+    }
+    return found;
+}
+
+static int create_locked(const account_t *account)
+{
+    uint32_t hash = hash_pseudo(account->pseudo);
+    account_t existing;
+    int found = find_locked(account->pseudo, hash, &existing);
+    if (found != 0)
+    {
+        return found == 1 ? -1 : -2;
+    }
+
+    if (append_to_bucket(bucket_of(hash), account) != 0)
+    {
+        return -2;
+    }
+    account_header.count++;
+    // Une coupe par ajout suffit à garder le remplissage sous ACCOUNT_MAX_LOAD ; une coupe qui échoue
+    // laisse le fichier tel quel et sera retentée au prochain ajout
+    if (account_header.count > ACCOUNT_MAX_LOAD * bucket_count() * ACCOUNTS_PER_PAGE && split_bucket() != 0)
+    {
+        JOURNAL(LOG_WARN, LOG_NONE, LOG_NONE, "Coupe du compartiment %u impossible : %s", account_header.split, strerror(errno));
+    }
+    if (write_header() != 0)
+    {
+        return -2;
+    }
+    cache_insert(account, hash);
+    return 0;
+}
+
+static int update_locked(const char *pseudo, int wins, int losses, int draws)
+{
+    uint32_t hash = hash_pseudo(pseudo);
+    page_buffer_t buffer;
+    page_location_t location;
+    int slot;
+    int found = locate_account(pseudo, hash, &buffer, &location, &slot);
+    if (found != 1)
+    {
+        return found;
+    }
+
+    account_t *account = &buffer.page.accounts[slot];
+    account->wins = wins;
+    account->losses = losses;
+    account->draws = draws;
+    if (write_page(location, &buffer) != 0)
+    {
+        return -1;
+    }
+
+    cache_entry_t *entry = cache_lookup(pseudo, hash);
+    if (entry != NULL)
+    {
+        entry->account = *account;
+    }
+    return 1;
+}
+
+/*
+    Importer users.dat et scores.dat dans un fichier des comptes qui vient d'être créé
+*/
+static void import_legacy_files()
+{
+    FILE *file = fopen(LEGACY_USERS_FILE, "rb");
+    int count = 0, imported = 0;
+    if (file == NULL)
+    {
+        return;
+    }
+    if (fread(&count, sizeof(int), 1, file) == 1)
+    {
+        legacy_user_t user;
+        for (int i = 0; i < count && fread(&user, sizeof(user), 1, file) == 1; ++i)
+        {
+            account_t account;
+            memset(&account, 0, sizeof(account));
+            memcpy(account.pseudo, user.pseudo, sizeof(account.pseudo) - 1);
+            memcpy(account.password, user.password, sizeof(account.password) - 1);
+            imported += create_locked(&account) == 0;
+        }
+    }
+    fclose(file);
+
+    file = fopen(LEGACY_SCORES_FILE, "rb");
+    if (file != NULL)
+    {
+        if (fread(&count, sizeof(int), 1, file) == 1)
+        {
+            legacy_score_t score;
+            for (int i = 0; i < count && fread(&score, sizeof(score), 1, file) == 1; ++i)
+            {
+                score.pseudo[sizeof(score.pseudo) - 1] = '\0';
+                update_locked(score.pseudo, score.wins, score.losses, score.draws);
+            }
+        }
+        fclose(file);
+    }
+    JOURNAL(LOG_INFO, LOG_NONE, LOG_NONE, "%d comptes importés depuis %s", imported, LEGACY_USERS_FILE);
+}
+
+/*
+    Ouvrir (ou créer) le fichier des comptes : seul l'en-tête est lu. Retourne 0, ou -1 si le fichier
+    ne peut pas être ouvert ou n'est pas un fichier de comptes.
+*/
+int accounts_open(const char *path, const char *overflow_path)
+{
+    LOCK(&accounts_mutex);
+    cache_pool = calloc(ACCOUNT_CACHE_SIZE, sizeof(cache_entry_t));
+    accounts_fd = open(path, O_RDWR | O_CREAT, 0600);
+    overflow_fd = open(overflow_path, O_RDWR | O_CREAT, 0600);
+    if (cache_pool == NULL || accounts_fd < 0 || overflow_fd < 0)
+    {
+        goto failed;
+    }
+
+    page_buffer_t buffer;
+    page_location_t location = {accounts_fd, 0};
+    if (read_page(location, &buffer) != 0)
+    {
+        goto failed;
+    }
+
+    if (buffer.header.magic[0] == '\0')
+    {
+        // Nouveau fichier : en-tête vide, puis import des anciens fichiers s'ils existent
+        memset(&account_header, 0, sizeof(account_header));
+        memcpy(account_header.magic, ACCOUNTS_MAGIC, sizeof(account_header.magic));
+        account_header.page_size = ACCOUNT_PAGE_SIZE;
+        if (write_header() != 0)
+        {
+            goto failed;
+        }
+        import_legacy_files();
+    }
+    else if (memcmp(buffer.header.magic, ACCOUNTS_MAGIC, sizeof(buffer.header.magic)) != 0 || buffer.header.page_size != ACCOUNT_PAGE_SIZE)
+    {
+        errno = EINVAL;
+        goto failed;
+    }
+    else
+    {
+        account_header = buffer.header;
+    }
+    UNLOCK(&accounts_mutex);
+    return 0;
+
+failed:
+    if (accounts_fd >= 0)
+    {
+        close(accounts_fd);
+    }
+    if (overflow_fd >= 0)
+    {
+        close(overflow_fd);
+    }
+    accounts_fd = -1;
+    overflow_fd = -1;
+    free(cache_pool);
+    cache_pool = NULL;
+    UNLOCK(&accounts_mutex);
+    return -1;
+}
+
+/*
+    Chercher un compte : retourne 1 et le copie dans account s'il existe, 0 sinon, -1 en cas d'erreur de lecture
+*/
+int account_find(const char *pseudo, account_t *account)
+{
+    LOCK(&accounts_mutex);
+    int found = accounts_fd < 0 ? 0 : find_locked(pseudo, hash_pseudo(pseudo), account);
+    UNLOCK(&accounts_mutex);
+    return found;
+}
+
+/*
+    Créer un compte avec un bilan vide : retourne 0, -1 si le pseudo existe déjà, -2 en cas d'erreur
+*/
+int account_create(const char *pseudo, const char *password)
+{
+    account_t account;
+    memset(&account, 0, sizeof(account));
+    strncpy(account.pseudo, pseudo, sizeof(account.pseudo) - 1);
+    strncpy(account.password, password, sizeof(account.password) - 1);
+
+    LOCK(&accounts_mutex);
+    int result = accounts_fd < 0 ? -2 : create_locked(&account);
+    UNLOCK(&accounts_mutex);
+    return result;
+}
+
+/*
+    Enregistrer le bilan d'un joueur : retourne 1, 0 s'il n'a pas de compte, -1 en cas d'erreur
+*/
+int account_update_scores(const char *pseudo, int wins, int losses, int draws)
+{
+    LOCK(&accounts_mutex);
+    int result = accounts_fd < 0 ? 0 : update_locked(pseudo, wins, losses, draws);
+    UNLOCK(&accounts_mutex);
+    return result;
+}
+
+void account_counters(account_counters_t *counters)
+{
+    LOCK(&accounts_mutex);
+    counters->accounts = account_header.count;
+    counters->buckets = accounts_fd < 0 ? 0 : bucket_count();
+    counters->overflow_pages = account_header.overflow_pages;
+    counters->cached = cache_used;
+    counters->hits = cache_hits;
+    counters->misses = cache_misses;
+    counters->page_reads = page_reads;
+    counters->page_writes = page_writes;
+    UNLOCK(&accounts_mutex);
+}
@@ -0,0 +1,80 @@
+#ifndef COMPTES_H
+#define COMPTES_H
+
+#include <stdint.h>
+
+/*
+    Comptes des joueurs (mot de passe et bilan) dans un fichier de pages à hachage linéaire.
+    Le pseudo choisit un compartiment, qui est une page de ACCOUNT_PAGE_SIZE octets à une position
+    calculée dans ACCOUNTS_FILE, suivie au besoin de pages de débordement chaînées dans
+    ACCOUNTS_OVERFLOW_FILE. Quand les compartiments sont trop remplis, le prochain compartiment de la
+    ronde est coupé en deux : le fichier grandit d'une page à la fois, sans jamais être réécrit.
+    L'ouverture ne lit que l'en-tête ; un compte absent du cache coûte la lecture de sa page (et de
+    ses éventuels débordements). Les comptes consultés récemment restent en mémoire, les plus anciens
+    sont évincés quand le cache a ACCOUNT_CACHE_SIZE comptes. Chaque modification est écrite tout de suite.
+    Un seul verrou (accounts_mutex) protège le fichier et le cache, pris après player_mutex.
+*/
+
+// Constants
+#define ACCOUNTS_FILE "comptes.dat"
+#define ACCOUNTS_OVERFLOW_FILE "comptes-debordement.dat"
+#define LEGACY_USERS_FILE "users.dat"   // Anciens fichiers, importés à la création du fichier des comptes
+#define LEGACY_SCORES_FILE "scores.dat"
+#define ACCOUNT_PAGE_SIZE 4096
+#define ACCOUNT_INITIAL_BUCKETS 16 // Puissance de 2
+#define ACCOUNT_MAX_LOAD 0.75      // Remplissage moyen des compartiments qui déclenche une coupe
+#define ACCOUNT_CACHE_SIZE 4096    // Comptes gardés en mémoire
+#define ACCOUNT_CACHE_BUCKETS 8192 // Puissance de 2
+
+// Structures
+typedef struct account_t
+{
+    char pseudo[32];
+    char password[128];
+    int32_t wins;
+    int32_t losses;
+    int32_t draws;
+} account_t;
+
+#define ACCOUNTS_PER_PAGE ((ACCOUNT_PAGE_SIZE - 2 * sizeof(uint32_t)) / sizeof(account_t))
+
+// Page d'un compartiment ou de débordement
+typedef struct account_page_t
+{
+    uint32_t count;
+    uint32_t overflow; // Page de débordement suivante, 0 en fin de chaîne
+    account_t accounts[ACCOUNTS_PER_PAGE];
+} account_page_t;
+
+// Première page de ACCOUNTS_FILE
+typedef struct account_header_t
+{
+    char magic[8];
+    uint32_t page_size;
+    uint32_t level;           // Les compartiments sont ACCOUNT_INITIAL_BUCKETS << level, plus split
+    uint32_t split;           // Prochain compartiment à couper
+    uint32_t overflow_pages;  // Pages écrites dans ACCOUNTS_OVERFLOW_FILE (la page 0 n'est pas utilisée)
+    uint32_t free_overflow;   // Première page de débordement libre, 0 si aucune
+    uint64_t count;           // Comptes enregistrés
+} account_header_t;
+
+typedef struct account_counters_t
+{
+    unsigned long long accounts;
+    unsigned int buckets;
+    unsigned int overflow_pages;
+    int cached;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long page_reads;
+    unsigned long long page_writes;
+} account_counters_t;
+
+// Prototypes
+int accounts_open(const char *path, const char *overflow_path);
+int account_find(const char *pseudo, account_t *account);
+int account_create(const char *pseudo, const char *password);
+int account_update_scores(const char *pseudo, int wins, int losses, int draws);
+void account_counters(account_counters_t *counters);
+
+#endif
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "awale.h"
+#include "tablebase.h"
+
+/*
+    Générateur de la table de finales par analyse rétrograde, niveau par niveau : une capture fait
+    toujours passer à un niveau inférieur, déjà résolu, et seuls les coups sans capture restent
+    à l'intérieur du niveau.
+
+    Dans un niveau, on resserre deux bornes par passes successives jusqu'au point fixe :
+    - lower : ce que le joueur au trait obtient si une partie sans fin lui est comptée au pire ;
+    - upper : ce qu'il obtient si elle lui est comptée au mieux.
+    La valeur avec une partie sans fin comptée 0 est alors max(lower, min(0, upper)). Les parties,
+    elles, s'arrêtent à la première position répétée avec partage des graines : voir tablebase.h.
+    Chaque passe est partagée entre les threads ; les bornes ne font que se resserrer, un thread
+    qui lit la borne d'une autre position avant sa mise à jour ralentit la convergence sans la fausser.
+
+    Usage : ./Serveur/generateur [graines max] [threads] [fichier]
+*/
+
+#define DEFAULT_SEEDS 12
+#define MAX_THREADS 64
+
+// Codage d'un coup : indice de la position suivante dans le niveau, ou valeur déjà connue
+#define MOVE_NONE INT_MIN
+#define EXIT_CODE(value) (-1 - ((value) + 64))
+#define EXIT_VALUE(code) (-1 - (code) - 64)
+
+typedef struct level_t
+{
+    int seeds;
+    unsigned long long count;
+    int *moves;          // PLAYER_PITS codes par position
+    signed char *lower;
+    signed char *upper;
+    signed char *values; // Résultat, dans la table complète
+} level_t;
+
+typedef struct worker_t
+{
+    level_t *level;
+    tablebase_t *table;
+    unsigned long long begin;
+    unsigned long long end;
+    int changed;
+} worker_t;
+
+static int thread_count = 1;
+
+static double elapsed(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+    Jouer une fois tous les coups du niveau : les captures et fins de partie reçoivent leur valeur,
+    les autres coups l'indice de la position suivante
+*/
+static void *build_moves(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    level_t *level = worker->level;
+    int board[BOARD_SIZE];
+
+    for (unsigned long long index = worker->begin; index < worker->end; ++index)
+    {
+        int *moves = &level->moves[index * PLAYER_PITS];
+        tablebase_unrank(index, level->seeds, board);
+
+        if (awale_game_over(board, 0))
+        {
+            int value = tablebase_terminal_value(board);
+            level->lower[index] = value;
+            level->upper[index] = value;
+            for (int pit = 0; pit < PLAYER_PITS; ++pit)
+            {
+                moves[pit] = MOVE_NONE;
+            }
+            continue;
+        }
+
+        level->lower[index] = -level->seeds;
+        level->upper[index] = level->seeds;
+        for (int pit = 0; pit < PLAYER_PITS; ++pit)
+        {
+            int value;
+            unsigned long long child;
+            switch (tablebase_move(worker->table, board, level->seeds, pit, &value, &child))
+            {
+            case TABLEBASE_MOVE_EXIT:
+                moves[pit] = EXIT_CODE(value);
+                break;
+            case TABLEBASE_MOVE_LEVEL:
+                moves[pit] = (int)child;
+                break;
+            default:
+                moves[pit] = MOVE_NONE;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+    Une passe sur une tranche du niveau
+*/
+static void *sweep(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    level_t *level = worker->level;
+    worker->changed = 0;
+
+    for (unsigned long long index = worker->begin; index < worker->end; ++index)
+    {
+        const int *moves = &level->moves[index * PLAYER_PITS];
+        int best_lower = INT_MIN;
+        int best_upper = INT_MIN;
+
+        for (int pit = 0; pit < PLAYER_PITS; ++pit)
+        {
+            int code = moves[pit];
+            int lower, upper;
+            if (code == MOVE_NONE)
+            {
+                continue;
+            }
+            if (code < 0)
+            {
+                lower = upper = EXIT_VALUE(code);
+            }
+            else
+            {
+                // La position suivante est vue de l'adversaire : ses bornes s'inversent
+                lower = -__atomic_load_n(&level->upper[code], __ATOMIC_RELAXED);
+                upper = -__atomic_load_n(&level->lower[code], __ATOMIC_RELAXED);
+            }
+            if (lower > best_lower)
+            {
+                best_lower = lower;
+            }
+            if (upper > best_upper)
+            {
+                best_upper = upper;
+            }
+        }
+
+        if (best_lower == INT_MIN)
+        {
+            continue; // Position terminale
+        }
+        if (best_lower > level->lower[index])
+        {
+            __atomic_store_n(&level->lower[index], (signed char)best_lower, __ATOMIC_RELAXED);
+            worker->changed = 1;
+        }
+        if (best_upper < level->upper[index])
+        {
+            __atomic_store_n(&level->upper[index], (signed char)best_upper, __ATOMIC_RELAXED);
+            worker->changed = 1;
+        }
+    }
+    return NULL;
+}
+
+// Exécuter task sur tout le niveau, découpé en tranches ; retourne 1 si une tranche a changé
+static int run_parallel(void *(*task)(void *), level_t *level, tablebase_t *table)
+{
+    pthread_t threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    int count = level->count < (unsigned long long)thread_count ? 1 : thread_count;
+
+    for (int i = 0; i < count; ++i)
+    {
+        workers[i].level = level;
+        workers[i].table = table;
+        workers[i].begin = level->count * i / count;
+        workers[i].end = level->count * (i + 1) / count;
+        workers[i].changed = 0;
+        if (i > 0 && pthread_create(&threads[i], NULL, task, &workers[i]) != 0)
+        {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    task(&workers[0]);
+
+    int changed = workers[0].changed;
+    for (int i = 1; i < count; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        changed |= workers[i].changed;
+    }
+    return changed;
+}
+
+static void solve_level(level_t *level, tablebase_t *table)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    level->moves = malloc(sizeof(int) * PLAYER_PITS * level->count);
+    level->lower = malloc(level->count);
+    level->upper = malloc(level->count);
+    if (level->moves == NULL || level->lower == NULL || level->upper == NULL)
+    {
+        fprintf(stderr, "Mémoire insuffisante pour le niveau %d (%llu positions)\n", level->seeds, level->count);
+        exit(EXIT_FAILURE);
+    }
+
+    run_parallel(build_moves, level, table);
+    int passes = 0;
+    while (run_parallel(sweep, level, table))
+    {
+        passes++;
+    }
+
+    unsigned long long cycles = 0;
+    for (unsigned long long index = 0; index < level->count; ++index)
+    {
+        int lower = level->lower[index];
+        int upper = level->upper[index];
+        if (lower < upper)
+        {
+            cycles++;
+        }
+        int bounded = upper < 0 ? upper : 0;
+        level->values[index] = lower > bounded ? lower : bounded;
+    }
+
+    printf("Niveau %2d : %11llu positions, %4d passes, %10llu sans fin possible, %.1f s\n", level->seeds, level->count,
+           passes, cycles, elapsed(&start));
+    fflush(stdout);
+
+    free(level->moves);
+    free(level->lower);
+    free(level->upper);
+}
+
+static int write_table(const char *path, const tablebase_t *table, const signed char *values)
+{
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+        perror(temporary);
+        return -1;
+    }
+
+    tablebase_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TABLEBASE_MAGIC, sizeof(header.magic));
+    header.max_seeds = table->max_seeds;
+    header.board_size = BOARD_SIZE;
+    header.positions = table->offsets[table->max_seeds + 1];
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(values, 1, header.positions, file) == header.positions;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary, path) != 0)
+    {
+        perror(path);
+        remove(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_seeds = argc > 1 ? atoi(argv[1]) : DEFAULT_SEEDS;
+    thread_count = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *path = argc > 3 ? argv[3] : TABLEBASE_FILE;
+
+    if (max_seeds < 0 || max_seeds > TABLEBASE_MAX_SEEDS)
+    {
+        fprintf(stderr, "Usage : %s [graines max, 0 à %d] [threads] [fichier]\n", argv[0], TABLEBASE_MAX_SEEDS);
+        return EXIT_FAILURE;
+    }
+    if (thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    if (thread_count > MAX_THREADS)
+    {
+        thread_count = MAX_THREADS;
+    }
+
+    tablebase_t table;
+    tablebase_prepare(&table, max_seeds);
+    unsigned long long positions = table.offsets[max_seeds + 1];
+    signed char *values = malloc(positions);
+    if (values == NULL)
+    {
+        fprintf(stderr, "Mémoire insuffisante pour %llu positions\n", positions);
+        return EXIT_FAILURE;
+    }
+    table.values = values;
+
+    printf("Table de finales jusqu'à %d graines : %llu positions, %d threads\n", max_seeds, positions, thread_count);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int seeds = 0; seeds <= max_seeds; ++seeds)
+    {
+        level_t level;
+        level.seeds = seeds;
+        level.count = tablebase_level_size(seeds);
+        level.values = values + table.offsets[seeds];
+        solve_level(&level, &table);
+    }
+
+    if (write_table(path, &table, values) < 0)
+    {
+        free(values);
+        return EXIT_FAILURE;
+    }
+    printf("Table écrite dans %s (%llu octets) en %.1f s\n", path, positions + sizeof(tablebase_header_t), elapsed(&start));
+    free(values);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,521 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "historique.h"
+#include "verrous.h"
+
+// Taille maximale d'une ligne d'un segment sur disque
+#define HISTORY_LINE_SIZE (HISTORY_TEXT + 2 * HISTORY_NAME_SIZE + 48)
+
+typedef struct history_mark_t history_mark_t;
+struct history_mark_t
+{
+    char pseudo[HISTORY_NAME_SIZE];
+    unsigned long mark;
+    time_t time; // Déconnexion : la position expire HISTORY_MARK_LIFETIME secondes plus tard
+    history_mark_t *next;
+};
+
+int history_enabled = 0;
+char history_directory[256];
+time_t history_started = 0;
+unsigned long history_sequence = 0;
+history_channel_t global_channel;
+history_channel_t *private_channels[HISTORY_BUCKETS];
+
+// Position dans l'historique à la déconnexion de chaque joueur, pour le rattrapage
+history_mark_t *marks[HISTORY_BUCKETS];
+pthread_mutex_t marks_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int hash_name(const char *first, const char *second)
+{
+    unsigned int hash = 2166136261u;
+    for (const char *c = first; *c; ++c)
+    {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    hash = (hash ^ '\n') * 16777619u;
+    for (const char *c = second; *c; ++c)
+    {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    return hash & (HISTORY_BUCKETS - 1);
+}
+
+static void init_channel(history_channel_t *channel, const char *name)
+{
+    memset(channel, 0, sizeof(*channel));
+    pthread_mutex_init(&channel->mutex, NULL);
+    snprintf(channel->name, sizeof(channel->name), "%s", name);
+}
+
+/*
+    Activer l'historique, avec les segments dans directory (créé au besoin)
+*/
+int history_start(const char *directory)
+{
+    snprintf(history_directory, sizeof(history_directory), "%s", directory);
+    if (mkdir(history_directory, 0755) < 0 && errno != EEXIST)
+    {
+        perror("Création du dossier de l'historique");
+    }
+
+    // Les numéros continuent ceux des exécutions précédentes, dont les messages sont dans les segments
+    history_started = time(NULL);
+    history_sequence = (unsigned long)history_started * 1000000UL;
+    init_channel(&global_channel, "global");
+    history_enabled = 1;
+    return 0;
+}
+
+history_channel_t *history_global()
+{
+    return history_enabled ? &global_channel : NULL;
+}
+
+/*
+    Canal d'une partie, conservé dans la partie et libéré par history_close à sa fin
+*/
+history_channel_t *history_game_channel(int game_id)
+{
+    if (!history_enabled)
+    {
+        return NULL;
+    }
+    history_channel_t *channel = malloc(sizeof(history_channel_t));
+    if (channel == NULL)
+    {
+        return NULL;
+    }
+    // Les numéros de partie repartent de 1 à chaque lancement du serveur
+    char name[64];
+    snprintf(name, sizeof(name), "partie-%ld-%d", (long)history_started, game_id);
+    init_channel(channel, name);
+    return channel;
+}
+
+/*
+    Écrire pseudo dans out sous une forme sûre pour un nom de fichier, sans que deux pseudos donnent le même
+    nom : lettres, chiffres et tirets sont gardés, tout autre octet devient _ suivi de son code hexadécimal.
+    out doit pouvoir recevoir 3 * strlen(pseudo) + 1 caractères. Retourne la longueur écrite.
+*/
+static size_t escape_name(const char *pseudo, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t length = 0;
+    for (const unsigned char *c = (const unsigned char *)pseudo; *c; ++c)
+    {
+        if (isalnum(*c) || *c == '-')
+        {
+            out[length++] = *c;
+        }
+        else
+        {
+            out[length++] = '_';
+            out[length++] = digits[*c >> 4];
+            out[length++] = digits[*c & 15];
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+static int same_pair(const history_channel_t *channel, const char *first, const char *second)
+{
+    return strcmp(channel->first, first) == 0 && strcmp(channel->second, second) == 0;
+}
+
+/*
+    Canal privé entre deux joueurs, créé au premier message si create est vrai
+*/
+history_channel_t *history_private_channel(const char *a, const char *b, int create)
+{
+    if (!history_enabled)
+    {
+        return NULL;
+    }
+    const char *first = strcmp(a, b) <= 0 ? a : b;
+    const char *second = first == a ? b : a;
+    history_channel_t **bucket = &private_channels[hash_name(first, second)];
+
+    history_channel_t *head = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+    for (history_channel_t *channel = head; channel != NULL; channel = channel->next)
+    {
+        if (same_pair(channel, first, second))
+        {
+            return channel;
+        }
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+
+    history_channel_t *channel = malloc(sizeof(history_channel_t));
+    if (channel == NULL)
+    {
+        return NULL;
+    }
+    init_channel(channel, "");
+    snprintf(channel->first, sizeof(channel->first), "%s", first);
+    snprintf(channel->second, sizeof(channel->second), "%s", second);
+    // Le nom sert de nom de fichier : mp-<premier>.<second>, le point ne pouvant pas sortir de escape_name
+    size_t length = snprintf(channel->name, sizeof(channel->name), "mp-");
+    length += escape_name(channel->first, channel->name + length);
+    channel->name[length++] = '.';
+    escape_name(channel->second, channel->name + length);
+
+    // Insertion en tête ; si un autre thread a inséré entre-temps, vérifier qu'il ne s'agit pas de la même paire
+    channel->next = head;
+    while (!__atomic_compare_exchange_n(bucket, &channel->next, channel, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+    {
+        for (history_channel_t *other = channel->next; other != head; other = other->next)
+        {
+            if (same_pair(other, first, second))
+            {
+                pthread_mutex_destroy(&channel->mutex);
+                free(channel);
+                return other;
+            }
+        }
+        head = channel->next;
+    }
+    return channel;
+}
+
+/*
+    Canaux privés auxquels participe pseudo
+*/
+int history_private_channels(const char *pseudo, history_channel_t **channels, int max)
+{
+    int count = 0;
+    if (!history_enabled)
+    {
+        return 0;
+    }
+    for (int i = 0; i < HISTORY_BUCKETS && count < max; ++i)
+    {
+        for (history_channel_t *channel = __atomic_load_n(&private_channels[i], __ATOMIC_ACQUIRE); channel != NULL && count < max;
+             channel = channel->next)
+        {
+            if (strcmp(channel->first, pseudo) == 0 || strcmp(channel->second, pseudo) == 0)
+            {
+                channels[count++] = channel;
+            }
+        }
+    }
+    return count;
+}
+
+// ********************************************************************************* //
+
+// Segments sur disque
+
+/*
+    Ajouter les messages [spilled, until) au segment du canal. Appelé avec le verrou du canal.
+*/
+static void spill(history_channel_t *channel, unsigned long until)
+{
+    char path[512];
+    char *buffer = malloc(HISTORY_LINE_SIZE * (until - channel->spilled) + 1);
+    if (buffer == NULL)
+    {
+        channel->spilled = until;
+        return;
+    }
+
+    size_t length = 0;
+    for (; channel->spilled < until; channel->spilled++)
+    {
+        const history_entry_t *entry = &channel->entries[channel->spilled & (HISTORY_SIZE - 1)];
+        length += snprintf(buffer + length, HISTORY_LINE_SIZE, "%lu\t%ld\t%s\t%s\t%s\n", entry->sequence, (long)entry->time, entry->sender,
+                           entry->target[0] ? entry->target : "-", entry->text);
+    }
+
+    snprintf(path, sizeof(path), "%s/%s.log", history_directory, channel->name);
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd >= 0)
+    {
+        if (write(fd, buffer, length) < 0)
+        {
+            perror(path);
+        }
+        close(fd);
+    }
+    free(buffer);
+}
+
+static int parse_line(char *line, history_entry_t *entry)
+{
+    char *fields[5];
+    fields[0] = line;
+    for (int i = 1; i < 5; ++i)
+    {
+        char *tab = strchr(fields[i - 1], '\t');
+        if (tab == NULL)
+        {
+            return 0;
+        }
+        *tab = '\0';
+        fields[i] = tab + 1;
+    }
+
+    entry->sequence = strtoul(fields[0], NULL, 10);
+    entry->time = (time_t)strtol(fields[1], NULL, 10);
+    snprintf(entry->sender, sizeof(entry->sender), "%s", fields[2]);
+    snprintf(entry->target, sizeof(entry->target), "%s", strcmp(fields[3], "-") == 0 ? "" : fields[3]);
+    snprintf(entry->text, sizeof(entry->text), "%s", fields[4]);
+    return 1;
+}
+
+/*
+    Lire au plus count messages de la fin du segment, plus récents que after.
+    Appelé avec le verrou du canal. Retourne le nombre de messages lus.
+*/
+static int read_segment(history_channel_t *channel, unsigned long after, int count, history_entry_t *entries)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.log", history_directory, channel->name);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    // Seule la fin du fichier est lue : count lignes tiennent dans count * HISTORY_LINE_SIZE octets
+    off_t size = lseek(fd, 0, SEEK_END);
+    off_t start = size - (off_t)count * HISTORY_LINE_SIZE;
+    if (start < 0)
+    {
+        start = 0;
+    }
+    size_t length = size - start;
+    char *buffer = malloc(length + 1);
+    if (buffer == NULL || pread(fd, buffer, length, start) != (ssize_t)length)
+    {
+        free(buffer);
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    buffer[length] = '\0';
+
+    // La première ligne est incomplète si la lecture ne commence pas au début du fichier
+    char *line = buffer;
+    if (start > 0)
+    {
+        line = strchr(buffer, '\n');
+        line = line != NULL ? line + 1 : buffer + length;
+    }
+
+    // On garde les count derniers messages dans un anneau
+    unsigned long read = 0;
+    history_entry_t entry;
+    while (*line)
+    {
+        char *end = strchr(line, '\n');
+        if (end == NULL)
+        {
+            break;
+        }
+        *end = '\0';
+        if (parse_line(line, &entry) && entry.sequence > after &&
+            (channel->first[0] == '\0' || strcmp(entry.sender, channel->first) == 0 || strcmp(entry.sender, channel->second) == 0))
+        {
+            entries[read % count] = entry;
+            read++;
+        }
+        line = end + 1;
+    }
+    free(buffer);
+
+    // Remettre l'anneau dans l'ordre chronologique
+    int kept = read < (unsigned long)count ? (int)read : count;
+    if (read > (unsigned long)count)
+    {
+        history_entry_t *ordered = malloc(sizeof(history_entry_t) * count);
+        if (ordered == NULL)
+        {
+            return 0;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            ordered[i] = entries[(read + i) % count];
+        }
+        memcpy(entries, ordered, sizeof(history_entry_t) * count);
+        free(ordered);
+    }
+    return kept;
+}
+
+// ********************************************************************************* //
+
+// Ajout et lecture
+
+void history_append(history_channel_t *channel, const char *sender, const char *target, const char *text)
+{
+    if (channel == NULL)
+    {
+        return;
+    }
+
+    LOCK(&channel->mutex);
+    if (channel->head - channel->spilled == HISTORY_SIZE)
+    {
+        spill(channel, channel->spilled + HISTORY_SPILL);
+    }
+    history_entry_t *entry = &channel->entries[channel->head & (HISTORY_SIZE - 1)];
+    entry->sequence = __atomic_add_fetch(&history_sequence, 1, __ATOMIC_RELAXED);
+    entry->time = time(NULL);
+    snprintf(entry->sender, sizeof(entry->sender), "%s", sender);
+    snprintf(entry->target, sizeof(entry->target), "%s", target != NULL ? target : "");
+    snprintf(entry->text, sizeof(entry->text), "%s", text);
+    channel->head++;
+    UNLOCK(&channel->mutex);
+}
+
+/*
+    Copier dans entries, dans l'ordre chronologique, les count derniers messages du canal plus récents
+    que after (0 pour tous). Le segment sur disque n'est lu que si l'anneau ne suffit pas.
+*/
+int history_recent(history_channel_t *channel, unsigned long after, int count, history_entry_t *entries)
+{
+    if (channel == NULL || count <= 0)
+    {
+        return 0;
+    }
+
+    LOCK(&channel->mutex);
+    // Messages en mémoire à retenir, en partant du plus récent
+    unsigned long first = channel->head;
+    while (first > channel->spilled && channel->head - first < (unsigned long)count &&
+           channel->entries[(first - 1) & (HISTORY_SIZE - 1)].sequence > after)
+    {
+        first--;
+    }
+    int in_memory = channel->head - first;
+
+    int on_disk = 0;
+    if (in_memory < count && first == channel->spilled && channel->spilled > 0)
+    {
+        on_disk = read_segment(channel, after, count - in_memory, entries);
+    }
+    for (unsigned long i = first; i < channel->head; ++i)
+    {
+        entries[on_disk++] = channel->entries[i & (HISTORY_SIZE - 1)];
+    }
+    UNLOCK(&channel->mutex);
+    return on_disk;
+}
+
+/*
+    Écrire les messages restants sur disque et libérer le canal (fin de partie)
+*/
+void history_close(history_channel_t *channel)
+{
+    if (channel == NULL)
+    {
+        return;
+    }
+    LOCK(&channel->mutex);
+    if (channel->head > channel->spilled)
+    {
+        spill(channel, channel->head);
+    }
+    UNLOCK(&channel->mutex);
+    pthread_mutex_destroy(&channel->mutex);
+    free(channel);
+}
+
+// ********************************************************************************* //
+
+// Rattrapage après une absence
+
+/*
+    Retirer d'un seau les positions expirées, d'un joueur qui n'est pas revenu à temps (marks_mutex verrouillé)
+*/
+static void prune_marks(history_mark_t **link, time_t now)
+{
+    while (*link != NULL)
+    {
+        history_mark_t *mark = *link;
+        if (now - mark->time >= HISTORY_MARK_LIFETIME)
+        {
+            *link = mark->next;
+            free(mark);
+        }
+        else
+        {
+            link = &mark->next;
+        }
+    }
+}
+
+void history_set_mark(const char *pseudo)
+{
+    if (!history_enabled)
+    {
+        return;
+    }
+    unsigned long position = __atomic_load_n(&history_sequence, __ATOMIC_RELAXED);
+    unsigned int bucket = hash_name(pseudo, "");
+    time_t now = time(NULL);
+
+    LOCK(&marks_mutex);
+    prune_marks(&marks[bucket], now);
+    history_mark_t *mark = marks[bucket];
+    while (mark != NULL && strcmp(mark->pseudo, pseudo) != 0)
+    {
+        mark = mark->next;
+    }
+    if (mark == NULL)
+    {
+        mark = malloc(sizeof(history_mark_t));
+        if (mark == NULL)
+        {
+            UNLOCK(&marks_mutex);
+            return;
+        }
+        snprintf(mark->pseudo, sizeof(mark->pseudo), "%s", pseudo);
+        mark->next = marks[bucket];
+        marks[bucket] = mark;
+    }
+    mark->mark = position;
+    mark->time = now;
+    UNLOCK(&marks_mutex);
+}
+
+/*
+    Position de l'historique à la dernière déconnexion de pseudo. Retourne 0 si le joueur n'est pas
+    parti depuis le lancement du serveur, ou depuis plus de HISTORY_MARK_LIFETIME secondes : position reçoit
+    alors le début de l'historique de ce lancement. La position est effacée : le rattrapage n'a lieu qu'une fois.
+*/
+int history_take_mark(const char *pseudo, unsigned long *position)
+{
+    int found = 0;
+    unsigned int bucket = hash_name(pseudo, "");
+    *position = (unsigned long)history_started * 1000000UL;
+
+    LOCK(&marks_mutex);
+    prune_marks(&marks[bucket], time(NULL));
+    for (history_mark_t **link = &marks[bucket]; *link != NULL; link = &(*link)->next)
+    {
+        if (strcmp((*link)->pseudo, pseudo) == 0)
+        {
+            history_mark_t *mark = *link;
+            *position = mark->mark;
+            *link = mark->next;
+            free(mark);
+            found = 1;
+            break;
+        }
+    }
+    UNLOCK(&marks_mutex);
+    return found;
+}
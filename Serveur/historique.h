@@ -0,0 +1,62 @@
+#ifndef HISTORIQUE_H
+#define HISTORIQUE_H
+
+#include <pthread.h>
+#include <time.h>
+
+/*
+    Historique des discussions : un anneau de HISTORY_SIZE messages par canal (chat global, chaque
+    partie, chaque paire de joueurs en privé), protégé par le verrou du seul canal. Quand l'anneau est
+    plein, les HISTORY_SPILL plus anciens messages sont ajoutés au segment du canal sur disque
+    (HISTORY_DIR/<canal>.log), qui n'est jamais réécrit.
+    Les canaux privés sont trouvés dans un répertoire sans verrou : un canal n'y est jamais retiré et
+    un nouveau canal est inséré en tête de son seau par compare-and-swap.
+    Tant que history_start n'est pas appelé (simulation), rien n'est enregistré.
+*/
+
+// Constants
+#define HISTORY_DIR "historique"
+#define HISTORY_SIZE 32 // Messages en mémoire par canal, puissance de 2
+#define HISTORY_SPILL 16 // Messages écrits sur disque d'un coup quand l'anneau est plein
+#define HISTORY_TEXT 256
+#define HISTORY_NAME_SIZE 32
+#define HISTORY_BUCKETS 256 // Seaux du répertoire des canaux privés et des absences
+#define HISTORY_MAX_PRIVATE 1000 // Conversations privées rattrapées à la connexion
+#define HISTORY_MARK_LIFETIME (24 * 3600) // Secondes pendant lesquelles une déconnexion est rattrapée au retour
+
+// Structures
+typedef struct history_entry_t
+{
+    unsigned long sequence; // Ordre global des messages, tous canaux confondus
+    time_t time;
+    char sender[HISTORY_NAME_SIZE];
+    char target[HISTORY_NAME_SIZE]; // Destinataire d'un message privé, vide sinon
+    char text[HISTORY_TEXT];
+} history_entry_t;
+
+typedef struct history_channel_t history_channel_t;
+struct history_channel_t
+{
+    pthread_mutex_t mutex;
+    char name[6 * HISTORY_NAME_SIZE + 8]; // Nom du segment sur disque, pseudos échappés (3 caractères par octet au plus)
+    char first[HISTORY_NAME_SIZE];        // Participants d'un canal privé, dans l'ordre alphabétique
+    char second[HISTORY_NAME_SIZE];
+    history_entry_t entries[HISTORY_SIZE];
+    unsigned long head;    // Messages ajoutés depuis la création du canal
+    unsigned long spilled; // Messages déjà écrits sur disque
+    history_channel_t *next; // Seau du répertoire des canaux privés
+};
+
+// Prototypes
+int history_start(const char *directory);
+history_channel_t *history_global();
+history_channel_t *history_game_channel(int game_id);
+history_channel_t *history_private_channel(const char *first, const char *second, int create);
+int history_private_channels(const char *pseudo, history_channel_t **channels, int max);
+void history_close(history_channel_t *channel);
+void history_append(history_channel_t *channel, const char *sender, const char *target, const char *text);
+int history_recent(history_channel_t *channel, unsigned long after, int count, history_entry_t *entries);
+void history_set_mark(const char *pseudo);
+int history_take_mark(const char *pseudo, unsigned long *position);
+
+#endif
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <pthread.h>
+
+#include "journal.h"
+#include "verrous.h"
+
+int journal_level = LOG_OFF;
+
+// Tampons de tous les threads qui ont écrit au moins un enregistrement
+journal_ring_t *rings = NULL;
+int ring_count = 0;
+int thread_counter = 0;
+pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t ring_key;
+static __thread journal_ring_t *thread_ring = NULL;
+
+// Fichier du journal, utilisé seulement par le thread qui vide les tampons (ou journal_flush)
+FILE *journal_file = NULL;
+char journal_path[256];
+long journal_size = 0;
+pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+unsigned long long journal_written = 0;
+unsigned long long journal_dropped = 0;
+
+static const char *level_names[] = {"DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+
+const char *journal_level_name(int level)
+{
+    if (level < LOG_DEBUG || level > LOG_OFF)
+    {
+        return "?";
+    }
+    return level_names[level];
+}
+
+/*
+    Niveau correspondant à un nom (debug, info, warn, error, off), -1 si le nom est inconnu
+*/
+int journal_level_from_name(const char *name)
+{
+    for (int level = LOG_DEBUG; level <= LOG_OFF; ++level)
+    {
+        if (strcasecmp(name, level_names[level]) == 0)
+        {
+            return level;
+        }
+    }
+    return -1;
+}
+
+void journal_set_level(int level)
+{
+    __atomic_store_n(&journal_level, level, __ATOMIC_RELAXED);
+}
+
+// Appelé à la fin d'un thread : le tampon sera libéré par le thread de vidage une fois vide
+static void release_thread_ring(void *arg)
+{
+    journal_ring_t *ring = (journal_ring_t *)arg;
+    __atomic_store_n(&ring->orphaned, 1, __ATOMIC_RELEASE);
+}
+
+static journal_ring_t *get_thread_ring()
+{
+    if (thread_ring != NULL)
+    {
+        return thread_ring;
+    }
+
+    journal_ring_t *ring = (journal_ring_t *)calloc(1, sizeof(journal_ring_t));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+
+    LOCK(&rings_mutex);
+    ring->thread_id = ++thread_counter;
+    ring->next = rings;
+    rings = ring;
+    ring_count++;
+    UNLOCK(&rings_mutex);
+
+    pthread_setspecific(ring_key, ring);
+    thread_ring = ring;
+    return ring;
+}
+
+/*
+    Ajouter un enregistrement au tampon du thread appelant. Le message est formaté directement
+    dans le tampon, sans verrou : seul ce thread écrit head, seul le thread de vidage écrit tail.
+*/
+void journal_write(int level, int connection_id, int game_id, const char *format, ...)
+{
+    journal_ring_t *ring = get_thread_ring();
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    unsigned long head = ring->head;
+    unsigned long tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= JOURNAL_RING_SIZE)
+    {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    journal_record_t *record = &ring->records[head & (JOURNAL_RING_SIZE - 1)];
+    clock_gettime(CLOCK_REALTIME, &record->time);
+    record->level = level;
+    record->connection_id = connection_id;
+    record->game_id = game_id;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(record->message, sizeof(record->message), format, args);
+    va_end(args);
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// ********************************************************************************* //
+
+// Vidage des tampons
+
+/*
+    Renommer serveur.log en serveur.log.1, serveur.log.1 en serveur.log.2, ... et repartir d'un fichier vide
+*/
+static void rotate_journal()
+{
+    char from[300];
+    char to[300];
+
+    fclose(journal_file);
+    for (int i = JOURNAL_FILES - 1; i >= 1; --i)
+    {
+        snprintf(from, sizeof(from), "%s.%d", journal_path, i);
+        snprintf(to, sizeof(to), "%s.%d", journal_path, i + 1);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", journal_path);
+    rename(journal_path, to);
+
+    journal_file = fopen(journal_path, "w");
+    if (journal_file == NULL)
+    {
+        journal_file = stderr;
+    }
+    journal_size = 0;
+}
+
+static void write_line(const char *line)
+{
+    int written = fputs(line, journal_file);
+    if (written >= 0)
+    {
+        journal_size += strlen(line);
+    }
+}
+
+static void write_record(const journal_ring_t *ring, const journal_record_t *record)
+{
+    char stamp[32];
+    char connection[16] = "-";
+    char game[16] = "-";
+    char line[JOURNAL_MESSAGE_SIZE + 128];
+    struct tm tm;
+
+    localtime_r(&record->time.tv_sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    if (record->connection_id != LOG_NONE)
+    {
+        snprintf(connection, sizeof(connection), "%d", record->connection_id);
+    }
+    if (record->game_id != LOG_NONE)
+    {
+        snprintf(game, sizeof(game), "%d", record->game_id);
+    }
+
+    snprintf(line, sizeof(line), "%s.%06ld %-5s t%d conn=%s partie=%s %s\n", stamp, record->time.tv_nsec / 1000,
+             journal_level_name(record->level), ring->thread_id, connection, game, record->message);
+    write_line(line);
+}
+
+/*
+    Vider les tampons de tous les threads dans le fichier. La liste n'est verrouillée que pour
+    en copier les éléments et retirer les tampons des threads terminés, pas pendant les écritures.
+*/
+void journal_flush()
+{
+    LOCK(&flush_mutex);
+    if (journal_file == NULL)
+    {
+        UNLOCK(&flush_mutex);
+        return;
+    }
+
+    LOCK(&rings_mutex);
+    int count = ring_count;
+    journal_ring_t **snapshot = malloc(sizeof(journal_ring_t *) * (count > 0 ? count : 1));
+    if (snapshot == NULL)
+    {
+        UNLOCK(&rings_mutex);
+        UNLOCK(&flush_mutex);
+        return;
+    }
+    int index = 0;
+    for (journal_ring_t *ring = rings; ring != NULL; ring = ring->next)
+    {
+        snapshot[index++] = ring;
+    }
+    UNLOCK(&rings_mutex);
+
+    int orphans = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        journal_ring_t *ring = snapshot[i];
+
+        // Lu avant head : tout ce que le thread a écrit avant de se terminer sera vidé
+        int orphaned = __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE);
+        unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        unsigned long tail = ring->tail;
+        for (; tail != head; ++tail)
+        {
+            write_record(ring, &ring->records[tail & (JOURNAL_RING_SIZE - 1)]);
+            journal_written++;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        unsigned long dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+        if (dropped > 0)
+        {
+            journal_record_t record = {.level = LOG_WARN, .connection_id = LOG_NONE, .game_id = LOG_NONE};
+            clock_gettime(CLOCK_REALTIME, &record.time);
+            snprintf(record.message, sizeof(record.message), "%lu enregistrements perdus (tampon plein)", dropped);
+            write_record(ring, &record);
+            journal_dropped += dropped;
+        }
+
+        if (orphaned)
+        {
+            snapshot[orphans++] = ring;
+        }
+    }
+
+    // Libérer les tampons des threads terminés
+    if (orphans > 0)
+    {
+        LOCK(&rings_mutex);
+        for (int i = 0; i < orphans; ++i)
+        {
+            journal_ring_t **link = &rings;
+            while (*link != NULL && *link != snapshot[i])
+            {
+                link = &(*link)->next;
+            }
+            if (*link != NULL)
+            {
+                *link = snapshot[i]->next;
+                ring_count--;
+            }
+            free(snapshot[i]);
+        }
+        UNLOCK(&rings_mutex);
+    }
+    free(snapshot);
+
+    fflush(journal_file);
+    if (journal_file != stderr && journal_size >= JOURNAL_MAX_SIZE)
+    {
+        rotate_journal();
+    }
+    UNLOCK(&flush_mutex);
+}
+
+static void *journal_flusher(void *arg)
+{
+    struct timespec delay = {0, JOURNAL_FLUSH_MS * 1000000L};
+    while (1)
+    {
+        nanosleep(&delay, NULL);
+        journal_flush();
+    }
+    return NULL;
+}
+
+/*
+    Ouvrir le journal et lancer le thread de vidage. Sans fichier accessible, le journal est écrit sur stderr.
+*/
+int journal_start(const char *path, int level)
+{
+    pthread_key_create(&ring_key, release_thread_ring);
+
+    snprintf(journal_path, sizeof(journal_path), "%s", path);
+    journal_file = fopen(journal_path, "a");
+    if (journal_file == NULL)
+    {
+        perror("Ouverture du journal");
+        journal_file = stderr;
+    }
+    else
+    {
+        fseek(journal_file, 0, SEEK_END);
+        journal_size = ftell(journal_file);
+    }
+
+    pthread_t flusher;
+    if (pthread_create(&flusher, NULL, journal_flusher, NULL) != 0)
+    {
+        return -1;
+    }
+    pthread_detach(flusher);
+
+    journal_set_level(level);
+    return journal_file == stderr ? -1 : 0;
+}
+
+/*
+    Compteurs pour la commande /journal
+*/
+void journal_counters(unsigned long long *written, unsigned long long *dropped, int *threads)
+{
+    LOCK(&flush_mutex);
+    *written = journal_written;
+    *dropped = journal_dropped;
+    UNLOCK(&flush_mutex);
+
+    LOCK(&rings_mutex);
+    *threads = ring_count;
+    UNLOCK(&rings_mutex);
+}
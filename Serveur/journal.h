@@ -0,0 +1,75 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <time.h>
+
+/*
+    Journal asynchrone du serveur. Chaque thread écrit ses enregistrements dans son propre tampon
+    circulaire, sans verrou ni appel système ; un thread de fond les vide dans JOURNAL_FILE, qui est
+    renommé en JOURNAL_FILE.1, .2, ... quand il dépasse JOURNAL_MAX_SIZE.
+    Un enregistrement sous le niveau courant ne coûte qu'une comparaison. Si le tampon d'un thread
+    est plein, l'enregistrement est perdu et compté plutôt que de bloquer l'appelant.
+*/
+
+// Constants
+#define JOURNAL_FILE "serveur.log"
+#define JOURNAL_MAX_SIZE (10 * 1024 * 1024) // Taille en octets avant rotation
+#define JOURNAL_FILES 5                     // Fichiers conservés après rotation
+#define JOURNAL_RING_SIZE 1024              // Enregistrements par thread, puissance de 2
+#define JOURNAL_MESSAGE_SIZE 160
+#define JOURNAL_FLUSH_MS 20
+
+// Niveaux
+#define LOG_DEBUG 0
+#define LOG_INFO 1
+#define LOG_WARN 2
+#define LOG_ERROR 3
+#define LOG_OFF 4 // Niveau tant que le journal n'est pas démarré
+
+// Identifiants absents (pas de connexion ou pas de partie associée à l'enregistrement)
+#define LOG_NONE 0
+
+extern int journal_level;
+
+// Le test du niveau est fait avant l'appel pour ne pas formater les messages filtrés
+#define JOURNAL(level, connection_id, game_id, ...)                          \
+    do                                                                       \
+    {                                                                        \
+        if ((level) >= __atomic_load_n(&journal_level, __ATOMIC_RELAXED))    \
+        {                                                                    \
+            journal_write((level), (connection_id), (game_id), __VA_ARGS__); \
+        }                                                                    \
+    } while (0)
+
+// Structures
+typedef struct journal_record_t
+{
+    struct timespec time;
+    int level;
+    int connection_id;
+    int game_id;
+    char message[JOURNAL_MESSAGE_SIZE];
+} journal_record_t;
+
+typedef struct journal_ring_t journal_ring_t;
+struct journal_ring_t
+{
+    journal_record_t records[JOURNAL_RING_SIZE];
+    unsigned long head; // Écrit par le thread propriétaire
+    unsigned long tail; // Écrit par le thread de vidage
+    unsigned long dropped;
+    int thread_id;
+    int orphaned; // Le thread propriétaire est terminé, le tampon est libéré une fois vidé
+    journal_ring_t *next;
+};
+
+// Prototypes
+int journal_start(const char *path, int level);
+void journal_write(int level, int connection_id, int game_id, const char *format, ...) __attribute__((format(printf, 4, 5)));
+void journal_set_level(int level);
+int journal_level_from_name(const char *name);
+const char *journal_level_name(int level);
+void journal_flush();
+void journal_counters(unsigned long long *written, unsigned long long *dropped, int *threads);
+
+#endif
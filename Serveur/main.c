@@ -0,0 +1,564 @@
+#include "serveur.h"
+#include "admin.h"
+#include "admission.h"
+#include "tampons.h"
+
+// Lecture ligne par ligne d'une connexion : plusieurs lignes peuvent arriver dans un même recv.
+// Le tampon est emprunté à la réserve tant qu'une ligne incomplète attend la suite, et rendu ensuite.
+typedef struct line_reader_t
+{
+    io_buffer_t *pending;
+} line_reader_t;
+
+// Connexion TCP d'un joueur, passée au thread client_handler
+typedef struct connection_t
+{
+    player_t *player;
+    line_reader_t reader;
+    char *resume_token; // Jeton reçu avec RESUME, jusqu'à sa prise en charge par resume_handler
+} connection_t;
+
+/*
+    Lire la prochaine ligne, sans le retour à la ligne. Une ligne plus longue que BUFFER_SIZE est coupée.
+    Retourne -1 si la connexion est fermée ou si le délai de réception est dépassé.
+*/
+static int read_line(int sockfd, line_reader_t *reader, char *line, size_t size)
+{
+    while (1)
+    {
+        io_buffer_t *pending = reader->pending;
+        if (pending == NULL)
+        {
+            // Attendre des données sans tampon : une connexion inactive n'en garde aucun
+            char probe;
+            if (recv(sockfd, &probe, 1, MSG_PEEK) <= 0)
+            {
+                return -1;
+            }
+            pending = reader->pending = buffer_acquire(BUFFER_SMALL);
+            if (pending == NULL)
+            {
+                return -1;
+            }
+        }
+
+        char *newline = memchr(pending->data, '\n', pending->length);
+        if (newline == NULL && pending->length == pending->capacity && pending->capacity < BUFFER_SIZE)
+        {
+            // Ligne plus longue que le tampon : passer à la classe de taille suivante
+            io_buffer_t *larger = buffer_acquire(pending->capacity + 1);
+            if (larger == NULL)
+            {
+                return -1;
+            }
+            memcpy(larger->data, pending->data, pending->length);
+            larger->length = pending->length;
+            buffer_release(pending);
+            pending = reader->pending = larger;
+        }
+
+        if (newline != NULL || pending->length == pending->capacity)
+        {
+            size_t line_length = newline != NULL ? (size_t)(newline - pending->data) : pending->length;
+            size_t consumed = newline != NULL ? line_length + 1 : line_length;
+            size_t copied = line_length < size - 1 ? line_length : size - 1;
+
+            memcpy(line, pending->data, copied);
+            line[copied] = '\0';
+            line[strcspn(line, "\r")] = '\0';
+            memmove(pending->data, pending->data + consumed, pending->length - consumed);
+            pending->length -= consumed;
+            if (pending->length == 0)
+            {
+                buffer_release(pending);
+                reader->pending = NULL;
+            }
+            return (int)copied;
+        }
+
+        ssize_t received = recv(sockfd, pending->data + pending->length, pending->capacity - pending->length, 0);
+        if (received <= 0)
+        {
+            return -1;
+        }
+        pending->length += received;
+    }
+}
+
+static void free_connection(connection_t *connection)
+{
+    if (connection != NULL)
+    {
+        buffer_release(connection->reader.pending);
+        free(connection->resume_token);
+        free(connection);
+    }
+}
+
+/*
+    Options des sockets acceptés : keepalive TCP pour repérer un pair disparu même sans trafic,
+    délai d'envoi pour ne pas bloquer un thread sur un client qui ne lit plus, et délai pour se connecter
+*/
+static void configure_client_socket(int sockfd)
+{
+    int enable = 1;
+    int idle = KEEPALIVE_IDLE;
+    int interval = KEEPALIVE_INTERVAL;
+    int count = KEEPALIVE_COUNT;
+    struct timeval send_timeout = {SEND_TIMEOUT, 0};
+    struct timeval login_timeout = {LOGIN_TIMEOUT, 0};
+
+    setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &login_timeout, sizeof(login_timeout));
+}
+
+// Thread traitant toutes les commandes d'un client
+void *client_handler(void *arg)
+{
+    connection_t *connection = (connection_t *)arg;
+    player_t *player = connection->player;
+    char buffer[BUFFER_SIZE];
+
+    // Après la connexion, l'inactivité est surveillée par les battements de cœur
+    struct timeval no_timeout = {0, 0};
+    setsockopt(player->sockfd, SOL_SOCKET, SO_RCVTIMEO, &no_timeout, sizeof(no_timeout));
+
+    // Envoyer un message de bienvenue
+    snprintf(buffer, sizeof(buffer), GREEN "Bienvenue %s ! Tapez /help pour les commandes disponibles.\n" RESET, player->pseudo);
+    send_to_player(player, buffer);
+    send_missed_messages(player);
+
+    // Informer les abonnés du chat global de la connexion
+    snprintf(buffer, sizeof(buffer), GREEN "%s a rejoint le chat.\n" RESET, player->pseudo);
+    channel_publish(global_chat_channel(), buffer, player);
+
+    while (1)
+    {
+        if (read_line(player->sockfd, &connection->reader, buffer, sizeof(buffer)) >= 0)
+        {
+            if (handle_line(player, buffer) < 0)
+            {
+                break; // Déconnecté par la commande (/quit, flood)
+            }
+        }
+        else
+        {
+            // Le joueur s'est déconnecté ou la connexion a été coupée par les battements de cœur
+            handle_player_disconnect(player);
+            break;
+        }
+    }
+
+    // Sans partie en attente de reconnexion, le joueur peut être libéré tout de suite
+    detach_handler(player);
+    free_connection(connection);
+    return NULL;
+}
+
+/*
+    Lancer le thread d'un joueur ajouté à la liste, directement ou depuis la file d'attente
+*/
+static void start_client(player_t *player, void *ctx)
+{
+    connection_t *connection = (connection_t *)ctx;
+    issue_session(player);
+
+    // Créer un thread pour gérer ce client
+    connection->player = player;
+    attach_handler(player);
+    pthread_create(&player->thread, NULL, client_handler, (void *)connection);
+    pthread_detach(player->thread);
+}
+
+/*
+    Libérer un joueur qui a quitté la file d'attente sans être admis
+*/
+static void drop_waiting_client(player_t *player, void *ctx)
+{
+    close(player->sockfd);
+    destroy_player(player);
+    free_connection((connection_t *)ctx);
+}
+
+/*
+    Connexion avec pseudo et mot de passe (player->pseudo est déjà reçu), ou enregistrement d'un nouveau pseudo.
+    Retourne 0 si le joueur est authentifié, -1 sinon.
+*/
+static int authenticate(player_t *player, line_reader_t *reader)
+{
+    char buffer[BUFFER_SIZE];
+
+    JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "Tentative de connexion pour le pseudo : %s", player->pseudo);
+
+    // Vérifier si le pseudo a déjà un compte
+    if (!user_exists(player->pseudo))
+    {
+        // Pseudo inconnu, inviter l'utilisateur à s'enregistrer
+        snprintf(buffer, sizeof(buffer), "Bienvenue %s ! Veuillez vous enregistrer.\nEntrez un mot de passe : ", player->pseudo);
+        send_to_player(player, buffer);
+
+        // Recevoir le mot de passe
+        char password[128];
+        if (read_line(player->sockfd, reader, password, sizeof(password)) >= 0)
+        {
+            // Demander la confirmation du mot de passe
+            snprintf(buffer, sizeof(buffer), "Confirmez le mot de passe : ");
+            send_to_player(player, buffer);
+
+            char password_confirm[128];
+            if (read_line(player->sockfd, reader, password_confirm, sizeof(password_confirm)) >= 0)
+            {
+
+                // Vérifier que les mots de passe correspondent
+                if (strcmp(password, password_confirm) != 0)
+                {
+                    snprintf(buffer, sizeof(buffer), RED "Les mots de passe ne correspondent pas. Veuillez réessayer.\n" RESET);
+                    send_to_player(player, buffer);
+                    return -1;
+                }
+
+                // Enregistrer le nouvel utilisateur
+                int reg_result = register_user(player->pseudo, password);
+                if (reg_result != 0)
+                {
+                    snprintf(buffer, sizeof(buffer), RED "Erreur lors de l'enregistrement de l'utilisateur.\n" RESET);
+                    send_to_player(player, buffer);
+                    return -1;
+                }
+
+                snprintf(buffer, sizeof(buffer), GREEN "Enregistrement réussi ! Vous êtes maintenant connecté.\n" RESET);
+                send_to_player(player, buffer);
+                load_player_score(player);
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        // Pseudo connu, demander le mot de passe
+        snprintf(buffer, sizeof(buffer), "Pseudo reconnu. Veuillez entrer votre mot de passe : ");
+        send_to_player(player, buffer);
+
+        // Recevoir le mot de passe
+        char password[128];
+        if (read_line(player->sockfd, reader, password, sizeof(password)) >= 0)
+        {
+            // Vérifier le mot de passe
+            int auth_result = verify_user_password(player->pseudo, password);
+            if (auth_result != 0)
+            {
+                snprintf(buffer, sizeof(buffer), RED "Mot de passe incorrect. Connexion refusée.\n" RESET);
+                send_to_player(player, buffer);
+                return -1;
+            }
+
+            snprintf(buffer, sizeof(buffer), GREEN "Connexion réussie !\n" RESET);
+            send_to_player(player, buffer);
+            // Charger les scores du joueur
+            load_player_score(player);
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+    Terminer la connexion d'un client : authentification si la session n'est pas reprise (token NULL,
+    line est alors le pseudo), puis retour d'un joueur en attente de reconnexion, ajout à la liste
+    ou mise en file d'attente
+*/
+static void finish_login(connection_t *connection, const char *line, const char *token)
+{
+    player_t *player = connection->player;
+    char buffer[BUFFER_SIZE];
+
+    if (token == NULL)
+    {
+        // Pseudo coupé à la taille du champ, comme avant la reprise de session
+        size_t length = strnlen(line, sizeof(player->pseudo) - 1);
+        memcpy(player->pseudo, line, length);
+        player->pseudo[length] = '\0';
+        if (authenticate(player, &connection->reader) < 0)
+        {
+            close(player->sockfd);
+            destroy_player(player);
+            free_connection(connection);
+            return;
+        }
+    }
+
+    player->is_admin = is_admin_pseudo(player->pseudo);
+
+    // Vérifier si le pseudo est déjà utilisé en jeu. Une session reprise désigne directement son joueur.
+    int pseudo_used_in_game = 0;
+    LOCK(&players_mutex);
+    player_t *parked = token != NULL ? find_session_player(token) : NULL;
+    for (int i = 0; parked == NULL && i < player_count; ++i)
+    {
+        if (strcmp(players[i]->pseudo, player->pseudo) == 0)
+        {
+            if (!players[i]->connected)
+            {
+                parked = players[i];
+            }
+            else
+            {
+                pseudo_used_in_game = 1;
+            }
+            break;
+        }
+    }
+
+    if (parked != NULL && !parked->connected)
+    {
+        // Reconnexion du joueur : mettre à jour la connexion et l'état du joueur
+        reattach_player(parked, player->sockfd, &tcp_transport, NULL);
+        issue_session(parked);
+
+        // Supprimer le joueur crée par défaut
+        destroy_player(player);
+
+        // Relancer le client_handler pour le joueur reconnecté
+        connection->player = parked;
+        attach_handler(parked);
+        pthread_create(&parked->thread, NULL, client_handler, (void *)connection);
+        pthread_detach(parked->thread);
+
+        UNLOCK(&players_mutex);
+        return;
+    }
+    pseudo_used_in_game |= parked != NULL;
+
+    if (pseudo_used_in_game)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Ce pseudo est déjà utilisé en jeu. Veuillez réessayer plus tard.\n" RESET);
+        send_to_player(player, buffer);
+        close(player->sockfd);
+        destroy_player(player);
+        free_connection(connection);
+        UNLOCK(&players_mutex);
+        return;
+    }
+
+    UNLOCK(&players_mutex);
+
+    // Ajouter le joueur à la liste, ou le mettre en file d'attente si le serveur est plein
+    int added = add_player_to_players(player);
+    if (added == -1 && admission_enqueue(player, connection) == 0)
+    {
+        return;
+    }
+    if (added < 0)
+    {
+        if (added == -2)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Ce pseudo est déjà utilisé en jeu. Veuillez réessayer plus tard.\n" RESET);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), RED "Le serveur est plein. Veuillez réessayer plus tard.\n" RESET);
+        }
+        send_to_player(player, buffer);
+        close(player->sockfd);
+        destroy_player(player);
+        free_connection(connection);
+        return;
+    }
+
+    start_client(player, connection);
+}
+
+/*
+    Thread d'une reconnexion avec RESUME : resume_session peut attendre que l'ancienne connexion
+    soit fermée, sans retarder les connexions suivantes sur le thread principal
+*/
+static void *resume_handler(void *arg)
+{
+    connection_t *connection = (connection_t *)arg;
+    player_t *player = connection->player;
+    char buffer[BUFFER_SIZE];
+
+    // La connexion peut passer à client_handler : le jeton n'y reste pas
+    char *token = connection->resume_token;
+    connection->resume_token = NULL;
+
+    if (resume_session(token, player->pseudo, sizeof(player->pseudo)) == 0)
+    {
+        // Reprise en un seul aller-retour, sans pseudo ni mot de passe
+        JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "Reprise de la session de %s", player->pseudo);
+        load_player_score(player);
+        finish_login(connection, NULL, token);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "Session inconnue ou expirée.\n" RESET "Entrez votre pseudo : ");
+        send_to_player(player, buffer);
+        if (read_line(player->sockfd, &connection->reader, buffer, sizeof(buffer)) >= 0)
+        {
+            finish_login(connection, buffer, NULL);
+        }
+        else
+        {
+            close(player->sockfd);
+            destroy_player(player);
+            free_connection(connection);
+        }
+    }
+    free(token);
+    return NULL;
+}
+
+// Thread principal qui gère la connexion et l'enregistrement des clients
+int main()
+{
+    int server_sockfd, new_sockfd;
+    struct sockaddr_in server_addr, client_addr;
+
+    // Rapport des verrous sur SIGUSR1 (si compilé avec PROFILAGE=1), avant de créer d'autres threads
+    lock_profiler_start();
+    journal_start(JOURNAL_FILE, LOG_INFO);
+    // Traces échantillonnées, assez rares pour rester actives en production (console : trace)
+    trace_set_rate(TRACE_DEFAULT_RATE);
+    history_start(HISTORY_DIR);
+    seed_game_random((unsigned long long)time(NULL) ^ ((unsigned long long)getpid() << 32));
+    timer_start();
+    // Un travailleur par processeur exécute les acteurs des parties et les commandes coûteuses
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (pool_start(cpu_count > 1 ? (int)cpu_count : 2) != 0)
+    {
+        perror("Erreur de création des travailleurs");
+        exit(EXIT_FAILURE);
+    }
+
+    // Création du socket serveur
+    server_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_sockfd < 0)
+    {
+        perror("Erreur de création du socket");
+        exit(EXIT_FAILURE);
+    }
+
+    // Forcer la réutilisation de l'adresse
+    int opt = 1;
+    if (setsockopt(server_sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    {
+        perror("setsockopt");
+        exit(EXIT_FAILURE);
+    }
+
+    // Configuration de l'adresse du serveur
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(PORT);
+
+    // Liaison du socket
+    if (bind(server_sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    {
+        perror("Erreur de liaison");
+        exit(EXIT_FAILURE);
+    }
+
+    // Écoute
+    if (listen(server_sockfd, 10) < 0)
+    {
+        perror("Erreur d'écoute");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Serveur en attente de joueurs sur le port %d, journal dans %s\n", PORT, JOURNAL_FILE);
+    JOURNAL(LOG_INFO, LOG_NONE, LOG_NONE, "Serveur en attente de joueurs sur le port %d", PORT);
+
+    // Fichier des comptes : seul l'en-tête est lu, les comptes le sont à la connexion de leur joueur
+    if (accounts_open(ACCOUNTS_FILE, ACCOUNTS_OVERFLOW_FILE) != 0)
+    {
+        perror("Fichier des comptes");
+        exit(EXIT_FAILURE);
+    }
+    // Charger les administrateurs et les commandes
+    load_admins();
+    init_commands();
+    start_heartbeats();
+    start_session_sweep();
+    // Table de finales pour /conseil, facultative
+    load_endgame_table(TABLEBASE_FILE);
+    // Console d'administration
+    if (admin_start(ADMIN_SOCKET) == 0)
+    {
+        printf("Console d'administration sur %s\n", ADMIN_SOCKET);
+    }
+    // File d'attente des joueurs quand le serveur est plein
+    if (admission_start(start_client, drop_waiting_client) != 0)
+    {
+        perror("Erreur de création de la file d'attente");
+    }
+
+    socklen_t clilen = sizeof(client_addr);
+
+    while (1)
+    {
+        new_sockfd = accept(server_sockfd, (struct sockaddr *)&client_addr, &clilen);
+        if (new_sockfd < 0)
+        {
+            JOURNAL(LOG_ERROR, LOG_NONE, LOG_NONE, "Erreur d'acceptation : %s", strerror(errno));
+            continue;
+        }
+
+        configure_client_socket(new_sockfd);
+        connection_t *connection = (connection_t *)calloc(1, sizeof(connection_t));
+        player_t *player = create_player(new_sockfd, &tcp_transport, NULL);
+        if (connection == NULL || player == NULL)
+        {
+            free_connection(connection);
+            if (player != NULL)
+            {
+                destroy_player(player);
+            }
+            close(new_sockfd);
+            continue;
+        }
+        connection->player = player;
+
+        // Recevoir le pseudo, ou le jeton d'une session à reprendre
+        char first_line[BUFFER_SIZE];
+        if (read_line(player->sockfd, &connection->reader, first_line, sizeof(first_line)) < 0)
+        {
+            close(player->sockfd);
+            destroy_player(player);
+            free_connection(connection);
+            continue;
+        }
+        if (strncmp(first_line, RESUME_COMMAND, strlen(RESUME_COMMAND)) == 0)
+        {
+            // La reprise peut attendre la fermeture de l'ancienne connexion : elle a son propre thread
+            pthread_t thread;
+            connection->resume_token = strdup(first_line + strlen(RESUME_COMMAND));
+            if (connection->resume_token == NULL || pthread_create(&thread, NULL, resume_handler, (void *)connection) != 0)
+            {
+                close(player->sockfd);
+                destroy_player(player);
+                free_connection(connection);
+                continue;
+            }
+            pthread_detach(thread);
+            continue;
+        }
+        finish_login(connection, first_line, NULL);
+    }
+
+    close(server_sockfd);
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "minuteur.h"
+#include "verrous.h"
+
+// Tas binaire des échéances, la plus proche en tête
+timer_entry_t *timers = NULL;
+int timer_count = 0;
+int timer_capacity = 0;
+unsigned long timer_sequence = 0;
+pthread_mutex_t timers_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t timers_cond;
+
+static unsigned long long monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int timer_before(const timer_entry_t *a, const timer_entry_t *b)
+{
+    if (a->deadline_ns != b->deadline_ns)
+    {
+        return a->deadline_ns < b->deadline_ns;
+    }
+    return a->sequence < b->sequence;
+}
+
+/*
+    Ajouter une échéance au tas. Retourne -1 si le tas ne peut pas grandir : l'échéance n'est pas programmée.
+*/
+static int heap_push(timer_entry_t entry)
+{
+    if (timer_count == timer_capacity)
+    {
+        int new_capacity = timer_capacity == 0 ? TIMER_INITIAL_CAPACITY : timer_capacity * 2;
+        timer_entry_t *new_timers = realloc(timers, sizeof(timer_entry_t) * new_capacity);
+        if (new_timers == NULL)
+        {
+            perror("realloc");
+            return -1;
+        }
+        timers = new_timers;
+        timer_capacity = new_capacity;
+    }
+
+    int i = timer_count++;
+    while (i > 0 && timer_before(&entry, &timers[(i - 1) / 2]))
+    {
+        timers[i] = timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    timers[i] = entry;
+    return 0;
+}
+
+static timer_entry_t heap_pop()
+{
+    timer_entry_t top = timers[0];
+    timer_entry_t last = timers[--timer_count];
+
+    int i = 0;
+    while (2 * i + 1 < timer_count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < timer_count && timer_before(&timers[child + 1], &timers[child]))
+        {
+            child++;
+        }
+        if (!timer_before(&timers[child], &last))
+        {
+            break;
+        }
+        timers[i] = timers[child];
+        i = child;
+    }
+    if (timer_count > 0)
+    {
+        timers[i] = last;
+    }
+    return top;
+}
+
+/*
+    Programmer un rappel dans delay_ms millisecondes. Retourne -1 si la mémoire manque : le rappel ne
+    sera jamais exécuté et l'appelant reprend ce qu'il lui confiait (arg).
+*/
+int timer_schedule(long delay_ms, timer_callback_t callback, void *arg)
+{
+    timer_entry_t entry;
+    entry.deadline_ns = monotonic_ns() + (unsigned long long)delay_ms * 1000000ULL;
+    entry.callback = callback;
+    entry.arg = arg;
+
+    LOCK(&timers_mutex);
+    entry.sequence = timer_sequence++;
+    if (heap_push(entry) != 0)
+    {
+        UNLOCK(&timers_mutex);
+        return -1;
+    }
+    // Réveiller le thread si la nouvelle échéance passe en tête
+    if (timers[0].sequence == entry.sequence)
+    {
+        pthread_cond_signal(&timers_cond);
+    }
+    UNLOCK(&timers_mutex);
+    return 0;
+}
+
+int timer_pending()
+{
+    LOCK(&timers_mutex);
+    int count = timer_count;
+    UNLOCK(&timers_mutex);
+    return count;
+}
+
+static void *timer_thread(void *arg)
+{
+    LOCK(&timers_mutex);
+    while (1)
+    {
+        if (timer_count == 0)
+        {
+            pthread_cond_wait(&timers_cond, &timers_mutex);
+            continue;
+        }
+
+        unsigned long long now = monotonic_ns();
+        if (timers[0].deadline_ns > now)
+        {
+            struct timespec deadline;
+            deadline.tv_sec = timers[0].deadline_ns / 1000000000ULL;
+            deadline.tv_nsec = timers[0].deadline_ns % 1000000000ULL;
+            pthread_cond_timedwait(&timers_cond, &timers_mutex, &deadline);
+            continue;
+        }
+
+        // Le rappel s'exécute sans le verrou : il peut programmer d'autres échéances
+        timer_entry_t entry = heap_pop();
+        UNLOCK(&timers_mutex);
+        long next_ms = entry.callback(entry.arg);
+        LOCK(&timers_mutex);
+
+        if (next_ms > 0)
+        {
+            entry.deadline_ns = monotonic_ns() + (unsigned long long)next_ms * 1000000ULL;
+            entry.sequence = timer_sequence++;
+            if (heap_push(entry) != 0)
+            {
+                // Rappel périodique perdu : le tas n'a pas pu grandir depuis que l'échéance en est sortie
+                fprintf(stderr, "Minuterie : rappel périodique abandonné faute de mémoire\n");
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+    Lancer le thread de la minuterie
+*/
+int timer_start()
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timers_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, timer_thread, NULL) != 0)
+    {
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
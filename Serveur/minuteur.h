@@ -0,0 +1,30 @@
+#ifndef MINUTEUR_H
+#define MINUTEUR_H
+
+/*
+    Service de minuterie : un seul thread exécute toutes les échéances du serveur (battements de cœur,
+    attentes de reconnexion) au lieu d'un thread par connexion ou par partie.
+    Les rappels s'exécutent sur ce thread et doivent rester courts.
+*/
+
+// Constants
+#define TIMER_INITIAL_CAPACITY 64
+
+// Un rappel retourne le délai avant sa prochaine exécution en millisecondes, ou 0 pour s'arrêter
+typedef long (*timer_callback_t)(void *arg);
+
+// Structures
+typedef struct timer_entry_t
+{
+    unsigned long long deadline_ns; // CLOCK_MONOTONIC
+    unsigned long sequence;         // Départage des échéances identiques, dans l'ordre de programmation
+    timer_callback_t callback;
+    void *arg;
+} timer_entry_t;
+
+// Prototypes
+int timer_start();
+int timer_schedule(long delay_ms, timer_callback_t callback, void *arg);
+int timer_pending();
+
+#endif
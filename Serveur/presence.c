@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "presence.h"
+#include "verrous.h"
+
+presence_entry_t *presence = NULL; // Trié par pseudo
+int presence_count = 0;
+int presence_capacity = 0;
+pthread_mutex_t presence_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+    Première entrée dont les length premiers caractères ne sont pas avant key (length 0 : comparaison complète)
+*/
+static int lower_bound(const char *key, size_t length)
+{
+    int low = 0, high = presence_count;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        int order = length > 0 ? strncmp(presence[middle].pseudo, key, length) : strcmp(presence[middle].pseudo, key);
+        if (order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*
+    Première entrée qui ne commence pas par le préfixe, après celles qui commencent par lui
+*/
+static int prefix_end(const char *prefix, size_t length)
+{
+    int low = 0, high = presence_count;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (strncmp(presence[middle].pseudo, prefix, length) <= 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void set_entry(presence_entry_t *entry, const char *pseudo, int wins, int losses, int draws)
+{
+    snprintf(entry->pseudo, sizeof(entry->pseudo), "%s", pseudo);
+    entry->wins = wins;
+    entry->losses = losses;
+    entry->draws = draws;
+}
+
+/*
+    Ajouter un joueur qui vient de se connecter, ou mettre à jour son entrée
+*/
+void presence_add(const char *pseudo, int wins, int losses, int draws)
+{
+    LOCK(&presence_mutex);
+    int index = lower_bound(pseudo, 0);
+    if (index < presence_count && strcmp(presence[index].pseudo, pseudo) == 0)
+    {
+        set_entry(&presence[index], pseudo, wins, losses, draws);
+        UNLOCK(&presence_mutex);
+        return;
+    }
+
+    if (presence_count == presence_capacity)
+    {
+        int new_capacity = presence_capacity == 0 ? 64 : presence_capacity * 2;
+        presence_entry_t *new_presence = realloc(presence, sizeof(presence_entry_t) * new_capacity);
+        if (new_presence == NULL)
+        {
+            UNLOCK(&presence_mutex);
+            return;
+        }
+        presence = new_presence;
+        presence_capacity = new_capacity;
+    }
+    memmove(&presence[index + 1], &presence[index], sizeof(presence_entry_t) * (presence_count - index));
+    set_entry(&presence[index], pseudo, wins, losses, draws);
+    presence_count++;
+    UNLOCK(&presence_mutex);
+}
+
+/*
+    Mettre à jour le score d'un joueur connecté ; un joueur absent de l'index n'y est pas ajouté
+*/
+void presence_update(const char *pseudo, int wins, int losses, int draws)
+{
+    LOCK(&presence_mutex);
+    int index = lower_bound(pseudo, 0);
+    if (index < presence_count && strcmp(presence[index].pseudo, pseudo) == 0)
+    {
+        set_entry(&presence[index], pseudo, wins, losses, draws);
+    }
+    UNLOCK(&presence_mutex);
+}
+
+void presence_remove(const char *pseudo)
+{
+    LOCK(&presence_mutex);
+    int index = lower_bound(pseudo, 0);
+    if (index < presence_count && strcmp(presence[index].pseudo, pseudo) == 0)
+    {
+        memmove(&presence[index], &presence[index + 1], sizeof(presence_entry_t) * (presence_count - index - 1));
+        presence_count--;
+    }
+    UNLOCK(&presence_mutex);
+}
+
+/*
+    Page (à partir de 1) des joueurs connectés dont le pseudo commence par prefix (vide : tous)
+*/
+void presence_query(const char *prefix, int page, presence_page_t *result)
+{
+    size_t length = strlen(prefix);
+
+    LOCK(&presence_mutex);
+    int first = length > 0 ? lower_bound(prefix, length) : 0;
+    int last = length > 0 ? prefix_end(prefix, length) : presence_count;
+    result->total = last - first;
+    int start = first + (page - 1) * PRESENCE_PAGE_SIZE;
+    result->count = start < last ? last - start : 0;
+    if (result->count > PRESENCE_PAGE_SIZE)
+    {
+        result->count = PRESENCE_PAGE_SIZE;
+    }
+    if (result->count > 0)
+    {
+        memcpy(result->entries, &presence[start], sizeof(presence_entry_t) * result->count);
+    }
+    UNLOCK(&presence_mutex);
+}
@@ -0,0 +1,38 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <pthread.h>
+
+/*
+    Index des joueurs connectés pour /joueurs, trié par pseudo. Il est tenu à jour à chaque connexion,
+    déconnexion et changement de score : une requête cherche son préfixe par dichotomie et ne copie
+    qu'une page, sans parcourir la liste des joueurs ni prendre le verrou d'un joueur.
+*/
+
+// Constants
+#define PRESENCE_PAGE_SIZE 20
+#define PRESENCE_NAME_SIZE 32
+
+// Structures
+typedef struct presence_entry_t
+{
+    char pseudo[PRESENCE_NAME_SIZE];
+    int wins;
+    int losses;
+    int draws;
+} presence_entry_t;
+
+typedef struct presence_page_t
+{
+    int total; // Joueurs connectés dont le pseudo commence par le préfixe
+    int count; // Entrées de cette page
+    presence_entry_t entries[PRESENCE_PAGE_SIZE];
+} presence_page_t;
+
+// Prototypes
+void presence_add(const char *pseudo, int wins, int losses, int draws);
+void presence_update(const char *pseudo, int wins, int losses, int draws);
+void presence_remove(const char *pseudo);
+void presence_query(const char *prefix, int page, presence_page_t *result);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+    Modèle des règles d'une variante, inclus une fois par variante dans awale.c après avoir défini :
+        VARIANT_PREFIX      préfixe des fonctions générées (<préfixe>_play et <préfixe>_game_over)
+        VARIANT_PITS        trous par joueur
+        VARIANT_SKIP_ORIGIN à partir de 12 graines, le semis saute le trou de départ
+        VARIANT_GRAND_SLAM  un coup qui prendrait toutes les graines adverses ne capture rien
+        VARIANT_MUST_FEED   un joueur doit nourrir un adversaire sans graines s'il le peut
+    La taille du plateau est une constante dans chaque copie : les boucles sont déroulées et les
+    modulos remplacés par le compilateur, sans test de la variante à l'exécution.
+    Pas de garde d'inclusion : ce fichier est fait pour être inclus plusieurs fois.
+*/
+
+#define VARIANT_SIZE (2 * VARIANT_PITS)
+#define VARIANT_PASTE(prefix, name) prefix##_##name
+#define VARIANT_EXPAND(prefix, name) VARIANT_PASTE(prefix, name)
+#define VARIANT_FUNCTION(name) VARIANT_EXPAND(VARIANT_PREFIX, name)
+
+static inline int VARIANT_FUNCTION(row_seeds)(const int board[], int player_id)
+{
+    int seeds = 0;
+    for (int i = 0; i < VARIANT_PITS; ++i)
+    {
+        seeds += board[player_id * VARIANT_PITS + i];
+    }
+    return seeds;
+}
+
+/*
+    Jouer le trou pit (0 à VARIANT_SIZE - 1) pour le joueur player_id : semer les graines dans le sens
+    du jeu puis capturer en remontant les trous adverses qui contiennent 2 ou 3 graines.
+*/
+int VARIANT_FUNCTION(play)(int board[], int player_id, int pit)
+{
+    int start = player_id * VARIANT_PITS;
+
+    // Vérification que le joueur joue dans sa propre rangée
+    if (pit < start || pit >= start + VARIANT_PITS)
+    {
+        return -1; // Mouvement invalide : hors de la rangée du joueur
+    }
+
+    int seeds = board[pit];
+    if (seeds == 0)
+    {
+        return -1; // Mouvement invalide : trou vide
+    }
+
+#if VARIANT_MUST_FEED
+    // Un coup qui n'atteint pas l'adversaire affamé est refusé s'il existe un coup qui le nourrit
+    if (VARIANT_FUNCTION(row_seeds)(board, 1 - player_id) == 0 && seeds < start + VARIANT_PITS - pit)
+    {
+        for (int i = start; i < start + VARIANT_PITS; ++i)
+        {
+            if (board[i] >= start + VARIANT_PITS - i)
+            {
+                return -1; // Mouvement invalide : l'adversaire doit être nourri
+            }
+        }
+    }
+#endif
+
+    board[pit] = 0; // On vide le trou choisi
+    int current_pit = pit;
+
+    // Semer les graines dans les trous suivants
+    while (seeds > 0)
+    {
+        current_pit = (current_pit + 1) % VARIANT_SIZE;
+#if VARIANT_SKIP_ORIGIN
+        if (current_pit == pit)
+        {
+            continue;
+        }
+#endif
+        board[current_pit]++;
+        seeds--;
+    }
+
+    // Remonter dans les trous adverses tant qu'ils contiennent 2 ou 3 graines
+    int opponent_start = (1 - player_id) * VARIANT_PITS;
+    int last_pit = current_pit;
+    int captured_seeds = 0;
+    while (current_pit >= opponent_start && current_pit < opponent_start + VARIANT_PITS &&
+           (board[current_pit] == 2 || board[current_pit] == 3))
+    {
+        captured_seeds += board[current_pit];
+        current_pit--;
+    }
+
+#if VARIANT_GRAND_SLAM
+    // Grand chelem : le coup est joué mais ne capture rien
+    if (captured_seeds > 0 && captured_seeds == VARIANT_FUNCTION(row_seeds)(board, 1 - player_id))
+    {
+        return 0;
+    }
+#endif
+
+    for (int i = current_pit + 1; i <= last_pit; ++i)
+    {
+        board[i] = 0;
+    }
+    return captured_seeds;
+}
+
+/*
+    Fin de partie quand player_id doit jouer
+*/
+int VARIANT_FUNCTION(game_over)(const int board[], int player_id)
+{
+#if VARIANT_MUST_FEED
+    // La partie continue tant que le joueur au trait a un coup valide
+    int start = player_id * VARIANT_PITS;
+    int starving = VARIANT_FUNCTION(row_seeds)(board, 1 - player_id) == 0;
+    for (int i = start; i < start + VARIANT_PITS; ++i)
+    {
+        if (board[i] > 0 && (!starving || board[i] >= start + VARIANT_PITS - i))
+        {
+            return 0;
+        }
+    }
+    return 1;
+#else
+    // Un des joueurs n'a plus de graines dans son camp
+    return VARIANT_FUNCTION(row_seeds)(board, 0) == 0 || VARIANT_FUNCTION(row_seeds)(board, 1) == 0;
+#endif
+}
+
+#undef VARIANT_FUNCTION
+#undef VARIANT_EXPAND
+#undef VARIANT_PASTE
+#undef VARIANT_SIZE
+#undef VARIANT_PREFIX
+#undef VARIANT_PITS
+#undef VARIANT_SKIP_ORIGIN
+#undef VARIANT_GRAND_SLAM
+#undef VARIANT_MUST_FEED
@@ -1,167 +1,133 @@
 #include "serveur.h"
+#include "tournoi.h"
+#include "admission.h"
 
-player_t *players[MAX_PLAYERS];
+player_t **players = NULL; // Tableau extensible jusqu'à max_players
 int player_count = 0;
+int players_capacity = 0;
+int max_players = MAX_PLAYERS;
 pthread_mutex_t players_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-game_t *games[MAX_GAMES];
+game_t **games = NULL; // Tableau extensible : les parties de tournoi ne sont pas limitées par MAX_GAMES
 int game_count = 0;
+int games_capacity = 0;
+int casual_game_count = 0; // Parties issues d'un défi, limitées à MAX_GAMES
 int game_id_counter = 1;
+int connection_id_counter = 0;
+int heartbeat_interval = HEARTBEAT_INTERVAL;
+int idle_timeout = IDLE_TIMEOUT;
 pthread_mutex_t games_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-user_credentials_t users[MAX_USERS];
-int user_count = 0;
-pthread_mutex_t users_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+unsigned long long game_random_state = 0; // Graine des tirages du jeu, fixée par seed_game_random
 
-user_score_t user_scores[MAX_USERS];
-int score_count = 0;
-pthread_mutex_t scores_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static void start_reconnection_timer(game_t *game);
+reconnection_wait_t start_reconnection_wait = start_reconnection_timer;
+static void handle_game_message(actor_t *actor, actor_message_t *link);
+static void release_game_actor(actor_t *actor);
+static void give_advice(game_t *game, player_t *player, int player_id);
 
-void load_scores()
+// ********************************************************************************* //
+
+// Transport
+
+static ssize_t tcp_send(int sockfd, void *ctx, const char *data, size_t length)
 {
-    pthread_mutex_lock(&scores_file_mutex);
-    FILE *file = fopen(SCORES_FILE, "rb");
-    if (file != NULL)
-    {
-        fread(&score_count, sizeof(int), 1, file);
-        fread(user_scores, sizeof(user_score_t), score_count, file);
-        fclose(file);
-    }
-    else
-    {
-        // Si le fichier n'existe pas, on initialise le score_count à 0
-        score_count = 0;
-    }
-    pthread_mutex_unlock(&scores_file_mutex);
+    return send(sockfd, data, length, MSG_NOSIGNAL);
 }
 
-void save_scores()
+static void tcp_close(int sockfd, void *ctx)
 {
-    pthread_mutex_lock(&scores_file_mutex);
-    FILE *file = fopen(SCORES_FILE, "wb");
-    if (file != NULL)
-    {
-        fwrite(&score_count, sizeof(int), 1, file);
-        fwrite(user_scores, sizeof(user_score_t), score_count, file);
-        fclose(file);
-    }
-    pthread_mutex_unlock(&scores_file_mutex);
+    close(sockfd);
 }
 
-int find_score_index(const char *pseudo)
+static void tcp_shutdown(int sockfd, void *ctx)
 {
-    for (int i = 0; i < score_count; ++i)
-    {
-        if (strcmp(user_scores[i].pseudo, pseudo) == 0)
-        {
-            return i;
-        }
-    }
-    return -1;
+    shutdown(sockfd, SHUT_RDWR);
 }
 
-int load_player_score(player_t *player)
+const transport_t tcp_transport = {tcp_send, tcp_close, NULL, tcp_shutdown};
+
+/*
+    Envoyer un message à un joueur par son transport
+*/
+int send_to_player(player_t *player, const char *message)
 {
-    pthread_mutex_lock(&player->player_mutex);
-    int index = find_score_index(player->pseudo);
-    if (index == -1)
-    {
-        // Si le joueur n'a pas encore de score, on l'initialise
-        strcpy(user_scores[score_count].pseudo, player->pseudo);
-        user_scores[score_count].wins = 0;
-        user_scores[score_count].losses = 0;
-        user_scores[score_count].draws = 0;
-        index = score_count;
-        score_count++;
-        save_scores();
-    }
-    // Charger les scores dans le joueur
-    player->wins = user_scores[index].wins;
-    player->losses = user_scores[index].losses;
-    player->draws = user_scores[index].draws;
-    pthread_mutex_unlock(&player->player_mutex);
-    return 0;
+    unsigned long long trace_start = TRACE_START();
+    int sent = player->transport->send(player->sockfd, player->transport_ctx, message, strlen(message));
+    TRACE_END("envoi", NULL, trace_start);
+    return sent;
 }
 
-void update_player_score(player_t *player)
+/*
+    Initialiser la graine des tirages du jeu (qui commence une partie), pour rejouer une simulation à l'identique
+*/
+void seed_game_random(unsigned long long seed)
 {
-    pthread_mutex_lock(&player->player_mutex);
-    int index = find_score_index(player->pseudo);
-    if (index != -1)
-    {
-        user_scores[index].wins = player->wins;
-        user_scores[index].losses = player->losses;
-        user_scores[index].draws = player->draws;
-        save_scores();
-    }
-    pthread_mutex_unlock(&player->player_mutex);
+    __atomic_store_n(&game_random_state, seed, __ATOMIC_RELAXED);
 }
 
+/*
+    Tirage pseudo-aléatoire (splitmix64), sans état partagé avec rand()
+*/
+unsigned int game_random()
+{
+    unsigned long long z = __atomic_add_fetch(&game_random_state, 0x9E3779B97F4A7C15ULL, __ATOMIC_RELAXED);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((z ^ (z >> 31)) >> 32);
+}
 
+// ********************************************************************************* //
 
-void load_users()
+/*
+    Charger le bilan du joueur depuis son compte. Un joueur sans compte (simulation) garde un bilan vide.
+*/
+int load_player_score(player_t *player)
 {
-    pthread_mutex_lock(&users_file_mutex);
-    FILE *file = fopen(USERS_FILE, "rb");
-    if (file != NULL)
+    account_t account;
+    LOCK(&player->player_mutex);
+    if (account_find(player->pseudo, &account) == 1)
     {
-        fread(&user_count, sizeof(int), 1, file);
-        fread(users, sizeof(user_credentials_t), user_count, file);
-        fclose(file);
+        player->wins = account.wins;
+        player->losses = account.losses;
+        player->draws = account.draws;
     }
-    pthread_mutex_unlock(&users_file_mutex);
+    UNLOCK(&player->player_mutex);
+    return 0;
 }
 
-void save_users()
+void update_player_score(player_t *player)
 {
-    pthread_mutex_lock(&users_file_mutex);
-    FILE *file = fopen(USERS_FILE, "wb");
-    if (file != NULL)
-    {
-        fwrite(&user_count, sizeof(int), 1, file);
-        fwrite(users, sizeof(user_credentials_t), user_count, file);
-        fclose(file);
-    }
-    pthread_mutex_unlock(&users_file_mutex);
+    LOCK(&player->player_mutex);
+    account_update_scores(player->pseudo, player->wins, player->losses, player->draws);
+    presence_update(player->pseudo, player->wins, player->losses, player->draws);
+    UNLOCK(&player->player_mutex);
 }
 
-int find_user_index(const char *pseudo)
+/*
+    Retourne 1 si le pseudo a un compte, 0 sinon
+*/
+int user_exists(const char *pseudo)
 {
-    for (int i = 0; i < user_count; ++i)
-    {
-        if (strcmp(users[i].pseudo, pseudo) == 0)
-        {
-            return i;
-        }
-    }
-    return -1;
+    account_t account;
+    return account_find(pseudo, &account) == 1;
 }
 
 int register_user(const char *pseudo, const char *password)
 {
-    if (user_count >= MAX_USERS)
-    {
-        return -1; // Trop d'utilisateurs
-    }
-
-    // Ajouter l'utilisateur
-    strcpy(users[user_count].pseudo, pseudo);
-    strcpy(users[user_count].password, password);
-    user_count++;
-
-    save_users();
-    return 0;
+    // Échoue aussi si le même pseudo vient d'être enregistré par une autre connexion
+    return account_create(pseudo, password) == 0 ? 0 : -1;
 }
 
 int verify_user_password(const char *pseudo, const char *password)
 {
-    int index = find_user_index(pseudo);
-    if (index == -1)
+    account_t account;
+    if (account_find(pseudo, &account) != 1)
     {
         return -1; // Utilisateur non trouvé
     }
 
-    if (strcmp(users[index].password, password) == 0)
+    if (strcmp(account.password, password) == 0)
     {
         return 0; // Mot de passe correct
     }
@@ -173,16 +139,36 @@ int verify_user_password(const char *pseudo, const char *password)
 
 void broadcast_to_all(char *message, player_t *sender)
 {
-    pthread_mutex_lock(&players_mutex);
+    // On copie les destinations sous le verrou et on envoie après, pour ne pas bloquer la liste des joueurs pendant les envois
+    endpoint_t *endpoints;
+    int endpoint_count = 0;
+
+    LOCK(&players_mutex);
+    endpoints = malloc(sizeof(endpoint_t) * (player_count > 0 ? player_count : 1));
+    if (endpoints == NULL)
+    {
+        UNLOCK(&players_mutex);
+        return;
+    }
     for (int i = 0; i < player_count; ++i)
     {
         player_t *p = players[i];
         if (p->connected && p != sender)
         {
-            send(p->sockfd, message, strlen(message), 0);
+            endpoints[endpoint_count].transport = p->transport;
+            endpoints[endpoint_count].ctx = p->transport_ctx;
+            endpoints[endpoint_count].sockfd = p->sockfd;
+            endpoint_count++;
         }
     }
-    pthread_mutex_unlock(&players_mutex);
+    UNLOCK(&players_mutex);
+
+    size_t length = strlen(message);
+    for (int i = 0; i < endpoint_count; ++i)
+    {
+        endpoints[i].transport->send(endpoints[i].sockfd, endpoints[i].ctx, message, length);
+    }
+    free(endpoints);
 }
 
 /*
@@ -191,7 +177,7 @@ void broadcast_to_all(char *message, player_t *sender)
 void send_private_message(player_t *sender, const char *target_pseudo, const char *message)
 {
     char buffer[BUFFER_SIZE];
-    pthread_mutex_lock(&players_mutex);
+    LOCK(&players_mutex);
     player_t *target_player = NULL;
     for (int i = 0; i < player_count; ++i)
     {
@@ -201,20 +187,31 @@ void send_private_message(player_t *sender, const char *target_pseudo, const cha
             break;
         }
     }
-    pthread_mutex_unlock(&players_mutex);
+    UNLOCK(&players_mutex);
 
     if (target_player == NULL)
     {
-        snprintf(buffer, sizeof(buffer), RED "Le joueur %s n'est pas connecté.\n" RESET, target_pseudo);
-        send(sender->sockfd, buffer, strlen(buffer), 0);
+        // Un joueur inscrit mais absent recevra le message à sa prochaine connexion
+        if (history_global() != NULL && user_exists(target_pseudo))
+        {
+            history_append(history_private_channel(sender->pseudo, target_pseudo, 1), sender->pseudo, target_pseudo, message);
+            snprintf(buffer, sizeof(buffer), MAGENTA "[MP à %s] %s\n" RESET YELLOW "%s n'est pas connecté, le message lui sera remis à sa prochaine connexion.\n" RESET,
+                     target_pseudo, message, target_pseudo);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), RED "Le joueur %s n'est pas connecté.\n" RESET, target_pseudo);
+        }
+        send_to_player(sender, buffer);
         return;
     }
 
+    history_append(history_private_channel(sender->pseudo, target_pseudo, 1), sender->pseudo, target_pseudo, message);
     snprintf(buffer, sizeof(buffer), MAGENTA "[MP de %s] %s\n" RESET, sender->pseudo, message);
-    send(target_player->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(target_player, buffer);
 
     snprintf(buffer, sizeof(buffer), MAGENTA "[MP à %s] %s\n" RESET, target_pseudo, message);
-    send(sender->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(sender, buffer);
 }
 
 /*
@@ -223,28 +220,17 @@ void send_private_message(player_t *sender, const char *target_pseudo, const cha
 void chat_in_game(player_t *player, int game_id, const char *message)
 {
     char buffer[BUFFER_SIZE];
-    pthread_mutex_lock(&player->player_mutex);
-    game_t *game = NULL;
-    for (int i = 0; i < player->game_count; ++i)
-    {
-        if (player->games[i]->game_id == game_id)
-        {
-            game = player->games[i];
-            break;
-        }
-    }
-    pthread_mutex_unlock(&player->player_mutex);
+    int player_id;
+    game_t *game = find_player_game(player, game_id, &player_id);
 
     if (game != NULL)
     {
-        player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
-        snprintf(buffer, sizeof(buffer), MAGENTA "[Partie %d] %s: %s\n" RESET, game_id, player->pseudo, message);
-        send(other_player->sockfd, buffer, strlen(buffer), 0);
+        post_game_message(game, GAME_MESSAGE_CHAT, player_id, 0, message);
     }
     else
     {
         snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans la partie %d.\n" RESET, game_id);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
     }
 }
 
@@ -253,12 +239,12 @@ void chat_in_game(player_t *player, int game_id, const char *message)
 /*
     Envoyer un défi
 */
-void challenge_player(player_t *player, const char *target_pseudo)
+void challenge_player(player_t *player, const char *target_pseudo, const variant_t *variant)
 {
     char buffer[BUFFER_SIZE];
 
     // On récupère l'adversaire
-    pthread_mutex_lock(&players_mutex);
+    LOCK(&players_mutex);
     player_t *target_player = NULL;
     for (int i = 0; i < player_count; ++i)
     {
@@ -268,13 +254,13 @@ void challenge_player(player_t *player, const char *target_pseudo)
             break;
         }
     }
-    pthread_mutex_unlock(&players_mutex);
+    UNLOCK(&players_mutex);
 
     // Le joueur n'est pas connecté
     if (target_player == NULL)
     {
         snprintf(buffer, sizeof(buffer), RED "Le joueur %s n'est pas connecté.\n" RESET, target_pseudo);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
         return;
     }
 
@@ -282,45 +268,54 @@ void challenge_player(player_t *player, const char *target_pseudo)
     if (target_player == player)
     {
         snprintf(buffer, sizeof(buffer), RED "Vous ne pouvez pas vous défier vous-même.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
         return;
     }
 
-    pthread_mutex_lock(&player->player_mutex);
-    pthread_mutex_lock(&target_player->player_mutex);
+    LOCK(&player->player_mutex);
+    LOCK(&target_player->player_mutex);
 
     // On ne peut pas avoir plusieurs défi à la fois.
     if (player->challenge_sent || player->challenge_received)
     {
         snprintf(buffer, sizeof(buffer), RED "Vous avez déjà un défi en cours.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
-        pthread_mutex_unlock(&target_player->player_mutex);
-        pthread_mutex_unlock(&player->player_mutex);
+        send_to_player(player, buffer);
+        UNLOCK(&target_player->player_mutex);
+        UNLOCK(&player->player_mutex);
         return;
     }
 
     if (target_player->challenge_received || target_player->challenge_sent)
     {
         snprintf(buffer, sizeof(buffer), RED "Le joueur %s est déjà en défi.\n" RESET, target_pseudo);
-        send(player->sockfd, buffer, strlen(buffer), 0);
-        pthread_mutex_unlock(&target_player->player_mutex);
-        pthread_mutex_unlock(&player->player_mutex);
+        send_to_player(player, buffer);
+        UNLOCK(&target_player->player_mutex);
+        UNLOCK(&player->player_mutex);
         return;
     }
 
     player->challenge_sent = 1;
     player->challengee = target_player;
+    player->challenge_variant = variant;
     target_player->challenge_received = 1;
     target_player->challenger = player;
 
-    snprintf(buffer, sizeof(buffer), YELLOW "%s vous a défié en duel ! Tapez /accepter pour accepter ou /refuser pour refuser.\n" RESET, player->pseudo);
-    send(target_player->sockfd, buffer, strlen(buffer), 0);
+    if (variant == DEFAULT_VARIANT)
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "%s vous a défié en duel ! Tapez /accepter pour accepter ou /refuser pour refuser.\n" RESET, player->pseudo);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "%s vous a défié en duel, variante %s (%s) ! Tapez /accepter pour accepter ou /refuser pour refuser.\n" RESET,
+                 player->pseudo, variant->name, variant->description);
+    }
+    send_to_player(target_player, buffer);
 
     snprintf(buffer, sizeof(buffer), GREEN "Défi envoyé à %s.\n" RESET, target_pseudo);
-    send(player->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(player, buffer);
 
-    pthread_mutex_unlock(&target_player->player_mutex);
-    pthread_mutex_unlock(&player->player_mutex);
+    UNLOCK(&target_player->player_mutex);
+    UNLOCK(&player->player_mutex);
 }
 
 /*
@@ -329,47 +324,51 @@ void challenge_player(player_t *player, const char *target_pseudo)
 void accept_challenge(player_t *player)
 {
     char buffer[BUFFER_SIZE];
-    pthread_mutex_lock(&player->player_mutex);
+    LOCK(&player->player_mutex);
 
     // Aucun défi en attente
     if (!player->challenge_received || player->challenger == NULL)
     {
         snprintf(buffer, sizeof(buffer), RED "Vous n'avez aucun défi à accepter.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
-        pthread_mutex_unlock(&player->player_mutex);
+        send_to_player(player, buffer);
+        UNLOCK(&player->player_mutex);
         return;
     }
 
     player_t *challenger = player->challenger;
 
-    pthread_mutex_lock(&challenger->player_mutex);
+    LOCK(&challenger->player_mutex);
 
-    // Créer une nouvelle partie
-    game_t *new_game = (game_t *)malloc(sizeof(game_t));
+    // Vérifier les limites de parties (les parties de tournoi ne comptent pas)
+    LOCK(&games_mutex);
+    int server_full = casual_game_count >= MAX_GAMES;
+    UNLOCK(&games_mutex);
 
-    // On récupère l'id à partir du compteur global
-    pthread_mutex_lock(&games_mutex);
-    new_game->game_id = game_id_counter++;
-    pthread_mutex_unlock(&games_mutex);
+    if (server_full || count_casual_games(player) >= MAX_GAMES_PER_PLAYER || count_casual_games(challenger) >= MAX_GAMES_PER_PLAYER)
+    {
+        if (server_full)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Trop de parties en cours sur le serveur. Réessayez plus tard.\n" RESET);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), RED "Impossible de lancer la partie : %d parties en cours au maximum par joueur.\n" RESET, MAX_GAMES_PER_PLAYER);
+        }
+        send_to_player(challenger, buffer);
+        send_to_player(player, buffer);
 
-    new_game->player1 = challenger;
-    new_game->player2 = player;
-    init_board(new_game->board);
-    new_game->turn = rand() % 2; // On choisie aléatoirement qui commence
-    new_game->game_over = 0;
-    new_game->waiting_reconnect = 0;
-    pthread_mutex_init(&new_game->game_mutex, NULL);
-    new_game->player1_score = 0;
-    new_game->player2_score = 0;
+        challenger->challenge_sent = 0;
+        challenger->challengee = NULL;
+        player->challenge_received = 0;
+        player->challenger = NULL;
 
-    // On ajoute la partie à la liste des parties
-    pthread_mutex_lock(&games_mutex);
-    games[game_count++] = new_game;
-    pthread_mutex_unlock(&games_mutex);
+        UNLOCK(&challenger->player_mutex);
+        UNLOCK(&player->player_mutex);
+        return;
+    }
 
-    // Ajouter la partie aux joueurs
-    challenger->games[challenger->game_count++] = new_game;
-    player->games[player->game_count++] = new_game;
+    // Créer une nouvelle partie, on choisit aléatoirement qui commence
+    game_t *new_game = create_game(challenger, player, game_random() % 2, 0, -1, challenger->challenge_variant);
 
     // Réinitialiser les défis
     challenger->challenge_sent = 0;
@@ -379,30 +378,122 @@ void accept_challenge(player_t *player)
 
     // Informer les joueurs
     snprintf(buffer, sizeof(buffer), GREEN "Défi accepté. La partie %d commence !\n" RESET, new_game->game_id);
-    send(challenger->sockfd, buffer, strlen(buffer), 0);
-    send(player->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(challenger, buffer);
+    send_to_player(player, buffer);
+
+    announce_game_start(new_game);
+
+    UNLOCK(&challenger->player_mutex);
+    UNLOCK(&player->player_mutex);
+}
+
+/*
+    Créer une partie et l'ajouter aux listes. Les mutex des deux joueurs sont déjà vérouillés.
+*/
+game_t *create_game(player_t *player1, player_t *player2, int turn, int tournament_id, int tournament_board, const variant_t *variant)
+{
+    game_t *new_game = (game_t *)malloc(sizeof(game_t));
+
+    new_game->player1 = player1;
+    new_game->player2 = player2;
+    new_game->variant = variant;
+    init_board(new_game->board, variant);
+    new_game->turn = turn;
+    new_game->game_over = 0;
+    new_game->waiting_reconnect = 0;
+    new_game->absent_player = NULL;
+    new_game->reconnect_deadline = 0;
+    new_game->board_version = 0;
+    position_history_init(&new_game->positions, variant, new_game->board, turn);
+    new_game->refs = 1; // Référence de la liste des parties, rendue à la fin de la partie
+    new_game->player1_score = 0;
+    new_game->player2_score = 0;
+    new_game->tournament_id = tournament_id;
+    new_game->tournament_board = tournament_board;
+
+    // On récupère l'id à partir du compteur global et on ajoute la partie à la liste des parties
+    LOCK(&games_mutex);
+    new_game->game_id = game_id_counter++;
+    // Les messages d'une partie vont toujours au même travailleur
+    actor_init(&new_game->actor, handle_game_message, release_game_actor, new_game->game_id);
+    new_game->history = history_game_channel(new_game->game_id);
+    if (game_count >= games_capacity)
+    {
+        games_capacity = games_capacity ? games_capacity * 2 : MAX_GAMES;
+        games = (game_t **)realloc(games, games_capacity * sizeof(game_t *));
+    }
+    games[game_count++] = new_game;
+    if (tournament_id == 0)
+    {
+        casual_game_count++;
+    }
+    UNLOCK(&games_mutex);
+
+    // Ajouter la partie aux joueurs
+    add_game_to_player(player1, new_game);
+    add_game_to_player(player2, new_game);
+    JOURNAL(LOG_INFO, LOG_NONE, new_game->game_id, "Partie créée : %s contre %s (tournoi %d, variante %s)", player1->pseudo, player2->pseudo, tournament_id,
+            variant->name);
+
+    return new_game;
+}
+
+/*
+    Envoyer le plateau initial et annoncer le joueur qui commence
+*/
+void announce_game_start(game_t *game)
+{
+    char buffer[BUFFER_SIZE];
+    player_t *player1 = game->player1;
+    player_t *player2 = game->player2;
 
     // Envoyer le plateau initial aux joueurs
-    print_board(challenger->sockfd, 0, challenger, player, new_game->board, new_game->game_id, new_game);
-    print_board(player->sockfd, 1, player, challenger, new_game->board, new_game->game_id, new_game);
+    print_board(0, player1, player2, game->board, game->game_id, game);
+    print_board(1, player2, player1, game->board, game->game_id, game);
 
     // Informer le joueur qui commence
-    snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] Vous commcencez la partie !\n" RESET, new_game->game_id);
-    if (new_game->turn == 0)
+    snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] Vous commcencez la partie !\n" RESET, game->game_id);
+    if (game->turn == 0)
     {
-        send(challenger->sockfd, buffer, strlen(buffer), 0);
-        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de commcencer la partie.\n" RESET, new_game->game_id);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player1, buffer);
+        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de commcencer la partie.\n" RESET, game->game_id);
+        send_to_player(player2, buffer);
     }
     else
     {
-        send(player->sockfd, buffer, strlen(buffer), 0);
-        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer\n" RESET, new_game->game_id);
-        send(challenger->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player2, buffer);
+        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer\n" RESET, game->game_id);
+        send_to_player(player1, buffer);
+    }
+}
+
+/*
+    Ajouter une partie à la liste (extensible) des parties du joueur. Le mutex du joueur est déjà vérouillé.
+*/
+void add_game_to_player(player_t *player, game_t *game)
+{
+    if (player->game_count >= player->games_capacity)
+    {
+        player->games_capacity = player->games_capacity ? player->games_capacity * 2 : MAX_GAMES_PER_PLAYER;
+        player->games = (game_t **)realloc(player->games, player->games_capacity * sizeof(game_t *));
     }
+    player->games[player->game_count++] = game;
+}
 
-    pthread_mutex_unlock(&challenger->player_mutex);
-    pthread_mutex_unlock(&player->player_mutex);
+/*
+    Nombre de parties hors tournoi du joueur. Le mutex du joueur est déjà vérouillé.
+*/
+int count_casual_games(player_t *player)
+{
+    int count = 0;
+    for (int i = 0; i < player->game_count; ++i)
+    {
+        if (player->games[i]->tournament_id == 0)
+        {
+            count++;
+        }
+    }
+    return count;
 }
 
 /*
@@ -411,23 +502,23 @@ void accept_challenge(player_t *player)
 void refuse_challenge(player_t *player)
 {
     char buffer[BUFFER_SIZE];
-    pthread_mutex_lock(&player->player_mutex);
+    LOCK(&player->player_mutex);
 
     if (!player->challenge_received || player->challenger == NULL)
     {
         snprintf(buffer, sizeof(buffer), RED "Vous n'avez aucun défi à refuser.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
-        pthread_mutex_unlock(&player->player_mutex);
+        send_to_player(player, buffer);
+        UNLOCK(&player->player_mutex);
         return;
     }
 
     player_t *challenger = player->challenger;
 
-    pthread_mutex_lock(&challenger->player_mutex);
+    LOCK(&challenger->player_mutex);
 
     // Informer le challenger
     snprintf(buffer, sizeof(buffer), RED "%s a refusé votre défi.\n" RESET, player->pseudo);
-    send(challenger->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(challenger, buffer);
 
     // Réinitialiser les défis
     challenger->challenge_sent = 0;
@@ -437,10 +528,10 @@ void refuse_challenge(player_t *player)
 
     // Informer le joueur
     snprintf(buffer, sizeof(buffer), GREEN "Vous avez refusé le défi de %s.\n" RESET, challenger->pseudo);
-    send(player->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(player, buffer);
 
-    pthread_mutex_unlock(&challenger->player_mutex);
-    pthread_mutex_unlock(&player->player_mutex);
+    UNLOCK(&challenger->player_mutex);
+    UNLOCK(&player->player_mutex);
 }
 
 /*
@@ -465,12 +556,12 @@ void remove_challenge(player_t *player)
 
     if (has_challenge)
     {
-        pthread_mutex_lock(&other_player->player_mutex);
+        LOCK(&other_player->player_mutex);
 
         // Informer l'autre joueur
         char buffer[BUFFER_SIZE];
         snprintf(buffer, sizeof(buffer), RED "%s s'est déconnecté. Le défi est annulé.\n" RESET, player->pseudo);
-        send(other_player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(other_player, buffer);
 
         // Réinitialiser les défis pour les deux joueurs
         player->challenge_sent = 0;
@@ -483,7 +574,7 @@ void remove_challenge(player_t *player)
         other_player->challenger = NULL;
         other_player->challengee = NULL;
 
-        pthread_mutex_unlock(&other_player->player_mutex);
+        UNLOCK(&other_player->player_mutex);
     }
     else
     {
@@ -501,198 +592,206 @@ void remove_challenge(player_t *player)
 /*
     Initialisation du plateau de jeu
 */
-void init_board(int board[])
+/*
+    État de la partie vu par player_id, sur une ligne que le client dessine lui-même :
+    @PLATEAU <partie> <version> <variante> <trous> <à vous de jouer> <votre score> <score adverse> <adversaire> <vos trous> <trous adverses>
+    Les trous de chaque camp sont numérotés à partir de 0 dans le camp de leur propriétaire, comme pour /play.
+*/
+static void send_board_state(int player_id, player_t *current_player, player_t *other_player, const int board[], game_t *game)
 {
-    for (int i = 0; i < BOARD_SIZE; ++i)
+    char buffer[BUFFER_SIZE];
+    int pits = game->variant->pits;
+    int own_score = (player_id == 0) ? game->player1_score : game->player2_score;
+    int other_score = (player_id == 0) ? game->player2_score : game->player1_score;
+
+    int length = snprintf(buffer, sizeof(buffer), BOARD_MESSAGE " %d %d %s %d %d %d %d %s", game->game_id, game->board_version, game->variant->name, pits,
+                          game->turn == player_id, own_score, other_score, other_player->pseudo);
+    for (int i = 0; i < game->variant->board_size; ++i)
     {
-        board[i] = INITIAL_SEEDS;
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %d", board[(player_id * pits + i) % game->variant->board_size]);
     }
+    snprintf(buffer + length, sizeof(buffer) - length, "\n");
+    send_to_player(current_player, buffer);
 }
 
 /*
-    Affichage du plateau de jeu
+    Affichage du plateau de jeu, composé dans un tampon emprunté et envoyé en un seul envoi
 */
-void print_board(int sockfd, int player_id, player_t *current_player, player_t *other_player, int board[], int game_id, game_t *game)
+void print_board(int player_id, player_t *current_player, player_t *other_player, int board[], int game_id, game_t *game)
 {
-    char buffer[BUFFER_SIZE];
-    memset(buffer, 0, sizeof(buffer));
+    unsigned long long trace_start = TRACE_START();
+    if (current_player->display_mode == DISPLAY_CLIENT)
+    {
+        send_board_state(player_id, current_player, other_player, board, game);
+        TRACE_END("affichage", "client", trace_start);
+        return;
+    }
+
+    io_buffer_t *out = buffer_acquire(BUFFER_LARGE);
+    if (out == NULL)
+    {
+        return;
+    }
 
     // Afficher le plateau de façon propre et ajouter les scores
-    snprintf(buffer, sizeof(buffer), "\n");
-    send(sockfd, buffer, strlen(buffer), 0);
+    buffer_append(out, "\n");
 
     int current_player_score = (player_id == 0) ? game->player1_score : game->player2_score;
     int other_player_score = (player_id == 0) ? game->player2_score : game->player1_score;
 
-    snprintf(buffer, sizeof(buffer), YELLOW "[Partie %d] Adversaire (%s) : %d points\n\n" RESET, game_id, other_player->pseudo, other_player_score);
-    send(sockfd, buffer, strlen(buffer), 0);
-
-    if (player_id == 0)
+    if (game->variant == DEFAULT_VARIANT)
     {
-        // Affichage pour le joueur 1
-
-        // Partie supérieure du plateau (joueur 2)
-        snprintf(buffer, sizeof(buffer), "   +-----+-----+-----+-----+-----+-----+\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), "   |");
-        for (int i = BOARD_SIZE - 1; i >= PLAYER_PITS; --i)
-        {
-            char pit[16];
-            snprintf(pit, sizeof(pit), " %3d |", board[i]);
-            strcat(buffer, pit);
-        }
-        strcat(buffer, "\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), "   +-----+-----+-----+-----+-----+-----+\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        // Partie inférieure du plateau (joueur 1)
-        snprintf(buffer, sizeof(buffer), "   |");
-        for (int i = 0; i < PLAYER_PITS; ++i)
-        {
-            char pit[16];
-            snprintf(pit, sizeof(pit), " %3d |", board[i]);
-            strcat(buffer, pit);
-        }
-        strcat(buffer, "\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), "   +-----+-----+-----+-----+-----+-----+\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), "    [0]   [1]   [2]   [3]   [4]   [5]\n\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), CYAN "      Toi (%s) : %d points\n" RESET, current_player->pseudo, current_player_score);
-        send(sockfd, buffer, strlen(buffer), 0);
+        buffer_append(out, YELLOW "[Partie %d | v%d] Adversaire (%s) : %d points\n\n" RESET, game_id, game->board_version, other_player->pseudo, other_player_score);
     }
     else
     {
-        // Affichage pour le joueur 2
-
-        // Partie supérieure du plateau (joueur 1)
-        snprintf(buffer, sizeof(buffer), "   +-----+-----+-----+-----+-----+-----+\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), "   |");
-        for (int i = PLAYER_PITS - 1; i >= 0; --i)
-        {
-            char pit[16];
-            snprintf(pit, sizeof(pit), " %3d |", board[i]);
-            strcat(buffer, pit);
-        }
-        strcat(buffer, "\n");
-        send(sockfd, buffer, strlen(buffer), 0);
-
-        snprintf(buffer, sizeof(buffer), "   +-----+-----+-----+-----+-----+-----+\n");
-        send(sockfd, buffer, strlen(buffer), 0);
+        buffer_append(out, YELLOW "[Partie %d | %s | v%d] Adversaire (%s) : %d points\n\n" RESET, game_id, game->variant->name, game->board_version,
+                      other_player->pseudo, other_player_score);
+    }
 
-        // Partie inférieure du plateau (joueur 2)
-        snprintf(buffer, sizeof(buffer), "   |");
-        for (int i = PLAYER_PITS; i < BOARD_SIZE; ++i)
-        {
-            char pit[16];
-            snprintf(pit, sizeof(pit), " %3d |", board[i]);
-            strcat(buffer, pit);
-        }
-        strcat(buffer, "\n");
-        send(sockfd, buffer, strlen(buffer), 0);
+    // Le camp adverse est affiché en haut, de droite à gauche, et le camp du joueur en bas
+    int pits = game->variant->pits;
+    int own_start = player_id * pits;
+    int other_start = (1 - player_id) * pits;
 
-        snprintf(buffer, sizeof(buffer), "   +-----+-----+-----+-----+-----+-----+\n");
-        send(sockfd, buffer, strlen(buffer), 0);
+    // Bordure à la largeur de la variante, répétée entre les rangées
+    char border[8 + MAX_PLAYER_PITS * 6];
+    int length = snprintf(border, sizeof(border), "   +");
+    for (int i = 0; i < pits; ++i)
+    {
+        length += snprintf(border + length, sizeof(border) - length, "-----+");
+    }
+    snprintf(border + length, sizeof(border) - length, "\n");
 
-        snprintf(buffer, sizeof(buffer), "    [0]   [1]   [2]   [3]   [4]   [5]\n\n");
-        send(sockfd, buffer, strlen(buffer), 0);
+    buffer_append(out, "%s   |", border);
+    for (int i = pits - 1; i >= 0; --i)
+    {
+        buffer_append(out, " %3d |", board[other_start + i]);
+    }
+    buffer_append(out, "\n%s   |", border);
+    for (int i = 0; i < pits; ++i)
+    {
+        buffer_append(out, " %3d |", board[own_start + i]);
+    }
+    buffer_append(out, "\n%s ", border);
+    for (int i = 0; i < pits; ++i)
+    {
+        buffer_append(out, "   [%d]", i);
+    }
+    buffer_append(out, "\n\n");
 
-        snprintf(buffer, sizeof(buffer), CYAN "Toi (%s) : %d points\n" RESET, current_player->pseudo, current_player_score);
-        send(sockfd, buffer, strlen(buffer), 0);
+    if (player_id == 0)
+    {
+        buffer_append(out, CYAN "      Toi (%s) : %d points\n" RESET, current_player->pseudo, current_player_score);
     }
+    else
+    {
+        buffer_append(out, CYAN "Toi (%s) : %d points\n" RESET, current_player->pseudo, current_player_score);
+    }
+
+    current_player->transport->send(current_player->sockfd, current_player->transport_ctx, out->data, out->length);
+    buffer_release(out);
+    TRACE_END("affichage", "complet", trace_start);
 }
 
 void display_board(player_t *player, int game_id)
 {
     char buffer[BUFFER_SIZE];
-    pthread_mutex_lock(&player->player_mutex);
-    game_t *game = NULL;
-    for (int i = 0; i < player->game_count; ++i)
-    {
-        if (player->games[i]->game_id == game_id)
-        {
-            game = player->games[i];
-            break;
-        }
-    }
-    pthread_mutex_unlock(&player->player_mutex);
+    int player_id;
+    game_t *game = find_player_game(player, game_id, &player_id);
 
     if (game != NULL)
     {
-        pthread_mutex_lock(&game->game_mutex);
-        int player_id = (game->player1 == player) ? 0 : 1;
-        player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
-        print_board(player->sockfd, player_id, player, other_player, game->board, game_id, game);
-        pthread_mutex_unlock(&game->game_mutex);
+        post_game_message(game, GAME_MESSAGE_VIEW, player_id, 0, NULL);
     }
     else
     {
         snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans la partie %d.\n" RESET, game_id);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
     }
 }
 
 /*
-    Jouer un coup
+    Envoyer uniquement les changements du plateau après un coup :
+    le coup joué, les trous modifiés et le gain de score
 */
-int make_move(int player_id, int pit, player_t *player, int board[], game_t *game)
+void send_board_delta(player_t *receiver, int player_id, player_t *mover, game_t *game, const int old_board[], int pit, int captured)
 {
-    int start = player_id == 0 ? 0 : PLAYER_PITS;
-    int end = player_id == 0 ? PLAYER_PITS - 1 : BOARD_SIZE - 1;
+    char buffer[BUFFER_SIZE];
+    char pit_change[32];
 
-    // Vérification que le joueur joue dans sa propre rangée
-    if (pit < start || pit > end)
-    {
-        return 0; // Mouvement invalide : hors de la rangée du joueur
-    }
+    int pits = game->variant->pits;
+    int own_start = player_id * pits;
+    int receiver_score = (player_id == 0) ? game->player1_score : game->player2_score;
+    int other_score = (player_id == 0) ? game->player2_score : game->player1_score;
+
+    snprintf(buffer, sizeof(buffer), BLUE "[Partie %d | v%d] %s a joué le trou %d :" RESET, game->game_id, game->board_version, mover->pseudo, pit % pits);
 
-    int seeds = board[pit];
-    if (seeds == 0)
+    // Les trous sont numérotés à partir de 0 dans le camp de leur propriétaire
+    for (int i = 0; i < game->variant->board_size; ++i)
     {
-        return 0; // Mouvement invalide : trou vide
+        int index = (own_start + i) % game->variant->board_size;
+        if (game->board[index] != old_board[index])
+        {
+            snprintf(pit_change, sizeof(pit_change), " %s[%d]=%d", (i < pits) ? "Vous" : "Adv", index % pits, game->board[index]);
+            strcat(buffer, pit_change);
+        }
     }
 
-    board[pit] = 0; // On vide le trou choisi
-    int current_pit = pit;
+    snprintf(pit_change, sizeof(pit_change), " | Score +%d", captured);
+    strcat(buffer, pit_change);
+    snprintf(pit_change, sizeof(pit_change), " (Vous %d - Adv %d)\n", receiver_score, other_score);
+    strcat(buffer, pit_change);
+    send_to_player(receiver, buffer);
+}
+
+/*
+    Changer le mode d'affichage des parties d'un joueur
+*/
+void set_display_mode(player_t *player, const char *mode)
+{
+    char buffer[BUFFER_SIZE];
 
-    // Semer les graines dans les trous suivants
-    while (seeds > 0)
+    if (strcmp(mode, "delta") == 0)
     {
-        current_pit = (current_pit + 1) % BOARD_SIZE;
-        board[current_pit]++;
-        seeds--;
+        LOCK(&player->player_mutex);
+        player->display_mode = DISPLAY_DELTA;
+        UNLOCK(&player->player_mutex);
+        snprintf(buffer, sizeof(buffer), GREEN "Affichage incrémental activé : seuls les trous modifiés seront envoyés. Tapez /play <numéro de partie> pour revoir le plateau.\n" RESET);
     }
+    else if (strcmp(mode, "complet") == 0)
+    {
+        LOCK(&player->player_mutex);
+        player->display_mode = DISPLAY_FULL;
+        UNLOCK(&player->player_mutex);
+        snprintf(buffer, sizeof(buffer), GREEN "Affichage complet du plateau activé.\n" RESET);
+    }
+    else if (strcmp(mode, "client") == 0)
+    {
+        // Demandé par le client lui-même à la connexion : la confirmation est une ligne de contrôle
+        LOCK(&player->player_mutex);
+        player->display_mode = DISPLAY_CLIENT;
+        UNLOCK(&player->player_mutex);
+        snprintf(buffer, sizeof(buffer), DISPLAY_MESSAGE " client\n");
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /affichage <complet|delta|client>\n" RESET);
+    }
+    send_to_player(player, buffer);
+}
 
-    int captured_seeds = 0; // Initialiser le nombre de graines capturées
-
-    // Vérifier si la capture est possible
-    if ((player_id == 0 && current_pit >= PLAYER_PITS) || (player_id == 1 && current_pit < PLAYER_PITS))
+/*
+    Jouer un coup
+*/
+int make_move(int player_id, int pit, player_t *player, int board[], game_t *game)
+{
+    // Les règles (semis et captures) de chaque variante sont dans awale.c, partagées avec la table de finales et
+    // l'autojeu, comme l'historique des positions qui arrête une partie qui tourne en rond
+    int captured_seeds = position_history_play(&game->positions, game->variant, board, player_id, pit);
+    if (captured_seeds < 0)
     {
-        // Remonter dans les trous adverses et capturer si les conditions sont remplies
-        while ((player_id == 0 && current_pit >= PLAYER_PITS) || (player_id == 1 && current_pit < PLAYER_PITS))
-        {
-            if (board[current_pit] == 2 || board[current_pit] == 3)
-            {
-                captured_seeds += board[current_pit];
-                board[current_pit] = 0;
-                current_pit--;
-                if (current_pit < 0)
-                    current_pit = BOARD_SIZE - 1;
-            }
-            else
-            {
-                break;
-            }
-        }
+        return 0; // Mouvement invalide : hors de la rangée du joueur ou trou vide
     }
 
     // Mettre à jour le score du joueur dans la partie
@@ -709,109 +808,129 @@ int make_move(int player_id, int pit, player_t *player, int board[], game_t *gam
 }
 
 /*
-    Décider du joueur qui doit jouer et récupérer le coup joué
+    Poster le coup joué à l'acteur de la partie
 */
 void make_move_command(player_t *player, int game_id, int move)
 {
     char buffer[BUFFER_SIZE];
 
     // On récupère la partie à partir du numéro de partie donné
-    pthread_mutex_lock(&player->player_mutex);
-    game_t *game = NULL;
-    for (int i = 0; i < player->game_count; ++i)
-    {
-        if (player->games[i]->game_id == game_id)
-        {
-            game = player->games[i];
-            break;
-        }
-    }
-    pthread_mutex_unlock(&player->player_mutex);
+    int player_id;
+    game_t *game = find_player_game(player, game_id, &player_id);
 
     if (game != NULL)
     {
-        pthread_mutex_lock(&game->game_mutex);
+        post_game_message(game, GAME_MESSAGE_MOVE, player_id, move, NULL);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans la partie %d.\n" RESET, game_id);
+        send_to_player(player, buffer);
+    }
+}
 
-        if (game->game_over)
-        {
-            snprintf(buffer, sizeof(buffer), RED "La partie %d est terminée.\n" RESET, game_id);
-            send(player->sockfd, buffer, strlen(buffer), 0);
-            pthread_mutex_unlock(&game->game_mutex);
-            return;
-        }
+/*
+    Décider du joueur qui doit jouer et jouer le coup (acteur de la partie)
+*/
+static void play_move(game_t *game, player_t *player, int player_id, int move)
+{
+    char buffer[BUFFER_SIZE];
 
-        int player_id = (game->player1 == player) ? 0 : 1;
-        player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
+    // La partie est suspendue tant que l'attente de reconnexion n'est pas terminée
+    if (game->waiting_reconnect)
+    {
+        snprintf(buffer, sizeof(buffer), RED "La partie %d est suspendue en attente de reconnexion.\n" RESET, game->game_id);
+        send_to_player(player, buffer);
+        return;
+    }
 
-        if (player_id == game->turn)
+    player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
+
+    if (player_id == game->turn)
+    {
+        if (move >= 0 && move < game->variant->pits)
         {
-            if (move >= 0 && move <= 5)
+            int pit = move;
+            // Conversion pour le joueur 2 (trous de la seconde rangée)
+            if (player_id == 1)
+                pit += game->variant->pits;
+
+            // On garde l'état précédent pour n'envoyer que les changements
+            int old_board[MAX_BOARD_SIZE];
+            memcpy(old_board, game->board, sizeof(old_board));
+            int old_score = (player_id == 0) ? game->player1_score : game->player2_score;
+
+            unsigned long long trace_start = TRACE_START();
+            int played = make_move(player_id, pit, player, game->board, game);
+            TRACE_END("coup", game->variant->name, trace_start);
+
+            if (played)
             {
-                int pit = move;
-                // Conversion pour le joueur 2 (trous 6 à 11)
-                if (player_id == 1)
-                    pit += PLAYER_PITS;
+                game->board_version++;
+                // Le trait change avant l'envoi : le plateau indique au client qui doit jouer
+                game->turn = 1 - game->turn;
+                int captured = ((player_id == 0) ? game->player1_score : game->player2_score) - old_score;
+
+                // Envoyer le nouveau plateau (ou seulement les changements) aux deux joueurs
+                if (player->display_mode == DISPLAY_DELTA)
+                {
+                    send_board_delta(player, player_id, player, game, old_board, pit, captured);
+                }
+                else
+                {
+                    print_board(player_id, player, other_player, game->board, game->game_id, game);
+                }
 
-                if (make_move(player_id, pit, player, game->board, game))
+                if (other_player->display_mode == DISPLAY_DELTA)
+                {
+                    send_board_delta(other_player, 1 - player_id, player, game, old_board, pit, captured);
+                }
+                else
                 {
                     char move_msg[BUFFER_SIZE];
-                    snprintf(move_msg, sizeof(move_msg), BLUE "[Partie %d] %s a joué le trou %d.\n" RESET, game->game_id, player->pseudo, pit % PLAYER_PITS);
-                    send(other_player->sockfd, move_msg, strlen(move_msg), 0);
-
-                    // Envoyer le nouveau plateau aux deux joueurs
-                    print_board(player->sockfd, player_id, player, other_player, game->board, game->game_id, game);
-                    print_board(other_player->sockfd, 1 - player_id, other_player, player, game->board, game->game_id, game);
-
-                    // Vérifier si la partie est terminée
-                    if (check_game_end(game->board))
-                    {
-                        end_game(game);
-                        pthread_mutex_unlock(&game->game_mutex);
-                        return;
-                    }
-
-                    // Mise à jour du tour
-                    game->turn = 1 - game->turn;
-
-                    // Informer le prochain joueur que c'est son tour
-                    snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] C'est à vous de jouer.\n" RESET, game->game_id);
-                    if (game->turn == 0)
-                    {
-                        send(game->player1->sockfd, buffer, strlen(buffer), 0);
-                        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
-                        send(game->player2->sockfd, buffer, strlen(buffer), 0);
-                    }
-                    else
-                    {
-                        send(game->player2->sockfd, buffer, strlen(buffer), 0);
-                        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
-                        send(game->player1->sockfd, buffer, strlen(buffer), 0);
-                    }
+                    snprintf(move_msg, sizeof(move_msg), BLUE "[Partie %d] %s a joué le trou %d.\n" RESET, game->game_id, player->pseudo, pit % game->variant->pits);
+                    send_to_player(other_player, move_msg);
+                    print_board(1 - player_id, other_player, player, game->board, game->game_id, game);
+                }
+
+                // Vérifier si la partie est terminée
+                if (check_game_end(game, 1 - player_id))
+                {
+                    end_game(game);
+                    return;
+                }
+
+                // Informer le prochain joueur que c'est son tour
+                snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] C'est à vous de jouer.\n" RESET, game->game_id);
+                if (game->turn == 0)
+                {
+                    send_to_player(game->player1, buffer);
+                    snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
+                    send_to_player(game->player2, buffer);
                 }
                 else
                 {
-                    snprintf(buffer, sizeof(buffer), RED "Mouvement invalide. Essayez à nouveau.\n" RESET);
-                    send(player->sockfd, buffer, strlen(buffer), 0);
+                    send_to_player(game->player2, buffer);
+                    snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
+                    send_to_player(game->player1, buffer);
                 }
             }
             else
             {
-                snprintf(buffer, sizeof(buffer), RED "Entrée invalide. Veuillez entrer un nombre entre 0 et 5.\n" RESET);
-                send(player->sockfd, buffer, strlen(buffer), 0);
+                snprintf(buffer, sizeof(buffer), RED "Mouvement invalide. Essayez à nouveau.\n" RESET);
+                send_to_player(player, buffer);
             }
         }
         else
         {
-            snprintf(buffer, sizeof(buffer), RED "Ce n'est pas votre tour de jouer dans la partie %d.\n" RESET, game_id);
-            send(player->sockfd, buffer, strlen(buffer), 0);
+            snprintf(buffer, sizeof(buffer), RED "Entrée invalide. Veuillez entrer un nombre entre 0 et %d.\n" RESET, game->variant->pits - 1);
+            send_to_player(player, buffer);
         }
-
-        pthread_mutex_unlock(&game->game_mutex);
     }
     else
     {
-        snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans la partie %d.\n" RESET, game_id);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        snprintf(buffer, sizeof(buffer), RED "Ce n'est pas votre tour de jouer dans la partie %d.\n" RESET, game->game_id);
+        send_to_player(player, buffer);
     }
 }
 
@@ -822,13 +941,13 @@ void abandon_game(player_t *player, int game_id)
 {
     char buffer[BUFFER_SIZE];
 
-    pthread_mutex_lock(&player->player_mutex);
+    LOCK(&player->player_mutex);
     if (player->game_count == 0)
     {
         snprintf(buffer, sizeof(buffer), RED "Vous n'avez aucune partie en cours pour abandonner.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
 
-        pthread_mutex_unlock(&player->player_mutex);
+        UNLOCK(&player->player_mutex);
         return;
     }
 
@@ -846,23 +965,39 @@ void abandon_game(player_t *player, int game_id)
     if (game == NULL)
     {
         snprintf(buffer, sizeof(buffer), RED "Cette partie n'existe pas.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
 
-        pthread_mutex_unlock(&player->player_mutex);
+        UNLOCK(&player->player_mutex);
         return;
     }
 
-    pthread_mutex_unlock(&player->player_mutex);
+    game_retain(game);
+    int player_id = (game->player1 == player) ? 0 : 1;
+    UNLOCK(&player->player_mutex);
+
+    post_game_message(game, GAME_MESSAGE_ABANDON, player_id, 0, NULL);
+}
 
-    pthread_mutex_lock(&game->game_mutex);
+/*
+    Terminer la partie sur l'abandon du joueur (acteur de la partie)
+*/
+static void resign_game(game_t *game, player_t *player)
+{
+    char buffer[BUFFER_SIZE];
 
-    if (!game->game_over)
+    if (game->waiting_reconnect)
+    {
+        // L'attente de reconnexion termine elle-même la partie
+        snprintf(buffer, sizeof(buffer), RED "La partie %d est suspendue en attente de reconnexion.\n" RESET, game->game_id);
+        send_to_player(player, buffer);
+    }
+    else
     {
         player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
 
         // Verrouiller les mutex dans l'ordre déterminé
-        pthread_mutex_lock(&player->player_mutex);
-        pthread_mutex_lock(&other_player->player_mutex);
+        LOCK(&player->player_mutex);
+        LOCK(&other_player->player_mutex);
 
         // Mettre à jour les statistiques
         player->losses++;
@@ -872,16 +1007,17 @@ void abandon_game(player_t *player, int game_id)
 
 
         // Informer l'autre joueur
+        JOURNAL(LOG_INFO, player->connection_id, game->game_id, "Abandon de %s", player->pseudo);
         snprintf(buffer, sizeof(buffer), RED "%s a abandonné la partie %d. Vous remportez la partie !\n" RESET, player->pseudo, game->game_id);
-        send(other_player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(other_player, buffer);
 
         // Envoyer une confirmation au joueur
         snprintf(buffer, sizeof(buffer), GREEN "Vous avez abandonné la partie %d.\n" RESET, game->game_id);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(player, buffer);
 
         // Déverrouiller les mutex des joueurs avant de retirer les parties ! (on les rebloque dedans)
-        pthread_mutex_unlock(&player->player_mutex);
-        pthread_mutex_unlock(&other_player->player_mutex);
+        UNLOCK(&player->player_mutex);
+        UNLOCK(&other_player->player_mutex);
 
         // Retirer la partie des deux joueurs
         remove_game_from_player(player, game);
@@ -889,45 +1025,24 @@ void abandon_game(player_t *player, int game_id)
 
         // Marquer la partie comme terminée
         game->game_over = 1;
+        tournament_report_result(game, (game->player1 == player) ? GAME_RESULT_PLAYER2_WIN : GAME_RESULT_PLAYER1_WIN);
 
         // Nettoyer la partie
-        pthread_mutex_unlock(&game->game_mutex);
         remove_game_from_games(game);
-        pthread_mutex_destroy(&game->game_mutex);
-        free(game);
+        game_release(game); // Référence de la liste des parties
         update_player_score(player);
         update_player_score(other_player);
     }
-    else
-    {
-        pthread_mutex_unlock(&game->game_mutex);
-    }
 }
 
 /*
     Vérifie si la partie est terminée
 */
-int check_game_end(int board[])
+int check_game_end(game_t *game, int player_id)
 {
-    // Vérifie si un des joueurs n'a plus de graines dans son camp
-    int player1_seeds = 0, player2_seeds = 0;
-
-    for (int i = 0; i < PLAYER_PITS; ++i)
-    {
-        player1_seeds += board[i];
-    }
-
-    for (int i = PLAYER_PITS; i < BOARD_SIZE; ++i)
-    {
-        player2_seeds += board[i];
-    }
-
-    if (player1_seeds == 0 || player2_seeds == 0)
-    {
-        return 1;
-    }
-
-    return 0;
+    // Selon la variante : un des joueurs n'a plus de graines, ou player_id ne peut plus jouer.
+    // Une position répétée se répéterait sans fin : la partie s'arrête aussi.
+    return game->positions.repeated || game->variant->game_over(game->board, player_id);
 }
 
 void end_game(game_t *game)
@@ -935,86 +1050,95 @@ void end_game(game_t *game)
     char buffer[BUFFER_SIZE];
 
     // Ajouter les graines restantes aux scores des joueurs
-    int player1_remaining_seeds = 0;
-    int player2_remaining_seeds = 0;
+    int remaining[2];
+    remaining_seeds(game->variant, game->board, remaining);
+    game->player1_score += remaining[0];
+    game->player2_score += remaining[1];
 
-    // Somme des graines dans le camp de chaque joueur
-    for (int i = 0; i < PLAYER_PITS; ++i)
+    // Envoyer le plateau final aux joueurs en affichage complet (le dernier coup a déjà été envoyé aux autres)
+    if (game->player1->display_mode != DISPLAY_DELTA)
     {
-        player1_remaining_seeds += game->board[i];
+        print_board(0, game->player1, game->player2, game->board, game->game_id, game);
     }
-
-    for (int i = PLAYER_PITS; i < BOARD_SIZE; ++i)
+    if (game->player2->display_mode != DISPLAY_DELTA)
     {
-        player2_remaining_seeds += game->board[i];
+        print_board(1, game->player2, game->player1, game->board, game->game_id, game);
     }
 
-    // Mise à jour des scores
-    game->player1_score += player1_remaining_seeds;
-    game->player2_score += player2_remaining_seeds;
-
-    // Envoyer le plateau final aux deux joueurs
-    print_board(game->player1->sockfd, 0, game->player1, game->player2, game->board, game->game_id, game);
-    print_board(game->player2->sockfd, 1, game->player2, game->player1, game->board, game->game_id, game);
-
     // Nettoyage du plateau
     memset(game->board, 0, sizeof(game->board));
 
     // Envoyer les résultats finaux
+    if (game->positions.repeated)
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "[Partie %d] Position répétée : la partie tourne en rond, chaque joueur garde les graines de son camp.\n" RESET,
+                 game->game_id);
+        send_to_player(game->player1, buffer);
+        send_to_player(game->player2, buffer);
+        JOURNAL(LOG_INFO, LOG_NONE, game->game_id, "Position répétée après %d coups sans capture", game->positions.count - 1);
+    }
     snprintf(buffer, sizeof(buffer), GREEN "Fin de la partie %d !\n" RESET, game->game_id);
-    send(game->player1->sockfd, buffer, strlen(buffer), 0);
-    send(game->player2->sockfd, buffer, strlen(buffer), 0);
+    send_to_player(game->player1, buffer);
+    send_to_player(game->player2, buffer);
 
     // Déterminer et annoncer le gagnant
     int player1_total_score = game->player1_score;
     int player2_total_score = game->player2_score;
+    int result;
 
     if (player1_total_score > player2_total_score)
     {
+        result = GAME_RESULT_PLAYER1_WIN;
         snprintf(buffer, sizeof(buffer), YELLOW "[Partie %d] %s a gagné la partie avec %d points !\n" RESET, game->game_id, game->player1->pseudo, player1_total_score);
-        send(game->player1->sockfd, buffer, strlen(buffer), 0);
-        send(game->player2->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(game->player1, buffer);
+        send_to_player(game->player2, buffer);
 
         // Mettre à jour les statistiques
-        pthread_mutex_lock(&game->player1->player_mutex);
+        LOCK(&game->player1->player_mutex);
         game->player1->wins++;
-        pthread_mutex_unlock(&game->player1->player_mutex);
+        presence_update(game->player1->pseudo, game->player1->wins, game->player1->losses, game->player1->draws);
+        UNLOCK(&game->player1->player_mutex);
 
-        pthread_mutex_lock(&game->player2->player_mutex);
+        LOCK(&game->player2->player_mutex);
         game->player2->losses++;
-        pthread_mutex_unlock(&game->player2->player_mutex);
+        presence_update(game->player2->pseudo, game->player2->wins, game->player2->losses, game->player2->draws);
+        UNLOCK(&game->player2->player_mutex);
     }
     else if (player2_total_score > player1_total_score)
     {
+        result = GAME_RESULT_PLAYER2_WIN;
         snprintf(buffer, sizeof(buffer), YELLOW "[Partie %d] %s a gagné la partie avec %d points !\n" RESET, game->game_id, game->player2->pseudo, player2_total_score);
-        send(game->player1->sockfd, buffer, strlen(buffer), 0);
-        send(game->player2->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(game->player1, buffer);
+        send_to_player(game->player2, buffer);
 
         // Mettre à jour les statistiques
-        pthread_mutex_lock(&game->player1->player_mutex);
+        LOCK(&game->player1->player_mutex);
         game->player1->losses++;
-        pthread_mutex_unlock(&game->player1->player_mutex);
+        UNLOCK(&game->player1->player_mutex);
         update_player_score(game->player1);
 
-        pthread_mutex_lock(&game->player2->player_mutex);
+        LOCK(&game->player2->player_mutex);
         game->player2->wins++;
-        pthread_mutex_unlock(&game->player2->player_mutex);
+        UNLOCK(&game->player2->player_mutex);
         update_player_score(game->player2);
     }
     else
     {
+        result = GAME_RESULT_DRAW;
         snprintf(buffer, sizeof(buffer), YELLOW "[Partie %d] Match nul ! Les deux joueurs ont %d points.\n" RESET, game->game_id, player1_total_score);
-        send(game->player1->sockfd, buffer, strlen(buffer), 0);
-        send(game->player2->sockfd, buffer, strlen(buffer), 0);
+        send_to_player(game->player1, buffer);
+        send_to_player(game->player2, buffer);
 
         // Mettre à jour les statistiques
-        pthread_mutex_lock(&game->player1->player_mutex);
+        LOCK(&game->player1->player_mutex);
         game->player1->draws++;
-        pthread_mutex_unlock(&game->player1->player_mutex);
+        presence_update(game->player1->pseudo, game->player1->wins, game->player1->losses, game->player1->draws);
+        UNLOCK(&game->player1->player_mutex);
 
-        pthread_mutex_lock(&game->player2->player_mutex);
+        LOCK(&game->player2->player_mutex);
         game->player2->draws++;
-        pthread_mutex_unlock(&game->player2->player_mutex);
+        presence_update(game->player2->pseudo, game->player2->wins, game->player2->losses, game->player2->draws);
+        UNLOCK(&game->player2->player_mutex);
     }
 
     // Marquer la partie comme terminée
@@ -1023,10 +1147,12 @@ void end_game(game_t *game)
     // Retirer la partie des joueurs
     remove_game_from_player(game->player1, game);
     remove_game_from_player(game->player2, game);
+    JOURNAL(LOG_INFO, LOG_NONE, game->game_id, "Partie terminée : %s %d - %d %s", game->player1->pseudo, game->player1_score, game->player2_score, game->player2->pseudo);
+    tournament_report_result(game, result);
 
-    // Nettoyer la partie
-    pthread_mutex_destroy(&game->game_mutex);
-    free(game);
+    // Nettoyer la partie, libérée avec le dernier message qui la désigne
+    remove_game_from_games(game);
+    game_release(game); // Référence de la liste des parties
 }
 
 /*
@@ -1034,7 +1160,7 @@ void end_game(game_t *game)
 */
 void remove_game_from_player(player_t *player, game_t *game)
 {
-    pthread_mutex_lock(&player->player_mutex);
+    LOCK(&player->player_mutex);
     int index = -1;
     for (int i = 0; i < player->game_count; ++i)
     {
@@ -1052,8 +1178,16 @@ void remove_game_from_player(player_t *player, game_t *game)
             player->games[i] = player->games[i + 1];
         }
         player->game_count--;
+
+        // Le client qui suit ses parties peut oublier celle-ci, quelle que soit la façon dont elle s'est terminée
+        if (player->display_mode == DISPLAY_CLIENT && player->connected)
+        {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), GAME_END_MESSAGE " %d\n", game->game_id);
+            send_to_player(player, buffer);
+        }
     }
-    pthread_mutex_unlock(&player->player_mutex);
+    UNLOCK(&player->player_mutex);
 }
 
 /*
@@ -1061,7 +1195,7 @@ void remove_game_from_player(player_t *player, game_t *game)
 */
 void remove_game_from_games(game_t *game)
 {
-    pthread_mutex_lock(&games_mutex);
+    LOCK(&games_mutex);
     int index = -1;
     for (int i = 0; i < game_count; ++i)
     {
@@ -1079,20 +1213,23 @@ void remove_game_from_games(game_t *game)
             games[i] = games[i + 1];
         }
         game_count--;
+        if (game->tournament_id == 0)
+        {
+            casual_game_count--;
+        }
     }
-    pthread_mutex_unlock(&games_mutex);
+    UNLOCK(&games_mutex);
 }
 
 /*
-    On retire le joueur de la liste des joueurs
+    On retire le joueur de la liste des joueurs, players_mutex doit être verrouillé
 */
-void remove_player_from_players(player_t *player)
+static void remove_player_locked(player_t *player)
 {
-    pthread_mutex_lock(&players_mutex);
     int index = -1;
     for (int i = 0; i < player_count; ++i)
     {
-        if (players[i]->pseudo == player->pseudo)
+        if (players[i] == player)
         {
             index = i;
             break;
@@ -1107,651 +1244,2277 @@ void remove_player_from_players(player_t *player)
         }
         player_count--;
     }
-    pthread_mutex_unlock(&players_mutex);
+    // Un jeton de session ne désigne que des joueurs de la liste (find_session_player)
+    forget_session(player, 0);
+    // Une place s'est libérée pour la file d'attente
+    admission_notify();
 }
 
-void handle_command(player_t *player, char *command)
+/*
+    On retire le joueur de la liste des joueurs
+*/
+void remove_player_from_players(player_t *player)
 {
-    char buffer[BUFFER_SIZE];
+    LOCK(&players_mutex);
+    remove_player_locked(player);
+    UNLOCK(&players_mutex);
+}
 
-    if (strncmp(command, "/defier ", 8) == 0)
-    {
-        challenge_player(player, command + 8);
-    }
-    else if (strcmp(command, "/accepter") == 0)
-    {
-        accept_challenge(player);
-    }
-    else if (strcmp(command, "/refuser") == 0)
-    {
-        refuse_challenge(player);
-    }
-    else if (strcmp(command, "/joueurs") == 0)
-    {
-        list_connected_players(player);
-    }
-    else if (strcmp(command, "/help") == 0)
-    {
-        show_help(player);
-    }
-    else if (strncmp(command, "/global ", 8) == 0)
-    {
-        snprintf(buffer, sizeof(buffer), CYAN "[Global] %s: %s\n" RESET, player->pseudo, command + 8);
-        broadcast_to_all(buffer, player);
-    }
-    else if (strncmp(command, "/mp ", 4) == 0)
+/*
+    Créer un joueur connecté par le transport donné, sans l'ajouter à la liste des joueurs
+*/
+player_t *create_player(int sockfd, const transport_t *transport, void *ctx)
+{
+    player_t *player = (player_t *)calloc(1, sizeof(player_t));
+    if (player == NULL)
+    {
+        return NULL;
+    }
+    player->sockfd = sockfd;
+    player->transport = transport;
+    player->transport_ctx = ctx;
+    player->connected = 1;
+    player->connection_id = __atomic_add_fetch(&connection_id_counter, 1, __ATOMIC_RELAXED);
+    player->last_seen = time(NULL);
+    init_rate_buckets(player);
+    pthread_mutex_init(&player->player_mutex, NULL);
+    return player;
+}
+
+/*
+    Libérer un joueur qui n'est plus dans la liste des joueurs
+*/
+void destroy_player(player_t *player)
+{
+    if (player->transport->release != NULL)
     {
-        char *target_pseudo = strtok(command + 4, " ");
-        char *msg = strtok(NULL, "");
-        if (target_pseudo && msg)
-        {
-            send_private_message(player, target_pseudo, msg);
-        }
-        else
-        {
-            snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /mp <pseudo> <message>\n" RESET);
-            send(player->sockfd, buffer, strlen(buffer), 0);
-        }
+        player->transport->release(player->transport_ctx);
     }
-    else if (strncmp(command, "/chat ", 6) == 0)
+    // Avant de libérer la connexion : un canal ne doit plus copier sa destination
+    channels_forget(player);
+    pthread_mutex_destroy(&player->player_mutex);
+    free(player->games);
+    free(player);
+}
+
+/*
+    Ajouter un joueur à la liste, retourne -1 si le serveur est plein, -2 si le pseudo est déjà dans la liste
+    (joueur admis depuis la file d'attente pendant que le même pseudo se connectait ailleurs)
+*/
+int add_player_to_players(player_t *player)
+{
+    LOCK(&players_mutex);
+    for (int i = 0; i < player_count; ++i)
     {
-        char *rest = command + 6;
-        int game_id;
-        char *message;
-        if (sscanf(rest, "%d", &game_id) == 1)
-        {
-            message = strchr(rest, ' ');
-            if (message)
-            {
-                message++; // On saute l'espace
-                chat_in_game(player, game_id, message);
-            }
-            else
-            {
-                snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /chat <numéro de partie> <message>\n" RESET);
-                send(player->sockfd, buffer, strlen(buffer), 0);
-            }
-        }
-        else
+        if (strcmp(players[i]->pseudo, player->pseudo) == 0)
         {
-            snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /chat <numéro de partie> <message>\n" RESET);
-            send(player->sockfd, buffer, strlen(buffer), 0);
+            UNLOCK(&players_mutex);
+            return -2;
         }
     }
-    else if (strncmp(command, "/play", 5) == 0)
+    if (player_count >= max_players)
     {
-        int game_id, move;
-        char *cmd_args = command + 5;
-        while (*cmd_args == ' ')
-            cmd_args++; // Ignorer les espaces
-
-        if (sscanf(cmd_args, "%d %d", &game_id, &move) == 2)
-        {
-            // Le joueur souhaite jouer un coup
-            make_move_command(player, game_id, move);
-        }
-        else if (sscanf(cmd_args, "%d", &game_id) == 1)
-        {
-            // Le joueur souhaite afficher le plateau
-            display_board(player, game_id);
-        }
-        else
-        {
-            snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /play <numéro de partie> [<nombre de 0 à 5>]\n" RESET);
-            send(player->sockfd, buffer, strlen(buffer), 0);
-        }
+        UNLOCK(&players_mutex);
+        return -1;
     }
-    else if (strncmp(command, "/abandon ", 9) == 0)
+    if (player_count == players_capacity)
     {
-        char *rest = command + 9;
-        int game_id;
-        if (sscanf(rest, "%d", &game_id) == 1)
-        {
-            abandon_game(player, game_id);
-        }
-        else
+        int new_capacity = players_capacity == 0 ? 16 : players_capacity * 2;
+        player_t **new_players = realloc(players, sizeof(player_t *) * new_capacity);
+        if (new_players == NULL)
         {
-            snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /abandon <numéro de partie>\n" RESET);
-            send(player->sockfd, buffer, strlen(buffer), 0);
+            UNLOCK(&players_mutex);
+            return -1;
         }
+        players = new_players;
+        players_capacity = new_capacity;
     }
-    else if (strcmp(command, "/quit") == 0)
-    {
-        handle_player_disconnect(player);
-        pthread_exit(NULL);
-    }
-    else
+    players[player_count++] = player;
+    UNLOCK(&players_mutex);
+
+    // L'index de présence d'un joueur ne change que sous son verrou, dans l'ordre des événements
+    LOCK(&player->player_mutex);
+    presence_add(player->pseudo, player->wins, player->losses, player->draws);
+    UNLOCK(&player->player_mutex);
+
+    // Chaque joueur arrive abonné au chat global, qu'il peut quitter avec /leave #global
+    channel_t *global = global_chat_channel();
+    if (global != NULL)
     {
-        snprintf(buffer, sizeof(buffer), RED "Commande non reconnue. Tapez /help pour voir la liste des commandes.\n" RESET);
-        send(player->sockfd, buffer, strlen(buffer), 0);
+        channel_join(player, global);
     }
+    return 0;
 }
 
-void list_connected_players(player_t *player)
+/*
+    Rattacher un joueur déconnecté à sa nouvelle connexion, players_mutex doit être verrouillé
+*/
+void reattach_player(player_t *player, int sockfd, const transport_t *transport, void *ctx)
 {
     char buffer[BUFFER_SIZE];
-    char line[BUFFER_SIZE];
-    pthread_mutex_lock(&players_mutex);
-    snprintf(buffer, sizeof(buffer), CYAN "Joueurs connectés :\n" RESET);
-    for (int i = 0; i < player_count; ++i)
-    {
-        player_t *p = players[i];
-        if (p->connected)
-        {
-            pthread_mutex_lock(&p->player_mutex);
-            snprintf(line, sizeof(line), "%s - V: %d | D: %d | N: %d\n", p->pseudo, p->wins, p->losses, p->draws);
-            pthread_mutex_unlock(&p->player_mutex);
-            strcat(buffer, line);
-        }
-    }
-    pthread_mutex_unlock(&players_mutex);
-    send(player->sockfd, buffer, strlen(buffer), 0);
+
+    LOCK(&player->player_mutex);
+    player->sockfd = sockfd;
+    player->transport = transport;
+    player->transport_ctx = ctx;
+    player->connected = 1;
+    player->session++;
+    player->last_seen = time(NULL);
+    player->last_ping = 0;
+    player->connection_id = __atomic_add_fetch(&connection_id_counter, 1, __ATOMIC_RELAXED);
+    JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "Reconnexion de %s", player->pseudo);
+    // Les destinations sont à jour : le joueur peut reprendre sa place dans ses canaux
+    channels_attach(player);
+    presence_add(player->pseudo, player->wins, player->losses, player->draws);
+
+    snprintf(buffer, sizeof(buffer), GREEN "Vous avez été reconnecté avec succès.\n" RESET);
+    send_to_player(player, buffer);
+    UNLOCK(&player->player_mutex);
 }
 
-void show_help(player_t *player)
+/*
+    Retirer de la liste un joueur déconnecté qui n'a plus de partie en cours ni de thread client_handler
+    (players_mutex verrouillé). Retourne 1 si le joueur doit être libéré par l'appelant.
+*/
+static int unlist_player_if_idle(player_t *player)
 {
-    char buffer[BUFFER_SIZE];
-    snprintf(buffer, sizeof(buffer),
-             CYAN "Commandes disponibles :\n"
-                  "/defier <pseudo> - Défier un joueur\n"
-                  "/accepter - Accepter un défi\n"
-                  "/refuser - Refuser un défi\n"
-                  "/joueurs - Lister les joueurs connectés\n"
-                  "/global <message> - Envoyer un message au chat global\n"
-                  "/mp <pseudo> <message> - Envoyer un message privé\n"
-                  "/chat <numéro de partie> <message> - Envoyer un message dans une partie\n"
-                  "/play <numéro de partie> [<nombre de 0 à 5>] - Afficher le plateau ou jouer dans une partie\n"
-                  "/abandon <numéro de partie> - Abandonner la partie\n"
-                  "/quit - Quitter le jeu\n"
-                  "/help - Afficher cette aide\n" RESET);
-    send(player->sockfd, buffer, strlen(buffer), 0);
+    LOCK(&player->player_mutex);
+    int idle = !player->connected && player->game_count == 0 && player->handlers == 0;
+    UNLOCK(&player->player_mutex);
+    if (idle)
+    {
+        remove_player_locked(player);
+    }
+    return idle;
 }
 
-void handle_player_disconnect(player_t *player)
+/*
+    Libérer un joueur déconnecté qui n'a plus de partie en cours. Retourne 1 si le joueur a été libéré.
+    Les conditions sont vérifiées sous players_mutex, pour qu'une reconnexion ne puisse pas le reprendre entre-temps.
+*/
+int release_player_if_idle(player_t *player)
 {
-    char buffer[BUFFER_SIZE];
-
-    printf("handle_player_disconnect: Joueur %s se déconnecte.\n", player->pseudo);
+    LOCK(&players_mutex);
+    int idle = unlist_player_if_idle(player);
+    UNLOCK(&players_mutex);
 
-    // Verrouiller le mutex du joueur
-    pthread_mutex_lock(&player->player_mutex);
-
-    if (!player->connected)
+    if (idle)
     {
-        printf("handle_player_disconnect: Joueur %s déjà marqué comme déconnecté.\n", player->pseudo);
-        pthread_mutex_unlock(&player->player_mutex);
-        return; // Le joueur est déjà marqué comme déconnecté
+        destroy_player(player);
     }
+    return idle;
+}
 
-    player->connected = 0;
-
-    // Informer les autres joueurs globalement
-    snprintf(buffer, sizeof(buffer), RED "%s s'est déconnecté.\n" RESET, player->pseudo);
-    broadcast_to_all(buffer, player);
+/*
+    Un thread client_handler va utiliser le joueur : tant qu'il tourne, seul lui peut libérer le joueur
+*/
+void attach_handler(player_t *player)
+{
+    LOCK(&player->player_mutex);
+    player->handlers++;
+    UNLOCK(&player->player_mutex);
+}
 
-    // Gérer les défis en attente
-    remove_challenge(player);
+/*
+    Fin d'un thread client_handler : le joueur est libéré s'il n'a plus de partie en cours. Une partie perdue
+    par forfait pendant la fin du thread ne libère donc pas le joueur sous ses pieds.
+*/
+void detach_handler(player_t *player)
+{
+    LOCK(&players_mutex);
+    LOCK(&player->player_mutex);
+    player->handlers--;
+    UNLOCK(&player->player_mutex);
+    int idle = unlist_player_if_idle(player);
+    UNLOCK(&players_mutex);
 
-    // Gérer les parties en cours
-    for (int i = 0; i < player->game_count; ++i)
+    if (idle)
     {
-        game_t *game = player->games[i];
-        pthread_mutex_lock(&game->game_mutex);
+        destroy_player(player);
+    }
+}
 
-        printf("handle_player_disconnect: Vérification de la partie %d pour le joueur %s.\n", game->game_id, player->pseudo);
-        printf("handle_player_disconnect: game_over=%d, waiting_reconnect=%d\n", game->game_over, game->waiting_reconnect);
+// ********************************************************************************* //
 
-        if (!game->game_over && !game->waiting_reconnect)
-        {
-            printf("handle_player_disconnect: Entrée dans la condition pour la partie %d.\n", game->game_id);
+// Registre des commandes
 
-            game->waiting_reconnect = 1;
+command_t commands[MAX_COMMANDS];
+int command_count = 0;
+int command_table[COMMAND_TABLE_SIZE]; // Index dans commands[] + 1, 0 si la case est libre
+command_stats_t unknown_command_stats;
 
-            // Informer l'autre joueur
-            player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
+char admins[MAX_ADMINS][32];
+int admin_count = 0;
 
-            pthread_mutex_lock(&other_player->player_mutex);
-            snprintf(buffer, sizeof(buffer), RED "Votre adversaire %s s'est déconnecté. En attente de reconnexion pendant %d secondes...\n" RESET, player->pseudo, TIME_OUT_TIME);
-            int bytes_sent = send(other_player->sockfd, buffer, strlen(buffer), 0);
-            if (bytes_sent < 0)
-            {
-                perror("Erreur lors de l'envoi du message à l'autre joueur");
-            }
-            pthread_mutex_unlock(&other_player->player_mutex);
+/*
+    Hachage FNV-1a d'un nom de commande
+*/
+static unsigned int hash_command_name(const char *name, size_t len)
+{
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
-            // Lancer un thread pour gérer la reconnexion
-            pthread_t reconnect_thread;
-            pthread_create(&reconnect_thread, NULL, wait_for_reconnection, (void *)game);
-            pthread_detach(reconnect_thread);
-        }
-        else
+/*
+    Ajouter une commande au registre. Les modules peuvent ajouter leurs commandes sans toucher à handle_command.
+*/
+int register_command(const char *name, int min_args, int max_args, int flags, int permission, command_handler_t handler, const char *usage)
+{
+    if (command_count >= MAX_COMMANDS || max_args > MAX_COMMAND_ARGS)
+    {
+        return -1;
+    }
+
+    size_t len = strlen(name);
+    unsigned int slot = hash_command_name(name, len) & (COMMAND_TABLE_SIZE - 1);
+    while (command_table[slot] != 0)
+    {
+        if (strcmp(commands[command_table[slot] - 1].name, name) == 0)
         {
-            printf("handle_player_disconnect: Condition non satisfaite pour la partie %d.\n", game->game_id);
+            return -1; // Commande déjà enregistrée
         }
-
-        pthread_mutex_unlock(&game->game_mutex);
+        slot = (slot + 1) & (COMMAND_TABLE_SIZE - 1);
     }
 
-    pthread_mutex_unlock(&player->player_mutex);
+    command_t *command = &commands[command_count];
+    memset(command, 0, sizeof(command_t));
+    command->name = name;
+    command->min_args = min_args;
+    command->max_args = max_args;
+    command->flags = flags;
+    command->permission = permission;
+    command->handler = handler;
+    command->usage = usage;
+    command->rate_class = RATE_CLASS_CONNECTION; // Seule la limite de la connexion s'applique par défaut
 
-    close(player->sockfd);
+    command_table[slot] = ++command_count;
+    return 0;
 }
 
-void *wait_for_reconnection(void *arg)
+/*
+    Soumettre une commande à une limite de débit en plus de celle de la connexion
+*/
+void set_command_rate_class(const char *name, int rate_class)
 {
-    game_t *game = (game_t *)arg;
-    player_t *player1 = game->player1;
-    player_t *player2 = game->player2;
-    player_t *disconnected_player;
-    player_t *other_player;
-
-    // Déterminer le joueur déconnecté
-    pthread_mutex_lock(&player1->player_mutex);
-    if (!player1->connected)
+    str_view_t view = {name, strlen(name)};
+    command_t *command = find_command(view);
+    if (command != NULL)
     {
-        disconnected_player = player1;
-        other_player = player2;
+        command->rate_class = rate_class;
     }
-    else
+}
+
+/*
+    Retrouver une commande à partir de son nom (vue sur le buffer reçu)
+*/
+command_t *find_command(str_view_t name)
+{
+    unsigned int slot = hash_command_name(name.ptr, name.len) & (COMMAND_TABLE_SIZE - 1);
+    while (command_table[slot] != 0)
     {
-        disconnected_player = player2;
-        other_player = player1;
+        command_t *command = &commands[command_table[slot] - 1];
+        if (strncmp(command->name, name.ptr, name.len) == 0 && command->name[name.len] == '\0')
+        {
+            return command;
+        }
+        slot = (slot + 1) & (COMMAND_TABLE_SIZE - 1);
     }
-    pthread_mutex_unlock(&player1->player_mutex);
+    return NULL;
+}
 
-    int wait_time = TIME_OUT_TIME; // Temps d'attente en secondes
-    char buffer[BUFFER_SIZE];
+/*
+    Découper une ligne en nom de commande et arguments sans la modifier.
+    Avec CMD_TEXT_LAST, le dernier argument s'étend jusqu'à la fin de la ligne.
+*/
+static const char *tokenize_next(const char *cursor, str_view_t *token)
+{
+    while (*cursor == ' ')
+        cursor++;
+    token->ptr = cursor;
+    while (*cursor != '\0' && *cursor != ' ')
+        cursor++;
+    token->len = cursor - token->ptr;
+    return cursor;
+}
 
-    for (int i = 0; i < wait_time; ++i)
+static void tokenize_arguments(const char *cursor, command_args_t *args, int max_args, int text_last)
+{
+    args->argc = 0;
+    while (args->argc < max_args)
     {
-        sleep(1);
-        pthread_mutex_lock(&disconnected_player->player_mutex);
-        if (disconnected_player->connected)
+        while (*cursor == ' ')
+            cursor++;
+        if (*cursor == '\0')
         {
-            // Le joueur s'est reconnecté
-            pthread_mutex_unlock(&disconnected_player->player_mutex);
+            break;
+        }
 
-            pthread_mutex_lock(&game->game_mutex);
-            game->waiting_reconnect = 0;
-            pthread_mutex_unlock(&game->game_mutex);
+        str_view_t *token = &args->argv[args->argc++];
+        if (text_last && args->argc == max_args)
+        {
+            // Le dernier argument est un texte libre : il va jusqu'à la fin de la ligne
+            token->ptr = cursor;
+            token->len = strlen(cursor);
+            cursor += token->len;
+        }
+        else
+        {
+            cursor = tokenize_next(cursor, token);
+        }
+    }
 
-            // Informer l'autre joueur que la partie reprend
-            snprintf(buffer, sizeof(buffer), GREEN "%s s'est reconnecté. La partie %d reprend.\n" RESET, disconnected_player->pseudo, game->game_id);
-            pthread_mutex_lock(&other_player->player_mutex);
-            send(other_player->sockfd, buffer, strlen(buffer), 0);
-            pthread_mutex_unlock(&other_player->player_mutex);
+    // Des arguments en trop sont une erreur de format
+    while (*cursor == ' ')
+        cursor++;
+    args->extra = (*cursor != '\0');
+}
 
-            // Réafficher le plateau pour les deux joueurs
-            int player_id = (game->player1 == disconnected_player) ? 0 : 1;
-            print_board(disconnected_player->sockfd, player_id, disconnected_player, other_player, game->board, game->game_id, game);
-            print_board(other_player->sockfd, 1 - player_id, other_player, disconnected_player, game->board, game->game_id, game);
+/*
+    Copier une vue dans un buffer terminé par '\0' (tronqué si besoin)
+*/
+void view_copy(str_view_t view, char *dest, size_t size)
+{
+    size_t len = view.len < size - 1 ? view.len : size - 1;
+    memcpy(dest, view.ptr, len);
+    dest[len] = '\0';
+}
 
-            // Informer le joueur que c'est son tour
-            snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] C'est à vous de jouer.\n" RESET, game->game_id);
-            if (game->turn == 0)
-            {
-                send(game->player1->sockfd, buffer, strlen(buffer), 0);
-                snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
-                send(game->player2->sockfd, buffer, strlen(buffer), 0);
-            }
-            else
-            {
-                send(game->player2->sockfd, buffer, strlen(buffer), 0);
-                snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
-                send(game->player1->sockfd, buffer, strlen(buffer), 0);
-            }
+/*
+    Convertir une vue en entier, retourne 0 si la vue n'est pas un nombre
+*/
+int view_to_int(str_view_t view, int *value)
+{
+    if (view.len == 0 || view.len > 10)
+    {
+        return 0;
+    }
 
-            return NULL; // Fin du thread
+    int sign = 1;
+    size_t i = 0;
+    if (view.ptr[0] == '-')
+    {
+        sign = -1;
+        i = 1;
+        if (view.len == 1)
+        {
+            return 0;
         }
-        pthread_mutex_unlock(&disconnected_player->player_mutex);
     }
 
-    // Le joueur ne s'est pas reconnecté après le délai
-    pthread_mutex_lock(&game->game_mutex);
-    game->game_over = 1;
-    game->waiting_reconnect = 0;
-    pthread_mutex_unlock(&game->game_mutex);
+    long result = 0;
+    for (; i < view.len; ++i)
+    {
+        if (view.ptr[i] < '0' || view.ptr[i] > '9')
+        {
+            return 0;
+        }
+        result = result * 10 + (view.ptr[i] - '0');
+    }
+    *value = (int)(sign * result);
+    return 1;
+}
 
-    // Informer l'autre joueur que la partie est terminée
-    snprintf(buffer, sizeof(buffer), RED "%s ne s'est pas reconnecté. Vous remportez la partie %d !\n" RESET, disconnected_player->pseudo, game->game_id);
-    pthread_mutex_lock(&other_player->player_mutex);
-    send(other_player->sockfd, buffer, strlen(buffer), 0);
+/*
+    Nombre décimal positif écrit avec un point (0.2, 5, 12.5), retourne 0 si la vue n'en est pas un
+*/
+int view_to_double(str_view_t view, double *value)
+{
+    char text[32];
+    if (view.len == 0 || view.len >= sizeof(text))
+    {
+        return 0;
+    }
+    // Pas de signe, d'exposant ni de inf/nan : seulement des chiffres et un point
+    int dots = 0;
+    for (size_t i = 0; i < view.len; ++i)
+    {
+        if (view.ptr[i] == '.')
+        {
+            dots++;
+        }
+        else if (view.ptr[i] < '0' || view.ptr[i] > '9')
+        {
+            return 0;
+        }
+    }
+    if (dots > 1 || view.len == (size_t)dots)
+    {
+        return 0;
+    }
+
+    view_copy(view, text, sizeof(text));
+    *value = strtod(text, NULL);
+    return 1;
+}
+
+static unsigned long long elapsed_ns(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)(now.tv_sec - start->tv_sec) * 1000000000ULL + (now.tv_nsec - start->tv_nsec);
+}
+
+static void record_command_stats(command_stats_t *stats, unsigned long long ns)
+{
+    __atomic_fetch_add(&stats->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->total_ns, ns, __ATOMIC_RELAXED);
+    unsigned long long max = __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&stats->max_ns, &max, ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// ********************************************************************************* //
+
+// Limitation de débit
+
+// Débit (jetons par seconde) et rafale de chaque classe, modifiables avec /limite
+rate_limit_t rate_limits[RATE_CLASS_COUNT] = {
+    {"connexion", "commandes", RATE_CONNECTION_PER_SEC, RATE_CONNECTION_BURST},
+    {"chat", "messages", RATE_CHAT_PER_SEC, RATE_CHAT_BURST},
+    {"defi", "défis", RATE_CHALLENGE_PER_SEC, RATE_CHALLENGE_BURST},
+    {"jeu", "coups", RATE_GAME_PER_SEC, RATE_GAME_BURST},
+};
+unsigned long rate_rejected[RATE_CLASS_COUNT];
+// Impaire pendant qu'une classe est modifiée : débit et rafale sont lus ensemble sans verrou (read_rate_limit)
+unsigned int rate_limits_version = 0;
+pthread_mutex_t rate_limits_mutex = PTHREAD_MUTEX_INITIALIZER; // Entre les modifications seulement
+unsigned long rate_mutes = 0;
+unsigned long rate_disconnects = 0;
+
+/*
+    Lire le débit et la rafale d'une classe, recommencer si /limite les a changés pendant la lecture
+*/
+static void read_rate_limit(int rate_class, double *rate, double *burst)
+{
+    unsigned int version;
+    do
+    {
+        version = __atomic_load_n(&rate_limits_version, __ATOMIC_ACQUIRE);
+        __atomic_load(&rate_limits[rate_class].rate, rate, __ATOMIC_RELAXED);
+        __atomic_load(&rate_limits[rate_class].burst, burst, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((version & 1) != 0 || version != __atomic_load_n(&rate_limits_version, __ATOMIC_RELAXED));
+}
+
+static void write_rate_limit(int rate_class, double rate, double burst)
+{
+    LOCK(&rate_limits_mutex);
+    __atomic_add_fetch(&rate_limits_version, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store(&rate_limits[rate_class].rate, &rate, __ATOMIC_RELAXED);
+    __atomic_store(&rate_limits[rate_class].burst, &burst, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&rate_limits_version, 1, __ATOMIC_RELEASE);
+    UNLOCK(&rate_limits_mutex);
+}
+
+/*
+    Initialiser les seaux à jetons d'un joueur (pleins)
+*/
+void init_rate_buckets(player_t *player)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int i = 0; i < RATE_CLASS_COUNT; ++i)
+    {
+        double rate;
+        read_rate_limit(i, &rate, &player->buckets[i].tokens);
+        player->buckets[i].last = now;
+        player->buckets[i].strikes = 0;
+        player->buckets[i].last_strike = 0;
+    }
+    player->muted_until = 0;
+}
+
+/*
+    Prendre un jeton dans le seau de la classe, retourne 0 si le seau est vide.
+    Les seaux d'un joueur ne sont utilisés que par son thread : pas de verrou.
+*/
+static int take_token(player_t *player, int rate_class)
+{
+    rate_bucket_t *bucket = &player->buckets[rate_class];
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double rate, burst;
+    read_rate_limit(rate_class, &rate, &burst);
+    double elapsed = (now.tv_sec - bucket->last.tv_sec) + (now.tv_nsec - bucket->last.tv_nsec) / 1e9;
+    bucket->last = now;
+    bucket->tokens += elapsed * rate;
+    if (bucket->tokens > burst)
+    {
+        bucket->tokens = burst;
+    }
+
+    if (bucket->tokens < 1.0)
+    {
+        return 0;
+    }
+    bucket->tokens -= 1.0;
+    return 1;
+}
+
+/*
+    Pénalités progressives, comptées par classe : commande ignorée, puis mise en sourdine (chat), puis déconnexion
+*/
+static void add_strike(player_t *player, int rate_class)
+{
+    char buffer[BUFFER_SIZE];
+    rate_bucket_t *bucket = &player->buckets[rate_class];
+    const char *what = rate_limits[rate_class].what;
+    time_t now = time(NULL);
+
+    // Les avertissements s'effacent après une période calme
+    if (now - bucket->last_strike > RATE_STRIKE_WINDOW)
+    {
+        bucket->strikes = 0;
+    }
+    bucket->last_strike = now;
+    bucket->strikes++;
+
+    if (bucket->strikes >= RATE_STRIKES_DISCONNECT)
+    {
+        __atomic_fetch_add(&rate_disconnects, 1, __ATOMIC_RELAXED);
+        snprintf(buffer, sizeof(buffer), RED "Trop de %s en peu de temps. Vous êtes déconnecté.\n" RESET, what);
+        send_to_player(player, buffer);
+        JOURNAL(LOG_WARN, player->connection_id, LOG_NONE, "%s déconnecté pour flood (%s)", player->pseudo, rate_limits[rate_class].name);
+        handle_player_disconnect(player);
+    }
+    else if (bucket->strikes == RATE_STRIKES_MUTE && rate_class == RATE_CLASS_CHAT)
+    {
+        __atomic_fetch_add(&rate_mutes, 1, __ATOMIC_RELAXED);
+        player->muted_until = now + RATE_MUTE_TIME;
+        JOURNAL(LOG_WARN, player->connection_id, LOG_NONE, "%s mis en sourdine pour flood", player->pseudo);
+        snprintf(buffer, sizeof(buffer), RED "Trop de %s en peu de temps. Vous ne pouvez plus discuter pendant %d secondes.\n" RESET, what, RATE_MUTE_TIME);
+        send_to_player(player, buffer);
+    }
+    else if (bucket->strikes == 1)
+    {
+        // On ne prévient qu'une fois pour ne pas amplifier le flood
+        snprintf(buffer, sizeof(buffer), RED "Trop de %s en peu de temps, commande ignorée. Ralentissez.\n" RESET, what);
+        send_to_player(player, buffer);
+    }
+}
+
+/*
+    Vérifier qu'un joueur peut exécuter une commande de la classe donnée
+*/
+int rate_limit_allow(player_t *player, int rate_class)
+{
+    if (rate_class == RATE_CLASS_CHAT && player->muted_until > time(NULL))
+    {
+        __atomic_fetch_add(&rate_rejected[rate_class], 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    if (!take_token(player, rate_class))
+    {
+        __atomic_fetch_add(&rate_rejected[rate_class], 1, __ATOMIC_RELAXED);
+        add_strike(player, rate_class);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+    Afficher ou modifier les limites de débit (administrateurs)
+*/
+static void cmd_limite(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+
+    if (args->argc == 3)
+    {
+        char name[16];
+        double rate, burst;
+        view_copy(args->argv[0], name, sizeof(name));
+
+        int rate_class = -1;
+        for (int i = 0; i < RATE_CLASS_COUNT; ++i)
+        {
+            if (strcmp(rate_limits[i].name, name) == 0)
+            {
+                rate_class = i;
+            }
+        }
+
+        if (rate_class == -1 || !view_to_double(args->argv[1], &rate) || !view_to_double(args->argv[2], &burst) || rate <= 0 || burst < 1)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /limite [<connexion|chat|defi|jeu> <par seconde> <rafale>]\n" RESET);
+            send_to_player(player, buffer);
+            return;
+        }
+        write_rate_limit(rate_class, rate, burst);
+    }
+    else if (args->argc != 0)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /limite [<connexion|chat|defi|jeu> <par seconde> <rafale>]\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), CYAN "%-10s %12s %8s %10s\n" RESET, "Classe", "Par seconde", "Rafale", "Refusées");
+    send_to_player(player, buffer);
+    for (int i = 0; i < RATE_CLASS_COUNT; ++i)
+    {
+        double rate, burst;
+        read_rate_limit(i, &rate, &burst);
+        snprintf(buffer, sizeof(buffer), "%-10s %12.2f %8.1f %10lu\n", rate_limits[i].name, rate, burst, __atomic_load_n(&rate_rejected[i], __ATOMIC_RELAXED));
+        send_to_player(player, buffer);
+    }
+    snprintf(buffer, sizeof(buffer), "Mises en sourdine : %lu, déconnexions : %lu\n", __atomic_load_n(&rate_mutes, __ATOMIC_RELAXED),
+             __atomic_load_n(&rate_disconnects, __ATOMIC_RELAXED));
+    send_to_player(player, buffer);
+}
+
+// Commande confiée à la réserve de travailleurs par handle_command
+typedef struct command_task_t
+{
+    command_t *cmd;
+    player_t *player;
+    const command_args_t *args;
+    unsigned int trace; // La trace de la requête continue sur le travailleur
+} command_task_t;
+
+static void run_command_task(void *arg)
+{
+    command_task_t *task = (command_task_t *)arg;
+    unsigned int outer_trace = trace_request;
+    if (task->trace != 0)
+    {
+        trace_resume(task->trace, task->player->connection_id, 0);
+    }
+    task->cmd->handler(task->player, task->args);
+    if (task->trace != 0)
+    {
+        trace_resume(outer_trace, task->player->connection_id, 0);
+    }
+}
+
+void handle_command(player_t *player, const char *command)
+{
+    char buffer[BUFFER_SIZE];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned long long trace_start = TRACE_START();
+
+    command_args_t args;
+    const char *cursor = tokenize_next(command, &args.name);
+    command_t *cmd = find_command(args.name);
+
+    if (cmd == NULL || (cmd->permission == PERM_ADMIN && !player->is_admin))
+    {
+        snprintf(buffer, sizeof(buffer), RED "Commande non reconnue. Tapez /help pour voir la liste des commandes.\n" RESET);
+        send_to_player(player, buffer);
+        record_command_stats(&unknown_command_stats, elapsed_ns(&start));
+        return;
+    }
+
+    // Limite propre à la commande, vérifiée avant tout traitement
+    if (cmd->rate_class != RATE_CLASS_CONNECTION && !rate_limit_allow(player, cmd->rate_class))
+    {
+        __atomic_fetch_add(&cmd->stats.throttled, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    tokenize_arguments(cursor, &args, cmd->max_args, cmd->flags & CMD_TEXT_LAST);
+    TRACE_END("analyse", cmd->name, trace_start);
+    if (args.argc < cmd->min_args || args.extra)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez %s\n" RESET, cmd->usage);
+        send_to_player(player, buffer);
+        __atomic_fetch_add(&cmd->stats.rejected, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    trace_start = TRACE_START();
+    if (cmd->flags & CMD_POOL)
+    {
+        command_task_t task = {cmd, player, &args, trace_request};
+        pool_run(run_command_task, &task, POOL_ANY_WORKER);
+    }
+    else
+    {
+        cmd->handler(player, &args);
+    }
+    TRACE_END("commande", cmd->name, trace_start);
+    record_command_stats(&cmd->stats, elapsed_ns(&start));
+}
+
+// Commandes du jeu
+
+static void cmd_defier(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    char target_pseudo[32];
+    char variant_name[32];
+    const variant_t *variant = DEFAULT_VARIANT;
+
+    view_copy(args->argv[0], target_pseudo, sizeof(target_pseudo));
+    if (args->argc == 2)
+    {
+        view_copy(args->argv[1], variant_name, sizeof(variant_name));
+        variant = find_variant(variant_name);
+    }
+
+    if (variant == NULL)
+    {
+        int length = snprintf(buffer, sizeof(buffer), RED "Variante inconnue : %s. Variantes disponibles :\n", variant_name);
+        for (int i = 0; i < variant_count && length < (int)sizeof(buffer); ++i)
+        {
+            length += snprintf(buffer + length, sizeof(buffer) - length, "  %s - %s\n", variants[i].name, variants[i].description);
+        }
+        if (length < (int)sizeof(buffer))
+        {
+            snprintf(buffer + length, sizeof(buffer) - length, RESET);
+        }
+        send_to_player(player, buffer);
+        return;
+    }
+
+    challenge_player(player, target_pseudo, variant);
+}
+
+static void cmd_accepter(player_t *player, const command_args_t *args)
+{
+    accept_challenge(player);
+}
+
+static void cmd_refuser(player_t *player, const command_args_t *args)
+{
+    refuse_challenge(player);
+}
+
+static void cmd_joueurs(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    char prefix[PRESENCE_NAME_SIZE] = "";
+    int page = 1;
+
+    // Un seul argument numérique est un numéro de page
+    if (args->argc == 2 || (args->argc == 1 && !view_to_int(args->argv[0], &page)))
+    {
+        view_copy(args->argv[0], prefix, sizeof(prefix));
+    }
+    if (args->argc == 2 && !view_to_int(args->argv[1], &page))
+    {
+        page = 0;
+    }
+    if (page < 1)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /joueurs [<préfixe>] [<page>]\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+    list_connected_players(player, prefix, page);
+}
+
+static void cmd_help(player_t *player, const command_args_t *args)
+{
+    show_help(player);
+}
+
+static void cmd_mp(player_t *player, const command_args_t *args)
+{
+    char target_pseudo[32];
+    view_copy(args->argv[0], target_pseudo, sizeof(target_pseudo));
+    send_private_message(player, target_pseudo, args->argv[1].ptr);
+}
+
+static void cmd_chat(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    int game_id;
+    if (view_to_int(args->argv[0], &game_id))
+    {
+        chat_in_game(player, game_id, args->argv[1].ptr);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /chat <numéro de partie> <message>\n" RESET);
+        send_to_player(player, buffer);
+    }
+}
+
+static void cmd_play(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    int game_id, move;
+
+    if (!view_to_int(args->argv[0], &game_id))
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /play <numéro de partie> [<numéro du trou>]\n" RESET);
+        send_to_player(player, buffer);
+    }
+    else if (args->argc == 2)
+    {
+        // Le joueur souhaite jouer un coup
+        if (view_to_int(args->argv[1], &move))
+        {
+            make_move_command(player, game_id, move);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), RED "Entrée invalide. Veuillez entrer un numéro de trou.\n" RESET);
+            send_to_player(player, buffer);
+        }
+    }
+    else
+    {
+        // Le joueur souhaite afficher le plateau
+        display_board(player, game_id);
+    }
+}
+
+static void cmd_abandon(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    int game_id;
+    if (view_to_int(args->argv[0], &game_id))
+    {
+        abandon_game(player, game_id);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /abandon <numéro de partie>\n" RESET);
+        send_to_player(player, buffer);
+    }
+}
+
+static void cmd_affichage(player_t *player, const command_args_t *args)
+{
+    char mode[16];
+    view_copy(args->argv[0], mode, sizeof(mode));
+    set_display_mode(player, mode);
+}
+
+static void cmd_quit(player_t *player, const command_args_t *args)
+{
+    // Un départ volontaire ne peut pas être repris avec RESUME
+    forget_session(player, 1);
+    handle_player_disconnect(player);
+}
+
+static void cmd_stats(player_t *player, const command_args_t *args)
+{
+    show_command_stats(player);
+}
+
+static void cmd_verrous(player_t *player, const command_args_t *args)
+{
+    show_lock_report(player, args->argc == 1 && args->argv[0].len == 3 && strncmp(args->argv[0].ptr, "raz", 3) == 0);
+}
+
+/*
+    Afficher ou changer le niveau du journal (administrateurs)
+*/
+static void cmd_journal(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+
+    if (args->argc == 1)
+    {
+        char name[16];
+        view_copy(args->argv[0], name, sizeof(name));
+        int level = journal_level_from_name(name);
+        if (level < 0)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Niveau inconnu. Utilisez /journal [debug|info|warn|error|off]\n" RESET);
+            send_to_player(player, buffer);
+            return;
+        }
+        journal_set_level(level);
+        JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "Niveau du journal changé en %s par %s", journal_level_name(level), player->pseudo);
+    }
+
+    unsigned long long written, dropped;
+    int threads;
+    journal_counters(&written, &dropped, &threads);
+    snprintf(buffer, sizeof(buffer), CYAN "Journal %s : niveau %s, %llu enregistrements écrits, %llu perdus, %d tampons de threads\n" RESET,
+             JOURNAL_FILE, journal_level_name(__atomic_load_n(&journal_level, __ATOMIC_RELAXED)), written, dropped, threads);
+    send_to_player(player, buffer);
+}
+
+/*
+    Enregistrer les commandes de base du serveur
+*/
+void init_commands()
+{
+    register_command("/defier", 1, 2, 0, PERM_PLAYER, cmd_defier, "/defier <pseudo> [awale|oware|mini]");
+    register_command("/accepter", 0, 0, 0, PERM_PLAYER, cmd_accepter, "/accepter");
+    register_command("/refuser", 0, 0, 0, PERM_PLAYER, cmd_refuser, "/refuser");
+    register_command("/joueurs", 0, 2, CMD_POOL, PERM_PLAYER, cmd_joueurs, "/joueurs [<préfixe>] [<page>]");
+    register_command("/help", 0, 0, 0, PERM_PLAYER, cmd_help, "/help");
+    register_command("/mp", 2, 2, CMD_TEXT_LAST, PERM_PLAYER, cmd_mp, "/mp <pseudo> <message>");
+    register_command("/chat", 2, 2, CMD_TEXT_LAST, PERM_PLAYER, cmd_chat, "/chat <numéro de partie> <message>");
+    register_command("/play", 1, 2, 0, PERM_PLAYER, cmd_play, "/play <numéro de partie> [<numéro du trou>]");
+    register_command("/abandon", 1, 1, 0, PERM_PLAYER, cmd_abandon, "/abandon <numéro de partie>");
+    register_command("/affichage", 1, 1, 0, PERM_PLAYER, cmd_affichage, "/affichage <complet|delta|client>");
+    register_command("/quit", 0, 0, 0, PERM_PLAYER, cmd_quit, "/quit");
+    register_command("/stats", 0, 0, 0, PERM_ADMIN, cmd_stats, "/stats");
+    register_command("/verrous", 0, 1, 0, PERM_ADMIN, cmd_verrous, "/verrous [raz]");
+    register_command("/journal", 0, 1, 0, PERM_ADMIN, cmd_journal, "/journal [debug|info|warn|error|off]");
+    register_command("/limite", 0, 3, 0, PERM_ADMIN, cmd_limite, "/limite [<connexion|chat|defi|jeu> <par seconde> <rafale>]");
+
+    set_command_rate_class("/mp", RATE_CLASS_CHAT);
+    set_command_rate_class("/chat", RATE_CLASS_CHAT);
+    set_command_rate_class("/defier", RATE_CLASS_CHALLENGE);
+    set_command_rate_class("/play", RATE_CLASS_GAME);
+    init_channel_commands();
+    init_tournament_commands();
+    init_heartbeat_commands();
+    init_endgame_commands();
+    init_history_commands();
+}
+
+/*
+    Produire les compteurs et la latence de chaque commande ligne par ligne (/stats et console d'administration)
+*/
+void report_command_stats(report_line_t emit, void *ctx)
+{
+    char buffer[BUFFER_SIZE];
+
+    snprintf(buffer, sizeof(buffer), "%-12s %10s %8s %8s %12s %12s\n", "Commande", "Appels", "Refus", "Limitées", "Moy. (us)", "Max (us)");
+    emit(ctx, buffer);
+
+    for (int i = 0; i <= command_count; ++i)
+    {
+        const char *name = (i < command_count) ? commands[i].name : "(inconnue)";
+        command_stats_t *stats = (i < command_count) ? &commands[i].stats : &unknown_command_stats;
+
+        unsigned long calls = __atomic_load_n(&stats->calls, __ATOMIC_RELAXED);
+        unsigned long rejected = __atomic_load_n(&stats->rejected, __ATOMIC_RELAXED);
+        unsigned long throttled = __atomic_load_n(&stats->throttled, __ATOMIC_RELAXED);
+        unsigned long long total_ns = __atomic_load_n(&stats->total_ns, __ATOMIC_RELAXED);
+        unsigned long long max_ns = __atomic_load_n(&stats->max_ns, __ATOMIC_RELAXED);
+        double mean_us = calls ? (double)total_ns / calls / 1000.0 : 0.0;
+
+        snprintf(buffer, sizeof(buffer), "%-12s %10lu %8lu %8lu %12.1f %12.1f\n", name, calls, rejected, throttled, mean_us, max_ns / 1000.0);
+        emit(ctx, buffer);
+    }
+}
+
+static void send_report_line(void *ctx, const char *line)
+{
+    player_t *player = (player_t *)ctx;
+    send_to_player(player, line);
+}
+
+/*
+    Afficher les compteurs et la latence de chaque commande (administrateurs)
+*/
+void show_command_stats(player_t *player)
+{
+    report_command_stats(send_report_line, player);
+}
+
+/*
+    Afficher le rapport du profilage des verrous (administrateurs), puis le remettre à zéro si demandé
+*/
+void show_lock_report(player_t *player, int reset)
+{
+    lock_profiler_report(send_report_line, player);
+    if (reset)
+    {
+        lock_profiler_reset();
+    }
+}
+
+/*
+    Charger la liste des administrateurs (un pseudo par ligne)
+*/
+void load_admins()
+{
+    FILE *file = fopen(ADMINS_FILE, "r");
+    if (file == NULL)
+    {
+        return;
+    }
+
+    char line[64];
+    while (admin_count < MAX_ADMINS && fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] != '\0')
+        {
+            size_t length = strlen(line);
+            if (length >= sizeof(admins[0]))
+            {
+                length = sizeof(admins[0]) - 1; // Pseudo tronqué comme à la connexion
+            }
+            memcpy(admins[admin_count], line, length);
+            admins[admin_count][length] = '\0';
+            admin_count++;
+        }
+    }
+    fclose(file);
+}
+
+int is_admin_pseudo(const char *pseudo)
+{
+    for (int i = 0; i < admin_count; ++i)
+    {
+        if (strcmp(admins[i], pseudo) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void list_connected_players(player_t *player, const char *prefix, int page)
+{
+    presence_page_t result;
+    presence_query(prefix, page, &result);
+
+    int pages = (result.total + PRESENCE_PAGE_SIZE - 1) / PRESENCE_PAGE_SIZE;
+    io_buffer_t *out = buffer_acquire(BUFFER_LARGE);
+    if (out == NULL)
+    {
+        return;
+    }
+    if (result.total == 0)
+    {
+        buffer_append(out, YELLOW "Aucun joueur connecté%s%s%s.\n" RESET, prefix[0] ? " dont le pseudo commence par « " : "", prefix, prefix[0] ? " »" : "");
+    }
+    else if (result.count == 0)
+    {
+        buffer_append(out, YELLOW "Page %d inexistante : %d page%s.\n" RESET, page, pages, pages > 1 ? "s" : "");
+    }
+    else
+    {
+        buffer_append(out, CYAN "Joueurs connectés (%d, page %d/%d) :\n" RESET, result.total, page, pages);
+        for (int i = 0; i < result.count; ++i)
+        {
+            presence_entry_t *entry = &result.entries[i];
+            buffer_append(out, "%s - V: %d | D: %d | N: %d\n", entry->pseudo, entry->wins, entry->losses, entry->draws);
+        }
+        if (page < pages)
+        {
+            buffer_append(out, CYAN "Page suivante : /joueurs %s%s%d\n" RESET, prefix, prefix[0] ? " " : "", page + 1);
+        }
+    }
+    player->transport->send(player->sockfd, player->transport_ctx, out->data, out->length);
+    buffer_release(out);
+}
+
+void show_help(player_t *player)
+{
+    char buffer[2 * BUFFER_SIZE]; // L'aide dépasse une ligne de chat
+    snprintf(buffer, sizeof(buffer),
+             CYAN "Commandes disponibles :\n"
+                  "/defier <pseudo> [awale|oware|mini] - Défier un joueur, dans la variante awale par défaut\n"
+                  "/accepter - Accepter un défi\n"
+                  "/refuser - Refuser un défi\n"
+                  "/joueurs [<préfixe>] [<page>] - Lister les joueurs connectés, par pages de 20\n"
+                  "/global <message> - Envoyer un message au chat global\n"
+                  "/join <#canal> - Rejoindre un canal de discussion, /leave <#canal> pour le quitter\n"
+                  "/say <#canal> <message> - Envoyer un message dans un canal, /canaux pour lister les vôtres\n"
+                  "/mp <pseudo> <message> - Envoyer un message privé\n"
+                  "/chat <numéro de partie> <message> - Envoyer un message dans une partie\n"
+                  "/play <numéro de partie> [<numéro du trou>] - Afficher le plateau ou jouer dans une partie\n"
+                  "/abandon <numéro de partie> - Abandonner la partie\n"
+                  "/affichage <complet|delta|client> - Recevoir le plateau complet, seulement les changements, ou l'état brut dessiné par le client\n"
+                  "/historique [global|partie <numéro>|mp <pseudo>] [<nombre>] - Derniers messages d'un chat\n"
+                  "/conseil <numéro de partie> - Meilleur coup d'après la table de finales\n"
+                  "/tournoi <creer|rejoindre|lancer|classement|liste> - Tournois toutes rondes ou suisses\n"
+                  "/quit - Quitter le jeu\n"
+                  "/help - Afficher cette aide\n" RESET);
+    send_to_player(player, buffer);
+}
+
+void handle_player_disconnect(player_t *player)
+{
+    char buffer[BUFFER_SIZE];
+
+    JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "Déconnexion de %s", player->pseudo);
+
+    // Verrouiller le mutex du joueur
+    LOCK(&player->player_mutex);
+
+    if (!player->connected)
+    {
+        JOURNAL(LOG_DEBUG, player->connection_id, LOG_NONE, "%s déjà marqué comme déconnecté", player->pseudo);
+        UNLOCK(&player->player_mutex);
+        return; // Le joueur est déjà marqué comme déconnecté
+    }
+
+    player->connected = 0;
+    channels_detach(player);
+    presence_remove(player->pseudo);
+    history_set_mark(player->pseudo);
+
+    // Informer les abonnés du chat global
+    snprintf(buffer, sizeof(buffer), RED "%s s'est déconnecté.\n" RESET, player->pseudo);
+    channel_publish(global_chat_channel(), buffer, player);
+
+    // Gérer les défis en attente
+    remove_challenge(player);
+
+    // Les parties en cours sont prévenues par leur acteur, une fois le verrou du joueur relâché
+    int count = player->game_count;
+    game_t **player_games = NULL;
+    if (count > 0)
+    {
+        player_games = (game_t **)malloc(count * sizeof(game_t *));
+        if (player_games == NULL)
+        {
+            perror("malloc");
+            count = 0;
+        }
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        player_games[i] = player->games[i];
+        game_retain(player_games[i]);
+    }
+
+    UNLOCK(&player->player_mutex);
+
+    for (int i = 0; i < count; ++i)
+    {
+        post_game_message(player_games[i], GAME_MESSAGE_DISCONNECT, (player_games[i]->player1 == player) ? 0 : 1, 0, NULL);
+    }
+    free(player_games);
+
+    // Une reprise de session attend peut-être que cette connexion soit vue fermée
+    wake_session_takeovers();
+
+    player->transport->close(player->sockfd, player->transport_ctx);
+}
+
+/*
+    Suspendre la partie dont un joueur s'est déconnecté et attendre son retour (acteur de la partie)
+*/
+static void suspend_game(game_t *game, player_t *player)
+{
+    char buffer[BUFFER_SIZE];
+
+    JOURNAL(LOG_DEBUG, player->connection_id, game->game_id, "game_over=%d, waiting_reconnect=%d", game->game_over, game->waiting_reconnect);
+
+    LOCK(&player->player_mutex);
+    int connected = player->connected;
+    UNLOCK(&player->player_mutex);
+
+    // Déjà en attente de l'autre joueur, ou revenu avant que le message soit traité
+    if (game->waiting_reconnect || connected)
+    {
+        return;
+    }
+
+    JOURNAL(LOG_INFO, player->connection_id, game->game_id, "Attente de la reconnexion de %s", player->pseudo);
+
+    game->waiting_reconnect = 1;
+    game->absent_player = player;
+    game->reconnect_deadline = time(NULL) + TIME_OUT_TIME;
+
+    // Informer l'autre joueur
+    player_t *other_player = (game->player1 == player) ? game->player2 : game->player1;
+
+    LOCK(&other_player->player_mutex);
+    snprintf(buffer, sizeof(buffer), RED "Votre adversaire %s s'est déconnecté. En attente de reconnexion pendant %d secondes...\n" RESET, player->pseudo, TIME_OUT_TIME);
+    int bytes_sent = send_to_player(other_player, buffer);
+    if (bytes_sent < 0)
+    {
+        JOURNAL(LOG_WARN, other_player->connection_id, game->game_id, "Erreur lors de l'envoi du message à l'autre joueur");
+    }
+    UNLOCK(&other_player->player_mutex);
+
+    // Lancer l'attente de la reconnexion
+    start_reconnection_wait(game);
+}
+
+/*
+    Le joueur s'est reconnecté à temps : la partie reprend
+*/
+static void resume_game(game_t *game, player_t *reconnected_player)
+{
+    char buffer[BUFFER_SIZE];
+    player_t *other_player = (game->player1 == reconnected_player) ? game->player2 : game->player1;
+
+    game->waiting_reconnect = 0;
+    JOURNAL(LOG_INFO, reconnected_player->connection_id, game->game_id, "Reprise de la partie");
+
+    // Informer l'autre joueur que la partie reprend
+    snprintf(buffer, sizeof(buffer), GREEN "%s s'est reconnecté. La partie %d reprend.\n" RESET, reconnected_player->pseudo, game->game_id);
+    LOCK(&other_player->player_mutex);
+    send_to_player(other_player, buffer);
+    UNLOCK(&other_player->player_mutex);
+
+    // Réafficher le plateau complet au joueur reconnecté, l'autre joueur a déjà la dernière version
+    int player_id = (game->player1 == reconnected_player) ? 0 : 1;
+    print_board(player_id, reconnected_player, other_player, game->board, game->game_id, game);
+    if (other_player->display_mode != DISPLAY_DELTA)
+    {
+        print_board(1 - player_id, other_player, reconnected_player, game->board, game->game_id, game);
+    }
+
+    // Informer le joueur que c'est son tour
+    snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] C'est à vous de jouer.\n" RESET, game->game_id);
+    if (game->turn == 0)
+    {
+        send_to_player(game->player1, buffer);
+        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
+        send_to_player(game->player2, buffer);
+    }
+    else
+    {
+        send_to_player(game->player2, buffer);
+        snprintf(buffer, sizeof(buffer), RED "[Partie %d] C'est à votre adversaire de jouer.\n" RESET, game->game_id);
+        send_to_player(game->player1, buffer);
+    }
+}
+
+/*
+    Le joueur ne s'est pas reconnecté après le délai : il perd la partie par forfait.
+    Les joueurs déconnectés sans autre partie sont libérés.
+*/
+static void forfeit_game(game_t *game, player_t *disconnected_player)
+{
+    char buffer[BUFFER_SIZE];
+    player_t *other_player = (game->player1 == disconnected_player) ? game->player2 : game->player1;
+
+    game->game_over = 1;
+    game->waiting_reconnect = 0;
+    JOURNAL(LOG_INFO, disconnected_player->connection_id, game->game_id, "Forfait de %s, absent depuis %d secondes", disconnected_player->pseudo, TIME_OUT_TIME);
+
+    // Informer l'autre joueur que la partie est terminée
+    snprintf(buffer, sizeof(buffer), RED "%s ne s'est pas reconnecté. Vous remportez la partie %d !\n" RESET, disconnected_player->pseudo, game->game_id);
+    LOCK(&other_player->player_mutex);
+    send_to_player(other_player, buffer);
 
     // Mettre à jour les statistiques
     other_player->wins++;
     disconnected_player->losses++;
-    pthread_mutex_unlock(&other_player->player_mutex);
+    UNLOCK(&other_player->player_mutex);
+
+    update_player_score(other_player);
+    update_player_score(disconnected_player);
+    tournament_report_result(game, (game->player1 == disconnected_player) ? GAME_RESULT_PLAYER2_WIN : GAME_RESULT_PLAYER1_WIN);
+
+    // Retirer la partie des deux joueurs, puis libérer ceux qui sont partis sans autre partie en cours.
+    // Sous players_mutex de bout en bout : le thread client_handler de l'absent peut être en train de finir (detach_handler)
+    LOCK(&players_mutex);
+    remove_game_from_player(disconnected_player, game);
+    remove_game_from_player(other_player, game);
+    int release_disconnected = unlist_player_if_idle(disconnected_player);
+    int release_other = unlist_player_if_idle(other_player);
+    UNLOCK(&players_mutex);
+    if (release_disconnected)
+    {
+        destroy_player(disconnected_player);
+    }
+    if (release_other)
+    {
+        destroy_player(other_player);
+    }
+
+    // Nettoyer la partie
+    remove_game_from_games(game);
+    game_release(game); // Référence de la liste des parties
+}
+
+/*
+    Reprendre la partie si le joueur attendu est revenu, la perdre par forfait à la fin du délai
+    (ou tout de suite si expired), sinon vérifier à nouveau dans une seconde
+*/
+static void check_absent_player(game_t *game, int expired)
+{
+    if (!game->waiting_reconnect)
+    {
+        return;
+    }
+
+    player_t *absent_player = game->absent_player;
+    LOCK(&absent_player->player_mutex);
+    int connected = absent_player->connected;
+    UNLOCK(&absent_player->player_mutex);
+
+    if (connected)
+    {
+        resume_game(game, absent_player);
+    }
+    else if (expired || time(NULL) >= game->reconnect_deadline)
+    {
+        forfeit_game(game, absent_player);
+    }
+    else
+    {
+        start_reconnection_timer(game);
+    }
+}
+
+/*
+    Échéance de la minuterie : la vérification est postée à l'acteur de la partie, avec la référence de l'échéance
+*/
+static long check_reconnection(void *arg)
+{
+    post_game_message((game_t *)arg, GAME_MESSAGE_RECONNECT_CHECK, 0, 0, NULL);
+    return 0;
+}
+
+/*
+    Vérifier à nouveau dans une seconde (acteur de la partie). Si l'échéance ne peut pas être programmée,
+    la partie ne serait plus jamais vérifiée : l'absent la perd tout de suite.
+*/
+static void start_reconnection_timer(game_t *game)
+{
+    game_retain(game);
+    if (timer_schedule(1000, check_reconnection, game) != 0)
+    {
+        JOURNAL(LOG_ERROR, LOG_NONE, game->game_id, "Échéance de reconnexion impossible à programmer, fin de la partie");
+        game_release(game);
+        check_absent_player(game, 1);
+    }
+}
+
+// ********************************************************************************* //
+
+// Acteurs des parties
+
+void game_retain(game_t *game)
+{
+    __atomic_add_fetch(&game->refs, 1, __ATOMIC_RELAXED);
+}
+
+/*
+    Rendre une référence : la dernière libère la partie et écrit son historique
+*/
+void game_release(game_t *game)
+{
+    if (__atomic_sub_fetch(&game->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        history_close(game->history);
+        free(game);
+    }
+}
+
+static void release_game_actor(actor_t *actor)
+{
+    game_release((game_t *)actor);
+}
+
+/*
+    Retrouver une partie du joueur et son camp. La partie est retournée avec une référence,
+    à rendre en postant un message ou par game_release ; NULL si le joueur n'y participe pas.
+*/
+game_t *find_player_game(player_t *player, int game_id, int *player_id)
+{
+    game_t *game = NULL;
+
+    LOCK(&player->player_mutex);
+    for (int i = 0; i < player->game_count; ++i)
+    {
+        if (player->games[i]->game_id == game_id)
+        {
+            game = player->games[i];
+            game_retain(game);
+            *player_id = (game->player1 == player) ? 0 : 1;
+            break;
+        }
+    }
+    UNLOCK(&player->player_mutex);
+    return game;
+}
+
+static game_message_t *new_game_message(game_t *game, int kind, size_t text_size)
+{
+    game_message_t *message = (game_message_t *)malloc(sizeof(game_message_t) + text_size);
+    if (message == NULL)
+    {
+        perror("malloc");
+        game_release(game);
+        return NULL;
+    }
+    message->kind = kind;
+    message->player_id = 0;
+    message->argument = 0;
+    message->call = NULL;
+    message->data = NULL;
+    message->trace = trace_request;
+    message->trace_connection = 0;
+    message->posted_ns = TRACE_START();
+    message->text[0] = '\0';
+    return message;
+}
+
+/*
+    Poster un message à l'acteur de la partie, avec la référence prise par l'appelant.
+    L'appelant ne doit tenir aucun verrou : sans travailleurs (simulation), le message est traité tout de suite.
+*/
+int post_game_message(game_t *game, int kind, int player_id, int argument, const char *text)
+{
+    size_t text_size = (text != NULL) ? strlen(text) + 1 : 1;
+    game_message_t *message = new_game_message(game, kind, text_size);
+    if (message == NULL)
+    {
+        return -1;
+    }
+    message->player_id = player_id;
+    message->argument = argument;
+    if (message->trace != 0)
+    {
+        player_t *poster = (player_id == 0) ? game->player1 : game->player2;
+        message->trace_connection = poster->connection_id;
+    }
+    if (text != NULL)
+    {
+        memcpy(message->text, text, text_size);
+    }
+    actor_post(&game->actor, &message->link);
+    return 0;
+}
+
+/*
+    Exécuter une fonction dans le contexte de la partie, avec la référence prise par l'appelant
+*/
+int post_game_call(game_t *game, game_call_t call, void *data)
+{
+    game_message_t *message = new_game_message(game, GAME_MESSAGE_CALL, 1);
+    if (message == NULL)
+    {
+        return -1;
+    }
+    message->call = call;
+    message->data = data;
+    actor_post(&game->actor, &message->link);
+    return 0;
+}
+
+// Noms des messages dans les traces, dans l'ordre de GAME_MESSAGE_*
+static const char *game_message_names[] = {"coup", "plateau", "chat", "abandon", "conseil", "déconnexion", "reconnexion", "fin d'attente", "appel"};
+
+/*
+    Traiter un message de la partie : un seul à la fois par partie, sans verrou sur son état
+*/
+static void handle_game_message(actor_t *actor, actor_message_t *link)
+{
+    char buffer[BUFFER_SIZE];
+    game_t *game = (game_t *)actor;
+    game_message_t *message = (game_message_t *)link;
+
+    // Une requête échantillonnée continue dans la partie : attente dans la boîte aux lettres, puis traitement
+    unsigned int outer_trace = trace_request;
+    unsigned long long trace_start = 0;
+    if (message->trace != 0)
+    {
+        trace_resume(message->trace, message->trace_connection, game->game_id);
+        trace_record("boîte aux lettres", NULL, message->posted_ns);
+        trace_start = trace_now();
+    }
+
+    if (message->kind == GAME_MESSAGE_CALL)
+    {
+        message->call(game, message->data);
+    }
+    else if (!game->game_over) // Sinon les joueurs de la partie ont pu être libérés
+    {
+        player_t *player = (message->player_id == 0) ? game->player1 : game->player2;
+        player_t *other_player = (message->player_id == 0) ? game->player2 : game->player1;
+
+        switch (message->kind)
+        {
+        case GAME_MESSAGE_MOVE:
+            play_move(game, player, message->player_id, message->argument);
+            break;
+        case GAME_MESSAGE_VIEW:
+            print_board(message->player_id, player, other_player, game->board, game->game_id, game);
+            break;
+        case GAME_MESSAGE_CHAT:
+            history_append(game->history, player->pseudo, NULL, message->text);
+            snprintf(buffer, sizeof(buffer), MAGENTA "[Partie %d] %s: %s\n" RESET, game->game_id, player->pseudo, message->text);
+            send_to_player(other_player, buffer);
+            break;
+        case GAME_MESSAGE_ABANDON:
+            resign_game(game, player);
+            break;
+        case GAME_MESSAGE_ADVICE:
+            give_advice(game, player, message->player_id);
+            break;
+        case GAME_MESSAGE_DISCONNECT:
+            suspend_game(game, player);
+            break;
+        case GAME_MESSAGE_RECONNECT_CHECK:
+            check_absent_player(game, 0);
+            break;
+        case GAME_MESSAGE_RECONNECT_TIMEOUT:
+            check_absent_player(game, 1);
+            break;
+        }
+    }
+
+    if (message->trace != 0)
+    {
+        trace_record("partie", game_message_names[message->kind], trace_start);
+        trace_resume(outer_trace, message->trace_connection, 0);
+    }
+    free(message);
+}
+
+/*
+    Traiter une ligne reçue d'un client. Retourne -1 si le joueur a été déconnecté pendant le traitement,
+    l'appelant ne doit alors plus lire depuis cette connexion.
+*/
+int handle_line(player_t *player, const char *line)
+{
+    char buffer[BUFFER_SIZE];
+    int session = player->session;
+
+    // Échantillonnage : la requête est suivie de la réception de la ligne jusqu'au dernier envoi
+    unsigned int trace = trace_request_begin(player->connection_id);
+    unsigned long long trace_start = TRACE_START();
+
+    // Toute ligne reçue prouve que la connexion est vivante, pas seulement /pong
+    __atomic_store_n(&player->last_seen, time(NULL), __ATOMIC_RELAXED);
+    JOURNAL(LOG_DEBUG, player->connection_id, LOG_NONE, "Commande : %.64s", line);
+
+    // Limite de la connexion, avant toute analyse de la commande
+    if (rate_limit_allow(player, RATE_CLASS_CONNECTION))
+    {
+        if (line[0] == '/')
+        {
+            handle_command(player, line);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), RED "Commande non reconnue. Tapez /help pour voir la liste des commandes.\n" RESET);
+            send_to_player(player, buffer);
+        }
+    }
+
+    LOCK(&player->player_mutex);
+    int still_connected = player->connected && player->session == session;
+    UNLOCK(&player->player_mutex);
+
+    if (trace != 0)
+    {
+        TRACE_END("requête", NULL, trace_start);
+        trace_request_end();
+    }
+    return still_connected ? 0 : -1;
+}
+
+// ********************************************************************************* //
+
+// Battements de cœur
+
+/*
+    Parcourir les joueurs connectés une fois par seconde : @PING aux joueurs silencieux depuis
+    heartbeat_interval, coupure des connexions muettes depuis idle_timeout. La coupure passe par
+    le thread de lecture du joueur, qui déclenche la déconnexion et l'attente de reconnexion habituelles.
+*/
+static long heartbeat_sweep(void *arg)
+{
+    time_t now = time(NULL);
+    int interval = __atomic_load_n(&heartbeat_interval, __ATOMIC_RELAXED);
+    int timeout = __atomic_load_n(&idle_timeout, __ATOMIC_RELAXED);
+    endpoint_t *endpoints;
+    int endpoint_count = 0;
+
+    LOCK(&players_mutex);
+    endpoints = malloc(sizeof(endpoint_t) * (player_count > 0 ? player_count : 1));
+    if (endpoints == NULL)
+    {
+        UNLOCK(&players_mutex);
+        return 1000;
+    }
+    for (int i = 0; i < player_count; ++i)
+    {
+        player_t *p = players[i];
+        LOCK(&p->player_mutex);
+        if (p->connected)
+        {
+            time_t idle = now - __atomic_load_n(&p->last_seen, __ATOMIC_RELAXED);
+            if (idle >= timeout)
+            {
+                JOURNAL(LOG_WARN, p->connection_id, LOG_NONE, "%s muet depuis %ld secondes, connexion coupée", p->pseudo, (long)idle);
+                if (p->transport->shutdown != NULL)
+                {
+                    p->transport->shutdown(p->sockfd, p->transport_ctx);
+                }
+            }
+            else if (idle >= interval && now - p->last_ping >= interval)
+            {
+                p->last_ping = now;
+                endpoints[endpoint_count].transport = p->transport;
+                endpoints[endpoint_count].ctx = p->transport_ctx;
+                endpoints[endpoint_count].sockfd = p->sockfd;
+                endpoint_count++;
+            }
+        }
+        UNLOCK(&p->player_mutex);
+    }
+    UNLOCK(&players_mutex);
+
+    // Envoyer les @PING hors des verrous, comme broadcast_to_all
+    for (int i = 0; i < endpoint_count; ++i)
+    {
+        endpoints[i].transport->send(endpoints[i].sockfd, endpoints[i].ctx, PING_MESSAGE, strlen(PING_MESSAGE));
+    }
+    free(endpoints);
+    return 1000;
+}
+
+void start_heartbeats()
+{
+    timer_schedule(1000, heartbeat_sweep, NULL);
+}
+
+/*
+    Afficher ou modifier l'intervalle des @PING et le délai d'inactivité (administrateurs)
+*/
+static void cmd_battement(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+
+    if (args->argc == 2)
+    {
+        int interval, timeout;
+        if (!view_to_int(args->argv[0], &interval) || !view_to_int(args->argv[1], &timeout) || interval < 1 || timeout <= interval)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /battement [<intervalle> <délai>] avec délai > intervalle (secondes)\n" RESET);
+            send_to_player(player, buffer);
+            return;
+        }
+        __atomic_store_n(&heartbeat_interval, interval, __ATOMIC_RELAXED);
+        __atomic_store_n(&idle_timeout, timeout, __ATOMIC_RELAXED);
+        JOURNAL(LOG_INFO, player->connection_id, LOG_NONE, "Battements : @PING après %d s, coupure après %d s", interval, timeout);
+    }
+    else if (args->argc != 0)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /battement [<intervalle> <délai>]\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), CYAN "@PING après %d s d'inactivité, connexion coupée après %d s sans réponse, puis %d s pour se reconnecter.\n" RESET,
+             __atomic_load_n(&heartbeat_interval, __ATOMIC_RELAXED), __atomic_load_n(&idle_timeout, __ATOMIC_RELAXED), TIME_OUT_TIME);
+    send_to_player(player, buffer);
+}
+
+// Réponse automatique du client à @PING, la ligne reçue suffit à mettre à jour last_seen
+static void cmd_pong(player_t *player, const command_args_t *args)
+{
+}
+
+void init_heartbeat_commands()
+{
+    register_command("/pong", 0, 0, 0, PERM_PLAYER, cmd_pong, "/pong");
+    register_command("/battement", 0, 2, 0, PERM_ADMIN, cmd_battement, "/battement [<intervalle> <délai>]");
+}
+
+// ********************************************************************************* //
+
+// Table de finales
+
+// Projetée en mémoire au démarrage, en lecture seule : les consultations ne prennent aucun verrou
+tablebase_t endgame_table;
+
+/*
+    Charger la table de finales générée par make tablebase, si elle existe
+*/
+void load_endgame_table(const char *path)
+{
+    if (tablebase_load(&endgame_table, path) == 0)
+    {
+        printf("Table de finales %s chargée : positions jusqu'à %d graines.\n", path, endgame_table.max_seeds);
+        JOURNAL(LOG_INFO, LOG_NONE, LOG_NONE, "Table de finales %s chargée (%d graines)", path, endgame_table.max_seeds);
+    }
+}
+
+/*
+    Conseiller le meilleur coup au joueur dont c'est le tour, d'après la table de finales
+*/
+static void cmd_conseil(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    int game_id;
 
-    // Retirer la partie des deux joueurs
-    remove_game_from_player(disconnected_player, game);
-    remove_game_from_player(other_player, game);
-    update_player_score(other_player);
+    if (!view_to_int(args->argv[0], &game_id))
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /conseil <numéro de partie>\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+    if (endgame_table.values == NULL)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Aucune table de finales n'est chargée sur le serveur.\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
 
-    // Retirer le joueur déconnecté
-    update_player_score(disconnected_player);
-    remove_player_from_players(disconnected_player);
-    pthread_mutex_destroy(&disconnected_player->player_mutex);
-    free(disconnected_player);
+    int player_id;
+    game_t *game = find_player_game(player, game_id, &player_id);
+    if (game == NULL)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans la partie %d.\n" RESET, game_id);
+        send_to_player(player, buffer);
+        return;
+    }
 
-    // Nettoyer la partie
-    remove_game_from_games(game);
-    pthread_mutex_destroy(&game->game_mutex);
-    free(game);
-    return NULL;
+    post_game_message(game, GAME_MESSAGE_ADVICE, player_id, 0, NULL);
+}
+
+/*
+    La table compte 0 une partie qui tourne sans fin, alors que la partie s'arrête à la première position
+    répétée et que chaque camp garde ses graines. Un coup qui répète une position de la partie a donc une
+    valeur connue sans la table : la différence des graines de chaque camp après le coup (sans capture,
+    sinon la position ne pourrait pas se répéter). Retourne le meilleur coup après correction.
+*/
+static int correct_repeating_moves(game_t *game, int player_id, int values[PLAYER_PITS])
+{
+    const variant_t *variant = game->variant;
+    int best = -1;
+    for (int pit = 0; pit < variant->pits; ++pit)
+    {
+        if (values[pit] == TABLEBASE_UNKNOWN)
+        {
+            continue;
+        }
+        int board[MAX_BOARD_SIZE];
+        position_history_t history = game->positions;
+        memcpy(board, game->board, sizeof(board));
+        if (position_history_play(&history, variant, board, player_id, player_id * variant->pits + pit) >= 0 && history.repeated)
+        {
+            int remaining[2];
+            remaining_seeds(variant, board, remaining);
+            values[pit] = remaining[player_id] - remaining[1 - player_id];
+        }
+        if (best < 0 || values[pit] > values[best])
+        {
+            best = pit;
+        }
+    }
+    return best;
 }
 
-// Thread traitant toutes les commandes d'un client
-void *client_handler(void *arg)
+/*
+    Consulter la table de finales pour la position de la partie (acteur de la partie)
+*/
+static void give_advice(game_t *game, player_t *player, int player_id)
 {
-    player_t *player = (player_t *)arg;
     char buffer[BUFFER_SIZE];
-    int receive;
+    int game_id = game->game_id;
+    int refused = game->tournament_id != 0 || game->turn != player_id || game->variant != DEFAULT_VARIANT;
+    int tournament = game->tournament_id != 0;
+    int other_variant = game->variant != DEFAULT_VARIANT;
 
-    // Envoyer un message de bienvenue
-    snprintf(buffer, sizeof(buffer), GREEN "Bienvenue %s ! Tapez /help pour les commandes disponibles.\n" RESET, player->pseudo);
-    send(player->sockfd, buffer, strlen(buffer), 0);
+    if (refused)
+    {
+        const char *reason = "Ce n'est pas à vous de jouer dans cette partie.";
+        if (tournament)
+        {
+            reason = "Les conseils ne sont pas disponibles dans les parties de tournoi.";
+        }
+        else if (other_variant)
+        {
+            reason = "La table de finales ne couvre que la variante awale.";
+        }
+        snprintf(buffer, sizeof(buffer), RED "%s\n" RESET, reason);
+        send_to_player(player, buffer);
+        return;
+    }
 
-    // Informer les autres joueurs de la connexion
-    snprintf(buffer, sizeof(buffer), GREEN "%s a rejoint le chat.\n" RESET, player->pseudo);
-    broadcast_to_all(buffer, player);
+    int values[PLAYER_PITS];
+    int best = tablebase_advice(&endgame_table, game->board, player_id, values);
+    if (best >= 0)
+    {
+        best = correct_repeating_moves(game, player_id, values);
+    }
+    if (best < 0)
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "[Partie %d] Trop de graines sur le plateau : la table de finales couvre jusqu'à %d graines.\n" RESET,
+                 game_id, endgame_table.max_seeds);
+        send_to_player(player, buffer);
+        return;
+    }
 
-    while (1)
+    int length = snprintf(buffer, sizeof(buffer), GREEN "[Partie %d] Conseil : jouez le trou %d, vous finirez avec %+d graines par rapport à votre adversaire "
+                                                        "sur celles qui restent en jeu.\nUne boucle sans fin compte 0, sauf pour un coup qui répète une position : "
+                                                        "la partie s'arrête et chaque camp garde ses graines.\nValeur de chaque coup :",
+                          game_id, best, values[best]);
+    for (int pit = 0; pit < PLAYER_PITS && length < (int)sizeof(buffer); ++pit)
     {
-        memset(buffer, 0, sizeof(buffer));
-        receive = recv(player->sockfd, buffer, sizeof(buffer), 0);
-        if (receive > 0)
+        if (values[pit] != TABLEBASE_UNKNOWN)
         {
-            buffer[strcspn(buffer, "\r\n")] = 0; // Enlever le retour à la ligne
+            length += snprintf(buffer + length, sizeof(buffer) - length, " %d:%+d", pit, values[pit]);
+        }
+    }
+    if (length < (int)sizeof(buffer))
+    {
+        snprintf(buffer + length, sizeof(buffer) - length, "\n" RESET);
+    }
+    send_to_player(player, buffer);
+}
 
-            if (buffer[0] == '/')
-            {
-                handle_command(player, buffer);
-            }
-            else
+void init_endgame_commands()
+{
+    register_command("/conseil", 1, 1, 0, PERM_PLAYER, cmd_conseil, "/conseil <numéro de partie>");
+    set_command_rate_class("/conseil", RATE_CLASS_GAME);
+}
+
+// ********************************************************************************* //
+
+// Historique des discussions
+
+#define HISTORY_GLOBAL 0
+#define HISTORY_GAME 1
+#define HISTORY_PRIVATE 2
+
+static void send_history_entry(player_t *player, int kind, int game_id, const history_entry_t *entry)
+{
+    char buffer[BUFFER_SIZE];
+    char stamp[32];
+    struct tm tm;
+
+    localtime_r(&entry->time, &tm);
+    strftime(stamp, sizeof(stamp), "%d/%m %H:%M", &tm);
+    if (kind == HISTORY_GLOBAL)
+    {
+        snprintf(buffer, sizeof(buffer), CYAN "[%s] [Global] %s: %s\n" RESET, stamp, entry->sender, entry->text);
+    }
+    else if (kind == HISTORY_GAME)
+    {
+        snprintf(buffer, sizeof(buffer), MAGENTA "[%s] [Partie %d] %s: %s\n" RESET, stamp, game_id, entry->sender, entry->text);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), MAGENTA "[%s] [MP %s → %s] %s\n" RESET, stamp, entry->sender, entry->target, entry->text);
+    }
+    send_to_player(player, buffer);
+}
+
+// Envoyer les messages d'un canal écrits par les autres joueurs après position, précédés d'un titre au premier message
+static void send_history_since(player_t *player, history_channel_t *channel, int kind, int game_id, unsigned long position, int *sent)
+{
+    char buffer[BUFFER_SIZE];
+    history_entry_t *entries = malloc(sizeof(history_entry_t) * HISTORY_CATCHUP);
+    if (entries == NULL)
+    {
+        return;
+    }
+    int count = history_recent(channel, position, HISTORY_CATCHUP, entries);
+    for (int i = 0; i < count; ++i)
+    {
+        if (strcmp(entries[i].sender, player->pseudo) != 0)
+        {
+            if ((*sent)++ == 0)
             {
-                snprintf(buffer, sizeof(buffer), RED "Commande non reconnue. Tapez /help pour voir la liste des commandes.\n" RESET);
-                send(player->sockfd, buffer, strlen(buffer), 0);
+                snprintf(buffer, sizeof(buffer), YELLOW "Pendant votre absence :\n" RESET);
+                send_to_player(player, buffer);
             }
+            send_history_entry(player, kind, game_id, &entries[i]);
         }
-        else
+    }
+    free(entries);
+}
+
+/*
+    Rattrapage à la connexion : messages du chat global, des parties en cours et privés écrits
+    depuis la dernière déconnexion du joueur (seulement les messages privés à sa première connexion)
+*/
+void send_missed_messages(player_t *player)
+{
+    unsigned long position;
+    int sent = 0;
+
+    if (history_global() == NULL)
+    {
+        return;
+    }
+    if (history_take_mark(player->pseudo, &position))
+    {
+        send_history_since(player, history_global(), HISTORY_GLOBAL, 0, position, &sent);
+
+        // Les parties sont lues sous le verrou du joueur : aucune ne peut être libérée pendant la lecture
+        LOCK(&player->player_mutex);
+        for (int i = 0; i < player->game_count; ++i)
         {
-            // Le joueur s'est déconnecté
-            handle_player_disconnect(player);
-            pthread_exit(NULL);
+            game_t *game = player->games[i];
+            send_history_since(player, game->history, HISTORY_GAME, game->game_id, position, &sent);
         }
+        UNLOCK(&player->player_mutex);
+    }
+
+    history_channel_t *channels[HISTORY_MAX_PRIVATE];
+    int channel_count = history_private_channels(player->pseudo, channels, HISTORY_MAX_PRIVATE);
+    for (int i = 0; i < channel_count; ++i)
+    {
+        send_history_since(player, channels[i], HISTORY_PRIVATE, 0, position, &sent);
     }
 }
 
-// Thread principal qui gère la connexion et l'enregistrement des clients
-int main()
+/*
+    Afficher les derniers messages du chat global, d'une partie ou d'une conversation privée
+*/
+static void cmd_historique(player_t *player, const command_args_t *args)
 {
-    int server_sockfd, new_sockfd;
-    struct sockaddr_in server_addr, client_addr;
     char buffer[BUFFER_SIZE];
+    char kind_name[16] = "global";
+    char pseudo[32] = "";
+    int game_id = 0;
+    int count = HISTORY_DEFAULT_LINES;
+    int next = 0;
+
+    if (history_global() == NULL)
+    {
+        snprintf(buffer, sizeof(buffer), RED "L'historique des discussions n'est pas activé sur ce serveur.\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    if (args->argc > 0 && !view_to_int(args->argv[0], &count))
+    {
+        view_copy(args->argv[0], kind_name, sizeof(kind_name));
+        next = 1;
+    }
+    int kind = strcmp(kind_name, "global") == 0 ? HISTORY_GLOBAL : strcmp(kind_name, "partie") == 0 ? HISTORY_GAME : strcmp(kind_name, "mp") == 0 ? HISTORY_PRIVATE : -1;
+    if (kind == HISTORY_GAME && next < args->argc && view_to_int(args->argv[next], &game_id))
+    {
+        next++;
+    }
+    else if (kind == HISTORY_PRIVATE && next < args->argc)
+    {
+        view_copy(args->argv[next++], pseudo, sizeof(pseudo));
+    }
+    else if (kind != HISTORY_GLOBAL)
+    {
+        kind = -1;
+    }
+    if (next < args->argc && !view_to_int(args->argv[next++], &count))
+    {
+        kind = -1;
+    }
+    if (kind < 0 || next < args->argc || count < 1 || count > HISTORY_MAX_LINES)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /historique [global|partie <numéro>|mp <pseudo>] [<nombre de 1 à %d>]\n" RESET, HISTORY_MAX_LINES);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    history_entry_t *entries = malloc(sizeof(history_entry_t) * count);
+    if (entries == NULL)
+    {
+        return;
+    }
 
-    // Création du socket serveur
-    server_sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_sockfd < 0)
+    int found = 0;
+    if (kind == HISTORY_GLOBAL)
+    {
+        found = history_recent(history_global(), 0, count, entries);
+    }
+    else if (kind == HISTORY_PRIVATE)
+    {
+        found = history_recent(history_private_channel(player->pseudo, pseudo, 0), 0, count, entries);
+    }
+    else
     {
-        perror("Erreur de création du socket");
-        exit(EXIT_FAILURE);
+        int in_game = 0;
+        LOCK(&player->player_mutex);
+        for (int i = 0; i < player->game_count; ++i)
+        {
+            game_t *game = player->games[i];
+            if (game->game_id == game_id)
+            {
+                found = history_recent(game->history, 0, count, entries);
+                in_game = 1;
+                break;
+            }
+        }
+        UNLOCK(&player->player_mutex);
+
+        if (!in_game)
+        {
+            snprintf(buffer, sizeof(buffer), RED "Vous n'êtes pas dans la partie %d.\n" RESET, game_id);
+            send_to_player(player, buffer);
+            free(entries);
+            return;
+        }
     }
 
-    // Forcer la réutilisation de l'adresse
-    int opt = 1;
-    if (setsockopt(server_sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    if (found == 0)
+    {
+        snprintf(buffer, sizeof(buffer), YELLOW "Aucun message.\n" RESET);
+        send_to_player(player, buffer);
+    }
+    for (int i = 0; i < found; ++i)
     {
-        perror("setsockopt");
-        exit(EXIT_FAILURE);
+        send_history_entry(player, kind, game_id, &entries[i]);
     }
+    free(entries);
+}
+
+void init_history_commands()
+{
+    register_command("/historique", 0, 3, CMD_POOL, PERM_PLAYER, cmd_historique, "/historique [global|partie <numéro>|mp <pseudo>] [<nombre>]");
+    set_command_rate_class("/historique", RATE_CLASS_CHAT);
+}
+
+// ********************************************************************************* //
+
+// Jetons de session
 
-    // Configuration de l'adresse du serveur
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(PORT);
+session_t *sessions[SESSION_BUCKETS];
+pthread_mutex_t sessions_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t sessions_cond; // Une connexion s'est fermée : réveille les reprises qui attendent (resume_session)
 
-    // Liaison du socket
-    if (bind(server_sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+static unsigned int hash_token(const char *token)
+{
+    unsigned int hash = 2166136261u;
+    for (const char *c = token; *c; ++c)
     {
-        perror("Erreur de liaison");
-        exit(EXIT_FAILURE);
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
     }
+    return hash & (SESSION_BUCKETS - 1);
+}
 
-    // Écoute
-    if (listen(server_sockfd, 10) < 0)
+// Emplacement du jeton dans sa liste (sous sessions_mutex), *résultat NULL s'il est inconnu
+static session_t **find_session(const char *token)
+{
+    session_t **link = &sessions[hash_token(token)];
+    while (*link != NULL && strcmp((*link)->token, token) != 0)
     {
-        perror("Erreur d'écoute");
-        exit(EXIT_FAILURE);
+        link = &(*link)->next;
     }
+    return link;
+}
 
-    printf("Serveur en attente de joueurs sur le port %d...\n", PORT);
+/*
+    Jeton tiré de /dev/urandom, retourne -1 s'il ne peut pas être lu : un jeton suffit à reprendre une
+    session sans mot de passe, il ne doit jamais être prévisible
+*/
+static int generate_token(char token[])
+{
+    static const char digits[] = "0123456789abcdef";
+    unsigned char bytes[SESSION_TOKEN_LENGTH / 2];
 
-    // Charger les utilisateurs
-    load_users();
-    // Charger les scores
-    load_scores();  
+    FILE *random = fopen("/dev/urandom", "rb");
+    if (random == NULL)
+    {
+        return -1;
+    }
+    size_t length = fread(bytes, 1, sizeof(bytes), random);
+    fclose(random);
+    if (length != sizeof(bytes))
+    {
+        return -1;
+    }
 
-    socklen_t clilen = sizeof(client_addr);
+    for (size_t i = 0; i < sizeof(bytes); ++i)
+    {
+        token[2 * i] = digits[bytes[i] >> 4];
+        token[2 * i + 1] = digits[bytes[i] & 15];
+    }
+    token[SESSION_TOKEN_LENGTH] = '\0';
+    return 0;
+}
 
-    while (1)
+/*
+    Émettre un nouveau jeton pour le joueur (à chaque connexion) et le lui envoyer ; l'ancien jeton n'est plus valable
+*/
+void issue_session(player_t *player)
+{
+    char buffer[BUFFER_SIZE];
+    session_t *session = (session_t *)calloc(1, sizeof(session_t));
+    if (session == NULL)
+    {
+        return;
+    }
+    if (generate_token(session->token) != 0)
+    {
+        // Sans jeton, le joueur se reconnecte avec son mot de passe
+        JOURNAL(LOG_ERROR, player->connection_id, LOG_NONE, "Lecture de /dev/urandom impossible, pas de jeton de session pour %s : %s", player->pseudo,
+                strerror(errno));
+        free(session);
+        return;
+    }
+    snprintf(session->pseudo, sizeof(session->pseudo), "%s", player->pseudo);
+    session->player = player;
+
+    LOCK(&sessions_mutex);
+    if (player->session_token[0] != '\0')
     {
-        new_sockfd = accept(server_sockfd, (struct sockaddr *)&client_addr, &clilen);
-        if (new_sockfd < 0)
+        session_t **link = find_session(player->session_token);
+        if (*link != NULL)
         {
-            perror("Erreur d'acceptation");
-            continue;
+            session_t *old = *link;
+            *link = old->next;
+            free(old);
         }
+    }
+    session_t **bucket = &sessions[hash_token(session->token)];
+    session->next = *bucket;
+    *bucket = session;
+    snprintf(player->session_token, sizeof(player->session_token), "%s", session->token);
+    UNLOCK(&sessions_mutex);
 
-        player_t *player = (player_t *)malloc(sizeof(player_t));
-        player->sockfd = new_sockfd;
-        player->connected = 1;
-        player->game_count = 0;
-        player->challenge_sent = 0;
-        player->challenge_received = 0;
-        player->challenger = NULL;
-        player->challengee = NULL;
-        player->wins = 0;
-        player->losses = 0;
-        player->draws = 0;
-        pthread_mutex_init(&player->player_mutex, NULL);
+    snprintf(buffer, sizeof(buffer), SESSION_MESSAGE "%s\n", session->token);
+    send_to_player(player, buffer);
+}
 
-        // Recevoir le pseudo
-        if (recv(player->sockfd, player->pseudo, 32, 0))
-        {
-            player->pseudo[strcspn(player->pseudo, "\r\n")] = 0; // Enlever le retour à la ligne
+/*
+    Le joueur est libéré : son jeton reste valable SESSION_LIFETIME secondes pour reprendre la session
+    avec un nouveau joueur. Avec revoke (/quit), le jeton est supprimé.
+*/
+void forget_session(player_t *player, int revoke)
+{
+    if (player->session_token[0] == '\0')
+    {
+        return;
+    }
 
-            printf("Tentative de connexion pour le pseudo : %s\n", player->pseudo);
+    LOCK(&sessions_mutex);
+    session_t **link = find_session(player->session_token);
+    if (*link != NULL)
+    {
+        session_t *session = *link;
+        if (revoke)
+        {
+            *link = session->next;
+            free(session);
+        }
+        else
+        {
+            session->player = NULL;
+            session->expires = time(NULL) + SESSION_LIFETIME;
+        }
+    }
+    if (revoke)
+    {
+        player->session_token[0] = '\0';
+    }
+    UNLOCK(&sessions_mutex);
+}
 
-            // Vérifier si le pseudo existe déjà dans le fichier des utilisateurs
-            int user_index = find_user_index(player->pseudo);
+/*
+    Joueur d'une session, à appeler sous players_mutex : un joueur est retiré de sa session quand
+    il est retiré de la liste des joueurs, le pointeur retourné reste donc valable tant que le verrou est pris.
+*/
+player_t *find_session_player(const char *token)
+{
+    LOCK(&sessions_mutex);
+    session_t *session = *find_session(token);
+    player_t *player = (session != NULL) ? session->player : NULL;
+    UNLOCK(&sessions_mutex);
+    return player;
+}
 
-            if (user_index == -1)
-            {
-                // Pseudo inconnu, inviter l'utilisateur à s'enregistrer
-                snprintf(buffer, sizeof(buffer), "Bienvenue %s ! Veuillez vous enregistrer.\nEntrez un mot de passe : ", player->pseudo);
-                send(player->sockfd, buffer, strlen(buffer), 0);
+/*
+    Un joueur vient d'être marqué déconnecté : réveiller les reprises de session qui attendent (resume_session).
+    sessions_mutex est pris après le changement de player->connected, le réveil ne peut donc pas être perdu.
+*/
+void wake_session_takeovers()
+{
+    LOCK(&sessions_mutex);
+    pthread_cond_broadcast(&sessions_cond);
+    UNLOCK(&sessions_mutex);
+}
 
-                // Recevoir le mot de passe
-                char password[128];
-                if (recv(player->sockfd, password, sizeof(password), 0))
-                {
-                    password[strcspn(password, "\r\n")] = 0; // Enlever le retour à la ligne
-
-                    // Demander la confirmation du mot de passe
-                    snprintf(buffer, sizeof(buffer), "Confirmez le mot de passe : ");
-                    send(player->sockfd, buffer, strlen(buffer), 0);
-
-                    char password_confirm[128];
-                    if (recv(player->sockfd, password_confirm, sizeof(password_confirm), 0))
-                    {
-                        password_confirm[strcspn(password_confirm, "\r\n")] = 0; // Enlever le retour à la ligne
-
-                        // Vérifier que les mots de passe correspondent
-                        if (strcmp(password, password_confirm) != 0)
-                        {
-                            snprintf(buffer, sizeof(buffer), RED "Les mots de passe ne correspondent pas. Veuillez réessayer.\n" RESET);
-                            send(player->sockfd, buffer, strlen(buffer), 0);
-                            close(player->sockfd);
-                            pthread_mutex_destroy(&player->player_mutex);
-                            free(player);
-                            continue;
-                        }
-
-                        // Enregistrer le nouvel utilisateur
-                        int reg_result = register_user(player->pseudo, password);
-                        if (reg_result != 0)
-                        {
-                            snprintf(buffer, sizeof(buffer), RED "Erreur lors de l'enregistrement de l'utilisateur.\n" RESET);
-                            send(player->sockfd, buffer, strlen(buffer), 0);
-                            close(player->sockfd);
-                            pthread_mutex_destroy(&player->player_mutex);
-                            free(player);
-                            continue;
-                        }
-
-                        snprintf(buffer, sizeof(buffer), GREEN "Enregistrement réussi ! Vous êtes maintenant connecté.\n" RESET);
-                        send(player->sockfd, buffer, strlen(buffer), 0);
-                        load_player_score(player);
-                    }
-                    else
-                    {
-                        close(player->sockfd);
-                        pthread_mutex_destroy(&player->player_mutex);
-                        free(player);
-                        continue;
-                    }
-                }
-                else
-                {
-                    close(player->sockfd);
-                    pthread_mutex_destroy(&player->player_mutex);
-                    free(player);
-                    continue;
-                }
-            }
-            else
-            {
-                // Pseudo connu, demander le mot de passe
-                snprintf(buffer, sizeof(buffer), "Pseudo reconnu. Veuillez entrer votre mot de passe : ");
-                send(player->sockfd, buffer, strlen(buffer), 0);
+/*
+    Retrouver le pseudo d'une session à reprendre. Si l'ancienne connexion n'a pas encore été vue morte
+    (coupure réseau sans fermeture), elle est coupée et on attend, au plus SESSION_TAKEOVER_MS, que son
+    thread la ferme. Bloquant : à appeler depuis le thread de la nouvelle connexion.
+    Retourne 0 si la session peut être reprise, -1 si le jeton est inconnu ou expiré.
+*/
+int resume_session(const char *token, char *pseudo, size_t size)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += SESSION_TAKEOVER_MS / 1000;
+    deadline.tv_nsec += (SESSION_TAKEOVER_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
 
-                // Recevoir le mot de passe
-                char password[128];
-                if (recv(player->sockfd, password, sizeof(password), 0))
-                {
-                    password[strcspn(password, "\r\n")] = 0; // Enlever le retour à la ligne
-
-                    // Vérifier le mot de passe
-                    int auth_result = verify_user_password(player->pseudo, password);
-                    if (auth_result != 0)
-                    {
-                        snprintf(buffer, sizeof(buffer), RED "Mot de passe incorrect. Connexion refusée.\n" RESET);
-                        send(player->sockfd, buffer, strlen(buffer), 0);
-                        close(player->sockfd);
-                        pthread_mutex_destroy(&player->player_mutex);
-                        free(player);
-                        continue;
-                    }
-
-                    snprintf(buffer, sizeof(buffer), GREEN "Connexion réussie !\n" RESET);
-                    send(player->sockfd, buffer, strlen(buffer), 0);
-                    // Charger les scores du joueur
-                    load_player_score(player);
-                }
-                else
-                {
-                    close(player->sockfd);
-                    pthread_mutex_destroy(&player->player_mutex);
-                    free(player);
-                    continue;
-                }
-            }
+    int shut = 0;
+    LOCK(&sessions_mutex);
+    while (1)
+    {
+        // Le jeton est recherché à chaque réveil : il a pu être révoqué pendant l'attente
+        session_t **link = find_session(token);
+        session_t *session = *link;
+        if (session == NULL || (session->player == NULL && session->expires < time(NULL)))
+        {
+            UNLOCK(&sessions_mutex);
+            return -1;
+        }
+        snprintf(pseudo, size, "%s", session->pseudo);
 
-            // Vérifier si le pseudo est déjà utilisé en jeu
-            int pseudo_used_in_game = 0;
-            pthread_mutex_lock(&players_mutex);
-            for (int i = 0; i < player_count; ++i)
+        int connected = 0;
+        player_t *player = session->player;
+        if (player != NULL)
+        {
+            // Le joueur ne peut pas être libéré tant que sessions_mutex est pris (forget_session)
+            LOCK(&player->player_mutex);
+            connected = player->connected;
+            if (connected && !shut && player->transport->shutdown != NULL)
             {
-                if (strcmp(players[i]->pseudo, player->pseudo) == 0)
-                {
-                    if (!players[i]->connected)
-                    {
-                        // Reconnexion du joueur
-                        pthread_mutex_lock(&players[i]->player_mutex);
-
-                        // Mettre à jour le socket et l'état du joueur
-                        players[i]->sockfd = new_sockfd;
-                        players[i]->connected = 1;
-
-                        // Informer le joueur de la reconnexion
-                        snprintf(buffer, sizeof(buffer), GREEN "Vous avez été reconnecté avec succès.\n" RESET);
-                        send(players[i]->sockfd, buffer, strlen(buffer), 0);
-
-                        pthread_mutex_unlock(&players[i]->player_mutex);
-
-                        printf("Joueur %s reconnecté.\n", player->pseudo);
-                        
-                        // Supprimer le joueur crée par défaut
-                        pthread_mutex_destroy(&player->player_mutex);
-                        free(player);
-
-                        // Relancer le client_handler pour le joueur reconnecté
-                        pthread_create(&players[i]->thread, NULL, client_handler, (void *)players[i]);
-                        pthread_detach(players[i]->thread);
-
-                        pthread_mutex_unlock(&players_mutex);
-
-                        goto next_client; // Passer au prochain client
-                    }
-                    else
-                    {
-                        pseudo_used_in_game = 1;
-                        break;
-                    }
-                }
+                player->transport->shutdown(player->sockfd, player->transport_ctx);
+                shut = 1;
             }
+            UNLOCK(&player->player_mutex);
+        }
+        else
+        {
+            // Le jeton d'un joueur libéré ne sert qu'une fois
+            *link = session->next;
+            free(session);
+        }
+
+        if (!connected)
+        {
+            UNLOCK(&sessions_mutex);
+            return 0;
+        }
+        // Réveillé par wake_session_takeovers quand l'ancienne connexion est vue fermée
+        if (pthread_cond_timedwait(&sessions_cond, &sessions_mutex, &deadline) == ETIMEDOUT)
+        {
+            UNLOCK(&sessions_mutex);
+            return -1;
+        }
+    }
+}
 
-            if (pseudo_used_in_game)
+// Supprimer les jetons expirés
+static long session_sweep(void *arg)
+{
+    time_t now = time(NULL);
+    LOCK(&sessions_mutex);
+    for (int i = 0; i < SESSION_BUCKETS; ++i)
+    {
+        session_t **link = &sessions[i];
+        while (*link != NULL)
+        {
+            session_t *session = *link;
+            if (session->player == NULL && session->expires < now)
             {
-                snprintf(buffer, sizeof(buffer), RED "Ce pseudo est déjà utilisé en jeu. Veuillez réessayer plus tard.\n" RESET);
-                send(player->sockfd, buffer, strlen(buffer), 0);
-                close(player->sockfd);
-                pthread_mutex_destroy(&player->player_mutex);
-                free(player);
-                pthread_mutex_unlock(&players_mutex);
-                continue;
+                *link = session->next;
+                free(session);
             }
-
-            // Ajouter le joueur à la liste
-            if (player_count >= MAX_PLAYERS)
+            else
             {
-                snprintf(buffer, sizeof(buffer), RED "Le serveur est plein. Veuillez réessayer plus tard.\n" RESET);
-                send(player->sockfd, buffer, strlen(buffer), 0);
-                close(player->sockfd);
-                pthread_mutex_destroy(&player->player_mutex);
-                free(player);
-                pthread_mutex_unlock(&players_mutex);
-                continue;
+                link = &session->next;
             }
-
-            players[player_count++] = player;
-            pthread_mutex_unlock(&players_mutex);
-
-            // Créer un thread pour gérer ce client
-            pthread_create(&player->thread, NULL, client_handler, (void *)player);
-            pthread_detach(player->thread);
         }
-        else
-        {
-            close(player->sockfd);
-            pthread_mutex_destroy(&player->player_mutex);
-            free(player);
-        }
-
-    next_client:
-        continue;
     }
+    UNLOCK(&sessions_mutex);
+    return SESSION_LIFETIME * 1000L;
+}
 
-    close(server_sockfd);
-    return 0;
+// Attente des reprises sur l'horloge monotone, et suppression périodique des jetons expirés
+void start_session_sweep()
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sessions_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    timer_schedule(SESSION_LIFETIME * 1000L, session_sweep, NULL);
 }
@@ -7,21 +7,96 @@
 #include <string.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "verrous.h"
+#include "journal.h"
+#include "minuteur.h"
+#include "awale.h"
+#include "tablebase.h"
+#include "historique.h"
+#include "travailleurs.h"
+#include "acteurs.h"
+#include "tampons.h"
+#include "canaux.h"
+#include "presence.h"
+#include "traces.h"
+#include "comptes.h"
 
 // Constants
 #define PORT 8080
 #define TIME_OUT_TIME 30
-#define USERS_FILE "users.dat"
-#define SCORES_FILE "scores.dat"
-#define MAX_USERS 1000
-#define MAX_GAMES_PER_PLAYER 5
-#define BOARD_SIZE 12 // Nombre total de trou sur le plateau de jeu
-#define PLAYER_PITS 6 // Nombre de trou par joueur
+#define HEARTBEAT_INTERVAL 15 // Secondes d'inactivité avant d'envoyer @PING
+#define IDLE_TIMEOUT 45 // Secondes sans aucune ligne reçue avant de considérer la connexion morte
+#define LOGIN_TIMEOUT 60 // Secondes pour envoyer pseudo et mot de passe
+#define SEND_TIMEOUT 10 // Un envoi bloqué plus longtemps échoue (client qui ne lit plus)
+#define KEEPALIVE_IDLE 30 // Keepalive TCP : inactivité avant la première sonde
+#define KEEPALIVE_INTERVAL 10 // Keepalive TCP : intervalle entre les sondes
+#define KEEPALIVE_COUNT 3 // Keepalive TCP : sondes sans réponse avant de couper
+#define PING_MESSAGE "@PING\n"
+#define SESSION_MESSAGE "@SESSION " // Suivi du jeton à envoyer avec RESUME pour reprendre la session
+#define RESUME_COMMAND "RESUME " // Première ligne d'une reconnexion, à la place du pseudo
+#define SESSION_TOKEN_LENGTH 32 // Caractères hexadécimaux
+#define BOARD_MESSAGE "@PLATEAU" // État d'une partie pour un client qui dessine lui-même le plateau
+#define GAME_END_MESSAGE "@FIN"   // La partie est terminée, le client l'oublie
+#define DISPLAY_MESSAGE "@AFFICHAGE" // Confirmation de /affichage client
+
+// Modes d'affichage des plateaux
+#define DISPLAY_FULL 0   // Plateau dessiné par le serveur après chaque coup
+#define DISPLAY_DELTA 1  // Seulement les trous modifiés
+#define DISPLAY_CLIENT 2 // Ligne BOARD_MESSAGE, dessinée par le client
+#define SESSION_BUCKETS 256 // Puissance de 2
+#define SESSION_LIFETIME 120 // Secondes de validité d'un jeton après la libération du joueur
+#define SESSION_TAKEOVER_MS 1000 // Attente de la fermeture de l'ancienne connexion lors d'une reprise
+#define MAX_GAMES_PER_PLAYER 5 // Hors parties de tournoi
 #define MAX_PLAYERS 100
-#define MAX_GAMES 100
-#define INITIAL_SEEDS 4 // Nombre de graine par trou au début du jeu
+#define MAX_GAMES 100 // Hors parties de tournoi
 #define BUFFER_SIZE 1024
+#define ADMINS_FILE "admins.txt"
+#define MAX_ADMINS 32
+#define MAX_COMMANDS 64
+#define COMMAND_TABLE_SIZE 128 // Puissance de 2, au moins le double de MAX_COMMANDS
+#define MAX_COMMAND_ARGS 4
+#define HISTORY_DEFAULT_LINES 20 // Messages affichés par /historique sans nombre
+#define HISTORY_MAX_LINES 100
+#define HISTORY_CATCHUP 20 // Messages rattrapés au plus par canal à la connexion
+
+// Limitation de débit : débit (commandes par seconde) et rafale par classe de commandes
+#define RATE_CONNECTION_PER_SEC 10
+#define RATE_CONNECTION_BURST 20
+#define RATE_CHAT_PER_SEC 1
+#define RATE_CHAT_BURST 5
+#define RATE_CHALLENGE_PER_SEC 0.2
+#define RATE_CHALLENGE_BURST 3
+#define RATE_GAME_PER_SEC 5
+#define RATE_GAME_BURST 10
+#define RATE_STRIKE_WINDOW 60 // Secondes sans refus dans une classe avant d'effacer ses avertissements
+#define RATE_STRIKES_MUTE 10 // Refus de messages avant la mise en sourdine (classe chat seulement)
+#define RATE_STRIKES_DISCONNECT 50 // Refus dans une même classe avant la déconnexion
+#define RATE_MUTE_TIME 30 // Durée de la mise en sourdine en secondes
+
+// Classes de limitation de débit
+#define RATE_CLASS_CONNECTION 0
+#define RATE_CLASS_CHAT 1
+#define RATE_CLASS_CHALLENGE 2
+#define RATE_CLASS_GAME 3
+#define RATE_CLASS_COUNT 4
+
+// Options des commandes
+#define CMD_TEXT_LAST 1 // Le dernier argument est un texte libre jusqu'à la fin de la ligne
+#define CMD_POOL 2 // Commande coûteuse exécutée par la réserve de travailleurs, le thread du client attend sa fin
+
+// Permissions des commandes
+#define PERM_PLAYER 0
+#define PERM_ADMIN 1
+
+// Résultat d'une partie
+#define GAME_RESULT_PLAYER1_WIN 0
+#define GAME_RESULT_PLAYER2_WIN 1
+#define GAME_RESULT_DRAW 2
 
 // Codes couleur
 #define RESET "\x1b[0m"
@@ -36,76 +111,286 @@
 typedef struct player_t player_t;
 typedef struct game_t game_t;
 
+// Seau à jetons
+typedef struct rate_bucket_t
+{
+    double tokens;
+    struct timespec last;
+    // Refus de la classe : un flood de coups ne compte pas contre le chat
+    int strikes;
+    time_t last_strike;
+} rate_bucket_t;
+
+typedef struct rate_limit_t
+{
+    const char *name;
+    const char *what; // Ce que compte la classe, pour les messages au joueur
+    double rate;
+    double burst;
+} rate_limit_t;
+
+// Transport des messages vers un client : socket TCP pour le serveur, mémoire pour la simulation
+typedef struct transport_t
+{
+    ssize_t (*send)(int sockfd, void *ctx, const char *data, size_t length);
+    void (*close)(int sockfd, void *ctx);
+    void (*release)(void *ctx); // Optionnel : le joueur est libéré, ctx ne sera plus utilisé
+    void (*shutdown)(int sockfd, void *ctx); // Optionnel : couper la connexion, le thread de lecture constate la déconnexion
+} transport_t;
+
+// Copie de la destination d'un joueur, utilisable sans verrou après la copie
+typedef struct endpoint_t
+{
+    const transport_t *transport;
+    void *ctx;
+    int sockfd;
+} endpoint_t;
+
+// Jeton de session : retrouve le joueur sans pseudo ni mot de passe
+typedef struct session_t session_t;
+struct session_t
+{
+    char token[SESSION_TOKEN_LENGTH + 1];
+    char pseudo[32];
+    player_t *player; // NULL une fois le joueur libéré
+    time_t expires; // Fin de validité une fois le joueur libéré
+    session_t *next;
+};
+
+// Lancement de l'attente de reconnexion d'une partie (thread pour le serveur, échéancier pour la simulation)
+typedef void (*reconnection_wait_t)(game_t *game);
+
 struct player_t
 {
     int sockfd;
+    const transport_t *transport;
+    void *transport_ctx;
+    int session; // Incrémenté à chaque reconnexion
+    int connection_id; // Identifiant de la connexion dans le journal
+    char session_token[SESSION_TOKEN_LENGTH + 1]; // Vide tant qu'aucun jeton n'a été émis
+    // Battements de cœur
+    time_t last_seen; // Dernière ligne reçue
+    time_t last_ping;
     char pseudo[32];
     pthread_t thread;
+    int handlers; // Threads client_handler qui utilisent le joueur (detach_handler)
     int connected;
     pthread_mutex_t player_mutex;
-    game_t *games[MAX_GAMES_PER_PLAYER];
+    game_t **games;
     int game_count;
+    int games_capacity;
     int challenge_sent;
     int challenge_received;
     player_t *challenger;
     player_t *challengee;
+    // Variante proposée dans le défi envoyé
+    const variant_t *challenge_variant;
     // Statistiques du joueur
     int wins;
     int losses;
     int draws;
+    int is_admin;
+    // Mode d'affichage des plateaux (DISPLAY_*)
+    int display_mode;
+    // Limitation de débit
+    rate_bucket_t buckets[RATE_CLASS_COUNT];
+    time_t muted_until;
+    // Canaux de discussion auxquels le joueur est abonné, même déconnecté
+    subscription_t *subscriptions[CHANNEL_MAX_PER_PLAYER];
+    int subscription_count;
 };
 
 struct game_t
 {
+    // Les messages de la partie sont traités un par un par son acteur : l'état de la partie n'a pas de verrou
+    actor_t actor;
+    // Références : une pour la liste des parties, une par message posté ou attente programmée
+    int refs;
     int game_id;
     player_t *player1;
     player_t *player2;
-    int board[BOARD_SIZE];
+    // Règles de la partie, choisies au moment du défi
+    const variant_t *variant;
+    int board[MAX_BOARD_SIZE];
     int turn;
     int game_over;
-    pthread_mutex_t game_mutex;
     // Scores par joueur dans la partie
     int player1_score;
     int player2_score;
     int waiting_reconnect;
+    // Joueur attendu et fin de l'attente de reconnexion
+    player_t *absent_player;
+    time_t reconnect_deadline;
+    // Version du plateau, incrémentée à chaque coup joué
+    int board_version;
+    // Empreinte de la position (plateau et trait) et positions jouées depuis la dernière capture
+    position_history_t positions;
+    // Tournoi auquel appartient la partie (0 pour un défi) et numéro de l'échiquier dans la ronde
+    int tournament_id;
+    int tournament_board;
+    // Historique du chat de la partie (NULL si l'historique n'est pas activé)
+    history_channel_t *history;
 };
 
-typedef struct user_credentials_t
+// Messages traités par l'acteur d'une partie
+enum game_message_kind
 {
-    char pseudo[32];
-    char password[128];
-} user_credentials_t;
+    GAME_MESSAGE_MOVE,
+    GAME_MESSAGE_VIEW,
+    GAME_MESSAGE_CHAT,
+    GAME_MESSAGE_ABANDON,
+    GAME_MESSAGE_ADVICE,
+    GAME_MESSAGE_DISCONNECT,
+    GAME_MESSAGE_RECONNECT_CHECK,   // Échéance de la minuterie pendant l'attente de reconnexion
+    GAME_MESSAGE_RECONNECT_TIMEOUT, // Fin de l'attente imposée (simulation)
+    GAME_MESSAGE_CALL               // Fonction exécutée dans le contexte de la partie (console d'administration)
+};
 
-typedef struct user_score_t
+// Fonction exécutée par l'acteur d'une partie, qui peut être terminée (game_over) quand elle est appelée
+typedef void (*game_call_t)(game_t *game, void *data);
+
+typedef struct game_message_t
 {
-    char pseudo[32];
-    int wins;
-    int losses;
-    int draws;
-} user_score_t;
+    actor_message_t link;
+    int kind;
+    int player_id; // Camp du joueur qui a posté le message (0 ou 1)
+    int argument;  // Trou joué
+    game_call_t call;
+    void *data;
+    unsigned int trace;        // Requête échantillonnée qui a posté le message, 0 sinon
+    int trace_connection;
+    unsigned long long posted_ns; // Pour la trace : attente dans la boîte aux lettres
+    char text[]; // Message du chat
+} game_message_t;
+
+// Vue sur une partie du buffer reçu, sans copie
+typedef struct str_view_t
+{
+    const char *ptr;
+    size_t len;
+} str_view_t;
+
+typedef struct command_args_t
+{
+    str_view_t name;
+    str_view_t argv[MAX_COMMAND_ARGS];
+    int argc;
+    int extra; // Arguments en trop
+} command_args_t;
+
+typedef void (*command_handler_t)(player_t *player, const command_args_t *args);
+
+typedef struct command_stats_t
+{
+    unsigned long calls;
+    unsigned long rejected;
+    unsigned long throttled;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+} command_stats_t;
+
+typedef struct command_t
+{
+    const char *name;
+    int min_args;
+    int max_args;
+    int flags;
+    int permission;
+    command_handler_t handler;
+    const char *usage;
+    int rate_class;
+    command_stats_t stats;
+} command_t;
+
+
+// Variables globales
+extern player_t **players;
+extern int player_count;
+extern int max_players;
+extern pthread_mutex_t players_mutex;
+extern game_t **games;
+extern int game_count;
+extern pthread_mutex_t games_mutex;
+extern rate_limit_t rate_limits[RATE_CLASS_COUNT];
+extern const transport_t tcp_transport;
+extern reconnection_wait_t start_reconnection_wait;
+extern int heartbeat_interval;
+extern int idle_timeout;
+extern tablebase_t endgame_table;
 
 
 // Prototypes
 void *client_handler(void *arg);
+int load_player_score(player_t *player);
+void update_player_score(player_t *player);
+int user_exists(const char *pseudo);
+int register_user(const char *pseudo, const char *password);
+int verify_user_password(const char *pseudo, const char *password);
+player_t *create_player(int sockfd, const transport_t *transport, void *ctx);
+void destroy_player(player_t *player);
+int add_player_to_players(player_t *player);
+void reattach_player(player_t *player, int sockfd, const transport_t *transport, void *ctx);
+int release_player_if_idle(player_t *player);
+void attach_handler(player_t *player);
+void detach_handler(player_t *player);
+int send_to_player(player_t *player, const char *message);
+int handle_line(player_t *player, const char *line);
+void seed_game_random(unsigned long long seed);
+unsigned int game_random();
 void broadcast_to_all(char *message, player_t *sender);
 void send_private_message(player_t *sender, const char *target_pseudo, const char *message);
 void chat_in_game(player_t *player, int game_id, const char *message);
-void handle_command(player_t *player, char *command);
-void list_connected_players(player_t *player);
+void handle_command(player_t *player, const char *command);
+int register_command(const char *name, int min_args, int max_args, int flags, int permission, command_handler_t handler, const char *usage);
+command_t *find_command(str_view_t name);
+void set_command_rate_class(const char *name, int rate_class);
+void init_rate_buckets(player_t *player);
+int rate_limit_allow(player_t *player, int rate_class);
+void init_commands();
+void report_command_stats(report_line_t emit, void *ctx);
+void show_command_stats(player_t *player);
+void show_lock_report(player_t *player, int reset);
+void view_copy(str_view_t view, char *dest, size_t size);
+int view_to_int(str_view_t view, int *value);
+int view_to_double(str_view_t view, double *value);
+void load_admins();
+int is_admin_pseudo(const char *pseudo);
+void list_connected_players(player_t *player, const char *prefix, int page);
 void show_help(player_t *player);
 void handle_player_disconnect(player_t *player);
-void *wait_for_reconnection(void *arg);
-void challenge_player(player_t *player, const char *target_pseudo);
+void start_heartbeats();
+void init_heartbeat_commands();
+void load_endgame_table(const char *path);
+void init_endgame_commands();
+void send_missed_messages(player_t *player);
+void init_history_commands();
+void issue_session(player_t *player);
+void forget_session(player_t *player, int revoke);
+int resume_session(const char *token, char *pseudo, size_t size);
+void wake_session_takeovers();
+player_t *find_session_player(const char *token);
+void start_session_sweep();
+void game_retain(game_t *game);
+void game_release(game_t *game);
+game_t *find_player_game(player_t *player, int game_id, int *player_id);
+int post_game_message(game_t *game, int kind, int player_id, int argument, const char *text);
+int post_game_call(game_t *game, game_call_t call, void *data);
+void challenge_player(player_t *player, const char *target_pseudo, const variant_t *variant);
 void accept_challenge(player_t *player);
+game_t *create_game(player_t *player1, player_t *player2, int turn, int tournament_id, int tournament_board, const variant_t *variant);
+void announce_game_start(game_t *game);
+void add_game_to_player(player_t *player, game_t *game);
+int count_casual_games(player_t *player);
 void refuse_challenge(player_t *player);
 void remove_challenge(player_t *player);
-void init_board(int board[]);
-void print_board(int sockfd, int player_id, player_t *current_player, player_t *other_player, int board[], int game_id, game_t *game);
+void print_board(int player_id, player_t *current_player, player_t *other_player, int board[], int game_id, game_t *game);
 void display_board(player_t *player, int game_id);
+void send_board_delta(player_t *receiver, int player_id, player_t *mover, game_t *game, const int old_board[], int pit, int captured);
+void set_display_mode(player_t *player, const char *mode);
 int make_move(int player_id, int pit, player_t *player, int board[], game_t *game);
 void make_move_command(player_t *player, int game_id, int move);
 void abandon_game(player_t *player, int game_id);
-int check_game_end(int board[]);
+int check_game_end(game_t *game, int player_id);
 void end_game(game_t *game);
 void remove_game_from_player(player_t *player, game_t *game);
 void remove_game_from_games(game_t *game);
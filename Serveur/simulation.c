@@ -0,0 +1,456 @@
+#include "serveur.h"
+
+/*
+    Simulation du serveur en mémoire, sans socket : des joueurs virtuels envoient des commandes
+    tirées d'un générateur à graine fixe et les messages qu'ils reçoivent sont résumés par une empreinte.
+    Deux exécutions avec les mêmes paramètres donnent la même empreinte, ce qui permet de vérifier
+    qu'une modification ne change pas le comportement et de mesurer le débit de commandes.
+
+    Usage : ./Serveur/simulation [joueurs] [commandes] [graine] [niveau du journal]
+*/
+
+// Constants
+#define SIM_DEFAULT_PLAYERS 1000
+#define SIM_DEFAULT_COMMANDS 1000000
+#define SIM_DEFAULT_SEED 42
+#define SIM_JOURNAL_FILE "simulation.log"
+#define SIM_RECONNECT_DELAY 5000 // Commandes simulées avant la fin de l'attente de reconnexion
+#define SIM_RECONNECT_CHANCE 20  // Un joueur déconnecté tiré au sort revient une fois sur SIM_RECONNECT_CHANCE
+
+// Structures
+typedef struct sim_client_t
+{
+    int index;
+    char pseudo[32];
+    player_t *player; // NULL quand le serveur a libéré le joueur
+    int connected;
+    unsigned long long messages;
+    unsigned long long bytes;
+} sim_client_t;
+
+// Attente de reconnexion d'une partie, résolue après SIM_RECONNECT_DELAY commandes
+typedef struct sim_wait_t
+{
+    game_t *game;
+    unsigned long deadline;
+} sim_wait_t;
+
+sim_client_t *clients = NULL;
+int client_count = 0;
+
+sim_wait_t *waits = NULL;
+int wait_count = 0;
+int wait_capacity = 0;
+
+unsigned long long sim_rng_state = 0;
+unsigned long sim_step = 0;
+unsigned long long digest = 0xcbf29ce484222325ULL; // Empreinte de tous les messages reçus
+unsigned long long total_messages = 0;
+unsigned long long total_bytes = 0;
+
+/*
+    Générateur de la simulation (splitmix64), séparé de celui du serveur
+*/
+static unsigned int sim_random()
+{
+    unsigned long long z = (sim_rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((z ^ (z >> 31)) >> 32);
+}
+
+// ********************************************************************************* //
+
+// Transport en mémoire
+
+static ssize_t sim_send(int sockfd, void *ctx, const char *data, size_t length)
+{
+    sim_client_t *client = (sim_client_t *)ctx;
+
+    client->messages++;
+    client->bytes += length;
+    total_messages++;
+    total_bytes += length;
+
+    // Le destinataire fait partie de l'empreinte, pas seulement le contenu. FNV-1a par mots de 8 octets :
+    // l'empreinte ne doit pas coûter plus cher que le traitement des commandes.
+    digest = (digest ^ (unsigned long long)client->index) * 0x100000001b3ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, data + i, sizeof(word));
+        digest = (digest ^ word) * 0x100000001b3ULL;
+    }
+    for (; i < length; ++i)
+    {
+        digest = (digest ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    }
+    return (ssize_t)length;
+}
+
+static void sim_close(int sockfd, void *ctx)
+{
+    sim_client_t *client = (sim_client_t *)ctx;
+    client->connected = 0;
+}
+
+static void sim_release(void *ctx)
+{
+    sim_client_t *client = (sim_client_t *)ctx;
+    client->player = NULL;
+}
+
+const transport_t sim_transport = {sim_send, sim_close, sim_release, NULL};
+
+// ********************************************************************************* //
+
+// Attentes de reconnexion
+
+/*
+    Remplace le thread d'attente du serveur : la partie est résolue après un nombre fixe de commandes
+*/
+static void sim_start_reconnection_wait(game_t *game)
+{
+    if (wait_count == wait_capacity)
+    {
+        wait_capacity = wait_capacity == 0 ? 64 : wait_capacity * 2;
+        waits = realloc(waits, sizeof(sim_wait_t) * wait_capacity);
+        if (waits == NULL)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    game_retain(game); // Rendue par le message qui résout l'attente
+    waits[wait_count].game = game;
+    waits[wait_count].deadline = sim_step + SIM_RECONNECT_DELAY;
+    wait_count++;
+}
+
+/*
+    Résoudre l'attente d'index donné : reprise si le joueur est revenu, forfait sinon
+*/
+static void resolve_wait(int index)
+{
+    game_t *game = waits[index].game;
+
+    // On retire l'attente avant de la résoudre, dans l'ordre pour rester déterministe
+    memmove(&waits[index], &waits[index + 1], sizeof(sim_wait_t) * (wait_count - index - 1));
+    wait_count--;
+
+    post_game_message(game, GAME_MESSAGE_RECONNECT_TIMEOUT, 0, 0, NULL);
+}
+
+static void resolve_expired_waits()
+{
+    int i = 0;
+    while (i < wait_count)
+    {
+        if (waits[i].deadline <= sim_step)
+        {
+            resolve_wait(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+/*
+    Un joueur revenu reprend tout de suite ses parties, comme le thread d'attente le ferait à la seconde suivante
+*/
+static void resolve_waits_of(player_t *player)
+{
+    int i = 0;
+    while (i < wait_count)
+    {
+        if (waits[i].game->absent_player == player)
+        {
+            resolve_wait(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+// ********************************************************************************* //
+
+// Joueurs virtuels
+
+static void connect_client(sim_client_t *client)
+{
+    if (client->player != NULL)
+    {
+        // Le joueur a encore des parties en attente : reconnexion
+        LOCK(&players_mutex);
+        reattach_player(client->player, client->index, &sim_transport, client);
+        UNLOCK(&players_mutex);
+        client->connected = 1;
+        resolve_waits_of(client->player);
+        return;
+    }
+
+    player_t *player = create_player(client->index, &sim_transport, client);
+    if (player == NULL)
+    {
+        perror("create_player");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(player->pseudo, sizeof(player->pseudo), "%s", client->pseudo);
+    if (add_player_to_players(player) < 0)
+    {
+        destroy_player(player);
+        return;
+    }
+    client->player = player;
+    client->connected = 1;
+}
+
+/*
+    Fin de connexion, comme à la sortie de client_handler
+*/
+static void drop_client(sim_client_t *client)
+{
+    player_t *player = client->player;
+    handle_player_disconnect(player);
+    release_player_if_idle(player);
+}
+
+static sim_client_t *random_client()
+{
+    return &clients[sim_random() % client_count];
+}
+
+/*
+    Choisir une partie où c'est au joueur de jouer, ou à défaut n'importe laquelle de ses parties
+*/
+static game_t *pick_game(player_t *player, int *player_id)
+{
+    if (player->game_count == 0)
+    {
+        return NULL;
+    }
+
+    int start = sim_random() % player->game_count;
+    for (int i = 0; i < player->game_count; ++i)
+    {
+        game_t *game = player->games[(start + i) % player->game_count];
+        *player_id = (game->player1 == player) ? 0 : 1;
+        if (!game->game_over && !game->waiting_reconnect && game->turn == *player_id)
+        {
+            return game;
+        }
+    }
+
+    game_t *game = player->games[start];
+    *player_id = (game->player1 == player) ? 0 : 1;
+    return game;
+}
+
+/*
+    Choisir un trou non vide du joueur, ou un trou au hasard s'ils sont tous vides
+*/
+static int pick_pit(game_t *game, int player_id)
+{
+    int pits = game->variant->pits;
+    int offset = player_id * pits;
+    int start = sim_random() % pits;
+    for (int i = 0; i < pits; ++i)
+    {
+        int pit = (start + i) % pits;
+        if (game->board[offset + pit] > 0)
+        {
+            return pit;
+        }
+    }
+    return start;
+}
+
+/*
+    Composer la prochaine commande d'un joueur connecté
+*/
+static void next_command(sim_client_t *client, char *line, size_t size)
+{
+    player_t *player = client->player;
+    int roll = sim_random() % 1000;
+    int player_id = 0;
+    game_t *game = pick_game(player, &player_id);
+
+    if (roll < 550 && game != NULL)
+    {
+        snprintf(line, size, "/play %d %d", game->game_id, pick_pit(game, player_id));
+    }
+    else if (roll < 700)
+    {
+        snprintf(line, size, "/defier %s", random_client()->pseudo);
+    }
+    else if (roll < 800)
+    {
+        if (player->challenge_received)
+        {
+            snprintf(line, size, (sim_random() % 10 == 0) ? "/refuser" : "/accepter");
+        }
+        else
+        {
+            snprintf(line, size, "/defier %s", random_client()->pseudo);
+        }
+    }
+    else if (roll < 880 && game != NULL)
+    {
+        snprintf(line, size, "/chat %d bien joué %lu", game->game_id, sim_step);
+    }
+    else if (roll < 930)
+    {
+        snprintf(line, size, "/mp %s bonjour %lu", random_client()->pseudo, sim_step);
+    }
+    else if (roll < 935)
+    {
+        snprintf(line, size, "/global annonce %lu", sim_step);
+    }
+    else if (roll < 945 && game != NULL)
+    {
+        snprintf(line, size, "/abandon %d", game->game_id);
+    }
+    else if (roll < 950)
+    {
+        snprintf(line, size, (sim_random() % 2) ? "/affichage delta" : "/affichage complet");
+    }
+    else if (roll < 955)
+    {
+        snprintf(line, size, "/help");
+    }
+    else if (roll < 960)
+    {
+        snprintf(line, size, "/quit");
+    }
+    else if (roll < 990 && game != NULL)
+    {
+        snprintf(line, size, "/play %d", game->game_id);
+    }
+    else
+    {
+        snprintf(line, size, (sim_random() % 2) ? "/inconnue" : "bonjour");
+    }
+}
+
+/*
+    Un pas de simulation : une commande d'un joueur connecté, une déconnexion ou une reconnexion.
+    Retourne 1 si une commande a été traitée.
+*/
+static int simulate_step(char *line, size_t size)
+{
+    sim_client_t *client = random_client();
+
+    if (!client->connected)
+    {
+        if (sim_random() % SIM_RECONNECT_CHANCE == 0)
+        {
+            connect_client(client);
+        }
+        return 0;
+    }
+
+    // Coupure de connexion sans /quit
+    if (sim_random() % 200 == 0)
+    {
+        drop_client(client);
+        return 0;
+    }
+
+    player_t *player = client->player;
+    next_command(client, line, size);
+    if (handle_line(player, line) < 0)
+    {
+        // Comme client_handler après /quit
+        release_player_if_idle(player);
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int player_total = argc > 1 ? atoi(argv[1]) : SIM_DEFAULT_PLAYERS;
+    unsigned long command_total = argc > 2 ? strtoul(argv[2], NULL, 10) : SIM_DEFAULT_COMMANDS;
+    unsigned long long seed = argc > 3 ? strtoull(argv[3], NULL, 10) : SIM_DEFAULT_SEED;
+    int journal = argc > 4 ? journal_level_from_name(argv[4]) : LOG_OFF;
+    char line[BUFFER_SIZE];
+
+    if (player_total < 2 || journal < 0)
+    {
+        fprintf(stderr, "Usage : %s [joueurs >= 2] [commandes] [graine] [debug|info|warn|error|off]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Le journal n'est pas démarré par défaut : il ne change pas l'empreinte mais mesure son coût
+    if (journal != LOG_OFF)
+    {
+        journal_start(SIM_JOURNAL_FILE, journal);
+    }
+
+    sim_rng_state = seed;
+    seed_game_random(seed);
+    start_reconnection_wait = sim_start_reconnection_wait;
+    max_players = player_total;
+
+    // Pas de limitation de débit : les joueurs virtuels envoient tout à la même milliseconde
+    for (int i = 0; i < RATE_CLASS_COUNT; ++i)
+    {
+        rate_limits[i].rate = 1e12;
+        rate_limits[i].burst = 1e12;
+    }
+    init_commands();
+
+    clients = calloc(player_total, sizeof(sim_client_t));
+    if (clients == NULL)
+    {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    client_count = player_total;
+    for (int i = 0; i < client_count; ++i)
+    {
+        clients[i].index = i;
+        snprintf(clients[i].pseudo, sizeof(clients[i].pseudo), "sim%d", i);
+        connect_client(&clients[i]);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    unsigned long commands = 0;
+    while (commands < command_total)
+    {
+        sim_step++;
+        commands += simulate_step(line, sizeof(line));
+        resolve_expired_waits();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    int connected = 0;
+    for (int i = 0; i < client_count; ++i)
+    {
+        connected += clients[i].connected;
+    }
+
+    printf("Joueurs virtuels     : %d (%d connectés, %d dans la liste du serveur)\n", client_count, connected, player_count);
+    printf("Commandes            : %lu en %lu pas\n", commands, sim_step);
+    printf("Durée                : %.3f s (%.0f commandes/s)\n", elapsed, elapsed > 0 ? commands / elapsed : 0.0);
+    printf("Messages reçus       : %llu (%llu octets)\n", total_messages, total_bytes);
+    printf("Parties en cours     : %d (%d en attente de reconnexion)\n", game_count, wait_count);
+    printf("Empreinte            : %016llx\n", digest);
+    if (journal != LOG_OFF)
+    {
+        unsigned long long written, dropped;
+        int threads;
+        journal_flush();
+        journal_counters(&written, &dropped, &threads);
+        printf("Journal              : %llu enregistrements écrits, %llu perdus (%s)\n", written, dropped, SIM_JOURNAL_FILE);
+    }
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tablebase.h"
+
+// compositions[k][m] : nombre de façons de répartir m graines dans k trous
+static unsigned long long compositions[BOARD_SIZE + 2][TABLEBASE_MAX_SEEDS + 1];
+static int compositions_ready = 0;
+
+static void init_compositions()
+{
+    if (compositions_ready)
+    {
+        return;
+    }
+    for (int m = 0; m <= TABLEBASE_MAX_SEEDS; ++m)
+    {
+        compositions[0][m] = m == 0;
+    }
+    for (int k = 1; k <= BOARD_SIZE + 1; ++k)
+    {
+        compositions[k][0] = 1;
+        for (int m = 1; m <= TABLEBASE_MAX_SEEDS; ++m)
+        {
+            compositions[k][m] = compositions[k][m - 1] + compositions[k - 1][m];
+        }
+    }
+    compositions_ready = 1;
+}
+
+/*
+    Calculer l'indice du premier plateau de chaque niveau (nombre de graines) jusqu'à max_seeds
+*/
+void tablebase_prepare(tablebase_t *table, int max_seeds)
+{
+    init_compositions();
+    memset(table, 0, sizeof(*table));
+    table->max_seeds = max_seeds;
+    table->offsets[0] = 0;
+    for (int seeds = 0; seeds <= max_seeds; ++seeds)
+    {
+        table->offsets[seeds + 1] = table->offsets[seeds] + compositions[BOARD_SIZE][seeds];
+    }
+}
+
+unsigned long long tablebase_level_size(int seeds)
+{
+    init_compositions();
+    return compositions[BOARD_SIZE][seeds];
+}
+
+/*
+    Indice d'un plateau parmi ceux qui ont le même nombre de graines : pour chaque trou, on compte
+    les plateaux qui ont moins de graines dans ce trou et le même début (somme télescopique des compositions)
+*/
+unsigned long long tablebase_rank(const int board[], int seeds)
+{
+    unsigned long long index = 0;
+    int remaining = seeds;
+    for (int i = 0; i < BOARD_SIZE - 1; ++i)
+    {
+        int after = BOARD_SIZE - i; // Trous restants, celui-ci compris
+        index += compositions[after][remaining] - compositions[after][remaining - board[i]];
+        remaining -= board[i];
+    }
+    return index;
+}
+
+void tablebase_unrank(unsigned long long index, int seeds, int board[])
+{
+    int remaining = seeds;
+    for (int i = 0; i < BOARD_SIZE - 1; ++i)
+    {
+        int after = BOARD_SIZE - 1 - i; // Trous après celui-ci
+        int count = 0;
+        while (index >= compositions[after][remaining - count])
+        {
+            index -= compositions[after][remaining - count];
+            count++;
+        }
+        board[i] = count;
+        remaining -= count;
+    }
+    board[BOARD_SIZE - 1] = remaining;
+}
+
+/*
+    Valeur d'une position terminale : chaque joueur garde les graines de son camp
+*/
+int tablebase_terminal_value(const int board[])
+{
+    int value = 0;
+    for (int i = 0; i < PLAYER_PITS; ++i)
+    {
+        value += board[i] - board[i + PLAYER_PITS];
+    }
+    return value;
+}
+
+/*
+    Jouer le trou pit depuis un plateau vu du joueur au trait. Pour une capture ou une fin de partie,
+    value reçoit la valeur du coup pour ce joueur ; sinon child reçoit l'indice de la position suivante
+    (vue de l'adversaire) dans le même niveau, dont la valeur n'est connue qu'à la fin du niveau.
+*/
+int tablebase_move(const tablebase_t *table, const int board[], int seeds, int pit, int *value, unsigned long long *child)
+{
+    int next[BOARD_SIZE];
+    memcpy(next, board, sizeof(next));
+    int captured = awale_play(next, 0, pit);
+    if (captured < 0)
+    {
+        return TABLEBASE_MOVE_ILLEGAL;
+    }
+
+    // L'adversaire devient le joueur au trait
+    int rotated[BOARD_SIZE];
+    for (int i = 0; i < BOARD_SIZE; ++i)
+    {
+        rotated[i] = next[(i + PLAYER_PITS) % BOARD_SIZE];
+    }
+
+    if (awale_game_over(rotated, 0))
+    {
+        *value = captured - tablebase_terminal_value(rotated);
+        return TABLEBASE_MOVE_EXIT;
+    }
+    if (captured > 0)
+    {
+        int left = seeds - captured;
+        *value = captured - table->values[table->offsets[left] + tablebase_rank(rotated, left)];
+        return TABLEBASE_MOVE_EXIT;
+    }
+    *child = tablebase_rank(rotated, seeds);
+    return TABLEBASE_MOVE_LEVEL;
+}
+
+// ********************************************************************************* //
+
+// Lecture de la table
+
+/*
+    Projeter le fichier de la table en mémoire. Retourne 0, ou -1 si le fichier est absent ou invalide.
+*/
+int tablebase_load(tablebase_t *table, const char *path)
+{
+    memset(table, 0, sizeof(*table));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(tablebase_header_t))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const tablebase_header_t *header = (const tablebase_header_t *)mapping;
+    if (memcmp(header->magic, TABLEBASE_MAGIC, sizeof(header->magic)) != 0 || header->board_size != BOARD_SIZE ||
+        header->max_seeds > TABLEBASE_MAX_SEEDS)
+    {
+        fprintf(stderr, "%s : format de table de finales invalide\n", path);
+        munmap(mapping, st.st_size);
+        return -1;
+    }
+
+    tablebase_prepare(table, header->max_seeds);
+    if (header->positions != table->offsets[table->max_seeds + 1] ||
+        (size_t)st.st_size != sizeof(tablebase_header_t) + header->positions)
+    {
+        fprintf(stderr, "%s : taille de table de finales invalide\n", path);
+        munmap(mapping, st.st_size);
+        memset(table, 0, sizeof(*table));
+        return -1;
+    }
+
+    table->mapping = mapping;
+    table->mapping_size = st.st_size;
+    table->values = (const signed char *)mapping + sizeof(tablebase_header_t);
+    return 0;
+}
+
+void tablebase_unload(tablebase_t *table)
+{
+    if (table->mapping != NULL)
+    {
+        munmap(table->mapping, table->mapping_size);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+// Plateau vu depuis player_id et nombre de graines, -1 s'il dépasse la table
+static int normalize(const tablebase_t *table, const int board[], int player_id, int normalized[])
+{
+    int seeds = 0;
+    for (int i = 0; i < BOARD_SIZE; ++i)
+    {
+        normalized[i] = board[(i + player_id * PLAYER_PITS) % BOARD_SIZE];
+        seeds += normalized[i];
+    }
+    if (table->values == NULL || seeds > table->max_seeds)
+    {
+        return -1;
+    }
+    return seeds;
+}
+
+/*
+    Valeur de la position pour player_id s'il est au trait, TABLEBASE_UNKNOWN hors de la table
+*/
+int tablebase_lookup(const tablebase_t *table, const int board[], int player_id)
+{
+    int normalized[BOARD_SIZE];
+    int seeds = normalize(table, board, player_id, normalized);
+    if (seeds < 0)
+    {
+        return TABLEBASE_UNKNOWN;
+    }
+    return table->values[table->offsets[seeds] + tablebase_rank(normalized, seeds)];
+}
+
+/*
+    Valeur de chaque coup de player_id (TABLEBASE_UNKNOWN pour un trou vide).
+    Retourne le meilleur trou (0 à PLAYER_PITS - 1), ou -1 si la position est hors de la table.
+*/
+int tablebase_advice(const tablebase_t *table, const int board[], int player_id, int values[PLAYER_PITS])
+{
+    int normalized[BOARD_SIZE];
+    int seeds = normalize(table, board, player_id, normalized);
+    if (seeds < 0)
+    {
+        return -1;
+    }
+
+    int best = -1;
+    for (int pit = 0; pit < PLAYER_PITS; ++pit)
+    {
+        int value = TABLEBASE_UNKNOWN;
+        unsigned long long child;
+        int kind = tablebase_move(table, normalized, seeds, pit, &value, &child);
+        if (kind == TABLEBASE_MOVE_LEVEL)
+        {
+            value = -table->values[table->offsets[seeds] + child];
+        }
+        values[pit] = value;
+        if (kind != TABLEBASE_MOVE_ILLEGAL && (best < 0 || value > values[best]))
+        {
+            best = pit;
+        }
+    }
+    return best;
+}
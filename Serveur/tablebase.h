@@ -0,0 +1,66 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <stddef.h>
+
+#include "awale.h"
+
+/*
+    Table de finales : la valeur exacte de toutes les positions qui ont au plus max_seeds graines
+    sur le plateau. La valeur d'une position est la différence de score (graines capturées puis
+    graines restantes dans chaque camp à la fin de la partie) que le joueur au trait obtient avec
+    le meilleur jeu des deux côtés. Une partie qui boucle sans fin compte pour 0.
+
+    Ce n'est pas la règle jouée : le serveur et l'autojeu arrêtent la partie à la première position
+    répétée et chaque camp garde ses graines (position_history_play). Cette valeur dépend du chemin
+    suivi, pas seulement de la position, et ne peut pas être rangée dans la table : une position dont
+    le meilleur jeu boucle y vaut 0 au lieu du partage des graines. /conseil corrige les coups qui
+    répètent une position de la partie ; la politique moteur de l'autojeu ne corrige rien.
+
+    Les positions sont toujours vues depuis le joueur au trait (ses trous sont 0 à PLAYER_PITS - 1).
+    Elles sont rangées par nombre de graines, puis dans l'ordre lexicographique du plateau : l'indice
+    d'une position se calcule sans recherche et sa valeur est un seul octet du fichier projeté en mémoire.
+*/
+
+// Constants
+#define TABLEBASE_FILE "awale.tb"
+#define TABLEBASE_MAGIC "AWALETB1"
+#define TABLEBASE_MAX_SEEDS 24 // Limite du générateur, bien au-delà de ce qui tient en mémoire
+#define TABLEBASE_UNKNOWN 127 // Position hors de la table (trop de graines) ou coup invalide
+
+// Résultat d'un coup pour le générateur
+#define TABLEBASE_MOVE_ILLEGAL 0
+#define TABLEBASE_MOVE_EXIT 1  // Capture ou fin de partie : la valeur ne dépend que des niveaux déjà calculés
+#define TABLEBASE_MOVE_LEVEL 2 // Ni capture ni fin : la position suivante a le même nombre de graines
+
+// Structures
+typedef struct tablebase_header_t
+{
+    char magic[8];
+    unsigned int max_seeds;
+    unsigned int board_size;
+    unsigned long long positions;
+} tablebase_header_t;
+
+typedef struct tablebase_t
+{
+    int max_seeds;
+    unsigned long long offsets[TABLEBASE_MAX_SEEDS + 2]; // Indice de la première position de chaque niveau
+    const signed char *values;
+    void *mapping; // Fichier projeté en mémoire, NULL si les valeurs viennent du générateur
+    size_t mapping_size;
+} tablebase_t;
+
+// Prototypes
+void tablebase_prepare(tablebase_t *table, int max_seeds);
+unsigned long long tablebase_level_size(int seeds);
+unsigned long long tablebase_rank(const int board[], int seeds);
+void tablebase_unrank(unsigned long long index, int seeds, int board[]);
+int tablebase_terminal_value(const int board[]);
+int tablebase_move(const tablebase_t *table, const int board[], int seeds, int pit, int *value, unsigned long long *child);
+int tablebase_load(tablebase_t *table, const char *path);
+void tablebase_unload(tablebase_t *table);
+int tablebase_lookup(const tablebase_t *table, const int board[], int player_id);
+int tablebase_advice(const tablebase_t *table, const int board[], int player_id, int values[PLAYER_PITS]);
+
+#endif
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "tampons.h"
+
+buffer_class_t buffer_classes[BUFFER_CLASS_COUNT] = {
+    {BUFFER_SMALL, PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0},
+    {BUFFER_MEDIUM, PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0},
+    {BUFFER_LARGE, PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0},
+};
+
+/*
+    Découper un nouveau bloc en tampons libres (verrou de la classe détenu)
+*/
+static int grow_class(buffer_class_t *class, int size_class)
+{
+    size_t stride = sizeof(io_buffer_t) + class->size;
+    // Garder les en-têtes alignés d'un tampon à l'autre
+    stride = (stride + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    size_t count = BUFFER_SLAB_SIZE / stride;
+
+    char *slab = malloc(stride * count);
+    if (slab == NULL)
+    {
+        perror("malloc");
+        return -1;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        io_buffer_t *buffer = (io_buffer_t *)(slab + i * stride);
+        buffer->size_class = size_class;
+        buffer->capacity = class->size;
+        buffer->next = class->free_list;
+        class->free_list = buffer;
+    }
+    class->slabs++;
+    return 0;
+}
+
+/*
+    Emprunter un tampon d'au moins size octets (au plus BUFFER_LARGE), vide. NULL si la mémoire manque.
+*/
+io_buffer_t *buffer_acquire(size_t size)
+{
+    int size_class = 0;
+    while (size_class < BUFFER_CLASS_COUNT - 1 && buffer_classes[size_class].size < size)
+    {
+        size_class++;
+    }
+    buffer_class_t *class = &buffer_classes[size_class];
+
+    LOCK(&class->mutex);
+    if (class->free_list == NULL && grow_class(class, size_class) < 0)
+    {
+        UNLOCK(&class->mutex);
+        return NULL;
+    }
+    io_buffer_t *buffer = class->free_list;
+    class->free_list = buffer->next;
+    class->in_use++;
+    if (class->in_use > class->peak)
+    {
+        class->peak = class->in_use;
+    }
+    UNLOCK(&class->mutex);
+
+    buffer->next = NULL;
+    buffer->length = 0;
+    buffer->data[0] = '\0';
+    return buffer;
+}
+
+void buffer_release(io_buffer_t *buffer)
+{
+    if (buffer == NULL)
+    {
+        return;
+    }
+    buffer_class_t *class = &buffer_classes[buffer->size_class];
+    LOCK(&class->mutex);
+    buffer->next = class->free_list;
+    class->free_list = buffer;
+    class->in_use--;
+    UNLOCK(&class->mutex);
+}
+
+/*
+    Ajouter du texte formaté à la fin du tampon, coupé s'il ne tient pas
+*/
+void buffer_append(io_buffer_t *buffer, const char *format, ...)
+{
+    if (buffer->length + 1 >= buffer->capacity)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+    va_end(args);
+
+    if (written > 0)
+    {
+        buffer->length += (size_t)written < buffer->capacity - buffer->length ? (size_t)written : buffer->capacity - buffer->length - 1;
+    }
+}
+
+/*
+    Occupation de la réserve, une ligne par classe de taille
+*/
+void buffer_pool_report(report_line_t emit, void *ctx)
+{
+    char line[128];
+    for (int i = 0; i < BUFFER_CLASS_COUNT; ++i)
+    {
+        buffer_class_t *class = &buffer_classes[i];
+        LOCK(&class->mutex);
+        snprintf(line, sizeof(line), "tampons de %zu octets : %d empruntés, %d au plus, %d blocs de %d Ko\n", class->size, class->in_use, class->peak, class->slabs,
+                 BUFFER_SLAB_SIZE / 1024);
+        UNLOCK(&class->mutex);
+        emit(ctx, line);
+    }
+}
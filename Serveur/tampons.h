@@ -0,0 +1,51 @@
+#ifndef TAMPONS_H
+#define TAMPONS_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "verrous.h"
+
+/*
+    Réserve de tampons d'entrée-sortie partagée par toutes les connexions. Une connexion n'emprunte un
+    tampon que le temps d'une ligne incomplète ou d'un affichage à envoyer, et le rend ensuite : une
+    connexion inactive ne garde aucun tampon. Les tampons sont découpés dans des blocs (slabs) de
+    BUFFER_SLAB_SIZE octets, par classe de taille, et ne retournent jamais au système : une pointe de
+    charge est réutilisée par la suivante sans appel à malloc.
+*/
+
+// Constants
+#define BUFFER_SLAB_SIZE 65536
+#define BUFFER_SMALL 256    // Commandes
+#define BUFFER_MEDIUM 1024  // Lignes longues (jusqu'à BUFFER_SIZE)
+#define BUFFER_LARGE 4096   // Affichages composés de plusieurs lignes
+#define BUFFER_CLASS_COUNT 3
+
+// Structures
+typedef struct io_buffer_t io_buffer_t;
+struct io_buffer_t
+{
+    io_buffer_t *next; // Liste des tampons libres de la classe
+    int size_class;
+    size_t capacity;
+    size_t length;
+    char data[];
+};
+
+typedef struct buffer_class_t
+{
+    size_t size;
+    pthread_mutex_t mutex;
+    io_buffer_t *free_list;
+    int slabs;
+    int in_use;
+    int peak;
+} buffer_class_t;
+
+// Prototypes
+io_buffer_t *buffer_acquire(size_t size);
+void buffer_release(io_buffer_t *buffer);
+void buffer_append(io_buffer_t *buffer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void buffer_pool_report(report_line_t emit, void *ctx);
+
+#endif
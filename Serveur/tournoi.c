@@ -0,0 +1,867 @@
+#include "tournoi.h"
+
+tournament_t *tournaments[MAX_TOURNAMENTS];
+int tournament_id_counter = 1;
+pthread_mutex_t tournaments_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Clé de tri du classement
+typedef struct standing_t
+{
+    int index;
+    int points;
+    int tiebreak;
+    int seeds;
+} standing_t;
+
+// Échiquier copié pour créer les parties hors du verrou des tournois
+typedef struct pairing_t
+{
+    int board;
+    char pseudo1[32];
+    char pseudo2[32];
+    int is_bye;
+} pairing_t;
+
+static void launch_round(int tournament_id);
+
+/*
+    Retrouver un tournoi à partir de son id (tournaments_mutex verrouillé)
+*/
+static tournament_t *find_tournament(int id)
+{
+    for (int i = 0; i < MAX_TOURNAMENTS; ++i)
+    {
+        if (tournaments[i] != NULL && tournaments[i]->id == id)
+        {
+            return tournaments[i];
+        }
+    }
+    return NULL;
+}
+
+static int find_entry(tournament_t *t, const char *pseudo)
+{
+    for (int i = 0; i < t->entry_count; ++i)
+    {
+        if (strcmp(t->entries[i].pseudo, pseudo) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+    Le joueur participe-t-il à un tournoi en cours ? Ses prochaines parties l'attendent.
+*/
+int tournament_is_playing(const char *pseudo)
+{
+    int playing = 0;
+    LOCK(&tournaments_mutex);
+    for (int i = 0; i < MAX_TOURNAMENTS && !playing; ++i)
+    {
+        tournament_t *t = tournaments[i];
+        playing = t != NULL && t->status == TOURNAMENT_RUNNING && find_entry(t, pseudo) != -1;
+    }
+    UNLOCK(&tournaments_mutex);
+    return playing;
+}
+
+static void free_tournament(tournament_t *t)
+{
+    free(t->entries);
+    free(t->played);
+    free(t->boards);
+    free(t);
+}
+
+/*
+    Retrouver un joueur connecté (players_mutex verrouillé)
+*/
+static player_t *find_connected_player(const char *pseudo)
+{
+    for (int i = 0; i < player_count; ++i)
+    {
+        if (players[i]->connected && strcmp(players[i]->pseudo, pseudo) == 0)
+        {
+            return players[i];
+        }
+    }
+    return NULL;
+}
+
+static void send_to_pseudo(const char *pseudo, const char *message)
+{
+    LOCK(&players_mutex);
+    player_t *player = find_connected_player(pseudo);
+    if (player != NULL)
+    {
+        send_to_player(player, message);
+    }
+    UNLOCK(&players_mutex);
+}
+
+static int has_played(tournament_t *t, int a, int b)
+{
+    int bit = a * t->entry_count + b;
+    return (t->played[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void set_played(tournament_t *t, int a, int b)
+{
+    int bit = a * t->entry_count + b;
+    t->played[bit / 8] |= 1 << (bit % 8);
+    bit = b * t->entry_count + a;
+    t->played[bit / 8] |= 1 << (bit % 8);
+}
+
+// ********************************************************************************* //
+
+// Classement
+
+/*
+    Calculer les départages : Buchholz (somme des points des adversaires) en suisse,
+    Sonneborn-Berger (points des adversaires battus, moitié pour les nuls) en toutes rondes
+*/
+static void compute_tiebreaks(tournament_t *t)
+{
+    for (int i = 0; i < t->entry_count; ++i)
+    {
+        t->entries[i].tiebreak = 0;
+    }
+
+    for (int i = 0; i < t->board_count; ++i)
+    {
+        tournament_board_t *b = &t->boards[i];
+        if (b->player2 < 0 || b->result == TOURNAMENT_RESULT_PENDING || b->result == TOURNAMENT_RESULT_DOUBLE_FORFEIT)
+        {
+            continue;
+        }
+
+        tournament_entry_t *e1 = &t->entries[b->player1];
+        tournament_entry_t *e2 = &t->entries[b->player2];
+
+        if (t->type == TOURNAMENT_SWISS)
+        {
+            e1->tiebreak += 2 * e2->points;
+            e2->tiebreak += 2 * e1->points;
+        }
+        else if (b->result == GAME_RESULT_PLAYER1_WIN)
+        {
+            e1->tiebreak += 2 * e2->points;
+        }
+        else if (b->result == GAME_RESULT_PLAYER2_WIN)
+        {
+            e2->tiebreak += 2 * e1->points;
+        }
+        else
+        {
+            e1->tiebreak += e2->points;
+            e2->tiebreak += e1->points;
+        }
+    }
+}
+
+static int compare_standings(const void *a, const void *b)
+{
+    const standing_t *s1 = (const standing_t *)a;
+    const standing_t *s2 = (const standing_t *)b;
+
+    if (s1->points != s2->points)
+        return s2->points - s1->points;
+    if (s1->tiebreak != s2->tiebreak)
+        return s2->tiebreak - s1->tiebreak;
+    if (s1->seeds != s2->seeds)
+        return s2->seeds - s1->seeds;
+    return s1->index - s2->index;
+}
+
+/*
+    Trier les participants par points puis départages. order doit contenir entry_count cases.
+*/
+static void compute_standings(tournament_t *t, int *order)
+{
+    compute_tiebreaks(t);
+
+    standing_t *standings = (standing_t *)malloc(t->entry_count * sizeof(standing_t));
+    for (int i = 0; i < t->entry_count; ++i)
+    {
+        standings[i].index = i;
+        standings[i].points = t->entries[i].points;
+        standings[i].tiebreak = t->entries[i].tiebreak;
+        standings[i].seeds = t->entries[i].seeds;
+    }
+    qsort(standings, t->entry_count, sizeof(standing_t), compare_standings);
+
+    for (int i = 0; i < t->entry_count; ++i)
+    {
+        order[i] = standings[i].index;
+    }
+    free(standings);
+}
+
+// ********************************************************************************* //
+
+// Appariements
+
+static tournament_board_t *add_board(tournament_t *t, int player1, int player2)
+{
+    if (t->board_count >= t->board_capacity)
+    {
+        t->board_capacity = t->board_capacity ? t->board_capacity * 2 : t->entry_count;
+        t->boards = (tournament_board_t *)realloc(t->boards, t->board_capacity * sizeof(tournament_board_t));
+    }
+
+    tournament_board_t *b = &t->boards[t->board_count++];
+    b->round = t->current_round;
+    b->player1 = player1;
+    b->player2 = player2;
+    b->game_id = 0;
+    b->result = TOURNAMENT_RESULT_PENDING;
+    b->player1_score = 0;
+    b->player2_score = 0;
+
+    if (player2 >= 0)
+    {
+        set_played(t, player1, player2);
+        t->entries[player1].color_balance++;
+        t->entries[player2].color_balance--;
+    }
+    return b;
+}
+
+/*
+    Toutes rondes par la méthode du cercle : le dernier participant reste fixe et les autres tournent.
+    Avec un nombre impair, le participant fictif n est l'exemption.
+*/
+static void pair_round_robin(tournament_t *t)
+{
+    int n = t->entry_count;
+    int n_even = n + (n % 2);
+    int m = n_even - 1;
+    int r = t->current_round - 1;
+
+    for (int k = 0; k < n_even / 2; ++k)
+    {
+        int a = (k == 0) ? n_even - 1 : (r + k) % m;
+        int b = (k == 0) ? r : (r - k + m) % m;
+
+        if (a >= n || b >= n)
+        {
+            add_board(t, (a >= n) ? b : a, -1);
+        }
+        else if ((r + k) % 2 == 0)
+        {
+            add_board(t, a, b);
+        }
+        else
+        {
+            add_board(t, b, a);
+        }
+    }
+}
+
+/*
+    Système suisse : les participants sont triés par points, l'exemption va au moins bien classé
+    qui n'en a pas encore eu, puis chacun affronte le suivant du classement qu'il n'a pas encore rencontré.
+*/
+static void pair_swiss(tournament_t *t)
+{
+    int n = t->entry_count;
+    int *order = (int *)malloc(n * sizeof(int));
+    char *paired = (char *)calloc(n, 1);
+    compute_standings(t, order);
+
+    if (n % 2 == 1)
+    {
+        int bye = order[n - 1];
+        for (int i = n - 1; i >= 0; --i)
+        {
+            if (!t->entries[order[i]].had_bye)
+            {
+                bye = order[i];
+                break;
+            }
+        }
+        paired[bye] = 1;
+        add_board(t, bye, -1);
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        int a = order[i];
+        if (paired[a])
+        {
+            continue;
+        }
+
+        int opponent = -1;
+        int fallback = -1;
+        for (int j = i + 1; j < n; ++j)
+        {
+            int b = order[j];
+            if (paired[b])
+            {
+                continue;
+            }
+            if (fallback == -1)
+            {
+                fallback = b;
+            }
+            if (!has_played(t, a, b))
+            {
+                opponent = b;
+                break;
+            }
+        }
+
+        // Si tout le monde a déjà été rencontré, on accepte une revanche
+        if (opponent == -1)
+        {
+            opponent = fallback;
+        }
+        if (opponent == -1)
+        {
+            break;
+        }
+
+        paired[a] = 1;
+        paired[opponent] = 1;
+
+        // Le premier joueur est celui qui a le moins souvent commencé
+        if (t->entries[a].color_balance <= t->entries[opponent].color_balance)
+        {
+            add_board(t, a, opponent);
+        }
+        else
+        {
+            add_board(t, opponent, a);
+        }
+    }
+
+    free(order);
+    free(paired);
+}
+
+// ********************************************************************************* //
+
+// Déroulement du tournoi
+
+static void *next_round_thread(void *arg)
+{
+    int tournament_id = (int)(long)arg;
+    launch_round(tournament_id);
+    return NULL;
+}
+
+/*
+    Enregistrer le résultat d'un échiquier et lancer la ronde suivante si c'était le dernier
+*/
+static void record_result(int tournament_id, int board, int result, int player1_score, int player2_score)
+{
+    LOCK(&tournaments_mutex);
+    tournament_t *t = find_tournament(tournament_id);
+    if (t == NULL || board < 0 || board >= t->board_count || t->boards[board].result != TOURNAMENT_RESULT_PENDING)
+    {
+        UNLOCK(&tournaments_mutex);
+        return;
+    }
+
+    tournament_board_t *b = &t->boards[board];
+    b->result = result;
+    b->player1_score = player1_score;
+    b->player2_score = player2_score;
+
+    tournament_entry_t *e1 = &t->entries[b->player1];
+    tournament_entry_t *e2 = (b->player2 >= 0) ? &t->entries[b->player2] : NULL;
+
+    e1->seeds += player1_score;
+    if (e2 != NULL)
+    {
+        e2->seeds += player2_score;
+    }
+
+    if (result == GAME_RESULT_PLAYER1_WIN)
+    {
+        e1->points += 2;
+        e1->wins++;
+        if (e2 != NULL)
+            e2->losses++;
+    }
+    else if (result == GAME_RESULT_PLAYER2_WIN)
+    {
+        e2->points += 2;
+        e2->wins++;
+        e1->losses++;
+    }
+    else if (result == GAME_RESULT_DRAW)
+    {
+        e1->points++;
+        e1->draws++;
+        e2->points++;
+        e2->draws++;
+    }
+    else
+    {
+        e1->losses++;
+        e2->losses++;
+    }
+
+    t->pending--;
+    if (t->pending == 0)
+    {
+        // La ronde suivante crée des parties : on la lance hors des verrous de la partie qui vient de finir
+        pthread_t round_thread;
+        pthread_create(&round_thread, NULL, next_round_thread, (void *)(long)t->id);
+        pthread_detach(round_thread);
+    }
+    UNLOCK(&tournaments_mutex);
+}
+
+/*
+    Appelé quand une partie se termine (fin normale, abandon ou absence de reconnexion)
+*/
+void tournament_report_result(game_t *game, int result)
+{
+    if (game->tournament_id == 0)
+    {
+        return;
+    }
+    record_result(game->tournament_id, game->tournament_board, result, game->player1_score, game->player2_score);
+}
+
+/*
+    Annoncer le classement final aux participants (tournaments_mutex verrouillé)
+*/
+static void finish_tournament(tournament_t *t)
+{
+    char buffer[BUFFER_SIZE];
+    int *order = (int *)malloc(t->entry_count * sizeof(int));
+    compute_standings(t, order);
+    t->status = TOURNAMENT_FINISHED;
+
+    JOURNAL(LOG_INFO, LOG_NONE, LOG_NONE, "Tournoi %d (%s) terminé, vainqueur : %s", t->id, t->name, t->entries[order[0]].pseudo);
+
+    for (int rank = 0; rank < t->entry_count; ++rank)
+    {
+        tournament_entry_t *e = &t->entries[order[rank]];
+        snprintf(buffer, sizeof(buffer), YELLOW "[Tournoi %d] Le tournoi %s est terminé ! Vainqueur : %s. Vous terminez %d/%d avec %d.%d points.\n" RESET,
+                 t->id, t->name, t->entries[order[0]].pseudo, rank + 1, t->entry_count, e->points / 2, (e->points % 2) * 5);
+        send_to_pseudo(e->pseudo, buffer);
+    }
+    free(order);
+}
+
+/*
+    Apparier la ronde suivante et créer toutes ses parties d'un coup
+*/
+static void launch_round(int tournament_id)
+{
+    char buffer[BUFFER_SIZE];
+
+    LOCK(&tournaments_mutex);
+    tournament_t *t = find_tournament(tournament_id);
+    if (t == NULL || t->status != TOURNAMENT_RUNNING)
+    {
+        UNLOCK(&tournaments_mutex);
+        return;
+    }
+
+    if (t->current_round >= t->rounds)
+    {
+        finish_tournament(t);
+        UNLOCK(&tournaments_mutex);
+        return;
+    }
+
+    t->current_round++;
+    int first_board = t->board_count;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (t->type == TOURNAMENT_SWISS)
+    {
+        pair_swiss(t);
+    }
+    else
+    {
+        pair_round_robin(t);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    JOURNAL(LOG_INFO, LOG_NONE, LOG_NONE, "Tournoi %d : ronde %d/%d appariée en %.3f ms (%d échiquiers)", t->id, t->current_round, t->rounds,
+            (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0, t->board_count - first_board);
+
+    // Copier les appariements pour créer les parties sans garder le verrou des tournois
+    int pairing_count = t->board_count - first_board;
+    pairing_t *pairings = (pairing_t *)malloc(pairing_count * sizeof(pairing_t));
+    int round = t->current_round;
+    int rounds = t->rounds;
+    t->pending = 0;
+
+    for (int i = 0; i < pairing_count; ++i)
+    {
+        tournament_board_t *b = &t->boards[first_board + i];
+        pairings[i].board = first_board + i;
+        pairings[i].is_bye = (b->player2 < 0);
+        strcpy(pairings[i].pseudo1, t->entries[b->player1].pseudo);
+        if (pairings[i].is_bye)
+        {
+            // L'exemption compte comme une victoire
+            pairings[i].pseudo2[0] = '\0';
+            b->result = GAME_RESULT_PLAYER1_WIN;
+            t->entries[b->player1].points += 2;
+            t->entries[b->player1].wins++;
+            t->entries[b->player1].had_bye = 1;
+        }
+        else
+        {
+            strcpy(pairings[i].pseudo2, t->entries[b->player2].pseudo);
+            t->pending++;
+        }
+    }
+
+    // Réserver un résultat fictif tant que les parties sont en création, pour ne pas enchaîner la ronde trop tôt
+    t->pending++;
+    UNLOCK(&tournaments_mutex);
+
+    for (int i = 0; i < pairing_count; ++i)
+    {
+        pairing_t *p = &pairings[i];
+
+        if (p->is_bye)
+        {
+            snprintf(buffer, sizeof(buffer), YELLOW "[Tournoi %d] Ronde %d/%d : vous êtes exempt, la ronde compte comme une victoire.\n" RESET, tournament_id, round, rounds);
+            send_to_pseudo(p->pseudo1, buffer);
+            continue;
+        }
+
+        LOCK(&players_mutex);
+        player_t *player1 = find_connected_player(p->pseudo1);
+        player_t *player2 = find_connected_player(p->pseudo2);
+
+        if (player1 != NULL && player2 != NULL)
+        {
+            // Toujours verrouiller les deux joueurs dans le même ordre
+            player_t *first = (player1 < player2) ? player1 : player2;
+            player_t *second = (player1 < player2) ? player2 : player1;
+            LOCK(&first->player_mutex);
+            LOCK(&second->player_mutex);
+
+            // Le premier joueur de l'échiquier commence toujours
+            game_t *game = create_game(player1, player2, 0, tournament_id, p->board, DEFAULT_VARIANT);
+
+            snprintf(buffer, sizeof(buffer), YELLOW "[Tournoi %d] Ronde %d/%d : vous affrontez %s dans la partie %d.\n" RESET, tournament_id, round, rounds, player2->pseudo, game->game_id);
+            send_to_player(player1, buffer);
+            snprintf(buffer, sizeof(buffer), YELLOW "[Tournoi %d] Ronde %d/%d : vous affrontez %s dans la partie %d.\n" RESET, tournament_id, round, rounds, player1->pseudo, game->game_id);
+            send_to_player(player2, buffer);
+            announce_game_start(game);
+
+            UNLOCK(&second->player_mutex);
+            UNLOCK(&first->player_mutex);
+            UNLOCK(&players_mutex);
+
+            LOCK(&tournaments_mutex);
+            t = find_tournament(tournament_id);
+            if (t != NULL)
+            {
+                t->boards[p->board].game_id = game->game_id;
+            }
+            UNLOCK(&tournaments_mutex);
+        }
+        else
+        {
+            UNLOCK(&players_mutex);
+
+            // Les absents perdent par forfait
+            int result = (player1 == NULL && player2 == NULL) ? TOURNAMENT_RESULT_DOUBLE_FORFEIT : (player1 == NULL) ? GAME_RESULT_PLAYER2_WIN : GAME_RESULT_PLAYER1_WIN;
+            if (result != TOURNAMENT_RESULT_DOUBLE_FORFEIT)
+            {
+                snprintf(buffer, sizeof(buffer), YELLOW "[Tournoi %d] Ronde %d/%d : %s est absent, vous gagnez par forfait.\n" RESET, tournament_id, round, rounds, (player1 == NULL) ? p->pseudo1 : p->pseudo2);
+                send_to_pseudo((player1 == NULL) ? p->pseudo2 : p->pseudo1, buffer);
+            }
+            record_result(tournament_id, p->board, result, 0, 0);
+        }
+    }
+    free(pairings);
+
+    // Retirer le résultat fictif : si toutes les parties sont déjà finies, la ronde suivante démarre
+    LOCK(&tournaments_mutex);
+    t = find_tournament(tournament_id);
+    if (t != NULL)
+    {
+        t->pending--;
+        if (t->pending == 0)
+        {
+            pthread_t round_thread;
+            pthread_create(&round_thread, NULL, next_round_thread, (void *)(long)tournament_id);
+            pthread_detach(round_thread);
+        }
+    }
+    UNLOCK(&tournaments_mutex);
+}
+
+// ********************************************************************************* //
+
+// Commandes /tournoi
+
+static void create_tournament(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    char type[16];
+    int rounds = 0;
+
+    if (args->argc < 3)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /tournoi creer <nom> <rr|suisse> [rondes]\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    view_copy(args->argv[2], type, sizeof(type));
+    if ((strcmp(type, "rr") != 0 && strcmp(type, "suisse") != 0) || (args->argc == 4 && (!view_to_int(args->argv[3], &rounds) || rounds < 1)))
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /tournoi creer <nom> <rr|suisse> [rondes]\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    LOCK(&tournaments_mutex);
+    int slot = -1;
+    for (int i = 0; i < MAX_TOURNAMENTS && slot == -1; ++i)
+    {
+        if (tournaments[i] == NULL)
+        {
+            slot = i;
+        }
+    }
+    // Sinon on réutilise la place d'un tournoi terminé
+    for (int i = 0; i < MAX_TOURNAMENTS && slot == -1; ++i)
+    {
+        if (tournaments[i]->status == TOURNAMENT_FINISHED)
+        {
+            free_tournament(tournaments[i]);
+            tournaments[i] = NULL;
+            slot = i;
+        }
+    }
+
+    if (slot == -1)
+    {
+        UNLOCK(&tournaments_mutex);
+        snprintf(buffer, sizeof(buffer), RED "Trop de tournois en cours. Réessayez plus tard.\n" RESET);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    tournament_t *t = (tournament_t *)calloc(1, sizeof(tournament_t));
+    t->id = tournament_id_counter++;
+    view_copy(args->argv[1], t->name, sizeof(t->name));
+    strcpy(t->organizer, player->pseudo);
+    t->type = (strcmp(type, "suisse") == 0) ? TOURNAMENT_SWISS : TOURNAMENT_ROUND_ROBIN;
+    t->status = TOURNAMENT_REGISTRATION;
+    t->rounds = rounds; // 0 : calculé au lancement
+    tournaments[slot] = t;
+
+    snprintf(buffer, sizeof(buffer), GREEN "Tournoi %d (%s, %s) créé. Inscriptions : /tournoi rejoindre %d, lancement : /tournoi lancer %d\n" RESET,
+             t->id, t->name, (t->type == TOURNAMENT_SWISS) ? "suisse" : "toutes rondes", t->id, t->id);
+    UNLOCK(&tournaments_mutex);
+
+    channel_publish(global_chat_channel(), buffer, NULL);
+}
+
+static void join_tournament(player_t *player, int tournament_id)
+{
+    char buffer[BUFFER_SIZE];
+
+    LOCK(&tournaments_mutex);
+    tournament_t *t = find_tournament(tournament_id);
+
+    if (t == NULL)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Le tournoi %d n'existe pas.\n" RESET, tournament_id);
+    }
+    else if (t->status != TOURNAMENT_REGISTRATION)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Les inscriptions du tournoi %d sont closes.\n" RESET, tournament_id);
+    }
+    else if (find_entry(t, player->pseudo) != -1)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Vous êtes déjà inscrit au tournoi %d.\n" RESET, tournament_id);
+    }
+    else if (t->entry_count >= MAX_TOURNAMENT_PLAYERS)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Le tournoi %d est complet.\n" RESET, tournament_id);
+    }
+    else
+    {
+        if (t->entry_count >= t->entry_capacity)
+        {
+            t->entry_capacity = t->entry_capacity ? t->entry_capacity * 2 : 16;
+            t->entries = (tournament_entry_t *)realloc(t->entries, t->entry_capacity * sizeof(tournament_entry_t));
+        }
+        tournament_entry_t *e = &t->entries[t->entry_count++];
+        memset(e, 0, sizeof(tournament_entry_t));
+        strcpy(e->pseudo, player->pseudo);
+        snprintf(buffer, sizeof(buffer), GREEN "Inscription au tournoi %d (%s) confirmée. %d inscrit(s).\n" RESET, t->id, t->name, t->entry_count);
+    }
+    UNLOCK(&tournaments_mutex);
+
+    send_to_player(player, buffer);
+}
+
+static void start_tournament(player_t *player, int tournament_id)
+{
+    char buffer[BUFFER_SIZE];
+
+    LOCK(&tournaments_mutex);
+    tournament_t *t = find_tournament(tournament_id);
+
+    if (t == NULL)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Le tournoi %d n'existe pas.\n" RESET, tournament_id);
+    }
+    else if (strcmp(t->organizer, player->pseudo) != 0 && !player->is_admin)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Seul l'organisateur (%s) peut lancer le tournoi %d.\n" RESET, t->organizer, tournament_id);
+    }
+    else if (t->status != TOURNAMENT_REGISTRATION)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Le tournoi %d est déjà lancé.\n" RESET, tournament_id);
+    }
+    else if (t->entry_count < 2)
+    {
+        snprintf(buffer, sizeof(buffer), RED "Il faut au moins 2 inscrits pour lancer le tournoi %d.\n" RESET, tournament_id);
+    }
+    else
+    {
+        int n = t->entry_count;
+        int max_rounds = n - 1 + (n % 2);
+        if (t->type == TOURNAMENT_ROUND_ROBIN)
+        {
+            t->rounds = max_rounds;
+        }
+        else if (t->rounds == 0)
+        {
+            // Par défaut, log2(n) rondes arrondi au-dessus suffisent à départager un vainqueur
+            while ((1 << t->rounds) < n)
+                t->rounds++;
+        }
+        if (t->rounds > max_rounds)
+        {
+            t->rounds = max_rounds;
+        }
+
+        t->played = (unsigned char *)calloc((n * n + 7) / 8, 1);
+        t->status = TOURNAMENT_RUNNING;
+        snprintf(buffer, sizeof(buffer), GREEN "Le tournoi %d (%s) commence : %d participants, %d rondes.\n" RESET, t->id, t->name, n, t->rounds);
+        UNLOCK(&tournaments_mutex);
+
+        channel_publish(global_chat_channel(), buffer, NULL);
+        launch_round(tournament_id);
+        return;
+    }
+    UNLOCK(&tournaments_mutex);
+
+    send_to_player(player, buffer);
+}
+
+static void show_standings(player_t *player, int tournament_id)
+{
+    char buffer[BUFFER_SIZE];
+
+    LOCK(&tournaments_mutex);
+    tournament_t *t = find_tournament(tournament_id);
+    if (t == NULL || t->entry_count == 0)
+    {
+        UNLOCK(&tournaments_mutex);
+        snprintf(buffer, sizeof(buffer), RED "Le tournoi %d n'existe pas ou n'a aucun inscrit.\n" RESET, tournament_id);
+        send_to_player(player, buffer);
+        return;
+    }
+
+    int *order = (int *)malloc(t->entry_count * sizeof(int));
+    compute_standings(t, order);
+
+    snprintf(buffer, sizeof(buffer), CYAN "Tournoi %d (%s) - ronde %d/%d\n%-4s %-32s %6s %8s %6s  V/N/D\n" RESET,
+             t->id, t->name, t->current_round, t->rounds, "Rang", "Pseudo", "Points", (t->type == TOURNAMENT_SWISS) ? "Buchholz" : "S-B", "Graines");
+    send_to_player(player, buffer);
+
+    for (int rank = 0; rank < t->entry_count; ++rank)
+    {
+        tournament_entry_t *e = &t->entries[order[rank]];
+        // On affiche le haut du classement et la ligne du joueur
+        if (rank >= TOURNAMENT_STANDINGS_LINES && strcmp(e->pseudo, player->pseudo) != 0)
+        {
+            continue;
+        }
+        snprintf(buffer, sizeof(buffer), "%-4d %-32s %4d.%d %8.2f %6d  %d/%d/%d\n", rank + 1, e->pseudo, e->points / 2, (e->points % 2) * 5,
+                 e->tiebreak / 4.0, e->seeds, e->wins, e->draws, e->losses);
+        send_to_player(player, buffer);
+    }
+    free(order);
+    UNLOCK(&tournaments_mutex);
+}
+
+static void list_tournaments(player_t *player)
+{
+    char buffer[BUFFER_SIZE];
+    const char *status_names[] = {"inscriptions", "en cours", "terminé"};
+
+    snprintf(buffer, sizeof(buffer), CYAN "Tournois :\n" RESET);
+    send_to_player(player, buffer);
+
+    LOCK(&tournaments_mutex);
+    for (int i = 0; i < MAX_TOURNAMENTS; ++i)
+    {
+        tournament_t *t = tournaments[i];
+        if (t != NULL)
+        {
+            snprintf(buffer, sizeof(buffer), "%d - %s (%s, %s) : %d inscrits, ronde %d/%d\n", t->id, t->name,
+                     (t->type == TOURNAMENT_SWISS) ? "suisse" : "toutes rondes", status_names[t->status], t->entry_count, t->current_round, t->rounds);
+            send_to_player(player, buffer);
+        }
+    }
+    UNLOCK(&tournaments_mutex);
+}
+
+static void cmd_tournoi(player_t *player, const command_args_t *args)
+{
+    char buffer[BUFFER_SIZE];
+    char action[16];
+    int tournament_id = 0;
+
+    view_copy(args->argv[0], action, sizeof(action));
+
+    if (strcmp(action, "creer") == 0)
+    {
+        create_tournament(player, args);
+    }
+    else if (strcmp(action, "liste") == 0)
+    {
+        list_tournaments(player);
+    }
+    else if (args->argc == 2 && view_to_int(args->argv[1], &tournament_id) && strcmp(action, "rejoindre") == 0)
+    {
+        join_tournament(player, tournament_id);
+    }
+    else if (args->argc == 2 && view_to_int(args->argv[1], &tournament_id) && strcmp(action, "lancer") == 0)
+    {
+        start_tournament(player, tournament_id);
+    }
+    else if (args->argc == 2 && view_to_int(args->argv[1], &tournament_id) && strcmp(action, "classement") == 0)
+    {
+        show_standings(player, tournament_id);
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), RED "Format incorrect. Utilisez /tournoi creer <nom> <rr|suisse> [rondes], /tournoi <rejoindre|lancer|classement> <numéro> ou /tournoi liste\n" RESET);
+        send_to_player(player, buffer);
+    }
+}
+
+void init_tournament_commands()
+{
+    // Le classement est trié à chaque demande : exécuté par la réserve de travailleurs
+    register_command("/tournoi", 1, 4, CMD_POOL, PERM_PLAYER, cmd_tournoi, "/tournoi <creer|rejoindre|lancer|classement|liste> [...]");
+}
@@ -0,0 +1,73 @@
+#ifndef TOURNOI_H
+#define TOURNOI_H
+
+#include "serveur.h"
+
+// Constants
+#define MAX_TOURNAMENTS 16
+#define MAX_TOURNAMENT_PLAYERS 1024
+#define TOURNAMENT_STANDINGS_LINES 20 // Nombre de lignes affichées par /tournoi classement
+
+// Formats de tournoi
+#define TOURNAMENT_ROUND_ROBIN 0 // Toutes rondes
+#define TOURNAMENT_SWISS 1       // Système suisse
+
+// États d'un tournoi
+#define TOURNAMENT_REGISTRATION 0
+#define TOURNAMENT_RUNNING 1
+#define TOURNAMENT_FINISHED 2
+
+// Résultat d'un échiquier pas encore joué
+#define TOURNAMENT_RESULT_PENDING -1
+#define TOURNAMENT_RESULT_DOUBLE_FORFEIT 3
+
+// Structures
+typedef struct tournament_entry_t
+{
+    char pseudo[32];
+    int points;   // En demi-points : victoire 2, nul 1, défaite 0
+    int tiebreak; // Départage ×2 (Buchholz en suisse, Sonneborn-Berger en toutes rondes)
+    int seeds;    // Graines gagnées sur l'ensemble des parties (second départage)
+    int wins;
+    int draws;
+    int losses;
+    int had_bye;
+    int color_balance; // Nombre de parties en premier joueur moins nombre de parties en second joueur
+} tournament_entry_t;
+
+typedef struct tournament_board_t
+{
+    int round;
+    int player1; // Index des participants, player2 = -1 pour une exemption
+    int player2;
+    int game_id;
+    int result; // GAME_RESULT_*, TOURNAMENT_RESULT_PENDING ou TOURNAMENT_RESULT_DOUBLE_FORFEIT
+    int player1_score;
+    int player2_score;
+} tournament_board_t;
+
+typedef struct tournament_t
+{
+    int id;
+    char name[32];
+    char organizer[32];
+    int type;
+    int status;
+    tournament_entry_t *entries;
+    int entry_count;
+    int entry_capacity;
+    unsigned char *played; // Matrice de bits des rencontres déjà jouées
+    int rounds;
+    int current_round;
+    tournament_board_t *boards; // Échiquiers de toutes les rondes
+    int board_count;
+    int board_capacity;
+    int pending; // Échiquiers de la ronde en cours sans résultat
+} tournament_t;
+
+// Prototypes
+void init_tournament_commands();
+void tournament_report_result(game_t *game, int result);
+int tournament_is_playing(const char *pseudo);
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "traces.h"
+
+trace_span_t trace_ring[TRACE_RING_SIZE];
+unsigned long trace_next = 0;         // Prochaine position d'écriture, jamais remise à zéro
+int trace_rate = 0;                   // Une requête sur trace_rate, 0 : désactivé
+unsigned long trace_line_counter = 0; // Lignes reçues depuis le lancement, pour l'échantillonnage
+unsigned int trace_request_counter = 0;
+int trace_thread_counter = 0;
+
+__thread unsigned int trace_request = 0;
+static __thread int trace_connection = 0;
+static __thread int trace_game = 0;
+static __thread int trace_thread = 0;
+
+unsigned long long trace_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/*
+    Décider si la ligne reçue est suivie, retourne le numéro de la requête ou 0
+*/
+unsigned int trace_request_begin(int connection_id)
+{
+    int rate = __atomic_load_n(&trace_rate, __ATOMIC_RELAXED);
+    if (rate <= 0 || __atomic_fetch_add(&trace_line_counter, 1, __ATOMIC_RELAXED) % rate != 0)
+    {
+        trace_request = 0;
+        return 0;
+    }
+
+    unsigned int request = __atomic_add_fetch(&trace_request_counter, 1, __ATOMIC_RELAXED);
+    if (request == 0)
+    {
+        request = __atomic_add_fetch(&trace_request_counter, 1, __ATOMIC_RELAXED);
+    }
+    trace_resume(request, connection_id, 0);
+    return request;
+}
+
+/*
+    Continuer sur ce thread une requête commencée ailleurs
+*/
+void trace_resume(unsigned int request, int connection_id, int game_id)
+{
+    trace_request = request;
+    trace_connection = connection_id;
+    trace_game = game_id;
+}
+
+void trace_request_end()
+{
+    trace_request = 0;
+}
+
+/*
+    Ajouter l'intervalle [start_ns, maintenant] à la requête courante
+*/
+void trace_record(const char *name, const char *detail, unsigned long long start_ns)
+{
+    unsigned long long end_ns = trace_now();
+    if (trace_thread == 0)
+    {
+        trace_thread = __atomic_add_fetch(&trace_thread_counter, 1, __ATOMIC_RELAXED);
+    }
+
+    // La position libère l'emplacement pendant l'écriture : un export concurrent l'ignore
+    unsigned long position = __atomic_fetch_add(&trace_next, 1, __ATOMIC_RELAXED);
+    trace_span_t *span = &trace_ring[position & (TRACE_RING_SIZE - 1)];
+    __atomic_store_n(&span->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    span->name = name;
+    span->detail = detail;
+    span->start_ns = start_ns;
+    span->duration_ns = end_ns - start_ns;
+    span->request = trace_request;
+    span->thread = trace_thread;
+    span->connection_id = trace_connection;
+    span->game_id = trace_game;
+    __atomic_store_n(&span->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+/*
+    Acquérir un verrou pour une requête suivie, en enregistrant les attentes de plus de TRACE_LOCK_MIN_NS
+*/
+int trace_lock(pthread_mutex_t *mutex, const char *expression)
+{
+    unsigned long long start = trace_now();
+    int result = pthread_mutex_lock(mutex);
+    if (trace_now() - start >= TRACE_LOCK_MIN_NS)
+    {
+        trace_record("verrou", expression, start);
+    }
+    return result;
+}
+
+void trace_set_rate(int rate)
+{
+    __atomic_store_n(&trace_rate, rate < 0 ? 0 : rate, __ATOMIC_RELAXED);
+}
+
+int trace_get_rate()
+{
+    return __atomic_load_n(&trace_rate, __ATOMIC_RELAXED);
+}
+
+unsigned long trace_recorded()
+{
+    return __atomic_load_n(&trace_next, __ATOMIC_RELAXED);
+}
+
+/*
+    Écrire les intervalles du tampon dans path au format JSON de Chrome, retourne leur nombre ou -1.
+    Un emplacement réécrit pendant sa copie est ignoré.
+*/
+int trace_export(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    int written = 0;
+    for (int i = 0; i < TRACE_RING_SIZE; ++i)
+    {
+        trace_span_t *slot = &trace_ring[i];
+        unsigned long sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == 0)
+        {
+            continue;
+        }
+        trace_span_t span = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence)
+        {
+            continue;
+        }
+
+        // Horodatages en microsecondes ; une requête est un flux de la trace, un thread une ligne
+        fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"requete\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"requete\":%u,\"connexion\":%d,\"partie\":%d",
+                written == 0 ? "" : ",", span.name, span.start_ns / 1000.0, span.duration_ns / 1000.0, span.thread, span.request,
+                span.connection_id, span.game_id);
+        if (span.detail != NULL)
+        {
+            fprintf(file, ",\"detail\":\"%s\"", span.detail);
+        }
+        fprintf(file, "}}");
+        written++;
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0)
+    {
+        return -1;
+    }
+    return written;
+}
@@ -0,0 +1,61 @@
+#ifndef TRACES_H
+#define TRACES_H
+
+#include <pthread.h>
+
+/*
+    Traces par requête, exportées au format « trace event » de Chrome (chrome://tracing, Perfetto).
+    Une requête sur trace_rate est échantillonnée à la réception de sa ligne : son numéro suit la
+    requête d'un thread à l'autre (message à l'acteur de la partie, tâche de la réserve), et chaque
+    étape (analyse, commande, attente d'un verrou, coup, affichage, envoi, sauvegarde) y ajoute un
+    intervalle. Les intervalles vont dans un tampon circulaire partagé, sans verrou : les plus anciens
+    sont écrasés. Une requête non échantillonnée ne coûte qu'une lecture de variable du thread.
+*/
+
+// Constants
+#define TRACE_RING_SIZE 65536      // Intervalles conservés, puissance de 2
+#define TRACE_DEFAULT_RATE 1000    // Une requête sur 1000 au lancement du serveur, 0 pour désactiver
+#define TRACE_LOCK_MIN_NS 1000     // Une acquisition de verrou plus rapide n'est pas enregistrée
+#define TRACE_FILE "traces.json"   // Fichier d'export par défaut
+
+// Structures
+typedef struct trace_span_t
+{
+    unsigned long sequence; // Position d'écriture + 1, 0 pendant l'écriture
+    const char *name;
+    const char *detail; // Chaîne constante (nom de commande, expression du verrou) ou NULL
+    unsigned long long start_ns;
+    unsigned long long duration_ns;
+    unsigned int request;
+    int thread;
+    int connection_id;
+    int game_id;
+} trace_span_t;
+
+// Requête suivie par le thread courant, 0 si elle n'est pas échantillonnée
+extern __thread unsigned int trace_request;
+
+// Début d'un intervalle, 0 hors d'une requête échantillonnée
+#define TRACE_START() (trace_request != 0 ? trace_now() : 0)
+#define TRACE_END(name, detail, start)                  \
+    do                                                  \
+    {                                                   \
+        if (trace_request != 0)                         \
+        {                                               \
+            trace_record((name), (detail), (start));    \
+        }                                               \
+    } while (0)
+
+// Prototypes
+unsigned long long trace_now();
+unsigned int trace_request_begin(int connection_id);
+void trace_resume(unsigned int request, int connection_id, int game_id);
+void trace_request_end();
+void trace_record(const char *name, const char *detail, unsigned long long start_ns);
+int trace_lock(pthread_mutex_t *mutex, const char *expression);
+void trace_set_rate(int rate);
+int trace_get_rate();
+unsigned long trace_recorded();
+int trace_export(const char *path);
+
+#endif
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "travailleurs.h"
+#include "verrous.h"
+
+worker_queue_t worker_queues[POOL_MAX_WORKERS];
+int worker_count = 0;
+int pool_running = 0;
+unsigned int next_worker = 0; // Tourniquet pour les tâches sans affinité soumises hors de la réserve
+__thread int current_worker = -1; // Indice du travailleur courant, -1 hors de la réserve
+
+// Travailleurs endormis et tâches en file : chacun lit le compteur de l'autre pour ne perdre aucun réveil
+int queued_tasks = 0;
+int sleeping_workers = 0;
+pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+// Tâche soumise par pool_run, dont l'appelant attend la fin
+typedef struct pool_wait_t
+{
+    task_fn_t run;
+    void *arg;
+    int done;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} pool_wait_t;
+
+static int queue_push(worker_queue_t *queue, task_t task)
+{
+    LOCK(&queue->mutex);
+    if (queue->count == queue->capacity)
+    {
+        int new_capacity = queue->capacity == 0 ? POOL_INITIAL_CAPACITY : queue->capacity * 2;
+        task_t *new_tasks = malloc(sizeof(task_t) * new_capacity);
+        if (new_tasks == NULL)
+        {
+            UNLOCK(&queue->mutex);
+            perror("malloc");
+            return -1;
+        }
+        for (int i = 0; i < queue->count; ++i)
+        {
+            new_tasks[i] = queue->tasks[(queue->first + i) % queue->capacity];
+        }
+        free(queue->tasks);
+        queue->tasks = new_tasks;
+        queue->capacity = new_capacity;
+        queue->first = 0;
+    }
+    queue->tasks[(queue->first + queue->count) % queue->capacity] = task;
+    // count est aussi lu sans verrou par les voleurs
+    __atomic_store_n(&queue->count, queue->count + 1, __ATOMIC_RELAXED);
+    UNLOCK(&queue->mutex);
+    return 0;
+}
+
+/*
+    Prendre une tâche : la plus ancienne pour le propriétaire de la file, la plus récente pour un voleur
+*/
+static int queue_pop(worker_queue_t *queue, int steal, task_t *task)
+{
+    // Lecture sans verrou : une file vue vide est simplement sautée
+    if (__atomic_load_n(&queue->count, __ATOMIC_RELAXED) == 0)
+    {
+        return 0;
+    }
+
+    LOCK(&queue->mutex);
+    if (queue->count == 0)
+    {
+        UNLOCK(&queue->mutex);
+        return 0;
+    }
+    if (steal)
+    {
+        *task = queue->tasks[(queue->first + queue->count - 1) % queue->capacity];
+    }
+    else
+    {
+        *task = queue->tasks[queue->first];
+        queue->first = (queue->first + 1) % queue->capacity;
+    }
+    __atomic_store_n(&queue->count, queue->count - 1, __ATOMIC_RELAXED);
+    UNLOCK(&queue->mutex);
+    return 1;
+}
+
+static int find_task(int self, task_t *task)
+{
+    if (queue_pop(&worker_queues[self], 0, task))
+    {
+        return 1;
+    }
+    for (int i = 1; i < worker_count; ++i)
+    {
+        if (queue_pop(&worker_queues[(self + i) % worker_count], 1, task))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg)
+{
+    current_worker = (int)(long)arg;
+    task_t task;
+
+    while (1)
+    {
+        if (find_task(current_worker, &task))
+        {
+            __atomic_sub_fetch(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+            task.run(task.arg);
+            continue;
+        }
+
+        // Rien à faire ni à voler : s'endormir jusqu'à la prochaine soumission
+        LOCK(&pool_mutex);
+        __atomic_add_fetch(&sleeping_workers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&queued_tasks, __ATOMIC_SEQ_CST) == 0)
+        {
+            pthread_cond_wait(&pool_cond, &pool_mutex);
+        }
+        __atomic_sub_fetch(&sleeping_workers, 1, __ATOMIC_SEQ_CST);
+        UNLOCK(&pool_mutex);
+    }
+    return NULL;
+}
+
+/*
+    Soumettre une tâche, au travailleur affinity % nombre de travailleurs si affinity >= 0 ;
+    sinon au travailleur courant, ou à tour de rôle hors de la réserve
+*/
+void pool_submit(task_fn_t run, void *arg, int affinity)
+{
+    if (!__atomic_load_n(&pool_running, __ATOMIC_ACQUIRE))
+    {
+        run(arg);
+        return;
+    }
+
+    int target;
+    if (affinity >= 0)
+    {
+        target = affinity % worker_count;
+    }
+    else if (current_worker >= 0)
+    {
+        target = current_worker;
+    }
+    else
+    {
+        target = __atomic_fetch_add(&next_worker, 1, __ATOMIC_RELAXED) % worker_count;
+    }
+
+    // Compter la tâche avant de la rendre visible : un travailleur ne peut pas la prendre avant
+    task_t task = {run, arg};
+    __atomic_add_fetch(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+    if (queue_push(&worker_queues[target], task) < 0)
+    {
+        __atomic_sub_fetch(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+        run(arg); // Plus de mémoire pour la file : exécuter la tâche ici plutôt que la perdre
+        return;
+    }
+
+    if (__atomic_load_n(&sleeping_workers, __ATOMIC_SEQ_CST) > 0)
+    {
+        LOCK(&pool_mutex);
+        pthread_cond_signal(&pool_cond);
+        UNLOCK(&pool_mutex);
+    }
+}
+
+static void run_and_signal(void *arg)
+{
+    pool_wait_t *wait = (pool_wait_t *)arg;
+    wait->run(wait->arg);
+
+    LOCK(&wait->mutex);
+    wait->done = 1;
+    pthread_cond_signal(&wait->cond);
+    UNLOCK(&wait->mutex);
+}
+
+/*
+    Exécuter une tâche sur la réserve et attendre sa fin. Un travailleur l'exécute lui-même :
+    attendre un autre travailleur pourrait bloquer toute la réserve.
+*/
+void pool_run(task_fn_t run, void *arg, int affinity)
+{
+    if (!__atomic_load_n(&pool_running, __ATOMIC_ACQUIRE) || current_worker >= 0)
+    {
+        run(arg);
+        return;
+    }
+
+    pool_wait_t wait;
+    wait.run = run;
+    wait.arg = arg;
+    wait.done = 0;
+    pthread_mutex_init(&wait.mutex, NULL);
+    pthread_cond_init(&wait.cond, NULL);
+
+    pool_submit(run_and_signal, &wait, affinity);
+
+    LOCK(&wait.mutex);
+    while (!wait.done)
+    {
+        pthread_cond_wait(&wait.cond, &wait.mutex);
+    }
+    UNLOCK(&wait.mutex);
+    pthread_mutex_destroy(&wait.mutex);
+    pthread_cond_destroy(&wait.cond);
+}
+
+int pool_started()
+{
+    return __atomic_load_n(&pool_running, __ATOMIC_ACQUIRE);
+}
+
+int pool_worker_count()
+{
+    return worker_count;
+}
+
+/*
+    Lancer les travailleurs : les tâches soumises ensuite leur sont confiées
+*/
+int pool_start(int workers)
+{
+    if (workers > POOL_MAX_WORKERS)
+    {
+        workers = POOL_MAX_WORKERS;
+    }
+    if (workers < 1)
+    {
+        workers = 1;
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        pthread_mutex_init(&worker_queues[i].mutex, NULL);
+        worker_queues[i].tasks = NULL;
+        worker_queues[i].capacity = 0;
+        worker_queues[i].first = 0;
+        worker_queues[i].count = 0;
+    }
+
+    // Les files des travailleurs qui n'ont pas pu être lancés sont vidées par les autres, par vol
+    worker_count = workers;
+    int started = 0;
+    for (int i = 0; i < workers; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker_main, (void *)(long)i) == 0)
+        {
+            pthread_detach(thread);
+            started++;
+        }
+    }
+    if (started == 0)
+    {
+        return -1;
+    }
+    __atomic_store_n(&pool_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
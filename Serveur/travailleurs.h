@@ -0,0 +1,46 @@
+#ifndef TRAVAILLEURS_H
+#define TRAVAILLEURS_H
+
+#include <pthread.h>
+
+/*
+    Réserve de travailleurs, un par processeur, avec vol de tâches. Chaque travailleur a sa propre file :
+    il prend ses tâches dans l'ordre d'arrivée et, quand elle est vide, vole la plus récente d'un autre
+    travailleur. Une tâche peut désigner un travailleur (affinité) : les messages d'une même partie vont
+    au même travailleur tant qu'il suit, et restent dans son cache. Un travailleur sans tâche s'endort
+    au lieu de tourner à vide.
+    Tant que pool_start n'est pas appelé (simulation), les tâches s'exécutent sur le thread qui les soumet.
+*/
+
+// Constants
+#define POOL_MAX_WORKERS 64
+#define POOL_INITIAL_CAPACITY 64 // Tâches par file, doublée au besoin
+#define POOL_ANY_WORKER -1
+
+typedef void (*task_fn_t)(void *arg);
+
+// Structures
+typedef struct task_t
+{
+    task_fn_t run;
+    void *arg;
+} task_t;
+
+// File circulaire d'un travailleur : le travailleur prend en tête, les voleurs en queue
+typedef struct worker_queue_t
+{
+    pthread_mutex_t mutex;
+    task_t *tasks;
+    int capacity;
+    int first;
+    int count;
+} worker_queue_t;
+
+// Prototypes
+int pool_start(int workers);
+int pool_started();
+int pool_worker_count();
+void pool_submit(task_fn_t run, void *arg, int affinity);
+void pool_run(task_fn_t run, void *arg, int affinity);
+
+#endif
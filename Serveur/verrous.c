@@ -0,0 +1,365 @@
+#include "verrous.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+lock_site_t lock_sites[MAX_LOCK_SITES];
+int lock_site_count = 0;
+pthread_mutex_t lock_sites_mutex = PTHREAD_MUTEX_INITIALIZER; // Protège uniquement l'ajout d'un site ou d'une classe
+
+char lock_classes[MAX_LOCK_CLASSES][32];
+int lock_class_count = 0;
+
+// lock_order[a][b] : nombre d'acquisitions d'un verrou de classe b pendant qu'un verrou de classe a est détenu
+unsigned long lock_order[MAX_LOCK_CLASSES][MAX_LOCK_CLASSES];
+// Premier site ayant acquis b en détenant a, pour situer une inversion dans le code
+lock_site_t *lock_order_site[MAX_LOCK_CLASSES][MAX_LOCK_CLASSES];
+
+// Verrous détenus par le thread courant
+typedef struct held_lock_t
+{
+    pthread_mutex_t *mutex;
+    lock_site_t *site;
+    unsigned long long acquired_ns;
+} held_lock_t;
+
+static __thread held_lock_t held_locks[MAX_HELD_LOCKS];
+static __thread int held_count = 0;
+
+static unsigned long long now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void atomic_max(unsigned long long *target, unsigned long long value)
+{
+    unsigned long long current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current && !__atomic_compare_exchange_n(target, &current, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/*
+    La classe d'un verrou est le dernier identifiant de l'expression : "&challenger->player_mutex" -> "player_mutex"
+*/
+static int find_lock_class(const char *expression)
+{
+    const char *name = expression;
+    for (const char *c = expression; *c != '\0'; ++c)
+    {
+        if (*c == '&' || *c == '>' || *c == '.' || *c == '(' || *c == ' ')
+        {
+            name = c + 1;
+        }
+    }
+
+    for (int i = 0; i < lock_class_count; ++i)
+    {
+        if (strcmp(lock_classes[i], name) == 0)
+        {
+            return i;
+        }
+    }
+
+    if (lock_class_count >= MAX_LOCK_CLASSES)
+    {
+        return MAX_LOCK_CLASSES - 1;
+    }
+    strncpy(lock_classes[lock_class_count], name, sizeof(lock_classes[0]) - 1);
+    return lock_class_count++;
+}
+
+static lock_site_t *register_site(const char *expression, const char *file, int line)
+{
+    pthread_mutex_lock(&lock_sites_mutex);
+    lock_site_t *site = NULL;
+    for (int i = 0; i < lock_site_count; ++i)
+    {
+        if (lock_sites[i].line == line && strcmp(lock_sites[i].file, file) == 0)
+        {
+            site = &lock_sites[i];
+        }
+    }
+
+    if (site == NULL)
+    {
+        // Au-delà de MAX_LOCK_SITES, les sites supplémentaires partagent la dernière case
+        site = &lock_sites[lock_site_count < MAX_LOCK_SITES ? lock_site_count++ : MAX_LOCK_SITES - 1];
+        site->file = file;
+        site->line = line;
+        site->expression = expression;
+        site->lock_class = find_lock_class(expression);
+    }
+    pthread_mutex_unlock(&lock_sites_mutex);
+    return site;
+}
+
+static void push_held_lock(pthread_mutex_t *mutex, lock_site_t *site)
+{
+    __atomic_fetch_add(&site->acquisitions, 1, __ATOMIC_RELAXED);
+
+    if (held_count < MAX_HELD_LOCKS)
+    {
+        held_locks[held_count].mutex = mutex;
+        held_locks[held_count].site = site;
+        held_locks[held_count].acquired_ns = now_ns();
+    }
+    held_count++;
+}
+
+/*
+    Acquérir un verrou en mesurant l'attente et en notant l'ordre par rapport aux verrous déjà détenus
+*/
+void lock_mutex(pthread_mutex_t *mutex, const char *expression, const char *file, int line, lock_site_t **site_cache)
+{
+    lock_site_t *site = __atomic_load_n(site_cache, __ATOMIC_ACQUIRE);
+    if (site == NULL)
+    {
+        site = register_site(expression, file, line);
+        __atomic_store_n(site_cache, site, __ATOMIC_RELEASE);
+    }
+
+    // Ordre d'acquisition : classe détenue -> classe demandée
+    for (int i = 0; i < held_count && i < MAX_HELD_LOCKS; ++i)
+    {
+        int held_class = held_locks[i].site->lock_class;
+        if (__atomic_fetch_add(&lock_order[held_class][site->lock_class], 1, __ATOMIC_RELAXED) == 0)
+        {
+            __atomic_store_n(&lock_order_site[held_class][site->lock_class], site, __ATOMIC_RELAXED);
+        }
+    }
+
+    unsigned long long wait_ns = 0;
+    if (pthread_mutex_trylock(mutex) != 0)
+    {
+        unsigned long long start = now_ns();
+        pthread_mutex_lock(mutex);
+        wait_ns = now_ns() - start;
+        __atomic_fetch_add(&site->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&site->wait_ns, wait_ns, __ATOMIC_RELAXED);
+        atomic_max(&site->max_wait_ns, wait_ns);
+        if (trace_request != 0 && wait_ns >= TRACE_LOCK_MIN_NS)
+        {
+            trace_record("verrou", expression, start);
+        }
+    }
+    push_held_lock(mutex, site);
+}
+
+/*
+    Essayer d'acquérir un verrou sans attendre. Un essai ne peut pas provoquer d'interblocage :
+    il n'est pas compté dans l'ordre d'acquisition. Retourne 0 si le verrou est acquis.
+*/
+int trylock_mutex(pthread_mutex_t *mutex, const char *expression, const char *file, int line, lock_site_t **site_cache)
+{
+    lock_site_t *site = __atomic_load_n(site_cache, __ATOMIC_ACQUIRE);
+    if (site == NULL)
+    {
+        site = register_site(expression, file, line);
+        __atomic_store_n(site_cache, site, __ATOMIC_RELEASE);
+    }
+
+    int result = pthread_mutex_trylock(mutex);
+    if (result != 0)
+    {
+        __atomic_fetch_add(&site->contended, 1, __ATOMIC_RELAXED);
+        return result;
+    }
+    push_held_lock(mutex, site);
+    return 0;
+}
+
+/*
+    Libérer un verrou et ajouter la durée de détention au site qui l'a acquis
+*/
+void unlock_mutex(pthread_mutex_t *mutex)
+{
+    int top = (held_count < MAX_HELD_LOCKS) ? held_count : MAX_HELD_LOCKS;
+
+    // Les verrous ne sont pas toujours libérés dans l'ordre inverse de leur acquisition
+    for (int i = top - 1; i >= 0; --i)
+    {
+        if (held_locks[i].mutex == mutex)
+        {
+            unsigned long long hold_ns = now_ns() - held_locks[i].acquired_ns;
+            __atomic_fetch_add(&held_locks[i].site->hold_ns, hold_ns, __ATOMIC_RELAXED);
+            atomic_max(&held_locks[i].site->max_hold_ns, hold_ns);
+
+            for (int j = i; j < top - 1; ++j)
+            {
+                held_locks[j] = held_locks[j + 1];
+            }
+            break;
+        }
+    }
+    if (held_count > 0)
+    {
+        held_count--;
+    }
+
+    pthread_mutex_unlock(mutex);
+}
+
+static int compare_sites(const void *a, const void *b)
+{
+    const lock_site_t *s1 = *(const lock_site_t **)a;
+    const lock_site_t *s2 = *(const lock_site_t **)b;
+    if (s1->wait_ns != s2->wait_ns)
+        return (s2->wait_ns > s1->wait_ns) ? 1 : -1;
+    return (s2->hold_ns > s1->hold_ns) ? 1 : (s2->hold_ns < s1->hold_ns) ? -1 : 0;
+}
+
+/*
+    Produire le rapport ligne par ligne : sites triés par temps d'attente, puis ordres d'acquisition suspects
+*/
+void lock_profiler_report(report_line_t emit, void *ctx)
+{
+    char line[256];
+
+    if (!lock_profiler_enabled())
+    {
+        emit(ctx, "Profilage des verrous désactivé : recompilez le serveur avec make PROFILAGE=1.\n");
+        return;
+    }
+
+    pthread_mutex_lock(&lock_sites_mutex);
+    int count = lock_site_count;
+    lock_site_t *sorted[MAX_LOCK_SITES];
+    for (int i = 0; i < count; ++i)
+    {
+        sorted[i] = &lock_sites[i];
+    }
+    pthread_mutex_unlock(&lock_sites_mutex);
+    qsort(sorted, count, sizeof(lock_site_t *), compare_sites);
+
+    snprintf(line, sizeof(line), "%-22s %-28s %10s %9s %11s %11s %11s %11s\n", "Site", "Verrou", "Acq.", "Contention", "Attente moy", "Attente max", "Détention moy", "Détention max");
+    emit(ctx, line);
+
+    for (int i = 0; i < count; ++i)
+    {
+        lock_site_t *s = sorted[i];
+        unsigned long acquisitions = __atomic_load_n(&s->acquisitions, __ATOMIC_RELAXED);
+        unsigned long contended = __atomic_load_n(&s->contended, __ATOMIC_RELAXED);
+        const char *file = strrchr(s->file, '/') ? strrchr(s->file, '/') + 1 : s->file;
+        char where[64];
+        snprintf(where, sizeof(where), "%s:%d", file, s->line);
+
+        // Temps en microsecondes
+        snprintf(line, sizeof(line), "%-22s %-28s %10lu %8.1f%% %11.2f %11.2f %11.2f %11.2f\n", where, s->expression, acquisitions,
+                 acquisitions ? 100.0 * contended / acquisitions : 0.0,
+                 contended ? s->wait_ns / 1000.0 / contended : 0.0, s->max_wait_ns / 1000.0,
+                 acquisitions ? s->hold_ns / 1000.0 / acquisitions : 0.0, s->max_hold_ns / 1000.0);
+        emit(ctx, line);
+    }
+
+    emit(ctx, "Ordre d'acquisition des classes de verrous :\n");
+    int suspicious = 0;
+    for (int a = 0; a < lock_class_count; ++a)
+    {
+        for (int b = a; b < lock_class_count; ++b)
+        {
+            unsigned long forward = __atomic_load_n(&lock_order[a][b], __ATOMIC_RELAXED);
+            unsigned long backward = __atomic_load_n(&lock_order[b][a], __ATOMIC_RELAXED);
+            lock_site_t *forward_site = lock_order_site[a][b];
+            lock_site_t *backward_site = lock_order_site[b][a];
+
+            if (a == b && forward > 0)
+            {
+                // Deux verrous de la même classe : l'ordre dépend des objets et peut s'inverser entre deux threads
+                snprintf(line, sizeof(line), "  IMBRICATION %.31s -> %.31s : %lu fois (ex. %s:%d)\n", lock_classes[a], lock_classes[b], forward,
+                         forward_site ? forward_site->file : "?", forward_site ? forward_site->line : 0);
+                emit(ctx, line);
+                suspicious++;
+            }
+            else if (a != b && forward > 0 && backward > 0)
+            {
+                snprintf(line, sizeof(line), "  INVERSION %.31s -> %.31s (%lu fois, ex. %s:%d) et %.31s -> %.31s (%lu fois, ex. %s:%d)\n",
+                         lock_classes[a], lock_classes[b], forward, forward_site ? forward_site->file : "?", forward_site ? forward_site->line : 0,
+                         lock_classes[b], lock_classes[a], backward, backward_site ? backward_site->file : "?", backward_site ? backward_site->line : 0);
+                emit(ctx, line);
+                suspicious++;
+            }
+            else if (a != b && (forward > 0 || backward > 0))
+            {
+                int first = forward > 0 ? a : b;
+                int second = forward > 0 ? b : a;
+                snprintf(line, sizeof(line), "  %.31s -> %.31s : %lu fois\n", lock_classes[first], lock_classes[second], forward + backward);
+                emit(ctx, line);
+            }
+        }
+    }
+    if (suspicious == 0)
+    {
+        emit(ctx, "  Aucune inversion observée.\n");
+    }
+}
+
+void lock_profiler_reset()
+{
+    pthread_mutex_lock(&lock_sites_mutex);
+    for (int i = 0; i < lock_site_count; ++i)
+    {
+        lock_site_t *s = &lock_sites[i];
+        __atomic_store_n(&s->acquisitions, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->contended, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->wait_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->max_wait_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->hold_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->max_hold_ns, 0, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&lock_sites_mutex);
+}
+
+int lock_profiler_enabled()
+{
+#ifdef LOCK_PROFILING
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void print_line(void *ctx, const char *line)
+{
+    fputs(line, stdout);
+}
+
+/*
+    Thread qui affiche le rapport sur la sortie standard à chaque SIGUSR1
+*/
+static void *signal_thread(void *arg)
+{
+    sigset_t *signals = (sigset_t *)arg;
+    int signal_number;
+
+    while (sigwait(signals, &signal_number) == 0)
+    {
+        lock_profiler_report(print_line, NULL);
+        fflush(stdout);
+    }
+    return NULL;
+}
+
+/*
+    À appeler dans main() avant de créer les autres threads, pour qu'ils héritent du masque de SIGUSR1
+*/
+void lock_profiler_start()
+{
+    if (!lock_profiler_enabled())
+    {
+        return;
+    }
+
+    static sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, signal_thread, &signals);
+    pthread_detach(thread);
+}
@@ -0,0 +1,67 @@
+#ifndef VERROUS_H
+#define VERROUS_H
+
+#include <pthread.h>
+
+#include "traces.h"
+
+/*
+    Profilage des verrous, activé en compilant avec -DLOCK_PROFILING (make PROFILAGE=1).
+    LOCK et UNLOCK remplacent pthread_mutex_lock et pthread_mutex_unlock : chaque site d'appel
+    compte ses acquisitions, son temps d'attente et de détention, et l'ordre d'acquisition des
+    classes de verrous (players_mutex, player_mutex, ...) est suivi pour repérer les inversions.
+    Dans les deux cas, l'attente d'un verrou est ajoutée à la trace d'une requête échantillonnée (traces.h).
+*/
+
+// Constants
+#define MAX_LOCK_SITES 256
+#define MAX_LOCK_CLASSES 32
+#define MAX_HELD_LOCKS 16 // Profondeur maximale d'imbrication suivie par thread
+
+// Structures
+typedef struct lock_site_t
+{
+    const char *file;
+    int line;
+    const char *expression; // Expression passée à LOCK, par exemple "&player->player_mutex"
+    int lock_class;
+    unsigned long acquisitions;
+    unsigned long contended;
+    unsigned long long wait_ns;
+    unsigned long long max_wait_ns;
+    unsigned long long hold_ns;
+    unsigned long long max_hold_ns;
+} lock_site_t;
+
+typedef void (*report_line_t)(void *ctx, const char *line);
+
+#ifdef LOCK_PROFILING
+#define LOCK(m)                                               \
+    do                                                        \
+    {                                                         \
+        static lock_site_t *lock_site_;                       \
+        lock_mutex((m), #m, __FILE__, __LINE__, &lock_site_); \
+    } while (0)
+#define UNLOCK(m) unlock_mutex(m)
+// Expression : 0 si le verrou est acquis, comme pthread_mutex_trylock
+#define TRYLOCK(m)                                               \
+    ({                                                           \
+        static lock_site_t *lock_site_;                          \
+        trylock_mutex((m), #m, __FILE__, __LINE__, &lock_site_); \
+    })
+#else
+#define LOCK(m) (trace_request != 0 ? trace_lock((m), #m) : pthread_mutex_lock(m))
+#define UNLOCK(m) pthread_mutex_unlock(m)
+#define TRYLOCK(m) pthread_mutex_trylock(m)
+#endif
+
+// Prototypes
+void lock_mutex(pthread_mutex_t *mutex, const char *expression, const char *file, int line, lock_site_t **site_cache);
+int trylock_mutex(pthread_mutex_t *mutex, const char *expression, const char *file, int line, lock_site_t **site_cache);
+void unlock_mutex(pthread_mutex_t *mutex);
+void lock_profiler_start();
+void lock_profiler_report(report_line_t emit, void *ctx);
+void lock_profiler_reset();
+int lock_profiler_enabled();
+
+#endif